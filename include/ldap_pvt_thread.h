@@ -107,6 +107,14 @@ ldap_pvt_thread_cond_wait LDAP_P((
 	ldap_pvt_thread_cond_t *cond,
 	ldap_pvt_thread_mutex_t *mutex ));
 
+/* Like cond_wait, but gives up after msec milliseconds; returns
+ * nonzero if it did */
+LDAP_F( int )
+ldap_pvt_thread_cond_timedwait LDAP_P((
+	ldap_pvt_thread_cond_t *cond,
+	ldap_pvt_thread_mutex_t *mutex,
+	int msec ));
+
 LDAP_F( int )
 ldap_pvt_thread_mutex_init LDAP_P(( ldap_pvt_thread_mutex_t *mutex ));
 
@@ -255,6 +263,16 @@ typedef enum {
 	LDAP_PVT_THREAD_POOL_PARAM_BACKLOAD_MAX,
 	LDAP_PVT_THREAD_POOL_PARAM_STATE
 } ldap_pvt_thread_pool_param_t;
+
+typedef struct ldap_pvt_thread_pool_qstat_s {
+	int qs_open;		/* threads */
+	int qs_active;		/* threads running a task */
+	int qs_pending;		/* tasks waiting */
+	unsigned long qs_tasks;		/* tasks taken off the queue */
+	unsigned long qs_stolen;	/* ...by threads of other queues */
+	unsigned long qs_wait_avg;	/* microseconds spent pending */
+	unsigned long qs_wait_max;
+} ldap_pvt_thread_pool_qstat_t;
 #endif /* !LDAP_PVT_THREAD_H_DONE */
 
 LDAP_F( int )
@@ -262,6 +280,12 @@ ldap_pvt_thread_pool_query LDAP_P((
 	ldap_pvt_thread_pool_t *pool,
 	ldap_pvt_thread_pool_param_t param, void *value ));
 
+LDAP_F( int )
+ldap_pvt_thread_pool_queue_stats LDAP_P((
+	ldap_pvt_thread_pool_t *pool,
+	int qnum,
+	ldap_pvt_thread_pool_qstat_t *stats ));
+
 LDAP_F( int )
 ldap_pvt_thread_pool_pausing LDAP_P((
 	ldap_pvt_thread_pool_t *pool ));
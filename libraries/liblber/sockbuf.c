@@ -574,7 +574,8 @@ Sockbuf_IO ber_sockbuf_io_tcp = {
 
 
 /*
- * Support for readahead (UDP needs it)
+ * Support for readahead (UDP needs it, slapd also uses it on TCP
+ * sessions so a small PDU is read with one call instead of two)
  */
 
 static int
@@ -638,6 +639,23 @@ sb_rdahead_read( Sockbuf_IO_Desc *sbiod, void *buf, ber_len_t len )
 
 	if ( len == 0 ) return bufptr;
 
+	/* The buffer is empty now. A request at least as large as the
+	 * buffer gains nothing from it, read straight into the caller's.
+	 */
+	if ( len >= p->buf_size ) {
+		for (;;) {
+			ret = LBER_SBIOD_READ_NEXT( sbiod, (char *) buf + bufptr, len );
+#ifdef EINTR
+			if ( ( ret < 0 ) && ( errno == EINTR ) ) continue;
+#endif
+			break;
+		}
+		if ( ret < 0 ) {
+			return ( bufptr ? bufptr : ret );
+		}
+		return bufptr + ret;
+	}
+
 	max = p->buf_size - p->buf_end;
 	ret = 0;
 	while ( max > 0 ) {
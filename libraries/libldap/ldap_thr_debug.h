@@ -82,6 +82,7 @@
 #define	ldap_pvt_thread_cond_signal		ldap_int_thread_cond_signal
 #define	ldap_pvt_thread_cond_broadcast	ldap_int_thread_cond_broadcast
 #define	ldap_pvt_thread_cond_wait		ldap_int_thread_cond_wait
+#define	ldap_pvt_thread_cond_timedwait	ldap_int_thread_cond_timedwait
 #define	ldap_pvt_thread_mutex_init		ldap_int_thread_mutex_init
 #define	ldap_pvt_thread_mutex_recursive_init		ldap_int_thread_mutex_recursive_init
 #define	ldap_pvt_thread_mutex_destroy	ldap_int_thread_mutex_destroy
@@ -156,6 +157,7 @@
 #undef	ldap_pvt_thread_cond_signal
 #undef	ldap_pvt_thread_cond_broadcast
 #undef	ldap_pvt_thread_cond_wait
+#undef	ldap_pvt_thread_cond_timedwait
 #undef	ldap_pvt_thread_mutex_init
 #undef	ldap_pvt_thread_mutex_recursive_init
 #undef	ldap_pvt_thread_mutex_destroy
@@ -959,6 +959,26 @@ ldap_pvt_thread_cond_wait(
 	return rc;
 }
 
+int
+ldap_pvt_thread_cond_timedwait(
+	ldap_pvt_thread_cond_t *cond,
+	ldap_pvt_thread_mutex_t *mutex,
+	int msec )
+{
+	int rc;
+	check_usage( &cond->usage, "ldap_pvt_thread_cond_timedwait:cond" );
+	check_usage( &mutex->usage, "ldap_pvt_thread_cond_timedwait:mutex" );
+	adjust_count( Idx_locked_mutex, -1 );
+	ASSERT_OWNER( mutex, "ldap_pvt_thread_cond_timedwait" );
+	RESET_OWNER( mutex );
+	rc = ldap_int_thread_cond_timedwait( WRAPPED( cond ), WRAPPED( mutex ), msec );
+	ASSERT_NO_OWNER( mutex, "ldap_pvt_thread_cond_timedwait" );
+	/* the mutex is held again even if the wait timed out */
+	SET_OWNER( mutex, ldap_int_thread_self() );
+	adjust_count( Idx_locked_mutex, +1 );
+	return rc;
+}
+
 int
 ldap_pvt_thread_mutex_recursive_init( ldap_pvt_thread_mutex_t *mutex )
 {
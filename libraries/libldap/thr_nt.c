@@ -157,6 +157,17 @@ ldap_pvt_thread_cond_wait( ldap_pvt_thread_cond_t *cond,
 	return( 0 );
 }
 
+int 
+ldap_pvt_thread_cond_timedwait( ldap_pvt_thread_cond_t *cond, 
+	ldap_pvt_thread_mutex_t *mutex, int msec )
+{
+	DWORD rc;
+
+	rc = SignalObjectAndWait( *mutex, *cond, msec, FALSE );
+	WaitForSingleObject( *mutex, INFINITE );
+	return( rc == WAIT_OBJECT_0 ? 0 : -1 );
+}
+
 int
 ldap_pvt_thread_cond_broadcast( ldap_pvt_thread_cond_t *cond )
 {
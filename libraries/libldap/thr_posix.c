@@ -30,8 +30,8 @@
 #ifndef HAVE_NANOSLEEP
 #include <ac/socket.h>
 #endif
-#include <ac/time.h>
 #endif
+#include <ac/time.h>
 
 #include "ldap_pvt_thread.h" /* Get the thread interface */
 #define LDAP_THREAD_IMPLEMENTATION
@@ -294,6 +294,23 @@ ldap_pvt_thread_cond_wait( ldap_pvt_thread_cond_t *cond,
 	return ERRVAL( pthread_cond_wait( cond, mutex ) );
 }
 
+int 
+ldap_pvt_thread_cond_timedwait( ldap_pvt_thread_cond_t *cond, 
+		      ldap_pvt_thread_mutex_t *mutex, int msec )
+{
+	struct timeval tv;
+	struct timespec ts;
+
+	gettimeofday( &tv, NULL );
+	ts.tv_sec = tv.tv_sec + msec / 1000;
+	ts.tv_nsec = ( tv.tv_usec + ( msec % 1000 ) * 1000L ) * 1000L;
+	if ( ts.tv_nsec >= 1000000000L ) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	return ERRVAL( pthread_cond_timedwait( cond, mutex, &ts ) );
+}
+
 int 
 ldap_pvt_thread_mutex_init( ldap_pvt_thread_mutex_t *mutex )
 {
@@ -117,6 +117,22 @@ ldap_pvt_thread_cond_wait( ldap_pvt_thread_cond_t *cond,
 	return( pth_cond_await( cond, mutex, NULL ) ? 0 : errno );
 }
 
+int 
+ldap_pvt_thread_cond_timedwait( ldap_pvt_thread_cond_t *cond, 
+	ldap_pvt_thread_mutex_t *mutex, int msec )
+{
+	pth_event_t ev;
+	int rc;
+
+	ev = pth_event( PTH_EVENT_TIME,
+		pth_timeout( msec / 1000, ( msec % 1000 ) * 1000 ));
+	rc = pth_cond_await( cond, mutex, ev ) ? 0 : errno;
+	if ( !rc && pth_event_status( ev ) == PTH_STATUS_OCCURRED )
+		rc = -1;
+	pth_event_free( ev, PTH_FREE_THIS );
+	return( rc );
+}
+
 int
 ldap_pvt_thread_cond_destroy( ldap_pvt_thread_cond_t *cv )
 {
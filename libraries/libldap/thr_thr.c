@@ -18,6 +18,8 @@
 
 #if defined( HAVE_THR )
 
+#include <ac/time.h>
+
 #include "ldap_pvt_thread.h" /* Get the thread interface */
 #define LDAP_THREAD_IMPLEMENTATION
 #include "ldap_thr_debug.h"	 /* May rename the symbols defined below */
@@ -117,6 +119,23 @@ ldap_pvt_thread_cond_wait( ldap_pvt_thread_cond_t *cond,
 	return( cond_wait( cond, mutex ) );
 }
 
+int 
+ldap_pvt_thread_cond_timedwait( ldap_pvt_thread_cond_t *cond, 
+	ldap_pvt_thread_mutex_t *mutex, int msec )
+{
+	struct timeval tv;
+	timestruc_t ts;
+
+	gettimeofday( &tv, NULL );
+	ts.tv_sec = tv.tv_sec + msec / 1000;
+	ts.tv_nsec = ( tv.tv_usec + ( msec % 1000 ) * 1000L ) * 1000L;
+	if ( ts.tv_nsec >= 1000000000L ) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	return( cond_timedwait( cond, mutex, &ts ) );
+}
+
 int
 ldap_pvt_thread_cond_destroy( ldap_pvt_thread_cond_t *cv )
 {
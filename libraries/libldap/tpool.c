@@ -94,6 +94,7 @@ typedef struct ldap_int_thread_task_s {
 	ldap_pvt_thread_start_t *ltt_start_routine;
 	void *ltt_arg;
 	struct ldap_int_thread_poolq_s *ltt_queue;
+	struct timeval ltt_queued;	/* when it was submitted */
 } ldap_int_thread_task_t;
 
 typedef LDAP_STAILQ_HEAD(tcq, ldap_int_thread_task_s) ldap_int_tpool_plist_t;
@@ -132,6 +133,12 @@ struct ldap_int_thread_poolq_s {
 	int ltp_active_count;		/* Active, not paused/idle tasks */
 	int ltp_open_count;			/* Number of threads */
 	int ltp_starting;			/* Currently starting threads */
+
+	/* Statistics, see ldap_pvt_thread_pool_queue_stats() */
+	unsigned long ltp_tasks;	/* tasks taken off this queue */
+	unsigned long ltp_stolen;	/* ...by threads of other queues */
+	unsigned long ltp_wait_usec;	/* their total time spent pending */
+	unsigned long ltp_wait_max;
 };
 
 struct ldap_int_thread_pool_s {
@@ -189,6 +196,8 @@ static LDAP_STAILQ_HEAD(tpq, ldap_int_thread_pool_s)
 static ldap_pvt_thread_mutex_t ldap_pvt_thread_pool_mutex;
 
 static void *ldap_int_thread_pool_wrapper( void *pool );
+static ldap_int_thread_task_t *ldap_int_thread_pool_steal(
+	struct ldap_int_thread_poolq_s *pq );
 
 static ldap_pvt_thread_key_t	ldap_tpool_key;
 
@@ -358,7 +367,7 @@ ldap_pvt_thread_pool_submit2 (
 	void **cookie )
 {
 	struct ldap_int_thread_pool_s *pool;
-	struct ldap_int_thread_poolq_s *pq;
+	struct ldap_int_thread_poolq_s *pq, *idleq = NULL;
 	ldap_int_thread_task_t *task;
 	ldap_pvt_thread_t thr;
 	int i, j;
@@ -416,6 +425,7 @@ ldap_pvt_thread_pool_submit2 (
 	task->ltt_start_routine = start_routine;
 	task->ltt_arg = arg;
 	task->ltt_queue = pq;
+	gettimeofday( &task->ltt_queued, NULL );
 	if ( cookie )
 		*cookie = task;
 
@@ -471,8 +481,31 @@ ldap_pvt_thread_pool_submit2 (
 	}
 	ldap_pvt_thread_cond_signal(&pq->ltp_cond);
 
+	/* No thread of this queue is free to take the task. Wake an
+	 * idle one of another queue to steal it instead; the counts
+	 * of other queues are only a hint here.
+	 */
+	if (pool->ltp_numqs > 1 &&
+		pq->ltp_active_count + pq->ltp_starting >= pq->ltp_open_count)
+	{
+		for (j = 1; j < pool->ltp_numqs; j++) {
+			struct ldap_int_thread_poolq_s *vq =
+				pool->ltp_wqs[(i + j) % pool->ltp_numqs];
+			if (vq->ltp_open_count > vq->ltp_active_count + vq->ltp_starting) {
+				idleq = vq;
+				break;
+			}
+		}
+	}
+
  done:
 	ldap_pvt_thread_mutex_unlock(&pq->ltp_mutex);
+	if (idleq) {
+		/* never hold two queue mutexes */
+		ldap_pvt_thread_mutex_lock(&idleq->ltp_mutex);
+		ldap_pvt_thread_cond_signal(&idleq->ltp_cond);
+		ldap_pvt_thread_mutex_unlock(&idleq->ltp_mutex);
+	}
 	return(0);
 
  failed:
@@ -778,6 +811,40 @@ ldap_pvt_thread_pool_query(
 	return ( count == -1 ? -1 : 0 );
 }
 
+/* Statistics of one work queue. Returns -1 if there's no such queue */
+int
+ldap_pvt_thread_pool_queue_stats(
+	ldap_pvt_thread_pool_t *tpool,
+	int qnum,
+	ldap_pvt_thread_pool_qstat_t *qs )
+{
+	struct ldap_int_thread_pool_s *pool;
+	struct ldap_int_thread_poolq_s *pq;
+
+	if ( tpool == NULL || qs == NULL )
+		return -1;
+
+	pool = *tpool;
+
+	if ( pool == NULL || qnum < 0 || qnum >= pool->ltp_numqs )
+		return -1;
+
+	pq = pool->ltp_wqs[qnum];
+	ldap_pvt_thread_mutex_lock(&pq->ltp_mutex);
+	qs->qs_open = pq->ltp_open_count;
+	qs->qs_active = pq->ltp_active_count;
+	qs->qs_pending = pq->ltp_pending_count;
+	if ( qs->qs_pending < 0 )
+		qs->qs_pending = -qs->qs_pending;
+	qs->qs_tasks = pq->ltp_tasks;
+	qs->qs_stolen = pq->ltp_stolen;
+	qs->qs_wait_avg = pq->ltp_tasks ? pq->ltp_wait_usec / pq->ltp_tasks : 0;
+	qs->qs_wait_max = pq->ltp_wait_max;
+	ldap_pvt_thread_mutex_unlock(&pq->ltp_mutex);
+
+	return 0;
+}
+
 /*
  * true if pool is pausing; does not lock any mutex to check.
  * 0 if not pause, 1 if pause, -1 if error or no pool.
@@ -938,6 +1005,70 @@ ldap_pvt_thread_pool_free ( ldap_pvt_thread_pool_t *tpool )
 	return(0);
 }
 
+/* Account for a task taken off pq, which must be locked */
+static void
+ldap_int_thread_pool_dequeued (
+	struct ldap_int_thread_poolq_s *pq,
+	ldap_int_thread_task_t *task )
+{
+	struct timeval now;
+	long wait;
+
+	gettimeofday( &now, NULL );
+	wait = ( now.tv_sec - task->ltt_queued.tv_sec ) * 1000000L +
+		( now.tv_usec - task->ltt_queued.tv_usec );
+	if ( wait < 0 )		/* the clock was set back */
+		wait = 0;
+	pq->ltp_tasks++;
+	pq->ltp_wait_usec += wait;
+	if ( pq->ltp_wait_max < (unsigned long)wait )
+		pq->ltp_wait_max = wait;
+}
+
+/* Take the oldest pending task of another queue for a thread of pq
+ * that has nothing to do. pq is locked, so the other queues are only
+ * tried, to avoid lock order problems; a busy queue has threads of
+ * its own about to look at it anyway.
+ */
+static ldap_int_thread_task_t *
+ldap_int_thread_pool_steal (
+	struct ldap_int_thread_poolq_s *pq )
+{
+	struct ldap_int_thread_pool_s *pool = pq->ltp_pool;
+	struct ldap_int_thread_poolq_s *vq;
+	ldap_int_thread_task_t *task = NULL;
+	int i, j, numqs = pool->ltp_numqs;
+
+	/* A pause hides the pending lists, and our own queue may
+	 * have been counted as inactive already.
+	 */
+	if (numqs < 2 || pool->ltp_pause || pool->ltp_finishing)
+		return NULL;
+
+	for (i=0; i<numqs; i++)
+		if (pool->ltp_wqs[i] == pq) break;
+	if (i == numqs)		/* retired by pool_queues() */
+		return NULL;
+
+	for (j = 1; j < numqs && task == NULL; j++) {
+		vq = pool->ltp_wqs[(i + j) % numqs];
+		/* unlocked peek, checked again below */
+		if (LDAP_STAILQ_EMPTY(vq->ltp_work_list))
+			continue;
+		if (ldap_pvt_thread_mutex_trylock(&vq->ltp_mutex))
+			continue;
+		task = LDAP_STAILQ_FIRST(vq->ltp_work_list);
+		if (task) {
+			LDAP_STAILQ_REMOVE_HEAD(vq->ltp_work_list, ltt_next.q);
+			vq->ltp_pending_count--;
+			vq->ltp_stolen++;
+			ldap_int_thread_pool_dequeued(vq, task);
+		}
+		ldap_pvt_thread_mutex_unlock(&vq->ltp_mutex);
+	}
+	return task;
+}
+
 /* Thread loop.  Accept and handle submitted tasks. */
 static void *
 ldap_int_thread_pool_wrapper ( 
@@ -949,7 +1080,7 @@ ldap_int_thread_pool_wrapper (
 	ldap_int_tpool_plist_t *work_list;
 	ldap_int_thread_userctx_t ctx, *kctx;
 	unsigned i, keyslot, hash;
-	int pool_lock = 0, freeme = 0;
+	int pool_lock = 0, freeme = 0, stolen;
 
 	assert(pool != NULL);
 
@@ -989,6 +1120,9 @@ ldap_int_thread_pool_wrapper (
 	for (;;) {
 		work_list = pq->ltp_work_list; /* help the compiler a bit */
 		task = LDAP_STAILQ_FIRST(work_list);
+		stolen = 0;
+		if (task == NULL && (task = ldap_int_thread_pool_steal(pq)) != NULL)
+			stolen = 1;
 		if (task == NULL) {	/* paused or no pending tasks */
 			if (--(pq->ltp_active_count) < 1) {
 				if (pool->ltp_pause) {
@@ -1034,6 +1168,9 @@ ldap_int_thread_pool_wrapper (
 
 				work_list = pq->ltp_work_list;
 				task = LDAP_STAILQ_FIRST(work_list);
+				if (task == NULL && !pool_lock &&
+					(task = ldap_int_thread_pool_steal(pq)) != NULL)
+					stolen = 1;
 			} while (task == NULL);
 
 			if (pool_lock) {
@@ -1044,8 +1181,11 @@ ldap_int_thread_pool_wrapper (
 			pq->ltp_active_count++;
 		}
 
-		LDAP_STAILQ_REMOVE_HEAD(work_list, ltt_next.q);
-		pq->ltp_pending_count--;
+		if (!stolen) {
+			LDAP_STAILQ_REMOVE_HEAD(work_list, ltt_next.q);
+			pq->ltp_pending_count--;
+			ldap_int_thread_pool_dequeued(pq, task);
+		}
 		ldap_pvt_thread_mutex_unlock(&pq->ltp_mutex);
 
 		task->ltt_start_routine(&ctx, task->ltt_arg);
@@ -705,6 +705,103 @@ int  mdb_env_copy2(MDB_env *env, const char *path, unsigned int flags);
 	 */
 int  mdb_env_copyfd2(MDB_env *env, mdb_filehandle_t fd, unsigned int flags);
 
+	/** @brief Copy an LMDB environment to the specified path, compacting
+	 *	named databases in parallel.
+	 *
+	 * Like #mdb_env_copy2(), but with #MDB_CP_COMPACT up to \b nthreads
+	 * threads walk and write different named databases at the same time.
+	 * Each named database is stored contiguously in the copy, following
+	 * the main database. The threads are only used if the environment
+	 * has at least two named databases; otherwise, or with \b nthreads
+	 * less than 2, the copy is the same as with #mdb_env_copy2().
+	 * @param[in] env An environment handle returned by #mdb_env_create(). It
+	 * must have already been opened successfully.
+	 * @param[in] path The directory in which the copy will reside. This
+	 * directory must already exist and be writable but must otherwise be
+	 * empty.
+	 * @param[in] flags Special options for this operation.
+	 * See #mdb_env_copy2() for options.
+	 * @param[in] nthreads The number of threads to compact with.
+	 * @return A non-zero error value on failure and 0 on success.
+	 */
+int  mdb_env_copy3(MDB_env *env, const char *path, unsigned int flags,
+	unsigned int nthreads);
+
+	/** @brief Copy an LMDB environment to the specified file descriptor,
+	 *	compacting named databases in parallel.
+	 *
+	 * See #mdb_env_copy3() for details. The threads write at their own
+	 * offsets in the file, so they are only used if \b fd refers to a
+	 * regular file; the copy is serial otherwise.
+	 * @param[in] env An environment handle returned by #mdb_env_create(). It
+	 * must have already been opened successfully.
+	 * @param[in] fd The filedescriptor to write the copy to. It must
+	 * have already been opened for Write access.
+	 * @param[in] flags Special options for this operation.
+	 * See #mdb_env_copy2() for options.
+	 * @param[in] nthreads The number of threads to compact with.
+	 * @return A non-zero error value on failure and 0 on success.
+	 */
+int  mdb_env_copyfd3(MDB_env *env, mdb_filehandle_t fd, unsigned int flags,
+	unsigned int nthreads);
+
+	/** @brief Copy the pages of an LMDB environment that changed since
+	 *	an earlier copy.
+	 *
+	 * This function may be used to make incremental backups of an existing
+	 * environment. Every page is compared with a page map written by an
+	 * earlier call, and only the pages that differ are written to the delta.
+	 * The page map records a checksum of every page in use; free pages are
+	 * neither compared nor copied. Applying the delta with
+	 * #mdb_env_applydelta() to a copy that matches the earlier page map
+	 * turns it into a copy of the environment as of this call.
+	 * @note This call reads every page in use. It can trigger significant
+	 * file size growth if run in parallel with write transactions, because
+	 * it employs a read-only transaction. See long-lived transactions under
+	 * @ref caveats_sec.
+	 * @param[in] env An environment handle returned by #mdb_env_create(). It
+	 * must have already been opened successfully.
+	 * @param[in] mapfd The page map of the earlier copy, opened for Read
+	 * access, or -1 to copy every page in use, for a delta that applies to
+	 * a newly created environment.
+	 * @param[in] newmapfd The filedescriptor to write the page map of this
+	 * copy to. It must have already been opened for Write access.
+	 * @param[in] fd The filedescriptor to write the delta to. It must have
+	 * already been opened for Write access.
+	 * @return A non-zero error value on failure and 0 on success. Some
+	 * possible errors are:
+	 * <ul>
+	 *	<li>#MDB_INVALID - mapfd is not a page map.
+	 *	<li>#MDB_INCOMPATIBLE - the page map is not one of this environment.
+	 * </ul>
+	 */
+int  mdb_env_copydelta(MDB_env *env, mdb_filehandle_t mapfd,
+	mdb_filehandle_t newmapfd, mdb_filehandle_t fd);
+
+	/** @brief Apply a delta written by #mdb_env_copydelta() to an environment.
+	 *
+	 * The environment must be a copy that matches the page map the delta
+	 * was made from: a copy made with #mdb_env_copy() without
+	 * #MDB_CP_COMPACT, or by applying earlier deltas, or, if the delta was
+	 * made without a page map, a newly created environment. The meta pages
+	 * are written last, once the data pages are flushed. If this call is
+	 * interrupted, the environment is unusable until the same delta has
+	 * been applied again. No other process or thread may use the
+	 * environment meanwhile.
+	 * @param[in] env An environment handle returned by #mdb_env_create(). It
+	 * must have already been opened successfully, and not with #MDB_RDONLY.
+	 * @param[in] fd The filedescriptor to read the delta from. It must
+	 * have already been opened for Read access.
+	 * @return A non-zero error value on failure and 0 on success. Some
+	 * possible errors are:
+	 * <ul>
+	 *	<li>#MDB_INVALID - fd is not a delta, or the delta is truncated.
+	 *	<li>#MDB_INCOMPATIBLE - the delta does not apply to the environment
+	 *		as it is.
+	 * </ul>
+	 */
+int  mdb_env_applydelta(MDB_env *env, mdb_filehandle_t fd);
+
 	/** @brief Return statistics about the LMDB environment.
 	 *
 	 * @param[in] env An environment handle returned by #mdb_env_create()
@@ -1250,6 +1250,10 @@ typedef struct MDB_xcursor {
 typedef struct MDB_pgstate {
 	pgno_t		*mf_pghead;	/**< Reclaimed freeDB pages, or NULL before use */
 	txnid_t		mf_pglast;	/**< ID of last used record, or 0 if !mf_pghead */
+	/** No run of contiguous pages in mf_pghead is longer than this.
+	 *	Spares #mdb_page_alloc() scans which cannot find a long enough run.
+	 */
+	pgno_t		mf_pgmaxrun;
 } MDB_pgstate;
 
 	/** The database environment. */
@@ -1292,6 +1296,7 @@ struct MDB_env {
 	MDB_pgstate	me_pgstate;		/**< state of old pages from freeDB */
 #	define		me_pglast	me_pgstate.mf_pglast
 #	define		me_pghead	me_pgstate.mf_pghead
+#	define		me_pgmaxrun	me_pgstate.mf_pgmaxrun
 	MDB_page	*me_dpages;		/**< list of malloc'd blocks for re-use */
 	/** IDL of pages that became unused in a write txn */
 	MDB_IDL		me_free_pgs;
@@ -2131,6 +2136,151 @@ mdb_page_dirty(MDB_txn *txn, MDB_page *mp)
 	txn->mt_dirty_room--;
 }
 
+/** Pages of the freeDB records read by one #mdb_page_alloc() call
+ * looking for a run of pages. They are kept apart from me_pghead, in
+ * the order read, along with a hash set of them for quick lookups,
+ * and only sorted and merged into me_pghead at the end.
+ */
+typedef struct MDB_pgpend {
+	MDB_IDL		pp_list;	/**< The pages, unsorted */
+	pgno_t		*pp_hash;	/**< Open addressing, 0 for empty slots */
+	unsigned	pp_mask;	/**< Number of slots - 1 */
+} MDB_pgpend;
+
+static unsigned
+mdb_pgpend_slot(MDB_pgpend *pp, pgno_t pgno)
+{
+	pgno_t h = pgno;
+
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	return (unsigned)h & pp->pp_mask;
+}
+
+static void
+mdb_pgpend_insert(MDB_pgpend *pp, pgno_t pgno)
+{
+	unsigned x = mdb_pgpend_slot(pp, pgno);
+
+	while (pp->pp_hash[x])
+		x = (x+1) & pp->pp_mask;
+	pp->pp_hash[x] = pgno;
+}
+
+/** Add the pages of a freeDB record. */
+static int
+mdb_pgpend_add(MDB_pgpend *pp, MDB_IDL idl)
+{
+	unsigned i, n = pp->pp_list ? pp->pp_list[0] : 0, len = idl[0];
+	size_t size;
+	int rc;
+
+	if (!pp->pp_list) {
+		if (!(pp->pp_list = mdb_midl_alloc(len)))
+			return ENOMEM;
+	} else {
+		if ((rc = mdb_midl_need(&pp->pp_list, len)) != 0)
+			return rc;
+	}
+	memcpy(pp->pp_list + n + 1, idl + 1, len * sizeof(pgno_t));
+	pp->pp_list[0] = n += len;
+
+	if (2*n > pp->pp_mask) {
+		/* Keep the hash at most half full */
+		for (size = 1024; size < 4*(size_t)n; size <<= 1) ;
+		free(pp->pp_hash);
+		if (!(pp->pp_hash = calloc(size, sizeof(pgno_t))))
+			return ENOMEM;
+		pp->pp_mask = size-1;
+		for (i=1; i<=n; i++)
+			mdb_pgpend_insert(pp, pp->pp_list[i]);
+	} else {
+		for (i=1; i<=len; i++)
+			mdb_pgpend_insert(pp, idl[i]);
+	}
+	return MDB_SUCCESS;
+}
+
+/** Tell if a page is free: in me_pghead, or in the records read. */
+static int
+mdb_pgpend_isfree(MDB_pgpend *pp, MDB_IDL mop, pgno_t pgno)
+{
+	unsigned x = mdb_pgpend_slot(pp, pgno);
+
+	for (; pp->pp_hash[x]; x = (x+1) & pp->pp_mask)
+		if (pp->pp_hash[x] == pgno)
+			return 1;
+	if (mop) {
+		x = mdb_midl_search(mop, pgno);
+		return x <= mop[0] && mop[x] == pgno;
+	}
+	return 0;
+}
+
+/** Look for a run of contiguous free pages that includes a page of a
+ * freeDB record just read. There was no such run before the record was
+ * read, so only the neighbors of its pages need to be looked at, rather
+ * than all of me_pghead.
+ * @param[in] pp the records read, including this one.
+ * @param[in] mop me_pghead, or NULL.
+ * @param[in] idl the pages of the record.
+ * @param[in] num the length of the run wanted.
+ * @param[out] pgno the first page of the run, if one was found.
+ * @param[in,out] maxrun raised to the length of any shorter run seen.
+ * @return 1 if a run was found, 0 otherwise.
+ */
+static int
+mdb_pgpend_search(MDB_pgpend *pp, MDB_IDL mop, MDB_IDL idl, int num,
+	pgno_t *pgno, pgno_t *maxrun)
+{
+	pgno_t p, lo, hi = 0, n2 = num-1;
+	unsigned i;
+
+	/* Start from the lowest page, to prefer pages at the tail */
+	for (i = idl[0]; i; i--) {
+		p = idl[i];
+		if (p <= hi)
+			continue;		/* part of the last run looked at */
+		for (hi = p; hi - p < n2 && mdb_pgpend_isfree(pp, mop, hi+1); hi++) ;
+		for (lo = p; hi - lo < n2 && mdb_pgpend_isfree(pp, mop, lo-1); lo--) ;
+		if (hi - lo >= n2) {
+			*pgno = lo;
+			return 1;
+		}
+		if (hi - lo + 1 > *maxrun)
+			*maxrun = hi - lo + 1;
+	}
+	return 0;
+}
+
+/** Merge the pages of the records read into me_pghead.
+ * @param[in] env the environment.
+ * @param[in] pp the records read. Their list is freed or becomes me_pghead.
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_pgpend_merge(MDB_env *env, MDB_pgpend *pp)
+{
+	MDB_IDL pend = pp->pp_list;
+	int rc = MDB_SUCCESS;
+
+	free(pp->pp_hash);
+	pp->pp_hash = NULL;
+	pp->pp_list = NULL;
+	if (!pend)
+		return rc;
+	mdb_midl_sort(pend);
+	if (!env->me_pghead) {
+		env->me_pghead = pend;
+		return rc;
+	}
+	if ((rc = mdb_midl_need(&env->me_pghead, pend[0])) == 0)
+		mdb_midl_xmerge(env->me_pghead, pend);
+	mdb_midl_free(pend);
+	return rc;
+}
+
 /** Allocate page numbers and memory for writing.  Maintain me_pglast,
  * me_pghead and mt_next_pgno.  Set #MDB_TXN_ERROR on failure.
  *
@@ -2139,6 +2289,12 @@ mdb_page_dirty(MDB_txn *txn, MDB_page *mp)
  * Do not modify the freedB, just merge freeDB records into me_pghead[]
  * and move me_pglast to say which records were consumed.  Only this
  * function can create me_pghead and move me_pglast/mt_next_pgno.
+ *
+ * A run of several pages is first sought in me_pghead, unless
+ * me_pgmaxrun tells it is too short. Records read from the freeDB
+ * while looking for one are merged apart, and only the runs around
+ * their pages are checked; me_pghead, which can get much longer on
+ * fragmented environments, is merged with them once at the end.
  * @param[in] mc cursor A cursor handle identifying the transaction and
  *	database for which we are allocating.
  * @param[in] num the number of pages to allocate.
@@ -2165,6 +2321,7 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 	MDB_env *env = txn->mt_env;
 	pgno_t pgno, *mop = env->me_pghead;
 	unsigned i, j, mop_len = mop ? mop[0] : 0, n2 = num-1;
+	MDB_pgpend pp = {0};
 	MDB_page *np;
 	txnid_t oldest = 0, last;
 	MDB_cursor_op op;
@@ -2193,18 +2350,37 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 	for (op = MDB_FIRST;; op = MDB_NEXT) {
 		MDB_val key, data;
 		MDB_node *leaf;
-		pgno_t *idl;
+		MDB_IDL idl;
 
 		/* Seek a big enough contiguous page range. Prefer
 		 * pages at the tail, just truncating the list.
+		 * Once records are read, they are searched as they come.
 		 */
-		if (mop_len > n2) {
-			i = mop_len;
-			do {
+		if (mop_len > n2 && !pp.pp_list) {
+			if (!n2) {
+				i = mop_len;
 				pgno = mop[i];
-				if (mop[i-n2] == pgno+n2)
-					goto search_done;
-			} while (--i > n2);
+				goto search_done;
+			}
+			if (env->me_pgmaxrun > n2) {
+				pgno_t run = 1, maxrun = 1;
+				for (i = mop_len; --i; ) {
+					if (mop[i] == mop[i+1]+1) {
+						if (++run > n2) {
+							i += n2;
+							pgno = mop[i];
+							goto search_done;
+						}
+					} else {
+						if (run > maxrun)
+							maxrun = run;
+						run = 1;
+					}
+				}
+				if (run > maxrun)
+					maxrun = run;
+				env->me_pgmaxrun = maxrun;
+			}
 			if (--retry < 0)
 				break;
 		}
@@ -2222,7 +2398,7 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 			if (Paranoid && mc->mc_dbi == FREE_DBI)
 				retry = -1;
 		}
-		if (Paranoid && retry < 0 && mop_len)
+		if (Paranoid && retry < 0 && (mop_len || pp.pp_list))
 			break;
 
 		last++;
@@ -2259,7 +2435,11 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 
 		idl = (MDB_ID *) data.mv_data;
 		i = idl[0];
-		if (!mop) {
+		if (n2) {
+			/* Keep it apart from me_pghead until done */
+			if ((rc = mdb_pgpend_add(&pp, idl)) != 0)
+				goto fail;
+		} else if (!mop) {
 			if (!(env->me_pghead = mop = mdb_midl_alloc(i))) {
 				rc = ENOMEM;
 				goto fail;
@@ -2276,11 +2456,32 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		for (j = i; j; j--)
 			DPRINTF(("IDL %"Z"u", idl[j]));
 #endif
-		/* Merge in descending sorted order */
-		mdb_midl_xmerge(mop, idl);
-		mop_len = mop[0];
+		if (n2) {
+			if (mdb_pgpend_search(&pp, mop, idl, num, &pgno,
+				&env->me_pgmaxrun)) {
+				if ((rc = mdb_pgpend_merge(env, &pp)) != 0)
+					goto fail;
+				mop = env->me_pghead;
+				mop_len = mop[0];
+				i = mdb_midl_search(mop, pgno);
+				/* What is left of the run may still be long */
+				env->me_pgmaxrun = ~(pgno_t)0;
+				goto search_done;
+			}
+			if (mop_len + pp.pp_list[0] > n2 && --retry < 0)
+				break;
+		} else {
+			/* Merge in descending sorted order */
+			mdb_midl_xmerge(mop, idl);
+			mop_len = mop[0];
+			env->me_pgmaxrun = ~(pgno_t)0;
+		}
 	}
 
+	if ((rc = mdb_pgpend_merge(env, &pp)) != 0)
+		goto fail;
+	mop = env->me_pghead;
+
 	/* Use new pages from the map when nothing suitable in the freeDB */
 	i = 0;
 	pgno = txn->mt_next_pgno;
@@ -2314,6 +2515,8 @@ search_done:
 	return MDB_SUCCESS;
 
 fail:
+	free(pp.pp_hash);
+	mdb_midl_free(pp.pp_list);
 	txn->mt_flags |= MDB_TXN_ERROR;
 	return rc;
 }
@@ -3018,6 +3221,7 @@ mdb_txn_end(MDB_txn *txn, unsigned mode)
 			/* me_pgstate: */
 			env->me_pghead = NULL;
 			env->me_pglast = 0;
+			env->me_pgmaxrun = 0;
 
 			env->me_txn = NULL;
 			mode = 0;	/* txn == env->me_txn0, do not free() it */
@@ -3254,6 +3458,7 @@ mdb_freelist_save(MDB_txn *txn)
 		loose[0] = count;
 		mdb_midl_sort(loose);
 		mdb_midl_xmerge(mop, loose);
+		env->me_pgmaxrun = ~(pgno_t)0;
 		txn->mt_loose_pgs = NULL;
 		txn->mt_loose_count = 0;
 		mop_len = mop[0];
@@ -5750,6 +5955,7 @@ release:
 		while (j>i)
 			mop[j--] = pg++;
 		mop[0] += ovpages;
+		env->me_pgmaxrun = ~(pgno_t)0;
 	} else {
 		rc = mdb_midl_append_range(&txn->mt_free_pgs, pg, ovpages);
 		if (rc)
@@ -9048,6 +9254,13 @@ mdb_put(MDB_txn *txn, MDB_dbi dbi,
 #endif
 #define MDB_EOF		0x10	/**< #mdb_env_copyfd1() is done reading */
 
+	/** A named DB in a parallel compacting copy. */
+typedef struct mdb_cdb {
+	MDB_db cd_db;			/**< Its record, with the new root once copied */
+	pgno_t cd_base;			/**< First page of its copy */
+	pgno_t cd_count;		/**< Number of pages it uses */
+} mdb_cdb;
+
 	/** State needed for a double-buffering compacting copy. */
 typedef struct mdb_copy {
 	MDB_env *mc_env;
@@ -9062,6 +9275,14 @@ typedef struct mdb_copy {
 	HANDLE mc_fd;
 	int mc_toggle;			/**< Buffer number in provider */
 	int mc_new;				/**< (0-2 buffers to write) | (#MDB_EOF at end) */
+	int mc_pwrite;			/**< Write at #mc_wpos, not at the file offset */
+	off_t mc_wpos;			/**< Output offset of the next write */
+	/** Named DBs already copied by #mdb_env_cpar(), in main DB order.
+	 *	The walk of the main DB takes their records from here.
+	 */
+	mdb_cdb *mc_subdbs;
+	unsigned mc_nsubdbs;
+	unsigned mc_nsub;		/**< Next record of #mc_subdbs to use */
 	/** Error code.  Never cleared if set.  Both threads can set nonzero
 	 *	to fail the copy.  Not mutex-protected, LMDB expects atomic int.
 	 */
@@ -9077,10 +9298,16 @@ mdb_env_copythr(void *arg)
 	int toggle = 0, wsize, rc;
 #ifdef _WIN32
 	DWORD len;
-#define DO_WRITE(rc, fd, ptr, w2, len)	rc = WriteFile(fd, ptr, w2, &len, NULL)
+	OVERLAPPED ov;
+#define DO_WRITE(rc, fd, ptr, w2, len)	\
+	memset(&ov, 0, sizeof(ov)); \
+	ov.Offset = my->mc_wpos & 0xffffffff; \
+	ov.OffsetHigh = my->mc_wpos >> 16 >> 16; \
+	rc = WriteFile(fd, ptr, w2, &len, my->mc_pwrite ? &ov : NULL)
 #else
 	int len;
-#define DO_WRITE(rc, fd, ptr, w2, len)	len = write(fd, ptr, w2); rc = (len >= 0)
+#define DO_WRITE(rc, fd, ptr, w2, len)	len = my->mc_pwrite ? \
+	pwrite(fd, ptr, w2, my->mc_wpos) : write(fd, ptr, w2); rc = (len >= 0)
 #ifdef SIGPIPE
 	sigset_t set;
 	sigemptyset(&set);
@@ -9118,6 +9345,7 @@ again:
 				rc = MDB_SUCCESS;
 				ptr += len;
 				wsize -= len;
+				my->mc_wpos += len;
 				continue;
 			} else {
 				rc = EIO;
@@ -9266,12 +9494,21 @@ mdb_env_cwalk(mdb_copy *my, pgno_t *pg, int flags)
 							ni = NODEPTR(mp, i);
 						}
 
-						memcpy(&db, NODEDATA(ni), sizeof(db));
-						my->mc_toggle = toggle;
-						rc = mdb_env_cwalk(my, &db.md_root, ni->mn_flags & F_DUPDATA);
-						if (rc)
-							goto done;
-						toggle = my->mc_toggle;
+						if (my->mc_subdbs && !(ni->mn_flags & F_DUPDATA)) {
+							/* A named DB, copied already */
+							if (my->mc_nsub >= my->mc_nsubdbs) {
+								rc = MDB_INCOMPATIBLE;
+								goto done;
+							}
+							db = my->mc_subdbs[my->mc_nsub++].cd_db;
+						} else {
+							memcpy(&db, NODEDATA(ni), sizeof(db));
+							my->mc_toggle = toggle;
+							rc = mdb_env_cwalk(my, &db.md_root, ni->mn_flags & F_DUPDATA);
+							if (rc)
+								goto done;
+							toggle = my->mc_toggle;
+						}
 						memcpy(NODEDATA(ni), &db, sizeof(db));
 					}
 				}
@@ -9326,54 +9563,368 @@ done:
 	return rc;
 }
 
-	/** Copy environment with compaction. */
+	/** Set up the buffers and locks of a compacting copy. */
 static int ESECT
-mdb_env_copyfd1(MDB_env *env, HANDLE fd)
+mdb_env_cinit(MDB_env *env, mdb_copy *my)
 {
-	MDB_meta *mm;
-	MDB_page *mp;
-	mdb_copy my = {0};
-	MDB_txn *txn = NULL;
-	pthread_t thr;
-	pgno_t root, new_root;
-	int rc = MDB_SUCCESS;
+	int rc;
 
 #ifdef _WIN32
-	if (!(my.mc_mutex = CreateMutex(NULL, FALSE, NULL)) ||
-		!(my.mc_cond = CreateEvent(NULL, FALSE, FALSE, NULL))) {
+	if (!(my->mc_mutex = CreateMutex(NULL, FALSE, NULL)) ||
+		!(my->mc_cond = CreateEvent(NULL, FALSE, FALSE, NULL))) {
 		rc = ErrCode();
-		goto done;
+		goto fail;
 	}
-	my.mc_wbuf[0] = _aligned_malloc(MDB_WBUF*2, env->me_os_psize);
-	if (my.mc_wbuf[0] == NULL) {
+	my->mc_wbuf[0] = _aligned_malloc(MDB_WBUF*2, env->me_os_psize);
+	if (my->mc_wbuf[0] == NULL) {
 		/* _aligned_malloc() sets errno, but we use Windows error codes */
 		rc = ERROR_NOT_ENOUGH_MEMORY;
-		goto done;
+		goto fail;
 	}
 #else
-	if ((rc = pthread_mutex_init(&my.mc_mutex, NULL)) != 0)
+	if ((rc = pthread_mutex_init(&my->mc_mutex, NULL)) != 0)
 		return rc;
-	if ((rc = pthread_cond_init(&my.mc_cond, NULL)) != 0)
-		goto done2;
+	if ((rc = pthread_cond_init(&my->mc_cond, NULL)) != 0)
+		goto fail2;
 #ifdef HAVE_MEMALIGN
-	my.mc_wbuf[0] = memalign(env->me_os_psize, MDB_WBUF*2);
-	if (my.mc_wbuf[0] == NULL) {
+	my->mc_wbuf[0] = memalign(env->me_os_psize, MDB_WBUF*2);
+	if (my->mc_wbuf[0] == NULL) {
 		rc = errno;
-		goto done;
+		goto fail;
 	}
 #else
 	{
 		void *p;
 		if ((rc = posix_memalign(&p, env->me_os_psize, MDB_WBUF*2)) != 0)
-			goto done;
-		my.mc_wbuf[0] = p;
+			goto fail;
+		my->mc_wbuf[0] = p;
+	}
+#endif
+#endif
+	memset(my->mc_wbuf[0], 0, MDB_WBUF*2);
+	my->mc_wbuf[1] = my->mc_wbuf[0] + MDB_WBUF;
+	my->mc_env = env;
+	return MDB_SUCCESS;
+
+fail:
+#ifdef _WIN32
+	if (my->mc_cond)  CloseHandle(my->mc_cond);
+	if (my->mc_mutex) CloseHandle(my->mc_mutex);
+#else
+	pthread_cond_destroy(&my->mc_cond);
+fail2:
+	pthread_mutex_destroy(&my->mc_mutex);
+#endif
+	return rc;
+}
+
+	/** Release what #mdb_env_cinit() set up. */
+static void ESECT
+mdb_env_cfree(mdb_copy *my)
+{
+#ifdef _WIN32
+	_aligned_free(my->mc_wbuf[0]);
+	CloseHandle(my->mc_cond);
+	CloseHandle(my->mc_mutex);
+#else
+	free(my->mc_wbuf[0]);
+	pthread_cond_destroy(&my->mc_cond);
+	pthread_mutex_destroy(&my->mc_mutex);
+#endif
+}
+
+	/** State shared by the threads of a parallel compacting copy. */
+typedef struct mdb_cpar {
+	MDB_env *cp_env;
+	MDB_txn *cp_txn;
+	HANDLE cp_fd;
+	off_t cp_start;			/**< Output offset of page 0 */
+	pthread_mutex_t cp_mutex;	/**< Protects #cp_next */
+	mdb_cdb *cp_dbs;		/**< Named DBs, in main DB order */
+	mdb_cdb **cp_order;		/**< Named DBs, largest first */
+	unsigned cp_ndbs;
+	unsigned cp_next;		/**< Next of #cp_order to take */
+	int cp_copying;			/**< Copy the named DBs, rather than count their pages */
+	volatile int cp_error;
+} mdb_cpar;
+
+	/** Count the pages of a named DB, including those of its
+	 *	sorted-duplicate sub-DBs, which its record leaves out.
+	 */
+static int ESECT
+mdb_env_ccount(MDB_txn *txn, mdb_cdb *cd)
+{
+	MDB_cursor mc = {0};
+	MDB_db *db = &cd->cd_db;
+	MDB_page *mp;
+	MDB_node *ni;
+	MDB_db sub;
+	unsigned i;
+	int rc;
+
+	cd->cd_count = db->md_branch_pages + db->md_leaf_pages +
+		db->md_overflow_pages;
+	if (db->md_root == P_INVALID || !(db->md_flags & MDB_DUPSORT))
+		return MDB_SUCCESS;
+
+	mc.mc_snum = 1;
+	mc.mc_txn = txn;
+	rc = mdb_page_get(&mc, db->md_root, &mc.mc_pg[0], NULL);
+	if (rc == MDB_SUCCESS)
+		rc = mdb_page_search_root(&mc, NULL, MDB_PS_FIRST);
+	for (; rc == MDB_SUCCESS; rc = mdb_cursor_sibling(&mc, 1)) {
+		mp = mc.mc_pg[mc.mc_top];
+		for (i=0; i<NUMKEYS(mp); i++) {
+			ni = NODEPTR(mp, i);
+			if (ni->mn_flags & F_SUBDATA) {
+				memcpy(&sub, NODEDATA(ni), sizeof(sub));
+				cd->cd_count += sub.md_branch_pages + sub.md_leaf_pages +
+					sub.md_overflow_pages;
+			}
+		}
+	}
+	return rc == MDB_NOTFOUND ? MDB_SUCCESS : rc;
+}
+
+	/** Compact a named DB into its own range of pages. */
+static int ESECT
+mdb_env_cdb(mdb_copy *my, mdb_cdb *cd, off_t start)
+{
+	pthread_t thr;
+	int rc;
+
+	my->mc_next_pgno = cd->cd_base;
+	my->mc_wpos = start + (off_t)cd->cd_base * my->mc_env->me_psize;
+	my->mc_toggle = 0;
+	my->mc_new = 0;
+	my->mc_wlen[0] = my->mc_wlen[1] = 0;
+	rc = THREAD_CREATE(thr, mdb_env_copythr, my);
+	if (rc)
+		return rc;
+	rc = mdb_env_cwalk(my, &cd->cd_db.md_root, 0);
+	if (rc == MDB_SUCCESS && my->mc_next_pgno != cd->cd_base + cd->cd_count)
+		rc = MDB_INCOMPATIBLE;	/* page leak or corrupt DB */
+	if (rc)
+		my->mc_error = rc;
+	mdb_env_cthr_toggle(my, 1 | MDB_EOF);
+	rc = THREAD_FINISH(thr);
+	return rc ? rc : my->mc_error;
+}
+
+	/** Worker thread for parallel compacting copy. Takes named DBs,
+	 *	largest first, and counts or copies them.
+	 */
+static THREAD_RET ESECT CALL_CONV
+mdb_env_cparthr(void *arg)
+{
+	mdb_cpar *cp = arg;
+	mdb_copy my = {0};
+	mdb_cdb *cd;
+	int rc;
+
+	if (cp->cp_copying) {
+		if ((rc = mdb_env_cinit(cp->cp_env, &my)) != 0) {
+			cp->cp_error = rc;
+			return (THREAD_RET)0;
+		}
+		my.mc_txn = cp->cp_txn;
+		my.mc_fd = cp->cp_fd;
+		my.mc_pwrite = 1;
+	}
+	while (!cp->cp_error) {
+		pthread_mutex_lock(&cp->cp_mutex);
+		cd = cp->cp_next < cp->cp_ndbs ? cp->cp_order[cp->cp_next++] : NULL;
+		pthread_mutex_unlock(&cp->cp_mutex);
+		if (!cd)
+			break;
+		if (cp->cp_copying)
+			rc = mdb_env_cdb(&my, cd, cp->cp_start);
+		else
+			rc = mdb_env_ccount(cp->cp_txn, cd);
+		if (rc)
+			cp->cp_error = rc;
+	}
+	if (cp->cp_copying)
+		mdb_env_cfree(&my);
+	return (THREAD_RET)0;
+}
+
+	/** Run nthreads workers over all named DBs and wait for them. */
+static int ESECT
+mdb_env_cthreads(mdb_cpar *cp, unsigned nthreads, int copying)
+{
+	pthread_t *thr;
+	unsigned i, n;
+	int rc;
+
+	if ((thr = malloc(nthreads * sizeof(pthread_t))) == NULL)
+		return ENOMEM;
+	cp->cp_copying = copying;
+	cp->cp_next = 0;
+	for (n=0; n<nthreads; n++) {
+		if ((rc = THREAD_CREATE(thr[n], mdb_env_cparthr, cp)) != 0) {
+			cp->cp_error = rc;
+			break;
+		}
+	}
+	for (i=0; i<n; i++)
+		THREAD_FINISH(thr[i]);
+	free(thr);
+	return cp->cp_error;
+}
+
+static int
+mdb_cdb_cmp(const void *a, const void *b)
+{
+	const mdb_cdb *x = *(const mdb_cdb **)a, *y = *(const mdb_cdb **)b;
+	pgno_t nx = x->cd_db.md_branch_pages + x->cd_db.md_leaf_pages +
+		x->cd_db.md_overflow_pages;
+	pgno_t ny = y->cd_db.md_branch_pages + y->cd_db.md_leaf_pages +
+		y->cd_db.md_overflow_pages;
+	return (nx < ny) - (nx > ny);
+}
+
+	/** Copy the named DBs of a compacting copy in parallel.
+	 *
+	 * Each named DB gets its own range of pages in the output, so
+	 * nthreads workers can walk and write them independently. The
+	 * ranges follow the main DB, which is written after the meta
+	 * pages once the workers are done, by the caller's walk of the
+	 * main DB; it takes the new records of the named DBs from
+	 * my->mc_subdbs instead of walking them again.
+	 *
+	 * Nothing is done unless the output is a regular file and the
+	 * main DB holds at least two named DBs; the copy is serial then.
+	 * @param[in] my control structure, with the meta pages in the buffer.
+	 * @param[in] nthreads number of workers.
+	 * @param[in,out] root the main DB's expected new root.
+	 */
+static int ESECT
+mdb_env_cpar(mdb_copy *my, unsigned nthreads, pgno_t *root)
+{
+	MDB_txn *txn = my->mc_txn;
+	MDB_db *md = &txn->mt_dbs[MAIN_DBI];
+	MDB_meta *mm;
+	mdb_cpar cp = {0};
+	MDB_cursor mc;
+	MDB_node *ni;
+	MDB_val key, data;
+	pgno_t next;
+	unsigned i;
+	int rc;
+
+	if ((md->md_flags & MDB_DUPSORT) || md->md_entries < 2)
+		return MDB_SUCCESS;
+#ifdef _WIN32
+	{
+		LARGE_INTEGER zero, pos;
+		zero.QuadPart = 0;
+		if (GetFileType(my->mc_fd) != FILE_TYPE_DISK ||
+			!SetFilePointerEx(my->mc_fd, zero, &pos, FILE_CURRENT))
+			return MDB_SUCCESS;
+		cp.cp_start = pos.QuadPart;
+	}
+#else
+	{
+		struct stat st;
+		if (fstat(my->mc_fd, &st) || !S_ISREG(st.st_mode) ||
+			(cp.cp_start = lseek(my->mc_fd, 0, SEEK_CUR)) < 0)
+			return MDB_SUCCESS;
+	}
+#endif
+
+	cp.cp_dbs = malloc(md->md_entries * sizeof(mdb_cdb));
+	if (cp.cp_dbs == NULL)
+		return ENOMEM;
+	mdb_cursor_init(&mc, txn, MAIN_DBI, NULL);
+	while ((rc = mdb_cursor_get(&mc, &key, &data, MDB_NEXT)) == 0) {
+		ni = NODEPTR(mc.mc_pg[mc.mc_top], mc.mc_ki[mc.mc_top]);
+		if ((ni->mn_flags & F_SUBDATA) && cp.cp_ndbs < md->md_entries)
+			memcpy(&cp.cp_dbs[cp.cp_ndbs++].cd_db, data.mv_data, sizeof(MDB_db));
+	}
+	if (rc != MDB_NOTFOUND)
+		goto done;
+	rc = MDB_SUCCESS;
+	if (cp.cp_ndbs < 2)
+		goto done;
+
+	if ((cp.cp_order = malloc(cp.cp_ndbs * sizeof(mdb_cdb *))) == NULL) {
+		rc = ENOMEM;
+		goto done;
+	}
+	for (i=0; i<cp.cp_ndbs; i++)
+		cp.cp_order[i] = &cp.cp_dbs[i];
+	qsort(cp.cp_order, cp.cp_ndbs, sizeof(mdb_cdb *), mdb_cdb_cmp);
+	if (nthreads > cp.cp_ndbs)
+		nthreads = cp.cp_ndbs;
+
+#ifdef _WIN32
+	if (!(cp.cp_mutex = CreateMutex(NULL, FALSE, NULL))) {
+		rc = ErrCode();
+		goto done;
 	}
+#else
+	if ((rc = pthread_mutex_init(&cp.cp_mutex, NULL)) != 0)
+		goto done;
 #endif
+	cp.cp_env = my->mc_env;
+	cp.cp_txn = txn;
+	cp.cp_fd = my->mc_fd;
+
+	/* Lay out the main DB first, then each named DB in turn */
+	rc = mdb_env_cthreads(&cp, nthreads, 0);
+	if (rc)
+		goto unlock;
+	next = NUM_METAS + md->md_branch_pages + md->md_leaf_pages +
+		md->md_overflow_pages;
+	for (i=0; i<cp.cp_ndbs; i++) {
+		cp.cp_dbs[i].cd_base = next;
+		next += cp.cp_dbs[i].cd_count;
+	}
+	if (next != *root + 1) {
+		rc = MDB_INCOMPATIBLE;	/* page leak or corrupt DB */
+		goto unlock;
+	}
+	rc = mdb_env_cthreads(&cp, nthreads, 1);
+	if (rc)
+		goto unlock;
+
+	*root = cp.cp_dbs[0].cd_base - 1;
+	mm = (MDB_meta *)METADATA(my->mc_wbuf[0] + my->mc_env->me_psize);
+	mm->mm_dbs[MAIN_DBI].md_root = *root;
+	my->mc_pwrite = 1;
+	my->mc_wpos = cp.cp_start;
+	my->mc_subdbs = cp.cp_dbs;
+	my->mc_nsubdbs = cp.cp_ndbs;
+	cp.cp_dbs = NULL;
+
+unlock:
+#ifdef _WIN32
+	CloseHandle(cp.cp_mutex);
+#else
+	pthread_mutex_destroy(&cp.cp_mutex);
 #endif
-	memset(my.mc_wbuf[0], 0, MDB_WBUF*2);
-	my.mc_wbuf[1] = my.mc_wbuf[0] + MDB_WBUF;
+done:
+	free(cp.cp_order);
+	free(cp.cp_dbs);
+	return rc;
+}
+
+	/** Copy environment with compaction. */
+static int ESECT
+mdb_env_copyfd1(MDB_env *env, HANDLE fd, unsigned int nthreads)
+{
+	MDB_meta *mm;
+	MDB_page *mp;
+	mdb_copy my = {0};
+	MDB_txn *txn = NULL;
+	pthread_t thr;
+	pgno_t root, new_root;
+	int rc = MDB_SUCCESS;
+
+	if ((rc = mdb_env_cinit(env, &my)) != 0)
+		return rc;
 	my.mc_next_pgno = NUM_METAS;
-	my.mc_env = env;
 	my.mc_fd = fd;
 	rc = THREAD_CREATE(thr, mdb_env_copythr, &my);
 	if (rc)
@@ -9431,6 +9982,11 @@ mdb_env_copyfd1(MDB_env *env, HANDLE fd)
 
 	my.mc_wlen[0] = env->me_psize * NUM_METAS;
 	my.mc_txn = txn;
+	if (nthreads > 1 && root != P_INVALID) {
+		rc = mdb_env_cpar(&my, nthreads, &new_root);
+		if (rc)
+			goto finish;
+	}
 	rc = mdb_env_cwalk(&my, &root, 0);
 	if (rc == MDB_SUCCESS && root != new_root) {
 		rc = MDB_INCOMPATIBLE;	/* page leak or corrupt DB */
@@ -9444,16 +10000,8 @@ finish:
 	mdb_txn_abort(txn);
 
 done:
-#ifdef _WIN32
-	if (my.mc_wbuf[0]) _aligned_free(my.mc_wbuf[0]);
-	if (my.mc_cond)  CloseHandle(my.mc_cond);
-	if (my.mc_mutex) CloseHandle(my.mc_mutex);
-#else
-	free(my.mc_wbuf[0]);
-	pthread_cond_destroy(&my.mc_cond);
-done2:
-	pthread_mutex_destroy(&my.mc_mutex);
-#endif
+	free(my.mc_subdbs);
+	mdb_env_cfree(&my);
 	return rc ? rc : my.mc_error;
 }
 
@@ -9558,14 +10106,21 @@ leave:
 }
 
 int ESECT
-mdb_env_copyfd2(MDB_env *env, HANDLE fd, unsigned int flags)
+mdb_env_copyfd3(MDB_env *env, HANDLE fd, unsigned int flags,
+	unsigned int nthreads)
 {
 	if (flags & MDB_CP_COMPACT)
-		return mdb_env_copyfd1(env, fd);
+		return mdb_env_copyfd1(env, fd, nthreads);
 	else
 		return mdb_env_copyfd0(env, fd);
 }
 
+int ESECT
+mdb_env_copyfd2(MDB_env *env, HANDLE fd, unsigned int flags)
+{
+	return mdb_env_copyfd3(env, fd, flags, 1);
+}
+
 int ESECT
 mdb_env_copyfd(MDB_env *env, HANDLE fd)
 {
@@ -9573,7 +10128,8 @@ mdb_env_copyfd(MDB_env *env, HANDLE fd)
 }
 
 int ESECT
-mdb_env_copy2(MDB_env *env, const char *path, unsigned int flags)
+mdb_env_copy3(MDB_env *env, const char *path, unsigned int flags,
+	unsigned int nthreads)
 {
 	int rc;
 	MDB_name fname;
@@ -9585,19 +10141,378 @@ mdb_env_copy2(MDB_env *env, const char *path, unsigned int flags)
 		mdb_fname_destroy(fname);
 	}
 	if (rc == MDB_SUCCESS) {
-		rc = mdb_env_copyfd2(env, newfd, flags);
+		rc = mdb_env_copyfd3(env, newfd, flags, nthreads);
 		if (close(newfd) < 0 && rc == MDB_SUCCESS)
 			rc = ErrCode();
 	}
 	return rc;
 }
 
+int ESECT
+mdb_env_copy2(MDB_env *env, const char *path, unsigned int flags)
+{
+	return mdb_env_copy3(env, path, flags, 1);
+}
+
 int ESECT
 mdb_env_copy(MDB_env *env, const char *path)
 {
 	return mdb_env_copy2(env, path, 0);
 }
 
+	/** Incremental copies.
+	 *
+	 *	Pages carry no record of the txn that wrote them, so a delta is
+	 *	found by comparing a 64-bit checksum of every page with a page map
+	 *	of the previous copy: a #MDB_deltamap followed by the checksum of
+	 *	each page, 0 for free pages. A delta is a #MDB_deltahdr followed
+	 *	by the page number and contents of every page that changed, the
+	 *	two meta pages first, and ends with the page number #P_INVALID.
+	 */
+#define MDB_DELTA_MAGIC	0x4D444264	/**< "MDBd", start of a delta */
+#define MDB_DMAP_MAGIC	0x4D44426D	/**< "MDBm", start of a page map */
+
+	/** Header of a page map */
+typedef struct MDB_deltamap {
+	uint32_t	dm_magic;	/**< #MDB_DMAP_MAGIC */
+	uint32_t	dm_psize;	/**< page size */
+	txnid_t		dm_txnid;	/**< the txn copied */
+	pgno_t		dm_npages;	/**< number of checksums that follow */
+} MDB_deltamap;
+
+	/** Header of a delta */
+typedef struct MDB_deltahdr {
+	uint32_t	dh_magic;	/**< #MDB_DELTA_MAGIC */
+	uint32_t	dh_psize;	/**< page size */
+	txnid_t		dh_base;	/**< txn the delta applies to, 0 for an empty env */
+	txnid_t		dh_txnid;	/**< txn the delta brings the env to */
+	pgno_t		dh_npages;	/**< size of the env in pages */
+} MDB_deltahdr;
+
+	/** Checksums read or written per I/O */
+#define MDB_DMAP_CHUNK	(MDB_WBUF / sizeof(uint64_t))
+
+#ifdef _WIN32
+#define DO_READ(rc, fd, ptr, w2, len)	rc = ReadFile(fd, ptr, w2, &len, NULL)
+#define DO_WRITE(rc, fd, ptr, w2, len)	rc = WriteFile(fd, ptr, w2, &len, NULL)
+#else
+#define DO_READ(rc, fd, ptr, w2, len)	len = read(fd, ptr, w2); rc = (len >= 0)
+#define DO_WRITE(rc, fd, ptr, w2, len)	len = write(fd, ptr, w2); rc = (len >= 0)
+#endif
+
+	/** Read exactly \b size bytes, or return #MDB_INVALID at end of file. */
+static int ESECT
+mdb_delta_read(HANDLE fd, void *buf, size_t size)
+{
+	char *ptr = buf;
+#ifdef _WIN32
+	DWORD len, w2;
+#else
+	ssize_t len;
+	size_t w2;
+#endif
+	int rc;
+
+	while (size > 0) {
+		w2 = size > MAX_WRITE ? MAX_WRITE : size;
+		DO_READ(rc, fd, ptr, w2, len);
+		if (!rc)
+			return ErrCode();
+		if (len == 0)
+			return MDB_INVALID;
+		ptr += len;
+		size -= len;
+	}
+	return MDB_SUCCESS;
+}
+
+static int ESECT
+mdb_delta_write(HANDLE fd, const void *buf, size_t size)
+{
+	const char *ptr = buf;
+#ifdef _WIN32
+	DWORD len, w2;
+#else
+	ssize_t len;
+	size_t w2;
+#endif
+	int rc;
+
+	while (size > 0) {
+		w2 = size > MAX_WRITE ? MAX_WRITE : size;
+		DO_WRITE(rc, fd, ptr, w2, len);
+		if (!rc)
+			return ErrCode();
+		if (len == 0)
+			return EIO;
+		ptr += len;
+		size -= len;
+	}
+	return MDB_SUCCESS;
+}
+#undef DO_READ
+#undef DO_WRITE
+
+	/** Checksum of page \b pgno, never 0. */
+static uint64_t
+mdb_delta_sum(MDB_env *env, pgno_t pgno)
+{
+	const uint64_t *w = (const uint64_t *)(env->me_map + pgno * env->me_psize);
+	uint64_t h = pgno ^ 0xcbf29ce484222325ULL;
+	unsigned i;
+
+	for (i = 0; i < env->me_psize / sizeof(uint64_t); i++) {
+		h ^= w[i];
+		h *= 0x9e3779b97f4a7c15ULL;
+		h ^= h >> 29;
+	}
+	return h ? h : 1;
+}
+
+int ESECT
+mdb_env_copydelta(MDB_env *env, mdb_filehandle_t mapfd,
+	mdb_filehandle_t newmapfd, mdb_filehandle_t fd)
+{
+	MDB_txn *txn = NULL;
+	MDB_deltamap dm, odm;
+	MDB_deltahdr dh;
+	MDB_page *mp = NULL;
+	MDB_meta *mm;
+	MDB_cursor mc;
+	MDB_val key, data;
+	unsigned char *isfree = NULL;
+	uint64_t *sums = NULL, *osums;
+	pgno_t pgno, npages, nmapped, onpages = 0, base, n, i;
+	size_t fsize = 0;
+	int rc;
+
+	rc = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+	if (rc)
+		return rc;
+
+	/* Pages past the end of the file are free */
+	npages = txn->mt_next_pgno;
+	if ((rc = mdb_fsize(env->me_fd, &fsize)))
+		goto leave;
+	nmapped = fsize / env->me_psize;
+	if (nmapped > npages)
+		nmapped = npages;
+
+	if (mapfd != INVALID_HANDLE_VALUE) {
+		if ((rc = mdb_delta_read(mapfd, &odm, sizeof(odm))))
+			goto leave;
+		if (odm.dm_magic != MDB_DMAP_MAGIC) {
+			rc = MDB_INVALID;
+			goto leave;
+		}
+		if (odm.dm_psize != env->me_psize || odm.dm_txnid > txn->mt_txnid) {
+			rc = MDB_INCOMPATIBLE;
+			goto leave;
+		}
+		onpages = odm.dm_npages;
+		base = odm.dm_txnid;
+	} else {
+		base = 0;
+	}
+
+	/* The content of free pages doesn't matter */
+	isfree = calloc(npages / 8 + 1, 1);
+	sums = malloc(2 * MDB_DMAP_CHUNK * sizeof(uint64_t));
+	mp = calloc(1, env->me_psize);
+	if (!isfree || !sums || !mp) {
+		rc = ENOMEM;
+		goto leave;
+	}
+	osums = sums + MDB_DMAP_CHUNK;
+	mdb_cursor_init(&mc, txn, FREE_DBI, NULL);
+	while ((rc = mdb_cursor_get(&mc, &key, &data, MDB_NEXT)) == 0) {
+		MDB_IDL idl = data.mv_data;
+		for (i = 1; i <= idl[0]; i++)
+			if (idl[i] < npages)
+				isfree[idl[i] >> 3] |= 1 << (idl[i] & 7);
+	}
+	if (rc != MDB_NOTFOUND)
+		goto leave;
+
+	dm.dm_magic = MDB_DMAP_MAGIC;
+	dm.dm_psize = env->me_psize;
+	dm.dm_txnid = txn->mt_txnid;
+	dm.dm_npages = npages;
+	if ((rc = mdb_delta_write(newmapfd, &dm, sizeof(dm))))
+		goto leave;
+
+	dh.dh_magic = MDB_DELTA_MAGIC;
+	dh.dh_psize = env->me_psize;
+	dh.dh_base = base;
+	dh.dh_txnid = txn->mt_txnid;
+	dh.dh_npages = npages;
+	if ((rc = mdb_delta_write(fd, &dh, sizeof(dh))))
+		goto leave;
+
+	/* Both meta pages describe the snapshot of txn */
+	mp->mp_flags = P_META;
+	mm = (MDB_meta *)METADATA(mp);
+	mdb_env_init_meta0(env, mm);
+	mm->mm_address = env->me_metas[0]->mm_address;
+	mm->mm_dbs[FREE_DBI] = txn->mt_dbs[FREE_DBI];
+	mm->mm_dbs[MAIN_DBI] = txn->mt_dbs[MAIN_DBI];
+	mm->mm_last_pg = npages - 1;
+	mm->mm_txnid = txn->mt_txnid;
+	for (pgno = 0; pgno < NUM_METAS; pgno++) {
+		mp->mp_pgno = pgno;
+		if ((rc = mdb_delta_write(fd, &pgno, sizeof(pgno))) ||
+			(rc = mdb_delta_write(fd, mp, env->me_psize)))
+			goto leave;
+	}
+	if (mapfd != INVALID_HANDLE_VALUE) {
+		/* Skip the checksums of the old meta pages */
+		if ((rc = mdb_delta_read(mapfd, osums, NUM_METAS * sizeof(uint64_t))))
+			goto leave;
+	}
+	sums[0] = sums[1] = 0;
+	if ((rc = mdb_delta_write(newmapfd, sums, NUM_METAS * sizeof(uint64_t))))
+		goto leave;
+
+	for (pgno = NUM_METAS; pgno < npages; pgno += n) {
+		n = npages - pgno;
+		if (n > MDB_DMAP_CHUNK)
+			n = MDB_DMAP_CHUNK;
+		memset(osums, 0, n * sizeof(uint64_t));
+		if (pgno < onpages) {
+			i = onpages - pgno;
+			if (i > n)
+				i = n;
+			if ((rc = mdb_delta_read(mapfd, osums, i * sizeof(uint64_t))))
+				goto leave;
+		}
+		for (i = 0; i < n; i++) {
+			pgno_t pg = pgno + i;
+			if (pg >= nmapped || (isfree[pg >> 3] & (1 << (pg & 7)))) {
+				sums[i] = 0;
+				continue;
+			}
+			sums[i] = mdb_delta_sum(env, pg);
+			if (sums[i] != osums[i]) {
+				if ((rc = mdb_delta_write(fd, &pg, sizeof(pg))) ||
+					(rc = mdb_delta_write(fd, env->me_map + pg * env->me_psize,
+						env->me_psize)))
+					goto leave;
+			}
+		}
+		if ((rc = mdb_delta_write(newmapfd, sums, n * sizeof(uint64_t))))
+			goto leave;
+	}
+	pgno = P_INVALID;
+	rc = mdb_delta_write(fd, &pgno, sizeof(pgno));
+
+leave:
+	free(mp);
+	free(sums);
+	free(isfree);
+	mdb_txn_abort(txn);
+	return rc;
+}
+
+	/** Write a page of a delta to the data file. */
+static int ESECT
+mdb_delta_put(MDB_env *env, pgno_t pgno, char *page)
+{
+	off_t off = (off_t)pgno * env->me_psize;
+	int rc;
+#ifdef _WIN32
+	DWORD len;
+	OVERLAPPED ov;
+	memset(&ov, 0, sizeof(ov));
+	ov.Offset = off & 0xffffffff;
+	ov.OffsetHigh = off >> 16 >> 16;
+	rc = WriteFile(env->me_fd, page, env->me_psize, &len, &ov) ? (int)len : -1;
+#else
+	rc = pwrite(env->me_fd, page, env->me_psize, off);
+#endif
+	if (rc == (int)env->me_psize)
+		return MDB_SUCCESS;
+	return rc < 0 ? ErrCode() : EIO;
+}
+
+int ESECT
+mdb_env_applydelta(MDB_env *env, mdb_filehandle_t fd)
+{
+	MDB_txn *txn = NULL;
+	MDB_deltahdr dh;
+	MDB_meta *meta;
+	char *buf, *metas;
+	pgno_t pgno;
+	int rc;
+
+	if (env->me_flags & MDB_RDONLY)
+		return EACCES;
+	if ((rc = mdb_delta_read(fd, &dh, sizeof(dh))))
+		return rc;
+	if (dh.dh_magic != MDB_DELTA_MAGIC)
+		return MDB_INVALID;
+	if (dh.dh_psize != env->me_psize)
+		return MDB_INCOMPATIBLE;
+	if ((size_t)dh.dh_npages * env->me_psize > env->me_mapsize) {
+		if ((rc = mdb_env_set_mapsize(env, (size_t)dh.dh_npages * env->me_psize)))
+			return rc;
+	}
+
+	buf = malloc((NUM_METAS + 1) * env->me_psize);
+	if (!buf)
+		return ENOMEM;
+	metas = buf + env->me_psize;
+
+	/* Keep out writers, then check the delta follows what we have */
+	if ((rc = mdb_txn_begin(env, NULL, 0, &txn)))
+		goto leave;
+	meta = mdb_env_pick_meta(env);
+	if (meta->mm_txnid != dh.dh_base) {
+		rc = MDB_INCOMPATIBLE;
+		goto leave;
+	}
+
+	/* The meta pages come first, but are written last */
+	for (pgno = 0; pgno < NUM_METAS; pgno++) {
+		pgno_t pg;
+		if ((rc = mdb_delta_read(fd, &pg, sizeof(pg))))
+			goto leave;
+		if (pg != pgno) {
+			rc = MDB_INVALID;
+			goto leave;
+		}
+		if ((rc = mdb_delta_read(fd, metas + pg * env->me_psize, env->me_psize)))
+			goto leave;
+	}
+	for (;;) {
+		if ((rc = mdb_delta_read(fd, &pgno, sizeof(pgno))))
+			goto leave;
+		if (pgno == P_INVALID)
+			break;
+		if (pgno < NUM_METAS || pgno >= dh.dh_npages) {
+			rc = MDB_INVALID;
+			goto leave;
+		}
+		if ((rc = mdb_delta_read(fd, buf, env->me_psize)) ||
+			(rc = mdb_delta_put(env, pgno, buf)))
+			goto leave;
+	}
+	if ((rc = mdb_env_sync(env, 1)))
+		goto leave;
+	for (pgno = 0; pgno < NUM_METAS; pgno++) {
+		if ((rc = mdb_delta_put(env, pgno, metas + pgno * env->me_psize)))
+			goto leave;
+	}
+	if ((rc = mdb_env_sync(env, 1)))
+		goto leave;
+	if (env->me_txns)
+		env->me_txns->mti_txnid = dh.dh_txnid;
+
+leave:
+	mdb_txn_abort(txn);
+	free(buf);
+	return rc;
+}
+
 int ESECT
 mdb_env_set_flags(MDB_env *env, unsigned int flag, int onoff)
 {
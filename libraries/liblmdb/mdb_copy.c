@@ -15,6 +15,7 @@
 #include <windows.h>
 #define	MDB_STDOUT	GetStdHandle(STD_OUTPUT_HANDLE)
 #else
+#include <sys/time.h>
 #define	MDB_STDOUT	1
 #endif
 #include <stdio.h>
@@ -25,21 +26,40 @@
 static void
 sighandle(int sig)
 {
+}
+
+	/* Wall clock time in milliseconds */
+static double
+now(void)
+{
+#ifdef _WIN32
+	return GetTickCount();
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
 }
 
 int main(int argc,char * argv[])
 {
-	int rc;
+	int rc, verbose = 0;
 	MDB_env *env;
 	const char *progname = argv[0], *act;
 	unsigned flags = MDB_RDONLY;
-	unsigned cpflags = 0;
+	unsigned cpflags = 0, nthreads = 1;
+	double start;
 
 	for (; argc > 1 && argv[1][0] == '-'; argc--, argv++) {
 		if (argv[1][1] == 'n' && argv[1][2] == '\0')
 			flags |= MDB_NOSUBDIR;
 		else if (argv[1][1] == 'c' && argv[1][2] == '\0')
 			cpflags |= MDB_CP_COMPACT;
+		else if (argv[1][1] == 't' && argv[1][2] == '\0' && argc > 2) {
+			nthreads = strtoul(argv[2], NULL, 0);
+			argc--, argv++;
+		} else if (argv[1][1] == 'v' && argv[1][2] == '\0')
+			verbose = 1;
 		else if (argv[1][1] == 'V' && argv[1][2] == '\0') {
 			printf("%s\n", MDB_VERSION_STRING);
 			exit(0);
@@ -48,7 +68,7 @@ int main(int argc,char * argv[])
 	}
 
 	if (argc<2 || argc>3) {
-		fprintf(stderr, "usage: %s [-V] [-c] [-n] srcpath [dstpath]\n", progname);
+		fprintf(stderr, "usage: %s [-V] [-c] [-n] [-t threads] [-v] srcpath [dstpath]\n", progname);
 		exit(EXIT_FAILURE);
 	}
 
@@ -68,10 +88,14 @@ int main(int argc,char * argv[])
 	}
 	if (rc == MDB_SUCCESS) {
 		act = "copying";
+		start = now();
 		if (argc == 2)
-			rc = mdb_env_copyfd2(env, MDB_STDOUT, cpflags);
+			rc = mdb_env_copyfd3(env, MDB_STDOUT, cpflags, nthreads);
 		else
-			rc = mdb_env_copy2(env, argv[2], cpflags);
+			rc = mdb_env_copy3(env, argv[2], cpflags, nthreads);
+		if (rc == MDB_SUCCESS && verbose)
+			fprintf(stderr, "%s: copied in %.3f seconds\n",
+				progname, (now() - start) / 1000.0);
 	}
 	if (rc)
 		fprintf(stderr, "%s: %s failed, error %d (%s)\n",
@@ -0,0 +1,172 @@
+/* mdb_delta.c - memory-mapped database incremental backup tool */
+/*
+ * Copyright 2012-2020 Howard Chu, Symas Corp.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+#ifdef _WIN32
+#include <windows.h>
+#define	MDB_STDIN	GetStdHandle(STD_INPUT_HANDLE)
+#define	MDB_STDOUT	GetStdHandle(STD_OUTPUT_HANDLE)
+#define	MDB_INVALID_FD	INVALID_HANDLE_VALUE
+#define	close(fd)	(CloseHandle(fd) ? 0 : -1)
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#define	MDB_STDIN	0
+#define	MDB_STDOUT	1
+#define	MDB_INVALID_FD	(-1)
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include "lmdb.h"
+
+static void
+sighandle(int sig)
+{
+}
+
+/* Open an existing file for reading, or create a new one for writing */
+static int
+openfile(const char *path, int wr, mdb_filehandle_t *fd)
+{
+#ifdef _WIN32
+	*fd = CreateFileA(path, wr ? GENERIC_WRITE : GENERIC_READ, 0, NULL,
+		wr ? CREATE_NEW : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	return *fd == MDB_INVALID_FD ? (int)GetLastError() : 0;
+#else
+	*fd = open(path, wr ? O_WRONLY|O_CREAT|O_EXCL : O_RDONLY, 0600);
+	return *fd == MDB_INVALID_FD ? errno : 0;
+#endif
+}
+
+static void
+usage(const char *progname)
+{
+	fprintf(stderr, "usage: %s [-V] [-n] [-m map] -o newmap srcpath [delta]\n"
+		"       %s -r [-V] [-n] dstpath [delta ...]\n", progname, progname);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc,char * argv[])
+{
+	int i, rc, restore = 0;
+	MDB_env *env;
+	mdb_filehandle_t mapfd = MDB_INVALID_FD, newmapfd = MDB_INVALID_FD,
+		fd = MDB_INVALID_FD;
+	const char *progname = argv[0], *act, *mapname = NULL, *newmapname = NULL;
+	char *file = NULL;
+	unsigned flags = 0;
+
+	for (; argc > 1 && argv[1][0] == '-'; argc--, argv++) {
+		if (argv[1][1] == 'n' && argv[1][2] == '\0')
+			flags |= MDB_NOSUBDIR;
+		else if (argv[1][1] == 'r' && argv[1][2] == '\0')
+			restore = 1;
+		else if (argv[1][1] == 'm' && argv[1][2] == '\0' && argc > 2) {
+			mapname = argv[2];
+			argc--, argv++;
+		} else if (argv[1][1] == 'o' && argv[1][2] == '\0' && argc > 2) {
+			newmapname = argv[2];
+			argc--, argv++;
+		} else if (argv[1][1] == 'V' && argv[1][2] == '\0') {
+			printf("%s\n", MDB_VERSION_STRING);
+			exit(0);
+		} else
+			usage(progname);
+	}
+
+	if (argc < 2 || (!restore && (argc > 3 || !newmapname)) ||
+		(restore && (mapname || newmapname)))
+		usage(progname);
+
+#ifdef SIGPIPE
+	signal(SIGPIPE, sighandle);
+#endif
+#ifdef SIGHUP
+	signal(SIGHUP, sighandle);
+#endif
+	signal(SIGINT, sighandle);
+	signal(SIGTERM, sighandle);
+
+	act = "opening environment";
+	rc = mdb_env_create(&env);
+	if (rc == MDB_SUCCESS) {
+		rc = mdb_env_open(env, argv[1], flags | (restore ? 0 : MDB_RDONLY), 0600);
+	}
+	if (rc == MDB_SUCCESS && restore) {
+		for (i = 2; i < argc || i == 2; i++) {
+			if (i < argc) {
+				file = argv[i];
+				act = "opening delta";
+				if ((rc = openfile(file, 0, &fd)))
+					break;
+			} else {
+				file = "stdin";
+				fd = MDB_STDIN;
+			}
+			act = "applying delta";
+			rc = mdb_env_applydelta(env, fd);
+			if (i < argc)
+				close(fd);
+			if (rc)
+				break;
+		}
+	} else if (rc == MDB_SUCCESS) {
+		if (mapname) {
+			act = "opening page map";
+			file = (char *)mapname;
+			rc = openfile(mapname, 0, &mapfd);
+		}
+		if (rc == MDB_SUCCESS) {
+			act = "creating page map";
+			file = (char *)newmapname;
+			rc = openfile(newmapname, 1, &newmapfd);
+		}
+		if (rc == MDB_SUCCESS) {
+			file = NULL;
+			if (argc == 3) {
+				act = "creating delta";
+				file = argv[2];
+				rc = openfile(file, 1, &fd);
+			} else {
+				fd = MDB_STDOUT;
+			}
+		}
+		if (rc == MDB_SUCCESS) {
+			act = "copying";
+			rc = mdb_env_copydelta(env, mapfd, newmapfd, fd);
+			if (close(newmapfd) < 0 && rc == MDB_SUCCESS)
+				rc = errno;
+			if (argc == 3 && close(fd) < 0 && rc == MDB_SUCCESS)
+				rc = errno;
+			if (rc) {
+				/* Don't leave behind a map that matches no copy */
+				remove(newmapname);
+			}
+		}
+		if (mapfd != MDB_INVALID_FD)
+			close(mapfd);
+	}
+	if (rc) {
+		if (file)
+			fprintf(stderr, "%s: %s %s failed, error %d (%s)\n",
+				progname, act, file, rc, mdb_strerror(rc));
+		else
+			fprintf(stderr, "%s: %s failed, error %d (%s)\n",
+				progname, act, rc, mdb_strerror(rc));
+	}
+	mdb_env_close(env);
+
+	return rc ? EXIT_FAILURE : EXIT_SUCCESS;
+}
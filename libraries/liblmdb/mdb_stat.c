@@ -35,6 +35,47 @@ static void prstat(MDB_stat *ms)
 	printf("  Entries: %"Z"u\n", ms->ms_entries);
 }
 
+static int pgcmp(const void *a, const void *b)
+{
+	size_t x = *(const size_t *)a, y = *(const size_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+/* Summarize how the free pages are spread: the number of runs of
+ * contiguous pages by length, in powers of two. Requests for several
+ * pages at once, for overflow records, must be met by a single run.
+ */
+static void prfrag(size_t *pgs, size_t n)
+{
+	size_t runs = 0, longest = 0, len, i, j;
+	size_t cnt[sizeof(size_t)*8] = {0}, tot[sizeof(size_t)*8] = {0};
+	int b, top = 0;
+
+	qsort(pgs, n, sizeof(size_t), pgcmp);
+	for (i = 0; i < n; i = j) {
+		for (j = i+1; j < n && pgs[j] == pgs[j-1]+1; j++) ;
+		len = j - i;
+		runs++;
+		if (len > longest)
+			longest = len;
+		for (b = 0; (len >> b) > 1; b++) ;
+		cnt[b]++;
+		tot[b] += len;
+		if (b > top)
+			top = b;
+	}
+	printf("  Free runs: %"Z"u, longest %"Z"u pages\n", runs, longest);
+	for (b = 0; runs && b <= top; b++) {
+		if (!cnt[b])
+			continue;
+		if (b)
+			printf("    %"Z"u-%"Z"u pages", (size_t)1 << b, ((size_t)2 << b) - 1);
+		else
+			printf("    1 page");
+		printf(": %"Z"u runs, %"Z"u pages\n", cnt[b], tot[b]);
+	}
+}
+
 static void usage(char *prog)
 {
 	fprintf(stderr, "usage: %s [-V] [-n] [-e] [-r[r]] [-f[f[f]]] [-a|-s subdb] dbpath\n", prog);
@@ -156,10 +197,11 @@ int main(int argc, char *argv[])
 	if (freinfo) {
 		MDB_cursor *cursor;
 		MDB_val key, data;
-		size_t pages = 0, *iptr;
+		size_t pages = 0, *iptr, *pgs = NULL;
 
 		printf("Freelist Status\n");
 		dbi = 0;
+		pgs = malloc(sizeof(size_t));
 		rc = mdb_cursor_open(txn, dbi, &cursor);
 		if (rc) {
 			fprintf(stderr, "mdb_cursor_open failed, error %d %s\n", rc, mdb_strerror(rc));
@@ -173,6 +215,16 @@ int main(int argc, char *argv[])
 		prstat(&mst);
 		while ((rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT)) == 0) {
 			iptr = data.mv_data;
+			if (pgs) {
+				size_t *p2 = realloc(pgs, (pages + *iptr) * sizeof(size_t));
+				if (!p2) {
+					free(pgs);
+					pgs = NULL;
+				} else {
+					pgs = p2;
+					memcpy(pgs + pages, iptr+1, *iptr * sizeof(size_t));
+				}
+			}
 			pages += *iptr;
 			if (freinfo > 1) {
 				char *bad = "";
@@ -201,6 +253,10 @@ int main(int argc, char *argv[])
 		}
 		mdb_cursor_close(cursor);
 		printf("  Free pages: %"Z"u\n", pages);
+		if (pgs) {
+			prfrag(pgs, pages);
+			free(pgs);
+		}
 	}
 
 	rc = mdb_open(txn, subname, 0, &dbi);
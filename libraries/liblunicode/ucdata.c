@@ -0,0 +1 @@
+ucdata/ucdata.c
\ No newline at end of file
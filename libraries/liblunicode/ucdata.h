@@ -0,0 +1 @@
+ucdata/ucdata.h
\ No newline at end of file
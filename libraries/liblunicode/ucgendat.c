@@ -0,0 +1 @@
+ucdata/ucgendat.c
\ No newline at end of file
@@ -0,0 +1 @@
+ucdata/uctable.h
\ No newline at end of file
@@ -0,0 +1 @@
+ure/ure.c
\ No newline at end of file
@@ -0,0 +1 @@
+ure/ure.h
\ No newline at end of file
@@ -0,0 +1 @@
+ure/urestubs.c
\ No newline at end of file
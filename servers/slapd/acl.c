@@ -230,7 +230,8 @@ slap_access_allowed(
 			state->as_fe_done--;
 		ACL_PRIV_ASSIGN( mask, state->as_vd_mask );
 	} else {
-		*state = state_init;
+		/* the memo is about the entry, keep it */
+		memcpy( state, &state_init, offsetof( AccessControlState, as_memo_e ) );
 
 		a = NULL;
 		count = 0;
@@ -488,6 +489,347 @@ done:
 	return ret;
 }
 
+/*
+ * Tell whether op may read every value of every attribute in its
+ * database without any access rule being evaluated, i.e. op is the
+ * rootdn, or no ACL is configured and the default access grants read.
+ * Whenever an overlay or the backend supplies its own access control
+ * the answer is no, and values must go through access_allowed().
+ */
+int
+access_allowed_unrestricted( Operation *op )
+{
+	if ( op->o_bd == NULL || op->o_acl_priv != ACL_NONE ||
+		op->o_is_auth_check )
+		return 0;
+
+	if ( op->o_bd->bd_info->bi_access_allowed != NULL ||
+		frontendDB->bd_info->bi_access_allowed != fe_access_allowed )
+		return 0;
+
+	if ( be_isroot( op ) )
+		return 1;
+
+	return op->o_bd->be_acl == NULL && frontendDB->be_acl == NULL &&
+		op->o_bd->be_dfltaccess >= ACL_READ;
+}
+
+
+/*
+ * Compiled acl lists.
+ *
+ * The acls of a list whose "to" clause has a plain DN pattern are hashed
+ * on that pattern, so the ones that may apply to an entry are found by
+ * looking up each suffix of its DN instead of trying every pattern; the
+ * others (regex, filter-only and "*" clauses) are tried one by one.
+ * A list is compiled when its database starts, or when it is first used
+ * after it was changed; any change drops all compiled lists.
+ *
+ * The outcome of the DN and filter tests of every acl of a list is
+ * computed once per entry, and kept in the AccessControlState, which
+ * callers keep for all the attributes of an entry. slap_acl_get() then
+ * goes from one acl that applies to the entry straight to the next,
+ * and only checks attributes and values.
+ */
+typedef struct AclIndex {
+	struct AclIndex	*ai_next;	/* all compiled lists */
+	int		ai_nacls;
+	AccessControl	**ai_acls;
+	int		*ai_chain;	/* next acl with the same pattern, or -1 */
+	int		ai_nother;
+	int		*ai_other;	/* acls tried against every entry */
+	unsigned int	ai_hmask;
+	int		*ai_hash;	/* first acl with a pattern, or -1 */
+} AclIndex;
+
+static AclIndex *acl_indexes;
+static ldap_pvt_thread_mutex_t acl_index_mutex;
+
+static unsigned int
+acl_dnhash( const char *s, ber_len_t len )
+{
+	unsigned int h = 2166136261U;
+
+	while ( len-- ) {
+		h ^= (unsigned char)*s++;
+		h *= 16777619U;
+	}
+	return h;
+}
+
+/* Whether the acl only applies to entries below its DN pattern */
+static int
+acl_dn_indexed( AccessControl *a )
+{
+	if ( a->acl_dn_pat.bv_len == 0 )
+		return 0;
+
+	switch ( a->acl_dn_style ) {
+	case ACL_STYLE_BASE:
+	case ACL_STYLE_ONE:
+	case ACL_STYLE_SUBTREE:
+	case ACL_STYLE_CHILDREN:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* Compile the list starting at head, unless it already is */
+void
+acl_compile( AccessControl *head )
+{
+	AclIndex *ai;
+	AccessControl *a;
+	unsigned int h;
+	int i, n, nindexed = 0;
+
+	if ( head == NULL )
+		return;
+
+	ldap_pvt_thread_mutex_lock( &acl_index_mutex );
+	if ( head->acl_cidx != NULL ) {
+		ldap_pvt_thread_mutex_unlock( &acl_index_mutex );
+		return;
+	}
+
+	for ( n = 0, a = head; a; a = a->acl_next, n++ ) {
+		if ( acl_dn_indexed( a ) )
+			nindexed++;
+	}
+	for ( h = 4; h < 2 * nindexed; h <<= 1 )
+		;
+
+	ai = ch_malloc( sizeof(AclIndex) + n * sizeof(AccessControl *) +
+		( 2 * n + h ) * sizeof(int) );
+	ai->ai_nacls = n;
+	ai->ai_acls = (AccessControl **)(ai + 1);
+	ai->ai_chain = (int *)(ai->ai_acls + n);
+	ai->ai_other = ai->ai_chain + n;
+	ai->ai_hash = ai->ai_other + n;
+	ai->ai_hmask = h - 1;
+	ai->ai_nother = 0;
+	for ( i = 0; i < h; i++ )
+		ai->ai_hash[i] = -1;
+
+	for ( i = 0, a = head; a; a = a->acl_next, i++ ) {
+		ai->ai_acls[i] = a;
+		ai->ai_chain[i] = -1;
+		if ( !acl_dn_indexed( a ) ) {
+			ai->ai_other[ai->ai_nother++] = i;
+			continue;
+		}
+
+		h = acl_dnhash( a->acl_dn_pat.bv_val, a->acl_dn_pat.bv_len );
+		for ( ;; h++ ) {
+			int j = ai->ai_hash[h & ai->ai_hmask];
+			if ( j < 0 ) {
+				ai->ai_hash[h & ai->ai_hmask] = i;
+				break;
+			}
+			if ( ber_bvcmp( &ai->ai_acls[j]->acl_dn_pat, &a->acl_dn_pat ) == 0 ) {
+				while ( ai->ai_chain[j] >= 0 )
+					j = ai->ai_chain[j];
+				ai->ai_chain[j] = i;
+				break;
+			}
+		}
+	}
+
+	/* head last: it tells readers the list is compiled. Readers
+	 * don't take the mutex, the release store makes sure they see
+	 * the index filled in once they see the pointer.
+	 */
+	for ( i = n - 1; i >= 0; i-- ) {
+		ai->ai_acls[i]->acl_cpos = i;
+		__atomic_store_n( &ai->ai_acls[i]->acl_cidx, ai, __ATOMIC_RELEASE );
+	}
+	ai->ai_next = acl_indexes;
+	acl_indexes = ai;
+	ldap_pvt_thread_mutex_unlock( &acl_index_mutex );
+}
+
+/* An acl list is about to change: forget all compiled lists. Lists only
+ * change while the server is paused, so no one is using them.
+ */
+void
+acl_uncompile( void )
+{
+	AclIndex *ai;
+	int i;
+
+	ldap_pvt_thread_mutex_lock( &acl_index_mutex );
+	while (( ai = acl_indexes )) {
+		acl_indexes = ai->ai_next;
+		for ( i = 0; i < ai->ai_nacls; i++ )
+			ai->ai_acls[i]->acl_cidx = NULL;
+		ch_free( ai );
+	}
+	ldap_pvt_thread_mutex_unlock( &acl_index_mutex );
+}
+
+/* Whether the "to" DN of acl a matches entry e */
+static int
+acl_match_dn( AccessControl *a, Entry *e, size_t nmatch, regmatch_t *pmatch )
+{
+	ber_len_t dnlen = e->e_nname.bv_len, patlen;
+
+	if ( !a->acl_dn_pat.bv_len && a->acl_dn_style == ACL_STYLE_REGEX )
+		return 1;
+
+	if ( a->acl_dn_style == ACL_STYLE_REGEX )
+		return regexec( &a->acl_dn_re, e->e_ndn, nmatch, pmatch, 0 ) == 0;
+
+	patlen = a->acl_dn_pat.bv_len;
+	if ( dnlen < patlen )
+		return 0;
+
+	if ( a->acl_dn_style == ACL_STYLE_BASE ) {
+		/* base dn -- entire object DN must match */
+		if ( dnlen != patlen )
+			return 0;
+
+	} else if ( a->acl_dn_style == ACL_STYLE_ONE ) {
+		ber_len_t	rdnlen = 0;
+		ber_len_t	sep = 0;
+
+		if ( dnlen <= patlen )
+			return 0;
+
+		if ( patlen > 0 ) {
+			if ( !DN_SEPARATOR( e->e_ndn[dnlen - patlen - 1] ) )
+				return 0;
+			sep = 1;
+		}
+
+		rdnlen = dn_rdnlen( NULL, &e->e_nname );
+		if ( rdnlen + patlen + sep != dnlen )
+			return 0;
+
+	} else if ( a->acl_dn_style == ACL_STYLE_SUBTREE ) {
+		if ( dnlen > patlen && !DN_SEPARATOR( e->e_ndn[dnlen - patlen - 1] ) )
+			return 0;
+
+	} else if ( a->acl_dn_style == ACL_STYLE_CHILDREN ) {
+		if ( dnlen <= patlen )
+			return 0;
+		if ( !DN_SEPARATOR( e->e_ndn[dnlen - patlen - 1] ) )
+			return 0;
+	}
+
+	return strcmp( a->acl_dn_pat.bv_val, e->e_ndn + dnlen - patlen ) == 0;
+}
+
+#define ACL_MEMO_SET(bits, i)	((bits)[(i) / ACL_MEMO_BITS] |= 1UL << ((i) % ACL_MEMO_BITS))
+#define ACL_MEMO_ISSET(bits, i)	(((bits)[(i) / ACL_MEMO_BITS] >> ((i) % ACL_MEMO_BITS)) & 1)
+
+/* Forget the memo of the state if it is about another entry */
+static void
+acl_memo_check( Entry *e, AccessControlState *state )
+{
+	unsigned int h = acl_dnhash( e->e_ndn, e->e_nname.bv_len );
+
+	if ( state->as_memo_e != e ||
+		state->as_memo_dnlen != e->e_nname.bv_len ||
+		state->as_memo_dnhash != h )
+	{
+		state->as_memo_e = e;
+		state->as_memo_dnlen = e->e_nname.bv_len;
+		state->as_memo_dnhash = h;
+		state->as_memo[0].am_idx = NULL;
+		state->as_memo[1].am_idx = NULL;
+	}
+}
+
+/* The memo of e for the list of acl a, or NULL if there is none */
+static AclMemo *
+acl_memo_get( Entry *e, AccessControl *a, AccessControlState *state )
+{
+	AclIndex *ai = __atomic_load_n( &a->acl_cidx, __ATOMIC_ACQUIRE );
+	AclMemo *am;
+	ber_len_t dnlen = e->e_nname.bv_len, i;
+	int j;
+
+	if ( ai == NULL || ai->ai_nacls > ACL_MEMO_MAX )
+		return NULL;
+
+	if ( state->as_memo[0].am_idx == ai )
+		return &state->as_memo[0];
+	if ( state->as_memo[1].am_idx == ai )
+		return &state->as_memo[1];
+
+	am = &state->as_memo[ state->as_memo[0].am_idx != NULL ];
+	if ( am->am_idx != NULL )
+		return NULL;
+
+	memset( am->am_dn, 0, sizeof(am->am_dn) );
+	memset( am->am_filter, 0, sizeof(am->am_filter) );
+
+	for ( j = 0; j < ai->ai_nother; j++ ) {
+		if ( acl_match_dn( ai->ai_acls[ai->ai_other[j]], e, 0, NULL ) )
+			ACL_MEMO_SET( am->am_dn, ai->ai_other[j] );
+	}
+
+	/* the whole DN, and what follows each separator */
+	for ( i = 0; i < dnlen; ) {
+		struct berval sfx;
+		unsigned int h;
+
+		sfx.bv_val = e->e_ndn + i;
+		sfx.bv_len = dnlen - i;
+		h = acl_dnhash( sfx.bv_val, sfx.bv_len );
+		for ( ;; h++ ) {
+			j = ai->ai_hash[h & ai->ai_hmask];
+			if ( j < 0 )
+				break;
+			if ( ber_bvcmp( &ai->ai_acls[j]->acl_dn_pat, &sfx ) == 0 ) {
+				for ( ; j >= 0; j = ai->ai_chain[j] ) {
+					if ( acl_match_dn( ai->ai_acls[j], e, 0, NULL ) )
+						ACL_MEMO_SET( am->am_dn, j );
+				}
+				break;
+			}
+		}
+
+		while ( i < dnlen && !DN_SEPARATOR( e->e_ndn[i] ) )
+			i++;
+		i++;
+	}
+
+	for ( j = 0; j < ai->ai_nacls; j++ ) {
+		if ( ACL_MEMO_ISSET( am->am_dn, j ) && ( !ai->ai_acls[j]->acl_filter ||
+			test_filter( NULL, e, ai->ai_acls[j]->acl_filter ) == LDAP_COMPARE_TRUE ) )
+			ACL_MEMO_SET( am->am_filter, j );
+	}
+
+	am->am_idx = ai;
+	return am;
+}
+
+/* The position of the first acl from pos on whose DN matches */
+static int
+acl_memo_next( AclMemo *am, int pos )
+{
+	int n = am->am_idx->ai_nacls, w = pos / ACL_MEMO_BITS;
+	unsigned long bits = am->am_dn[w] >> ( pos % ACL_MEMO_BITS );
+
+	if ( bits ) {
+		while ( !( bits & 1 ) ) {
+			bits >>= 1;
+			pos++;
+		}
+		return pos < n ? pos : n;
+	}
+	for ( w++; w * ACL_MEMO_BITS < n; w++ ) {
+		if ( am->am_dn[w] ) {
+			bits = am->am_dn[w];
+			for ( pos = w * ACL_MEMO_BITS; !( bits & 1 ); pos++ )
+				bits >>= 1;
+			return pos < n ? pos : n;
+		}
+	}
+	return n;
+}
 
 /*
  * slap_acl_get - return the acl applicable to entry e, attribute
@@ -508,7 +850,6 @@ slap_acl_get(
 	AccessControlState *state )
 {
 	const char *attr;
-	ber_len_t dnlen;
 	AccessControl *prev;
 
 	assert( e != NULL );
@@ -531,75 +872,52 @@ slap_acl_get(
 		assert( a != NULL );
 		if ( a == frontendDB->be_acl )
 			state->as_fe_done = 1;
+		if ( __atomic_load_n( &a->acl_cidx, __ATOMIC_ACQUIRE ) == NULL )
+			acl_compile( a );
 	} else {
 		prev = a;
 		a = a->acl_next;
 	}
 
-	dnlen = e->e_nname.bv_len;
+	acl_memo_check( e, state );
 
  retry:
 	for ( ; a != NULL; prev = a, a = a->acl_next ) {
+		AclMemo *am;
+
 		(*count) ++;
 
 		if ( a != frontendDB->be_acl && state->as_fe_done )
 			state->as_fe_done++;
 
-		if ( a->acl_dn_pat.bv_len || ( a->acl_dn_style != ACL_STYLE_REGEX )) {
+		am = acl_memo_get( e, a, state );
+		if ( am != NULL ) {
+			int skip = acl_memo_next( am, a->acl_cpos ) - a->acl_cpos;
+
+			if ( skip ) {
+				/* none of the acls until the next match applies to e */
+				skip--;
+				*count += skip;
+				if ( state->as_fe_done )
+					state->as_fe_done += skip;
+				a = am->am_idx->ai_acls[a->acl_cpos + skip];
+				continue;
+			}
+
+			/* refill the matches for substitutions */
+			if ( a->acl_dn_pat.bv_len && a->acl_dn_style == ACL_STYLE_REGEX )
+				(void)acl_match_dn( a, e, matches->dn_count, matches->dn_data );
+
+		} else if ( a->acl_dn_pat.bv_len || ( a->acl_dn_style != ACL_STYLE_REGEX )) {
 			if ( a->acl_dn_style == ACL_STYLE_REGEX ) {
 				Debug( LDAP_DEBUG_ACL, "=> dnpat: [%d] %s nsub: %d\n", 
 					*count, a->acl_dn_pat.bv_val, (int) a->acl_dn_re.re_nsub );
-				if ( regexec ( &a->acl_dn_re, 
-					       e->e_ndn, 
-				 	       matches->dn_count, 
-					       matches->dn_data, 0 ) )
-					continue;
-
 			} else {
-				ber_len_t patlen;
-
 				Debug( LDAP_DEBUG_ACL, "=> dn: [%d] %s\n", 
 					*count, a->acl_dn_pat.bv_val );
-				patlen = a->acl_dn_pat.bv_len;
-				if ( dnlen < patlen )
-					continue;
-
-				if ( a->acl_dn_style == ACL_STYLE_BASE ) {
-					/* base dn -- entire object DN must match */
-					if ( dnlen != patlen )
-						continue;
-
-				} else if ( a->acl_dn_style == ACL_STYLE_ONE ) {
-					ber_len_t	rdnlen = 0;
-					ber_len_t	sep = 0;
-
-					if ( dnlen <= patlen )
-						continue;
-
-					if ( patlen > 0 ) {
-						if ( !DN_SEPARATOR( e->e_ndn[dnlen - patlen - 1] ) )
-							continue;
-						sep = 1;
-					}
-
-					rdnlen = dn_rdnlen( NULL, &e->e_nname );
-					if ( rdnlen + patlen + sep != dnlen )
-						continue;
-
-				} else if ( a->acl_dn_style == ACL_STYLE_SUBTREE ) {
-					if ( dnlen > patlen && !DN_SEPARATOR( e->e_ndn[dnlen - patlen - 1] ) )
-						continue;
-
-				} else if ( a->acl_dn_style == ACL_STYLE_CHILDREN ) {
-					if ( dnlen <= patlen )
-						continue;
-					if ( !DN_SEPARATOR( e->e_ndn[dnlen - patlen - 1] ) )
-						continue;
-				}
-
-				if ( strcmp( a->acl_dn_pat.bv_val, e->e_ndn + dnlen - patlen ) != 0 )
-					continue;
 			}
+			if ( !acl_match_dn( a, e, matches->dn_count, matches->dn_data ) )
+				continue;
 
 			Debug( LDAP_DEBUG_ACL, "=> acl_get: [%d] matched\n",
 				*count );
@@ -693,7 +1011,11 @@ slap_acl_get(
 			}
 		}
 
-		if ( a->acl_filter != NULL ) {
+		if ( am != NULL ) {
+			if ( !ACL_MEMO_ISSET( am->am_filter, a->acl_cpos ) )
+				continue;
+
+		} else if ( a->acl_filter != NULL ) {
 			ber_int_t rc = test_filter( NULL, e, a->acl_filter );
 			if ( rc != LDAP_COMPARE_TRUE ) {
 				continue;
@@ -708,6 +1030,8 @@ slap_acl_get(
 	if ( !state->as_fe_done ) {
 		state->as_fe_done = 1;
 		a = frontendDB->be_acl;
+		if ( a && __atomic_load_n( &a->acl_cidx, __ATOMIC_ACQUIRE ) == NULL )
+			acl_compile( a );
 		goto retry;
 	}
 
@@ -2503,6 +2827,8 @@ acl_init( void )
 {
 	int	i, rc;
 
+	ldap_pvt_thread_mutex_init( &acl_index_mutex );
+
 	for ( i = 0; acl_init_func[ i ] != NULL; i++ ) {
 		rc = (*(acl_init_func[ i ]))();
 		if ( rc != 0 ) {
@@ -2300,6 +2300,7 @@ acl_append( AccessControl **l, AccessControl *a, int pos )
 {
 	int i;
 
+	acl_uncompile();
 	for (i=0 ; i != pos && *l != NULL; l = &(*l)->acl_next, i++ ) {
 		;	/* Empty */
 	}
@@ -2360,6 +2361,8 @@ acl_free( AccessControl *a )
 	Access *n;
 	AttributeName *an;
 
+	if ( a->acl_cidx )
+		acl_uncompile();
 	if ( a->acl_filter ) {
 		filter_free( a->acl_filter );
 	}
@@ -64,6 +64,7 @@ mdb_add(Operation *op, SlapReply *rs )
 	}
 
 	/* begin transaction */
+	opinfo.moi_flag = MOI_GROUP;
 	rs->sr_err = mdb_opinfo_get( op, mdb, 0, &moi );
 	rs->sr_text = NULL;
 	if( rs->sr_err != 0 ) {
@@ -312,7 +313,8 @@ mdb_add(Operation *op, SlapReply *rs )
 	}
 
 	/* attribute indexes */
-	rs->sr_err = mdb_index_entry_add( op, txn, op->ora_e );
+	rs->sr_err = mdb_index_entry( op, txn, ( moi->moi_flag & MOI_DEFER ) ?
+		MDB_INDEX_DEFER_OP : SLAP_INDEX_ADD_OP, op->ora_e );
 	if ( rs->sr_err != LDAP_SUCCESS ) {
 		Debug( LDAP_DEBUG_TRACE,
 			LDAP_XSTRING(mdb_add) ": index_entry_add failed\n" );
@@ -360,16 +362,18 @@ mdb_add(Operation *op, SlapReply *rs )
 		opinfo.moi_oe.oe_key = NULL;
 		if ( op->o_noop ) {
 			mdb->mi_numads = numads;
-			mdb_txn_abort( txn );
+			mdb_opinfo_abort( mdb, &opinfo );
 			rs->sr_err = LDAP_X_NO_OPERATION;
 			txn = NULL;
 			goto return_results;
 		}
 
-		rs->sr_err = mdb_txn_commit( txn );
+		rs->sr_err = mdb_opinfo_commit( mdb, &opinfo );
 		txn = NULL;
 		if ( rs->sr_err != 0 ) {
-			mdb->mi_numads = numads;
+			/* a failed group has reset it already */
+			if ( !( opinfo.moi_flag & MOI_GROUP ))
+				mdb->mi_numads = numads;
 			rs->sr_text = "txn_commit failed";
 			Debug( LDAP_DEBUG_ANY,
 				LDAP_XSTRING(mdb_add) ": %s : %s (%d)\n",
@@ -394,7 +398,7 @@ return_results:
 	if( moi == &opinfo ) {
 		if( txn != NULL ) {
 			mdb->mi_numads = numads;
-			mdb_txn_abort( txn );
+			mdb_opinfo_abort( mdb, &opinfo );
 		}
 		if ( opinfo.moi_oe.oe_key ) {
 			LDAP_SLIST_REMOVE( &op->o_extra, &opinfo.moi_oe, OpExtra, oe_next );
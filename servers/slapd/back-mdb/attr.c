@@ -110,7 +110,8 @@ mdb_attr_dbs_open(
 				cr->msg );
 			return rc;
 		}
-		dbis = ch_calloc( 1, mdb->mi_nattrs * sizeof(MDB_dbi) );
+		/* the sort index handles go in the second half */
+		dbis = ch_calloc( 2, mdb->mi_nattrs * sizeof(MDB_dbi) );
 	} else {
 		rc = 0;
 	}
@@ -142,6 +143,50 @@ mdb_attr_dbs_open(
 			dbis[i] = mdb->mi_attrs[i]->ai_dbi;
 	}
 
+	/* Sort indexes each have a DB of their own, whose keys are the
+	 * normalized values themselves.
+	 */
+	for ( i=0; !rc && i<mdb->mi_nattrs; i++ ) {
+		AttrInfo *ai = mdb->mi_attrs[i], *sort;
+		struct berval name;
+
+		if ( !(( ai->ai_indexmask | ai->ai_newmask ) & SLAP_INDEX_SORT ))
+			continue;
+		if ( ai->ai_sort ) {
+			/* Built from scratch when added at runtime */
+			if (( ai->ai_newmask & ~ai->ai_indexmask & SLAP_INDEX_SORT ) &&
+				!mdb->mi_index_task )
+				rc = mdb_drop( txn, ai->ai_sort->ai_dbi, 0 );
+			continue;
+		}
+		name.bv_len = ai->ai_desc->ad_cname.bv_len + 1;
+		name.bv_val = ch_malloc( name.bv_len + 1 );
+		name.bv_val[0] = SLAP_INDEX_SORT_PREFIX;
+		strcpy( name.bv_val+1, ai->ai_desc->ad_cname.bv_val );
+		sort = ch_calloc( 1, sizeof(AttrInfo) );
+		sort->ai_desc = ai->ai_desc;
+		sort->ai_multi_hi = UINT_MAX;
+		sort->ai_multi_lo = UINT_MAX;
+		rc = mdb_dbi_open( txn, name.bv_val, flags, &sort->ai_dbi );
+		if ( rc == 0 && ( ai->ai_newmask & ~ai->ai_indexmask & SLAP_INDEX_SORT ))
+			rc = mdb_drop( txn, sort->ai_dbi, 0 );
+		if ( rc ) {
+			snprintf( cr->msg, sizeof(cr->msg), "database \"%s\": "
+				"mdb_dbi_open(%s) failed: %s (%d).",
+				be->be_suffix[0].bv_val, name.bv_val,
+				mdb_strerror(rc), rc );
+			Debug( LDAP_DEBUG_ANY,
+				LDAP_XSTRING(mdb_attr_dbs) ": %s\n",
+				cr->msg );
+			ch_free( sort );
+		} else {
+			ai->ai_sort = sort;
+			if ( dbis )
+				dbis[mdb->mi_nattrs + i] = sort->ai_dbi;
+		}
+		ch_free( name.bv_val );
+	}
+
 	/* Only commit if this is our txn */
 	if ( tx0 == NULL ) {
 		if ( !rc ) {
@@ -160,6 +205,10 @@ mdb_attr_dbs_open(
 		/* Something failed, forget anything we just opened */
 		if ( rc ) {
 			for ( i=0; i<mdb->mi_nattrs; i++ ) {
+				if ( dbis[mdb->mi_nattrs + i] ) {
+					ch_free( mdb->mi_attrs[i]->ai_sort );
+					mdb->mi_attrs[i]->ai_sort = NULL;
+				}
 				if ( dbis[i] ) {
 					mdb->mi_attrs[i]->ai_dbi = 0;
 					mdb->mi_attrs[i]->ai_indexmask |= MDB_INDEX_DELETING;
@@ -179,11 +228,17 @@ mdb_attr_dbs_close(
 )
 {
 	int i;
-	for ( i=0; i<mdb->mi_nattrs; i++ )
+	for ( i=0; i<mdb->mi_nattrs; i++ ) {
 		if ( mdb->mi_attrs[i]->ai_dbi ) {
 			mdb_dbi_close( mdb->mi_dbenv, mdb->mi_attrs[i]->ai_dbi );
 			mdb->mi_attrs[i]->ai_dbi = 0;
 		}
+		if ( mdb->mi_attrs[i]->ai_sort ) {
+			mdb_dbi_close( mdb->mi_dbenv, mdb->mi_attrs[i]->ai_sort->ai_dbi );
+			ch_free( mdb->mi_attrs[i]->ai_sort );
+			mdb->mi_attrs[i]->ai_sort = NULL;
+		}
+	}
 }
 
 int
@@ -374,6 +429,22 @@ fail:
 			goto fail;
 		}
 
+		/* the sort index keeps values in the order of memcmp, only
+		 * of use with the ordering rules that compare that way */
+		if( IS_SLAP_INDEX( mask, SLAP_INDEX_SORT ) &&
+			ad->ad_type->sat_ordering &&
+			ad->ad_type->sat_ordering->smr_match != octetStringOrderingMatch )
+		{
+			if (c_reply) {
+				snprintf(c_reply->msg, sizeof(c_reply->msg),
+					"sort index of attribute \"%s\" disallowed", attrs[i] );
+				fprintf( stderr, "%s: line %d: %s\n",
+					fname, lineno, c_reply->msg );
+			}
+			rc = LDAP_INAPPROPRIATE_MATCHING;
+			goto fail;
+		}
+
 		Debug( LDAP_DEBUG_CONFIG, "index %s 0x%04lx\n",
 			ad->ad_cname.bv_val, mask );
 
@@ -388,6 +459,7 @@ fail:
 		a->ai_dbi = 0;
 		a->ai_multi_hi = UINT_MAX;
 		a->ai_multi_lo = UINT_MAX;
+		a->ai_sort = NULL;
 
 		if ( mdb->mi_flags & MDB_IS_OPEN ) {
 			a->ai_indexmask = 0;
@@ -441,11 +513,11 @@ fail:
 				 * it must be replaced. Otherwise we end up with multiple 
 				 * olcIndex values for the same attribute */
 				if ( b->ai_indexmask & MDB_INDEX_DELETING ) {
-					/* If we were editing this attr, reset it */
+					/* If we were editing this attr, reset it. If it
+					 * was still being built, only its old mask is
+					 * complete: the online indexer starts over.
+					 */
 					b->ai_indexmask &= ~MDB_INDEX_DELETING;
-					/* If this is leftover from a previous add, commit it */
-					if ( b->ai_newmask )
-						b->ai_indexmask = b->ai_newmask;
 					b->ai_newmask = a->ai_newmask;
 					ch_free( a );
 					rc = 0;
@@ -479,14 +551,16 @@ mdb_attr_index_unparser( void *v1, void *v2 )
 	BerVarray *bva = v2;
 	struct berval bv;
 	char *ptr;
+	/* an index being built is configured with its new mask */
+	slap_mask_t mask = ai->ai_newmask ? ai->ai_newmask : ai->ai_indexmask;
 
-	slap_index2bvlen( ai->ai_indexmask, &bv );
+	slap_index2bvlen( mask, &bv );
 	if ( bv.bv_len ) {
 		bv.bv_len += ai->ai_desc->ad_cname.bv_len + 1;
 		ptr = ch_malloc( bv.bv_len+1 );
 		bv.bv_val = lutil_strcopy( ptr, ai->ai_desc->ad_cname.bv_val );
 		*bv.bv_val++ = ' ';
-		slap_index2bv( ai->ai_indexmask, &bv );
+		slap_index2bv( mask, &bv );
 		bv.bv_val = ptr;
 		ber_bvarray_add( bva, &bv );
 	}
@@ -506,7 +580,7 @@ mdb_attr_index_unparse( struct mdb_info *mdb, BerVarray *bva )
 		mdb_attr_index_unparser( &aidef, bva );
 	}
 	for ( i=0; i<mdb->mi_nattrs; i++ )
-		if ( mdb->mi_attrs[i]->ai_indexmask )
+		if ( mdb->mi_attrs[i]->ai_indexmask || mdb->mi_attrs[i]->ai_newmask )
 			mdb_attr_index_unparser( mdb->mi_attrs[i], bva );
 }
 
@@ -677,6 +751,7 @@ mdb_attr_info_free( AttrInfo *ai )
 #ifdef LDAP_COMP_MATCH
 	free( ai->ai_cr );
 #endif
+	free( ai->ai_sort );
 	free( ai );
 }
 
@@ -751,6 +826,14 @@ int mdb_ad_read( struct mdb_info *mdb, MDB_txn *txn )
 	rc = mdb_cursor_get( mc, &key, &data, MDB_SET );
 
 	while ( rc == MDB_SUCCESS ) {
+		int k;
+
+		/* compression dictionaries follow the descriptions */
+		memcpy( &k, key.mv_data, sizeof(int) );
+		if ( k >= MDB_MAXADS ) {
+			rc = MDB_NOTFOUND;
+			break;
+		}
 		bdata.bv_len = data.mv_size;
 		bdata.bv_val = data.mv_data;
 		ad = NULL;
@@ -822,3 +905,128 @@ void mdb_ad_unwind( struct mdb_info *mdb, int prev_ads )
 	}
 	mdb->mi_numads = i;
 }
+
+/* The indices being built online are recorded in the ad2id DB under
+ * key 0, which no AttributeDescription uses, so that the build resumes
+ * where it stopped when the database is opened again: the ID of the
+ * next entry to index, followed by an mdb_ixstate for each index.
+ */
+typedef struct mdb_ixstate {
+	int is_adx;				/* ad2id index of the attribute */
+	unsigned is_mask;		/* index types already complete */
+	unsigned is_newmask;	/* index types being built */
+} mdb_ixstate;
+
+#define IS_BUILDING(ai)	((ai)->ai_newmask && \
+	!((ai)->ai_indexmask & MDB_INDEX_DELETING))
+
+/* Restore the state of the indices that were being built. Returns
+ * the number of indices that still need building.
+ */
+int mdb_ixstate_get( struct mdb_info *mdb, MDB_txn *txn )
+{
+	MDB_val key, data;
+	mdb_ixstate is;
+	AttrInfo *ai;
+	slap_mask_t mask;
+	char *ptr;
+	ID next;
+	int zero = 0, restart = 0, n = 0, rc;
+
+	key.mv_size = sizeof(int);
+	key.mv_data = &zero;
+	rc = mdb_get( txn, mdb->mi_ad2id, &key, &data );
+	if ( rc ) {
+		if ( rc != MDB_NOTFOUND )
+			Debug( LDAP_DEBUG_ANY,
+				"mdb_ixstate_get: mdb_get failed %s(%d)\n",
+				mdb_strerror(rc), rc );
+		return 0;
+	}
+	if ( data.mv_size < sizeof(ID) )
+		return 0;
+
+	ptr = data.mv_data;
+	memcpy( &next, ptr, sizeof(ID) );
+	for ( ptr += sizeof(ID); ptr + sizeof(is) <= (char *)data.mv_data + data.mv_size;
+		ptr += sizeof(is) ) {
+		memcpy( &is, ptr, sizeof(is) );
+		if ( is.is_adx < 1 || is.is_adx > mdb->mi_numads )
+			continue;
+		ai = mdb_attr_mask( mdb, mdb->mi_ads[is.is_adx] );
+		if ( !ai || !ai->ai_indexmask )
+			continue;
+		/* the index is configured as it is meant to be once built */
+		mask = ai->ai_indexmask;
+		if ( !( mask & ~is.is_mask ))
+			continue;
+		ai->ai_indexmask = mask & is.is_mask;
+		ai->ai_newmask = mask;
+		/* the configuration changed meanwhile, start over */
+		if ( mask != is.is_newmask )
+			restart = 1;
+		n++;
+		Debug( LDAP_DEBUG_ANY, "mdb_ixstate_get: "
+			"index of %s still being built\n",
+			ai->ai_desc->ad_cname.bv_val );
+	}
+	if ( n )
+		mdb->mi_index_next = restart ? 1 : next;
+	return n;
+}
+
+/* Record the indices being built in txn, or clear the record if
+ * there are none.
+ */
+int mdb_ixstate_put( struct mdb_info *mdb, MDB_txn *txn )
+{
+	MDB_val key, data;
+	mdb_ixstate *is;
+	AttrInfo *ai;
+	int zero = 0, prev_ads = mdb->mi_numads;
+	int i, n = 0, rc = 0;
+
+	for ( i = 0; i < mdb->mi_nattrs; i++ ) {
+		ai = mdb->mi_attrs[i];
+		if ( !IS_BUILDING( ai ))
+			continue;
+		rc = mdb_ad_get( mdb, txn, ai->ai_desc );
+		if ( rc )
+			goto fail;
+		n++;
+	}
+
+	key.mv_size = sizeof(int);
+	key.mv_data = &zero;
+	if ( !n ) {
+		rc = mdb_del( txn, mdb->mi_ad2id, &key, NULL );
+		if ( rc == MDB_NOTFOUND )
+			rc = 0;
+		goto fail;
+	}
+
+	data.mv_size = sizeof(ID) + n * sizeof(mdb_ixstate);
+	data.mv_data = ch_malloc( data.mv_size );
+	memcpy( data.mv_data, &mdb->mi_index_next, sizeof(ID) );
+	is = (mdb_ixstate *)((char *)data.mv_data + sizeof(ID));
+	for ( i = 0; i < mdb->mi_nattrs; i++ ) {
+		ai = mdb->mi_attrs[i];
+		if ( !IS_BUILDING( ai ))
+			continue;
+		is->is_adx = mdb->mi_adxs[ai->ai_desc->ad_index];
+		is->is_mask = ai->ai_indexmask;
+		is->is_newmask = ai->ai_newmask;
+		is++;
+	}
+	rc = mdb_put( txn, mdb->mi_ad2id, &key, &data, 0 );
+	ch_free( data.mv_data );
+
+fail:
+	if ( rc ) {
+		Debug( LDAP_DEBUG_ANY,
+			"mdb_ixstate_put: failed %s(%d)\n",
+			mdb_strerror(rc), rc );
+		mdb_ad_unwind( mdb, prev_ads );
+	}
+	return rc;
+}
@@ -51,6 +51,12 @@ LDAP_BEGIN_DECL
 /* Most users will never see this */
 #define DEFAULT_RTXN_SIZE	10000
 
+/* Candidate count below which further AND terms aren't fetched */
+#define DEFAULT_PLAN_THRESHOLD	16
+
+/* Entries reindexed per txn by the online indexer */
+#define DEFAULT_INDEX_CHUNK	100
+
 #ifdef LDAP_DEVEL
 #define MDB_MONITOR_IDX
 #endif
@@ -63,6 +69,40 @@ typedef struct mdb_monitor_t {
 /* From ldap_rq.h */
 struct re_s;
 
+struct mdb_info;
+
+/* A decoded entry kept by the entry cache, followed by its
+ * attributes, their value arrays and the values themselves */
+typedef struct mdb_ecache_ent {
+	struct mdb_info	*ce_mdb;
+	ID		ce_id;
+	int		ce_refcnt;	/* the cache's, plus one per shell */
+	int		ce_nattrs;
+	slap_mask_t	ce_ocflags;
+} mdb_ecache_ent;
+
+typedef struct mdb_ecache_slot {
+	mdb_ecache_ent	*cs_ent;
+	size_t		cs_modtxn;	/* last txn storing an entry of this slot */
+} mdb_ecache_slot;
+
+typedef struct mdb_ecache_lock {
+	ldap_pvt_thread_mutex_t	el_mutex;
+	unsigned long	el_hits;
+	unsigned long	el_misses;
+} mdb_ecache_lock;
+
+#define MDB_ECACHE_LOCKS	64
+
+/* The first word of a compressed id2entry record has this bit set */
+#define MDB_ENC_PACKED	(1U<<(sizeof(unsigned int)*CHAR_BIT-1))
+
+/* Most compression dictionaries in a database */
+#define MDB_MAXDICTS	64
+
+struct mdb_dict;
+struct mdb_dict_sampler;
+
 struct mdb_info {
 	MDB_env		*mi_dbenv;
 
@@ -89,6 +129,27 @@ struct mdb_info {
 
 	struct re_s		*mi_txn_cp_task;
 	struct re_s		*mi_index_task;
+	ID			mi_index_next;	/* next entry the online indexer reads */
+	unsigned	mi_index_chunk;	/* entries per txn */
+	unsigned	mi_index_rate;	/* max entries per second, 0 = no limit */
+	int			mi_index_defer;	/* a bulk load is putting indexing off */
+
+	unsigned	mi_gc_maxops;	/* group commit: updates per txn, 0 = off */
+	unsigned	mi_gc_msec;	/* longest wait for a group to fill */
+	ldap_pvt_thread_mutex_t	mi_gc_mutex;
+	ldap_pvt_thread_cond_t	mi_gc_cond;
+	MDB_txn		*mi_gc_txn;	/* the txn shared by the group */
+	int			mi_gc_state;
+	int			mi_gc_busy;	/* a member's child txn is open */
+	int			mi_gc_waiting;	/* writers waiting to join */
+	int			mi_gc_pending;	/* members waiting for the commit */
+	unsigned	mi_gc_nops;	/* updates committed to the group */
+	unsigned long	mi_gc_gen;	/* groups begun */
+	unsigned long	mi_gc_done;	/* groups ended */
+	int			mi_gc_rc;	/* result of the last group's commit */
+	int			mi_gc_numads;	/* mi_numads when the group began */
+	int			mi_gc_cnumads;	/* ...and when the open child began */
+	struct timeval	mi_gc_start;
 
 	mdb_monitor_t	mi_monitor;
 
@@ -103,6 +164,7 @@ struct mdb_info {
 #define	MDB_DEL_INDEX	0x08
 #define	MDB_RE_OPEN		0x10
 #define	MDB_NEED_UPGRADE	0x20
+#define	MDB_RESIZE_ECACHE	0x40
 
 	int mi_numads;
 
@@ -113,6 +175,34 @@ struct mdb_info {
 		/* less than this many values in an attr goes
 		 * back into main blob */
 
+	int		mi_idl_bitmap;
+		/* store oversized index keys as bitmaps */
+
+	unsigned	mi_plan_threshold;
+		/* stop fetching AND terms once there are fewer
+		 * candidates than this */
+	/* updated atomically, without a lock */
+	unsigned long	mi_plan_ands;	/* AND filters planned */
+	unsigned long	mi_plan_reorders;	/* ...whose terms were reordered */
+	unsigned long	mi_plan_skipped;	/* AND terms never fetched */
+
+	unsigned	mi_search_threads;
+		/* threads sharing the filter tests of a large search */
+
+	unsigned	mi_ecache_size;
+		/* number of decoded entries to cache */
+	unsigned	mi_ecache_nslots;
+	mdb_ecache_slot	*mi_ecache;
+	mdb_ecache_lock	mi_ecache_locks[MDB_ECACHE_LOCKS];
+
+	int		mi_compress;	/* compress id2entry records */
+	unsigned	mi_dict_size;
+		/* size of the dictionary slapadd trains, 0 = none */
+	ldap_pvt_thread_mutex_t	mi_dict_mutex;
+	int		mi_ndicts;
+	struct mdb_dict	*mi_dicts[MDB_MAXDICTS];
+	struct mdb_dict_sampler	*mi_dict_train;	/* slapadd is sampling */
+
 	MDB_dbi	mi_dbis[MDB_NDB];
 	AttributeDescription *mi_ads[MDB_MAXADS];
 	int mi_adxs[MDB_MAXADS];
@@ -128,10 +218,15 @@ typedef struct mdb_op_info {
 	MDB_txn*	moi_txn;
 	int			moi_ref;
 	char		moi_flag;
+	unsigned long	moi_gen;	/* the group this write txn joined */
 } mdb_op_info;
 #define MOI_READER	0x01
 #define MOI_FREEIT	0x02
 #define MOI_KEEPER	0x04
+#define MOI_GROUP	0x08	/* may join a group commit */
+#define MOI_LEADER	0x10	/* commits the group it joined */
+#define MOI_BULK	0x20	/* the txn of a bulk load */
+#define MOI_DEFER	0x40	/* an update in a bulk load's txn */
 
 LDAP_END_DECL
 
@@ -149,6 +244,7 @@ typedef struct mdb_attrinfo {
 	MDB_dbi ai_dbi;
 	unsigned ai_multi_hi;
 	unsigned ai_multi_lo;
+	struct mdb_attrinfo *ai_sort;	/* the sort index, in its own DB */
 } AttrInfo;
 
 /* tool threaded indexer state */
@@ -162,6 +258,7 @@ typedef struct mdb_attrixinfo {
 /* These flags must not clash with SLAP_INDEX flags or ops in slap.h! */
 #define	MDB_INDEX_DELETING	0x8000U	/* index is being modified */
 #define	MDB_INDEX_UPDATE_OP	0x03	/* performing an index update */
+#define	MDB_INDEX_DEFER_OP	0x04	/* adding, but not to indices being built */
 
 /* For slapindex to record which attrs in an entry belong to which
  * index database 
@@ -0,0 +1,284 @@
+/* cache.c - cache of decoded entries */
+/* $OpenLDAP$ */
+/* This work is part of OpenLDAP Software <http://www.openldap.org/>.
+ *
+ * Copyright 2000-2020 The OpenLDAP Foundation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+#include "portable.h"
+
+#include <stdio.h>
+#include <ac/string.h>
+
+#include "back-mdb.h"
+
+/* The cache is direct mapped: entry ID n lives in slot n % mi_ecache_nslots.
+ * A cached entry is a private copy of what mdb_entry_decode returned,
+ * with its values copied out of the map, so it outlives the read txn
+ * it was decoded in. Users never get the copy itself, but a shell
+ * allocated per operation whose attributes share the copy's values;
+ * the shell's e_private points to the copy, which stays allocated
+ * until the last shell is returned, even if it was evicted meanwhile.
+ *
+ * Every slot remembers the last write txn that stored or deleted an
+ * entry of that slot. Writers update it before they commit, so a
+ * reader whose snapshot is older than that txn never gets nor stores
+ * a copy from that slot.
+ */
+
+/* The number of slots is a multiple of MDB_ECACHE_LOCKS, so the IDs
+ * sharing a slot share its lock too */
+#define ECACHE_LOCK(mdb, id)	(&(mdb)->mi_ecache_locks[(id) % MDB_ECACHE_LOCKS])
+
+void
+mdb_ecache_init( struct mdb_info *mdb )
+{
+	int i;
+
+	for ( i = 0; i < MDB_ECACHE_LOCKS; i++ )
+		ldap_pvt_thread_mutex_init( &mdb->mi_ecache_locks[i].el_mutex );
+}
+
+void
+mdb_ecache_destroy( struct mdb_info *mdb )
+{
+	int i;
+
+	mdb_ecache_resize( mdb, 0 );
+	for ( i = 0; i < MDB_ECACHE_LOCKS; i++ )
+		ldap_pvt_thread_mutex_destroy( &mdb->mi_ecache_locks[i].el_mutex );
+}
+
+/* drop a reference; the caller holds the lock of ce's ID */
+static void
+mdb_ecache_unref( mdb_ecache_ent *ce )
+{
+	if ( --ce->ce_refcnt == 0 )
+		ch_free( ce );
+}
+
+/* Empty the cache and give it room for nslots entries. Called when
+ * the database is opened or reconfigured, so no write is in progress.
+ */
+void
+mdb_ecache_resize( struct mdb_info *mdb, unsigned nslots )
+{
+	mdb_ecache_slot *slots = NULL;
+	unsigned i;
+
+	if ( nslots ) {
+		MDB_envinfo mei;
+
+		nslots = ( nslots + MDB_ECACHE_LOCKS - 1 ) & ~( MDB_ECACHE_LOCKS - 1 );
+
+		/* Writes before now were not recorded: only readers
+		 * that see all of them may use the new slots.
+		 */
+		mdb_env_info( mdb->mi_dbenv, &mei );
+		slots = ch_malloc( nslots * sizeof(mdb_ecache_slot) );
+		for ( i = 0; i < nslots; i++ ) {
+			slots[i].cs_ent = NULL;
+			slots[i].cs_modtxn = mei.me_last_txnid;
+		}
+	}
+
+	for ( i = 0; i < MDB_ECACHE_LOCKS; i++ )
+		ldap_pvt_thread_mutex_lock( &mdb->mi_ecache_locks[i].el_mutex );
+
+	for ( i = 0; i < mdb->mi_ecache_nslots; i++ ) {
+		if ( mdb->mi_ecache[i].cs_ent )
+			mdb_ecache_unref( mdb->mi_ecache[i].cs_ent );
+	}
+	ch_free( mdb->mi_ecache );
+	mdb->mi_ecache = slots;
+	mdb->mi_ecache_nslots = nslots;
+
+	for ( i = 0; i < MDB_ECACHE_LOCKS; i++ )
+		ldap_pvt_thread_mutex_unlock( &mdb->mi_ecache_locks[i].el_mutex );
+}
+
+/* Return a shell for the cached copy of entry id if txn may see it */
+int
+mdb_ecache_get( Operation *op, MDB_txn *txn, ID id, Entry **e )
+{
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	mdb_ecache_lock *el = ECACHE_LOCK( mdb, id );
+	mdb_ecache_ent *ce = NULL;
+	mdb_ecache_slot *cs;
+	Entry *x;
+	Attribute *a;
+	int i;
+
+	ldap_pvt_thread_mutex_lock( &el->el_mutex );
+	if ( mdb->mi_ecache_nslots ) {
+		cs = &mdb->mi_ecache[id % mdb->mi_ecache_nslots];
+		if ( cs->cs_ent && cs->cs_ent->ce_id == id &&
+			mdb_txn_id( txn ) >= cs->cs_modtxn ) {
+			ce = cs->cs_ent;
+			ce->ce_refcnt++;
+			el->el_hits++;
+		} else {
+			el->el_misses++;
+		}
+	}
+	ldap_pvt_thread_mutex_unlock( &el->el_mutex );
+
+	if ( !ce )
+		return MDB_NOTFOUND;
+
+	x = op->o_tmpalloc( sizeof(Entry) + ce->ce_nattrs * sizeof(Attribute),
+		op->o_tmpmemctx );
+	BER_BVZERO( &x->e_bv );
+	x->e_private = ce;
+	x->e_ocflags = ce->ce_ocflags;
+	if ( ce->ce_nattrs ) {
+		x->e_attrs = (Attribute *)(x+1);
+		a = x->e_attrs;
+		memcpy( a, ce+1, ce->ce_nattrs * sizeof(Attribute) );
+		for ( i = 1; i < ce->ce_nattrs; i++, a++ )
+			a->a_next = a+1;
+		a->a_next = NULL;
+	} else {
+		x->e_attrs = NULL;
+	}
+	*e = x;
+	return 0;
+}
+
+/* Keep a copy of entry e, decoded from id2entry in txn */
+void
+mdb_ecache_put( Operation *op, MDB_txn *txn, Entry *e )
+{
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	mdb_ecache_lock *el = ECACHE_LOCK( mdb, e->e_id );
+	mdb_ecache_ent *ce, *old = NULL;
+	mdb_ecache_slot *cs;
+	Attribute *a, *ca;
+	struct berval *bv;
+	char *ptr;
+	size_t len;
+	int nattrs = 0, nvals = 0, i;
+
+	len = sizeof(mdb_ecache_ent);
+	for ( a = e->e_attrs; a; a = a->a_next ) {
+		nattrs++;
+		for ( i = 0; i < a->a_numvals; i++ )
+			len += a->a_vals[i].bv_len + 1;
+		nvals += a->a_numvals + 1;
+		if ( a->a_nvals != a->a_vals ) {
+			for ( i = 0; i < a->a_numvals; i++ )
+				len += a->a_nvals[i].bv_len + 1;
+			nvals += a->a_numvals + 1;
+		}
+	}
+	len += nattrs * sizeof(Attribute) + nvals * sizeof(struct berval);
+
+	ce = ch_malloc( len );
+	ce->ce_mdb = mdb;
+	ce->ce_id = e->e_id;
+	ce->ce_refcnt = 1;
+	ce->ce_nattrs = nattrs;
+	ce->ce_ocflags = e->e_ocflags;
+
+	ca = (Attribute *)(ce+1);
+	bv = (struct berval *)(ca + nattrs);
+	ptr = (char *)(bv + nvals);
+	for ( a = e->e_attrs; a; a = a->a_next, ca++ ) {
+		*ca = *a;
+		ca->a_next = NULL;
+		ca->a_vals = bv;
+		for ( i = 0; i < a->a_numvals; i++, bv++ ) {
+			bv->bv_len = a->a_vals[i].bv_len;
+			bv->bv_val = ptr;
+			memcpy( ptr, a->a_vals[i].bv_val, bv->bv_len );
+			ptr += bv->bv_len;
+			*ptr++ = '\0';
+		}
+		BER_BVZERO( bv );
+		bv++;
+		if ( a->a_nvals != a->a_vals ) {
+			ca->a_nvals = bv;
+			for ( i = 0; i < a->a_numvals; i++, bv++ ) {
+				bv->bv_len = a->a_nvals[i].bv_len;
+				bv->bv_val = ptr;
+				memcpy( ptr, a->a_nvals[i].bv_val, bv->bv_len );
+				ptr += bv->bv_len;
+				*ptr++ = '\0';
+			}
+			BER_BVZERO( bv );
+			bv++;
+		} else {
+			ca->a_nvals = ca->a_vals;
+		}
+	}
+
+	ldap_pvt_thread_mutex_lock( &el->el_mutex );
+	if ( mdb->mi_ecache_nslots ) {
+		cs = &mdb->mi_ecache[e->e_id % mdb->mi_ecache_nslots];
+		if ( mdb_txn_id( txn ) >= cs->cs_modtxn ) {
+			old = cs->cs_ent;
+			cs->cs_ent = ce;
+			ce = NULL;
+		}
+	}
+	if ( old )
+		mdb_ecache_unref( old );
+	ldap_pvt_thread_mutex_unlock( &el->el_mutex );
+
+	if ( ce )
+		ch_free( ce );
+}
+
+/* Entry id is being stored or deleted by the write txn txn */
+void
+mdb_ecache_invalidate( struct mdb_info *mdb, MDB_txn *txn, ID id )
+{
+	mdb_ecache_lock *el = ECACHE_LOCK( mdb, id );
+	mdb_ecache_slot *cs;
+
+	ldap_pvt_thread_mutex_lock( &el->el_mutex );
+	if ( mdb->mi_ecache_nslots ) {
+		cs = &mdb->mi_ecache[id % mdb->mi_ecache_nslots];
+		cs->cs_modtxn = mdb_txn_id( txn );
+		if ( cs->cs_ent && cs->cs_ent->ce_id == id ) {
+			mdb_ecache_unref( cs->cs_ent );
+			cs->cs_ent = NULL;
+		}
+	}
+	ldap_pvt_thread_mutex_unlock( &el->el_mutex );
+}
+
+/* A shell from mdb_ecache_get is being returned */
+void
+mdb_ecache_release( mdb_ecache_ent *ce )
+{
+	mdb_ecache_lock *el = ECACHE_LOCK( ce->ce_mdb, ce->ce_id );
+
+	ldap_pvt_thread_mutex_lock( &el->el_mutex );
+	mdb_ecache_unref( ce );
+	ldap_pvt_thread_mutex_unlock( &el->el_mutex );
+}
+
+void
+mdb_ecache_stats( struct mdb_info *mdb, unsigned long *hits,
+	unsigned long *misses )
+{
+	int i;
+
+	*hits = *misses = 0;
+	for ( i = 0; i < MDB_ECACHE_LOCKS; i++ ) {
+		ldap_pvt_thread_mutex_lock( &mdb->mi_ecache_locks[i].el_mutex );
+		*hits += mdb->mi_ecache_locks[i].el_hits;
+		*misses += mdb->mi_ecache_locks[i].el_misses;
+		ldap_pvt_thread_mutex_unlock( &mdb->mi_ecache_locks[i].el_mutex );
+	}
+}
@@ -0,0 +1,646 @@
+/* compress.c - compression of id2entry records */
+/* $OpenLDAP$ */
+/* This work is part of OpenLDAP Software <http://www.openldap.org/>.
+ *
+ * Copyright 2000-2020 The OpenLDAP Foundation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+#include "portable.h"
+
+#include <stdio.h>
+#include <ac/string.h>
+
+#include "back-mdb.h"
+
+/* A packed record starts with four words: MDB_ENC_PACKED ORed with
+ * the ID of the dictionary it was compressed with (0 for none), the
+ * number of attributes and of values of the entry, and the length of
+ * the record as mdb_entry_encode() built it. The compressed record
+ * follows.
+ *
+ * The codec is a byte oriented LZ77 in the style of LZ4: a sequence
+ * is a token byte holding a literal length and a match length in its
+ * nibbles, extended by 255s, followed by the literals and the 16 bit
+ * distance of the match, less one. The last sequence has literals only.
+ * A dictionary is a block of text that matches may refer to as if it
+ * preceded the record, so that even small entries find matches.
+ *
+ * Dictionaries are trained by slapadd from the first entries it adds,
+ * stored in the ad2id DB after the attribute descriptions, and never
+ * changed once stored.
+ */
+
+#define LZ_MINMATCH	4
+#define LZ_MAXDIST	65536
+#define LZ_HLOG	12
+#define LZ_HSIZE	(1<<LZ_HLOG)
+
+#define LZ_READ32(p)	((p)[0] | (p)[1] << 8 | (p)[2] << 16 | (unsigned)(p)[3] << 24)
+#define LZ_HASH(p)	((LZ_READ32(p) * 2654435761U) >> (32 - LZ_HLOG))
+
+#define MDB_PACK_HDR	(4*sizeof(unsigned int))
+
+/* Dictionaries are stored at this key of ad2id plus their ID */
+#define MDB_DICT_KEY	MDB_MAXADS
+
+typedef struct mdb_dict {
+	unsigned	md_len;
+	unsigned	md_hash[LZ_HSIZE];	/* positions in md_data, plus 1 */
+	unsigned char	md_data[1];
+} mdb_dict;
+
+/* Entries sampled by slapadd to train a dictionary */
+typedef struct mdb_dict_sampler {
+	unsigned char	*ds_buf;
+	size_t	ds_len;
+	size_t	ds_max;	/* bytes to sample before training */
+	ID	*ds_ids;
+	unsigned	ds_nids;
+	unsigned	ds_maxids;
+} mdb_dict_sampler;
+
+/* Sample this many times the size of the dictionary */
+#define MDB_DICT_SAMPLES	32
+
+/* Length of the segments a dictionary is made of, and of the strings
+ * whose frequency in the samples decides which segments are chosen */
+#define MDB_DICT_SEGMENT	64
+#define MDB_DICT_DMER	8
+#define MDB_DICT_FLOG	18
+
+static size_t
+mdb_lz_bound( size_t len )
+{
+	return len + len / 255 + 16;
+}
+
+/* Length of the match at virtual position ref, where the dictionary
+ * is followed by the source */
+static int
+mdb_lz_count( mdb_dict *dict, const unsigned char *src, int slen,
+	int ref, int ip )
+{
+	const unsigned char *p = src + ip, *end = src + slen, *r, *dend;
+
+	if ( dict && ref < (int)dict->md_len ) {
+		r = dict->md_data + ref;
+		dend = dict->md_data + dict->md_len;
+		while ( p < end && r < dend && *p == *r ) {
+			p++;
+			r++;
+		}
+		if ( r < dend )
+			return p - ( src + ip );
+		r = src;
+	} else {
+		r = src + ref - ( dict ? dict->md_len : 0 );
+	}
+	while ( p < end && *p == *r ) {
+		p++;
+		r++;
+	}
+	return p - ( src + ip );
+}
+
+static unsigned char *
+mdb_lz_putlen( unsigned char *op, int len )
+{
+	for ( ; len >= 255; len -= 255 )
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+/* Compress src into dst. Returns the compressed length, or 0 if it
+ * would not fit in dcap bytes.
+ */
+static int
+mdb_lz_compress( mdb_dict *dict, const unsigned char *src, int slen,
+	unsigned char *dst, int dcap )
+{
+	unsigned htab[LZ_HSIZE], ref;
+	int dlen = dict ? dict->md_len : 0;
+	int ip = 0, anchor = 0, lit, len, step;
+	unsigned char *op = dst, *end = dst + dcap, *tok;
+
+	if ( dict )
+		memcpy( htab, dict->md_hash, sizeof(htab) );
+	else
+		memset( htab, 0, sizeof(htab) );
+
+	while ( ip + LZ_MINMATCH <= slen ) {
+		unsigned h = LZ_HASH( src + ip );
+
+		ref = htab[h];
+		htab[h] = dlen + ip + 1;
+		if ( !ref || dlen + ip - ( ref - 1 ) > LZ_MAXDIST ||
+			( len = mdb_lz_count( dict, src, slen, ref - 1, ip )) < LZ_MINMATCH ) {
+			/* skip faster through data that does not compress */
+			step = 1 + (( ip - anchor ) >> 6 );
+			ip += step;
+			continue;
+		}
+		lit = ip - anchor;
+		if ( op + 1 + lit + lit/255 + 3 + len/255 + 1 > end )
+			return 0;
+		tok = op++;
+		*tok = ( lit < 15 ? lit : 15 ) << 4;
+		if ( lit >= 15 )
+			op = mdb_lz_putlen( op, lit - 15 );
+		memcpy( op, src + anchor, lit );
+		op += lit;
+		ref = dlen + ip - ( ref - 1 ) - 1;
+		*op++ = ref & 0xff;
+		*op++ = ref >> 8;
+		len -= LZ_MINMATCH;
+		*tok |= len < 15 ? len : 15;
+		if ( len >= 15 )
+			op = mdb_lz_putlen( op, len - 15 );
+		ip += len + LZ_MINMATCH;
+		anchor = ip;
+		/* so that repeats of what was just matched are found */
+		if ( ip - 2 + LZ_MINMATCH <= slen )
+			htab[LZ_HASH( src + ip - 2 )] = dlen + ip - 2 + 1;
+	}
+	lit = slen - anchor;
+	if ( op + 1 + lit + lit/255 + 1 > end )
+		return 0;
+	tok = op++;
+	*tok = ( lit < 15 ? lit : 15 ) << 4;
+	if ( lit >= 15 )
+		op = mdb_lz_putlen( op, lit - 15 );
+	memcpy( op, src + anchor, lit );
+	op += lit;
+	return op - dst;
+}
+
+/* Decompress src into the dlen bytes of dst. Returns 0 if src was
+ * valid and filled dst exactly, -1 otherwise.
+ */
+static int
+mdb_lz_decompress( mdb_dict *dict, const unsigned char *src, int slen,
+	unsigned char *dst, int dlen )
+{
+	const unsigned char *ip = src, *iend = src + slen, *r;
+	unsigned char *op = dst, *oend = dst + dlen;
+	size_t len, off, n;
+	unsigned c, tok;
+
+	while ( ip < iend ) {
+		tok = *ip++;
+		len = tok >> 4;
+		if ( len == 15 ) {
+			do {
+				if ( ip >= iend )
+					return -1;
+				c = *ip++;
+				len += c;
+			} while ( c == 255 );
+		}
+		if ( len > (size_t)( iend - ip ) || len > (size_t)( oend - op ))
+			return -1;
+		memcpy( op, ip, len );
+		ip += len;
+		op += len;
+		if ( ip == iend )
+			break;
+
+		if ( iend - ip < 2 )
+			return -1;
+		off = ( ip[0] | ip[1] << 8 ) + 1;
+		ip += 2;
+		len = ( tok & 15 );
+		if ( len == 15 ) {
+			do {
+				if ( ip >= iend )
+					return -1;
+				c = *ip++;
+				len += c;
+			} while ( c == 255 );
+		}
+		len += LZ_MINMATCH;
+		if ( len > (size_t)( oend - op ))
+			return -1;
+		if ( off > (size_t)( op - dst )) {
+			/* starts in the dictionary */
+			n = off - ( op - dst );
+			if ( !dict || n > dict->md_len )
+				return -1;
+			r = dict->md_data + dict->md_len - n;
+			if ( n > len )
+				n = len;
+			memcpy( op, r, n );
+			op += n;
+			len -= n;
+			r = dst;
+		} else {
+			r = op - off;
+		}
+		if ( len <= (size_t)( op - r )) {
+			memcpy( op, r, len );
+			op += len;
+		} else {
+			while ( len-- )
+				*op++ = *r++;
+		}
+	}
+	return op == oend ? 0 : -1;
+}
+
+static mdb_dict *
+mdb_dict_alloc( const void *data, unsigned len )
+{
+	mdb_dict *d = ch_malloc( sizeof(mdb_dict) + len );
+	unsigned i;
+
+	d->md_len = len;
+	memcpy( d->md_data, data, len );
+	memset( d->md_hash, 0, sizeof(d->md_hash) );
+	for ( i = 0; i + LZ_MINMATCH <= len; i++ )
+		d->md_hash[LZ_HASH( d->md_data + i )] = i + 1;
+	return d;
+}
+
+/* Load the dictionaries added since they were last read. Readers
+ * look at mi_dicts without the mutex, so a dictionary is filled in
+ * before it is published with a release store.
+ */
+int
+mdb_dict_read( struct mdb_info *mdb, MDB_txn *txn )
+{
+	MDB_val key, data;
+	int i, rc = 0;
+
+	for ( i = mdb->mi_ndicts + 1; i <= MDB_MAXDICTS; i++ ) {
+		int k = MDB_DICT_KEY + i;
+
+		key.mv_size = sizeof(int);
+		key.mv_data = &k;
+		rc = mdb_get( txn, mdb->mi_ad2id, &key, &data );
+		if ( rc )
+			break;
+		__atomic_store_n( &mdb->mi_dicts[i-1],
+			mdb_dict_alloc( data.mv_data, data.mv_size ), __ATOMIC_RELEASE );
+		__atomic_store_n( &mdb->mi_ndicts, i, __ATOMIC_RELEASE );
+	}
+	if ( rc == MDB_NOTFOUND )
+		rc = 0;
+	if ( rc )
+		Debug( LDAP_DEBUG_ANY,
+			"mdb_dict_read: mdb_get failed %s(%d)\n",
+			mdb_strerror(rc), rc );
+	return rc;
+}
+
+/* Forget the dictionaries added after the first prev */
+void
+mdb_dict_unwind( struct mdb_info *mdb, int prev )
+{
+	int i;
+
+	for ( i = prev; i < mdb->mi_ndicts; i++ ) {
+		ch_free( mdb->mi_dicts[i] );
+		mdb->mi_dicts[i] = NULL;
+	}
+	mdb->mi_ndicts = prev;
+}
+
+void
+mdb_dict_free( struct mdb_info *mdb )
+{
+	mdb_dict_unwind( mdb, 0 );
+	if ( mdb->mi_dict_train ) {
+		mdb_dict_sampler *ds = mdb->mi_dict_train;
+		ch_free( ds->ds_buf );
+		ch_free( ds->ds_ids );
+		ch_free( ds );
+		mdb->mi_dict_train = NULL;
+	}
+}
+
+static mdb_dict *
+mdb_dict_get( struct mdb_info *mdb, MDB_txn *txn, unsigned id )
+{
+	mdb_dict *d;
+
+	if ( id > MDB_MAXDICTS )
+		return NULL;
+	d = __atomic_load_n( &mdb->mi_dicts[id-1], __ATOMIC_ACQUIRE );
+	if ( !d ) {
+		/* added by another process since we looked */
+		ldap_pvt_thread_mutex_lock( &mdb->mi_dict_mutex );
+		if ( !mdb->mi_dicts[id-1] )
+			mdb_dict_read( mdb, txn );
+		d = mdb->mi_dicts[id-1];
+		ldap_pvt_thread_mutex_unlock( &mdb->mi_dict_mutex );
+	}
+	return d;
+}
+
+size_t
+mdb_entry_packsize( size_t len )
+{
+	return MDB_PACK_HDR + mdb_lz_bound( len );
+}
+
+/* Compress the encoded entry raw with the newest dictionary, into
+ * packed, which has room for mdb_entry_packsize(raw->mv_size) bytes.
+ * Returns 0 if that saved enough space to be worth it, -1 otherwise.
+ */
+static int
+mdb_entry_pack_dict( mdb_dict *dict, unsigned id, MDB_val *raw, MDB_val *packed )
+{
+	unsigned int *hp = packed->mv_data, *lp = raw->mv_data;
+	size_t max;
+	int len;
+
+	/* Give up unless it saves an eighth */
+	max = raw->mv_size - raw->mv_size / 8;
+	if ( max <= MDB_PACK_HDR )
+		return -1;
+	len = mdb_lz_compress( dict, raw->mv_data, raw->mv_size,
+		(unsigned char *)( hp + 4 ), max - MDB_PACK_HDR );
+	if ( !len )
+		return -1;
+	hp[0] = MDB_ENC_PACKED | id;
+	hp[1] = lp[0];
+	hp[2] = lp[1];
+	hp[3] = raw->mv_size;
+	packed->mv_size = MDB_PACK_HDR + len;
+	return 0;
+}
+
+int
+mdb_entry_pack( struct mdb_info *mdb, MDB_val *raw, MDB_val *packed )
+{
+	int id = __atomic_load_n( &mdb->mi_ndicts, __ATOMIC_ACQUIRE );
+
+	return mdb_entry_pack_dict( id ? mdb->mi_dicts[id-1] : NULL, id,
+		raw, packed );
+}
+
+/* Decompress the packed record data into the len bytes of dst */
+int
+mdb_entry_unpack( struct mdb_info *mdb, MDB_txn *txn, MDB_val *data,
+	void *dst, unsigned len )
+{
+	unsigned int *hp = data->mv_data;
+	unsigned id = hp[0] & ~MDB_ENC_PACKED;
+	mdb_dict *dict = NULL;
+
+	if ( data->mv_size < MDB_PACK_HDR || hp[3] != len )
+		return -1;
+	if ( id ) {
+		dict = mdb_dict_get( mdb, txn, id );
+		if ( !dict ) {
+			Debug( LDAP_DEBUG_ANY,
+				"mdb_entry_unpack: dictionary %u not found\n", id );
+			return -1;
+		}
+	}
+	return mdb_lz_decompress( dict, (unsigned char *)( hp + 4 ),
+		data->mv_size - MDB_PACK_HDR, dst, len );
+}
+
+/* Start sampling the entries added, to train a dictionary of
+ * mi_dict_size bytes */
+void
+mdb_dict_sample_begin( struct mdb_info *mdb )
+{
+	mdb_dict_sampler *ds;
+
+	if ( mdb->mi_dict_train || mdb->mi_ndicts >= MDB_MAXDICTS )
+		return;
+	ds = ch_calloc( 1, sizeof(mdb_dict_sampler) );
+	ds->ds_max = (size_t)mdb->mi_dict_size * MDB_DICT_SAMPLES;
+	mdb->mi_dict_train = ds;
+}
+
+void
+mdb_dict_sample( struct mdb_info *mdb, ID id, MDB_val *raw )
+{
+	mdb_dict_sampler *ds = mdb->mi_dict_train;
+	size_t len = raw->mv_size;
+
+	if ( ds->ds_len >= ds->ds_max )
+		return;
+	if ( len > ds->ds_max - ds->ds_len )
+		len = ds->ds_max - ds->ds_len;
+	if ( !ds->ds_buf )
+		ds->ds_buf = ch_malloc( ds->ds_max );
+	memcpy( ds->ds_buf + ds->ds_len, raw->mv_data, len );
+	ds->ds_len += len;
+	if ( ds->ds_nids == ds->ds_maxids ) {
+		ds->ds_maxids = ds->ds_maxids ? ds->ds_maxids * 2 : 1024;
+		ds->ds_ids = ch_realloc( ds->ds_ids, ds->ds_maxids * sizeof(ID) );
+	}
+	ds->ds_ids[ds->ds_nids++] = id;
+}
+
+int
+mdb_dict_sample_full( struct mdb_info *mdb )
+{
+	mdb_dict_sampler *ds = mdb->mi_dict_train;
+
+	return ds->ds_len >= ds->ds_max;
+}
+
+typedef struct mdb_dict_seg {
+	size_t	sg_off;
+	unsigned long	sg_score;
+} mdb_dict_seg;
+
+static int
+mdb_dict_segcmp( const void *a, const void *b )
+{
+	const mdb_dict_seg *x = a, *y = b;
+
+	return x->sg_score < y->sg_score ? -1 : x->sg_score > y->sg_score;
+}
+
+#define DMER_HASH(p)	((( LZ_READ32(p) * 2654435761U ) ^ \
+	( LZ_READ32((p)+4) * 2246822519U )) >> ( 32 - MDB_DICT_FLOG ))
+
+/* Build a dictionary of at most size bytes out of the samples. The
+ * samples are cut into as many epochs as the dictionary has segments,
+ * and the segment of each epoch whose strings are the most frequent
+ * in all the samples is kept; the strings of a kept segment no longer
+ * count, so that the segments differ. The best segments go last, since
+ * shorter distances are cheaper to reach.
+ */
+static unsigned
+mdb_dict_build( const unsigned char *buf, size_t len, unsigned char *dict,
+	unsigned size )
+{
+	unsigned *freq;
+	mdb_dict_seg *segs;
+	size_t nseg, esize, e, i, ndm, best;
+	unsigned long score, bscore;
+	unsigned n = 0, k;
+
+	if ( len < MDB_DICT_SEGMENT )
+		return 0;
+	ndm = len - MDB_DICT_DMER + 1;
+	nseg = size / MDB_DICT_SEGMENT;
+	if ( nseg > len / MDB_DICT_SEGMENT )
+		nseg = len / MDB_DICT_SEGMENT;
+	if ( !nseg )
+		return 0;
+	esize = len / nseg;
+
+	freq = ch_calloc( 1 << MDB_DICT_FLOG, sizeof(unsigned) );
+	for ( i = 0; i < ndm; i++ )
+		freq[DMER_HASH( buf + i )]++;
+
+	segs = ch_malloc( nseg * sizeof(mdb_dict_seg) );
+	for ( e = 0; e < nseg; e++ ) {
+		size_t lo = e * esize, hi = lo + esize;
+		size_t w = MDB_DICT_SEGMENT - MDB_DICT_DMER + 1;
+
+		if ( hi > len )
+			hi = len;
+		if ( hi - lo < MDB_DICT_SEGMENT )
+			continue;
+		/* slide a window over the epoch */
+		score = 0;
+		for ( i = lo; i < lo + w; i++ )
+			score += freq[DMER_HASH( buf + i )];
+		bscore = score;
+		best = lo;
+		for ( i = lo + 1; i + MDB_DICT_SEGMENT <= hi; i++ ) {
+			score -= freq[DMER_HASH( buf + i - 1 )];
+			score += freq[DMER_HASH( buf + i + w - 1 )];
+			if ( score > bscore ) {
+				bscore = score;
+				best = i;
+			}
+		}
+		if ( bscore <= w )
+			continue;	/* nothing in it repeats */
+		for ( i = best; i < best + w; i++ )
+			freq[DMER_HASH( buf + i )] = 0;
+		segs[n].sg_off = best;
+		segs[n].sg_score = bscore;
+		n++;
+	}
+	qsort( segs, n, sizeof(mdb_dict_seg), mdb_dict_segcmp );
+	for ( k = 0; k < n; k++ )
+		memcpy( dict + k * MDB_DICT_SEGMENT, buf + segs[k].sg_off,
+			MDB_DICT_SEGMENT );
+	ch_free( segs );
+	ch_free( freq );
+	return n * MDB_DICT_SEGMENT;
+}
+
+/* Train a dictionary from the samples and store it in txn, then
+ * compress the sampled entries again with it. Sampling ends. Entries
+ * whose txn was aborted are simply not found.
+ */
+int
+mdb_dict_train( struct mdb_info *mdb, MDB_txn *txn )
+{
+	mdb_dict_sampler *ds = mdb->mi_dict_train;
+	mdb_dict *d = NULL;
+	MDB_val key, data, raw, packed;
+	unsigned char *dbuf;
+	char *ubuf = NULL, *pbuf = NULL;
+	size_t ulen = 0;
+	unsigned len, i, repacked = 0;
+	int rc = 0, id = mdb->mi_ndicts + 1, k = MDB_DICT_KEY + id;
+
+	mdb->mi_dict_train = NULL;
+	dbuf = ch_malloc( mdb->mi_dict_size );
+	len = mdb_dict_build( ds->ds_buf, ds->ds_len, dbuf, mdb->mi_dict_size );
+	if ( !len )
+		goto done;
+
+	key.mv_size = sizeof(int);
+	key.mv_data = &k;
+	data.mv_size = len;
+	data.mv_data = dbuf;
+	rc = mdb_put( txn, mdb->mi_ad2id, &key, &data, MDB_NOOVERWRITE );
+	if ( rc ) {
+		Debug( LDAP_DEBUG_ANY,
+			"mdb_dict_train: mdb_put failed %s(%d)\n",
+			mdb_strerror(rc), rc );
+		goto done;
+	}
+	d = mdb_dict_alloc( dbuf, len );
+
+	/* The records may have changed since they were sampled,
+	 * so start from what is stored */
+	for ( i = 0; i < ds->ds_nids; i++ ) {
+		unsigned int *hp;
+
+		key.mv_size = sizeof(ID);
+		key.mv_data = &ds->ds_ids[i];
+		rc = mdb_get( txn, mdb->mi_id2entry, &key, &data );
+		if ( rc == MDB_NOTFOUND || ( !rc && data.mv_size < MDB_PACK_HDR )) {
+			rc = 0;
+			continue;
+		}
+		if ( rc )
+			break;
+		hp = data.mv_data;
+		if ( hp[0] & MDB_ENC_PACKED ) {
+			if ( hp[0] != MDB_ENC_PACKED )
+				continue;	/* already has a dictionary */
+			raw.mv_size = hp[3];
+		} else {
+			raw.mv_size = data.mv_size;
+		}
+		if ( ulen < raw.mv_size ) {
+			ulen = raw.mv_size;
+			ch_free( ubuf );
+			ch_free( pbuf );
+			ubuf = ch_malloc( ulen );
+			pbuf = ch_malloc( mdb_entry_packsize( ulen ));
+		}
+		if ( hp[0] & MDB_ENC_PACKED ) {
+			if ( mdb_entry_unpack( mdb, txn, &data, ubuf, raw.mv_size ))
+				continue;
+			raw.mv_data = ubuf;
+		} else {
+			raw.mv_data = data.mv_data;
+		}
+		packed.mv_data = pbuf;
+		if ( mdb_entry_pack_dict( d, id, &raw, &packed ) ||
+			packed.mv_size >= data.mv_size )
+			continue;
+		rc = mdb_put( txn, mdb->mi_id2entry, &key, &packed, 0 );
+		if ( rc )
+			break;
+		repacked++;
+	}
+	if ( rc ) {
+		Debug( LDAP_DEBUG_ANY,
+			"mdb_dict_train: id2entry update failed %s(%d)\n",
+			mdb_strerror(rc), rc );
+		ch_free( d );
+		goto done;
+	}
+	__atomic_store_n( &mdb->mi_dicts[id-1], d, __ATOMIC_RELEASE );
+	__atomic_store_n( &mdb->mi_ndicts, id, __ATOMIC_RELEASE );
+	Debug( LDAP_DEBUG_TRACE,
+		"mdb_dict_train: dictionary %d of %u bytes from %lu bytes of "
+		"%u entries, %u repacked\n",
+		id, len, (unsigned long)ds->ds_len, ds->ds_nids, repacked );
+
+done:
+	ch_free( ubuf );
+	ch_free( pbuf );
+	ch_free( dbuf );
+	ch_free( ds->ds_buf );
+	ch_free( ds->ds_ids );
+	ch_free( ds );
+	return rc;
+}
@@ -45,6 +45,9 @@ enum {
 	MDB_SSTACK,
 	MDB_MULTIVAL,
 	MDB_IDLEXP,
+	MDB_ECACHE,
+	MDB_GCOMMIT,
+	MDB_DICTSIZE,
 };
 
 static ConfigTable mdbcfg[] = {
@@ -63,21 +66,60 @@ static ConfigTable mdbcfg[] = {
 			"DESC 'Database checkpoint interval in kbytes and minutes' "
 			"EQUALITY caseIgnoreMatch "
 			"SYNTAX OMsDirectoryString SINGLE-VALUE )",NULL, NULL },
+	{ "compress", "on|off", 2, 2, 0, ARG_ON_OFF|ARG_OFFSET,
+		(void *)offsetof(struct mdb_info, mi_compress),
+		"( OLcfgDbAt:12.14 NAME 'olcDbCompress' "
+		"DESC 'Compress entries stored in id2entry' "
+		"EQUALITY booleanMatch "
+		"SYNTAX OMsBoolean SINGLE-VALUE )", NULL, NULL },
+	{ "compressdict", "bytes", 2, 2, 0, ARG_UINT|ARG_MAGIC|MDB_DICTSIZE,
+		mdb_cf_gen, "( OLcfgDbAt:12.15 NAME 'olcDbCompressDict' "
+		"DESC 'Size of the compression dictionary trained by slapadd' "
+		"EQUALITY integerMatch "
+		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "dbnosync", NULL, 1, 2, 0, ARG_ON_OFF|ARG_MAGIC|MDB_DBNOSYNC,
 		mdb_cf_gen, "( OLcfgDbAt:1.4 NAME 'olcDbNoSync' "
 			"DESC 'Disable synchronous database writes' "
 			"EQUALITY booleanMatch "
 			"SYNTAX OMsBoolean SINGLE-VALUE )", NULL, NULL },
+	{ "entrycache", "entries", 2, 2, 0, ARG_UINT|ARG_MAGIC|MDB_ECACHE,
+		mdb_cf_gen, "( OLcfgDbAt:12.10 NAME 'olcDbEntryCache' "
+		"DESC 'Number of decoded entries to cache' "
+		"EQUALITY integerMatch "
+		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "envflags", "flags", 2, 0, 0, ARG_MAGIC|MDB_ENVFLAGS,
 		mdb_cf_gen, "( OLcfgDbAt:12.3 NAME 'olcDbEnvFlags' "
 			"DESC 'Database environment flags' "
 			"EQUALITY caseIgnoreMatch "
 			"SYNTAX OMsDirectoryString )", NULL, NULL },
+	{ "groupcommit", "ops> <msec", 3, 3, 0, ARG_MAGIC|MDB_GCOMMIT,
+		mdb_cf_gen, "( OLcfgDbAt:12.13 NAME 'olcDbGroupCommit' "
+		"DESC 'Updates per shared transaction, and longest wait in milliseconds' "
+		"EQUALITY caseIgnoreMatch "
+		"SYNTAX OMsDirectoryString SINGLE-VALUE )", NULL, NULL },
+	{ "idlbitmap", "on|off", 2, 2, 0, ARG_ON_OFF|ARG_OFFSET,
+		(void *)offsetof(struct mdb_info, mi_idl_bitmap),
+		"( OLcfgDbAt:12.7 NAME 'olcDbIdlBitmap' "
+		"DESC 'Store oversized index keys as bitmaps instead of ranges' "
+		"EQUALITY booleanMatch "
+		"SYNTAX OMsBoolean SINGLE-VALUE )", NULL, NULL },
 	{ "index", "attr> <[pres,eq,approx,sub]", 2, 3, 0, ARG_MAGIC|MDB_INDEX,
 		mdb_cf_gen, "( OLcfgDbAt:0.2 NAME 'olcDbIndex' "
 		"DESC 'Attribute index parameters' "
 		"EQUALITY caseIgnoreMatch "
 		"SYNTAX OMsDirectoryString )", NULL, NULL },
+	{ "indexchunk", "entries", 2, 2, 0, ARG_UINT|ARG_OFFSET,
+		(void *)offsetof(struct mdb_info, mi_index_chunk),
+		"( OLcfgDbAt:12.11 NAME 'olcDbIndexChunk' "
+		"DESC 'Number of entries reindexed per transaction by the online indexer' "
+		"EQUALITY integerMatch "
+		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
+	{ "indexrate", "entries", 2, 2, 0, ARG_UINT|ARG_OFFSET,
+		(void *)offsetof(struct mdb_info, mi_index_rate),
+		"( OLcfgDbAt:12.12 NAME 'olcDbIndexRate' "
+		"DESC 'Maximum number of entries reindexed per second by the online indexer' "
+		"EQUALITY integerMatch "
+		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "maxentrysize", "size", 2, 2, 0, ARG_ULONG|ARG_OFFSET,
 		(void *)offsetof(struct mdb_info, mi_maxentrysize),
 		"( OLcfgDbAt:12.4 NAME 'olcDbMaxEntrySize' "
@@ -105,6 +147,12 @@ static ConfigTable mdbcfg[] = {
 		"DESC 'Hi/Lo thresholds for splitting multivalued attr out of main blob' "
 		"EQUALITY caseIgnoreMatch "
 		"SYNTAX OMsDirectoryString )", NULL, NULL },
+	{ "plannerthreshold", "count", 2, 2, 0, ARG_UINT|ARG_OFFSET,
+		(void *)offsetof(struct mdb_info, mi_plan_threshold),
+		"( OLcfgDbAt:12.8 NAME 'olcDbPlannerThreshold' "
+		"DESC 'Candidate count below which remaining AND terms are not fetched' "
+		"EQUALITY integerMatch "
+		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "rtxnsize", "entries", 2, 2, 0, ARG_UINT|ARG_OFFSET,
 		(void *)offsetof(struct mdb_info, mi_rtxn_size),
 		"( OLcfgDbAt:12.5 NAME 'olcDbRtxnSize' "
@@ -116,6 +164,12 @@ static ConfigTable mdbcfg[] = {
 		"DESC 'Depth of search stack in IDLs' "
 		"EQUALITY integerMatch "
 		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
+	{ "searchthreads", "count", 2, 2, 0, ARG_UINT|ARG_OFFSET,
+		(void *)offsetof(struct mdb_info, mi_search_threads),
+		"( OLcfgDbAt:12.9 NAME 'olcDbSearchThreads' "
+		"DESC 'Number of threads testing the candidates of a large search' "
+		"EQUALITY integerMatch "
+		"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ NULL, NULL, 0, 0, 0, ARG_IGNORED,
 		NULL, NULL, NULL, NULL }
 };
@@ -137,7 +191,10 @@ static ConfigOCs mdbocs[] = {
 		"MAY ( olcDbCheckpoint $ olcDbEnvFlags $ "
 		"olcDbNoSync $ olcDbIndex $ olcDbMaxReaders $ olcDbMaxSize $ "
 		"olcDbMode $ olcDbSearchStack $ olcDbMaxEntrySize $ olcDbRtxnSize $ "
-		"olcDbMultival ) )",
+		"olcDbMultival $ olcDbIdlBitmap $ olcDbPlannerThreshold $ "
+		"olcDbSearchThreads $ olcDbEntryCache $ olcDbIndexChunk $ "
+		"olcDbIndexRate $ olcDbGroupCommit $ olcDbCompress $ "
+		"olcDbCompressDict ) )",
 			Cft_Database, mdbcfg+1 },
 	{ NULL, 0, NULL }
 };
@@ -191,6 +248,82 @@ mdb_checkpoint( void *ctx, void *arg )
 	return NULL;
 }
 
+/* Reindex up to max entries from mi_index_next on in a single txn,
+ * and record where to go on in the same txn. Sets *count to the
+ * number of entries read; returns MDB_NOTFOUND once the last entry
+ * is reindexed.
+ */
+static int
+mdb_online_index_chunk( Operation *op, unsigned max, unsigned *count )
+{
+	struct mdb_info *mdb = op->o_bd->be_private;
+	MDB_cursor *curs;
+	MDB_val key, data;
+	MDB_txn *txn;
+	ID id, next = mdb->mi_index_next;
+	Entry *e;
+	unsigned n = 0;
+	int rc, done = 0;
+
+	*count = 0;
+	rc = mdb_txn_begin( mdb->mi_dbenv, NULL, 0, &txn );
+	if ( rc )
+		return rc;
+	rc = mdb_cursor_open( txn, mdb->mi_id2entry, &curs );
+	if ( rc ) {
+		mdb_txn_abort( txn );
+		return rc;
+	}
+
+	key.mv_size = sizeof(ID);
+	while ( n < max ) {
+		key.mv_data = &next;
+		rc = mdb_cursor_get( curs, &key, &data, MDB_SET_RANGE );
+		if ( rc ) {
+			if ( rc == MDB_NOTFOUND ) {
+				done = 1;
+				rc = 0;
+			}
+			break;
+		}
+		memcpy( &id, key.mv_data, sizeof(ID) );
+		rc = mdb_id2entry( op, curs, id, &e );
+		if ( rc )
+			break;
+		rc = mdb_index_entry( op, txn, MDB_INDEX_UPDATE_OP, e );
+		mdb_entry_return( op, e );
+		if ( rc )
+			break;
+		next = id + 1;
+		n++;
+	}
+	mdb_cursor_close( curs );
+
+	if ( rc == 0 ) {
+		mdb->mi_index_next = next;
+		if ( done ) {
+			/* the indices are complete, drop their record */
+			int zero = 0;
+			key.mv_size = sizeof(int);
+			key.mv_data = &zero;
+			rc = mdb_del( txn, mdb->mi_ad2id, &key, NULL );
+			if ( rc == MDB_NOTFOUND )
+				rc = 0;
+		} else {
+			rc = mdb_ixstate_put( mdb, txn );
+		}
+	}
+	if ( rc == 0 ) {
+		rc = mdb_txn_commit( txn );
+	} else {
+		mdb_txn_abort( txn );
+	}
+	*count = n;
+	if ( rc == 0 && done )
+		rc = MDB_NOTFOUND;
+	return rc;
+}
+
 /* reindex entries on the fly */
 static void *
 mdb_online_index( void *ctx, void *arg )
@@ -203,12 +336,9 @@ mdb_online_index( void *ctx, void *arg )
 	OperationBuffer opbuf;
 	Operation *op;
 
-	MDB_cursor *curs;
-	MDB_val key, data;
-	MDB_txn *txn;
-	ID id;
-	Entry *e;
-	int rc, getnext = 1;
+	unsigned long total = 0;
+	unsigned max, count;
+	int rc = 0;
 	int i;
 
 	connection_fake_init( &conn, &opbuf, ctx );
@@ -216,73 +346,70 @@ mdb_online_index( void *ctx, void *arg )
 
 	op->o_bd = be;
 
-	id = 1;
-	key.mv_size = sizeof(ID);
+	if ( !mdb->mi_index_next )
+		mdb->mi_index_next = 1;
 
 	while ( 1 ) {
+		/* the indices stay unfinished, the build resumes
+		 * when the database is opened again */
 		if ( slapd_shutdown )
 			break;
 
-		rc = mdb_txn_begin( mdb->mi_dbenv, NULL, 0, &txn );
-		if ( rc )
-			break;
-		rc = mdb_cursor_open( txn, mdb->mi_id2entry, &curs );
-		if ( rc ) {
-			mdb_txn_abort( txn );
-			break;
-		}
-		if ( getnext ) {
-			getnext = 0;
-			key.mv_data = &id;
-			rc = mdb_cursor_get( curs, &key, &data, MDB_SET_RANGE );
-			if ( rc ) {
-				mdb_txn_abort( txn );
-				if ( rc == MDB_NOTFOUND )
-					rc = 0;
-				break;
-			}
-			memcpy( &id, key.mv_data, sizeof( id ));
+		/* leave the rest of this second's quota to the next run;
+		 * while a bulk load puts indexing off, look back every second */
+		if (( mdb->mi_index_rate && total >= mdb->mi_index_rate ) ||
+			mdb->mi_index_defer ) {
+			ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
+			ldap_pvt_runqueue_stoptask( &slapd_rq, rtask );
+			rtask->interval.tv_sec = 1;
+			ldap_pvt_runqueue_resched( &slapd_rq, rtask, 0 );
+			ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
+			slap_wake_listener();
+			return NULL;
 		}
 
-		rc = mdb_id2entry( op, curs, id, &e );
-		mdb_cursor_close( curs );
-		if ( rc ) {
-			mdb_txn_abort( txn );
-			if ( rc == MDB_NOTFOUND ) {
-				id++;
-				getnext = 1;
-				continue;
-			}
-			break;
-		}
-		rc = mdb_index_entry( op, txn, MDB_INDEX_UPDATE_OP, e );
-		mdb_entry_return( op, e );
-		if ( rc == 0 ) {
-			rc = mdb_txn_commit( txn );
-			txn = NULL;
-		} else {
-			mdb_txn_abort( txn );
-			txn = NULL;
-		}
-		if ( rc ) {
-			Debug( LDAP_DEBUG_ANY,
-				LDAP_XSTRING(mdb_online_index) ": database %s: "
-				"txn_commit failed: %s (%d)\n",
-				be->be_suffix[0].bv_val, mdb_strerror(rc), rc );
+		max = mdb->mi_index_chunk ? mdb->mi_index_chunk : 1;
+		if ( mdb->mi_index_rate && max > mdb->mi_index_rate - total )
+			max = mdb->mi_index_rate - total;
+		rc = mdb_online_index_chunk( op, max, &count );
+		total += count;
+		if ( rc )
 			break;
-		}
-		id++;
-		getnext = 1;
+
+		/* let cn=config changes through between chunks */
+		ldap_pvt_thread_pool_pausecheck( &connection_pool );
 	}
 
-	for ( i = 0; i < mdb->mi_nattrs; i++ ) {
-		if ( mdb->mi_attrs[ i ]->ai_indexmask & MDB_INDEX_DELETING
-			|| mdb->mi_attrs[ i ]->ai_newmask == 0 )
-		{
-			continue;
+	if ( rc == MDB_NOTFOUND ) {
+		rc = 0;
+		ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
+		/* a bulk load began after the last chunk; its entries
+		 * are still to be indexed */
+		if ( mdb->mi_index_defer ) {
+			ldap_pvt_runqueue_stoptask( &slapd_rq, rtask );
+			rtask->interval.tv_sec = 1;
+			ldap_pvt_runqueue_resched( &slapd_rq, rtask, 0 );
+			ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
+			slap_wake_listener();
+			return NULL;
+		}
+		for ( i = 0; i < mdb->mi_nattrs; i++ ) {
+			if ( mdb->mi_attrs[ i ]->ai_indexmask & MDB_INDEX_DELETING
+				|| mdb->mi_attrs[ i ]->ai_newmask == 0 )
+			{
+				continue;
+			}
+			mdb->mi_attrs[ i ]->ai_indexmask = mdb->mi_attrs[ i ]->ai_newmask;
+			mdb->mi_attrs[ i ]->ai_newmask = 0;
 		}
-		mdb->mi_attrs[ i ]->ai_indexmask = mdb->mi_attrs[ i ]->ai_newmask;
-		mdb->mi_attrs[ i ]->ai_newmask = 0;
+		mdb->mi_index_next = 0;
+		ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
+	} else if ( rc ) {
+		Debug( LDAP_DEBUG_ANY,
+			LDAP_XSTRING(mdb_online_index) ": database %s: "
+			"reindexing stopped at entry %lu: %s (%d)\n",
+			be->be_suffix[0].bv_val, (unsigned long) mdb->mi_index_next,
+			mdb_strerror(rc), rc );
 	}
 
 	ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
@@ -294,6 +421,99 @@ mdb_online_index( void *ctx, void *arg )
 	return NULL;
 }
 
+/* Schedule the online indexer, unless it is already */
+void
+mdb_online_index_start( BackendDB *be )
+{
+	struct mdb_info *mdb = be->be_private;
+
+	ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
+	if ( !mdb->mi_index_task ) {
+		/* Start the task as soon as we finish here. Set a long
+		 * interval (10 hours) so that it only gets scheduled once.
+		 * At startup, be may be an overlay's copy of the database.
+		 */
+		mdb->mi_index_task = ldap_pvt_runqueue_insert( &slapd_rq, 36000,
+			mdb_online_index, be->bd_self,
+			LDAP_XSTRING(mdb_online_index), be->be_suffix[0].bv_val );
+	}
+	ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
+}
+
+/* A bulk load is beginning a txn, which holds the writer lock. If the
+ * database is empty, put off the indices its adds may skip, that is all
+ * but the sort indices and those of entryUUID, which replication looks
+ * entries up by. They are treated as being built from the first entry
+ * the load adds, and searches don't use them until the online indexer
+ * is done with them. A database that already has entries keeps its
+ * indices, so its searches stay indexed; only indices already being
+ * built, e.g. by an earlier load, are left to the indexer.
+ */
+int
+mdb_online_index_defer( Operation *op, MDB_txn *txn )
+{
+	struct mdb_info *mdb = op->o_bd->be_private;
+	MDB_cursor *mc;
+	AttrInfo *ai;
+	ID id;
+	int i, building = 0, defer = 0, rc;
+
+	rc = mdb_cursor_open( txn, mdb->mi_id2entry, &mc );
+	if ( rc == 0 ) {
+		rc = mdb_next_id( op->o_bd, mc, &id );
+		mdb_cursor_close( mc );
+	}
+	if ( rc )
+		return rc;
+
+	ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
+	for ( i = 0; i < mdb->mi_nattrs; i++ ) {
+		ai = mdb->mi_attrs[i];
+		if ( ai->ai_indexmask & MDB_INDEX_DELETING )
+			continue;
+		if ( ai->ai_newmask )
+			building++;
+		else if ( id == 1 && ai->ai_desc != slap_schema.si_ad_entryUUID &&
+			( ai->ai_indexmask & ~SLAP_INDEX_SORT ))
+			defer++;
+	}
+	if ( !building && !defer )
+		goto done;
+
+	mdb->mi_index_defer = 1;
+	if ( !mdb->mi_index_next )
+		/* the indexer hasn't started on them yet */
+		mdb->mi_index_next = building ? 1 : id;
+	for ( i = 0; defer && i < mdb->mi_nattrs; i++ ) {
+		ai = mdb->mi_attrs[i];
+		if ( ai->ai_newmask || ( ai->ai_indexmask & MDB_INDEX_DELETING ) ||
+			ai->ai_desc == slap_schema.si_ad_entryUUID ||
+			!( ai->ai_indexmask & ~SLAP_INDEX_SORT ))
+			continue;
+		ai->ai_newmask = ai->ai_indexmask;
+		ai->ai_indexmask &= SLAP_INDEX_SORT;
+	}
+done:
+	ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
+	return 0;
+}
+
+/* A bulk load is over, build what it put off */
+void
+mdb_online_index_resume( BackendDB *be )
+{
+	struct mdb_info *mdb = be->be_private;
+	int building;
+
+	ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
+	mdb->mi_index_defer = 0;
+	building = mdb->mi_index_next != 0;
+	ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
+
+	if ( building )
+		mdb_online_index_start( be );
+}
+
 /* Cleanup loose ends after Modify completes */
 static int
 mdb_cf_cleanup( ConfigArgs *c )
@@ -322,9 +542,27 @@ mdb_cf_cleanup( ConfigArgs *c )
 		}
 	}
 
+	if ( mdb->mi_flags & MDB_RESIZE_ECACHE ) {
+		mdb->mi_flags ^= MDB_RESIZE_ECACHE;
+		if ( mdb->mi_flags & MDB_IS_OPEN )
+			mdb_ecache_resize( mdb, mdb->mi_ecache_size );
+	}
+
 	if ( mdb->mi_flags & MDB_OPEN_INDEX ) {
+		MDB_txn *txn;
 		mdb->mi_flags ^= MDB_OPEN_INDEX;
 		rc = mdb_attr_dbs_open( c->be, NULL, &c->reply );
+		/* record the new indices before the indexer gets to them */
+		if ( rc == 0 ) {
+			rc = mdb_txn_begin( mdb->mi_dbenv, NULL, 0, &txn );
+			if ( rc == 0 ) {
+				rc = mdb_ixstate_put( mdb, txn );
+				if ( rc == 0 )
+					rc = mdb_txn_commit( txn );
+				else
+					mdb_txn_abort( txn );
+			}
+		}
 		if ( rc )
 			rc = LDAP_OTHER;
 	}
@@ -369,6 +607,19 @@ mdb_cf_gen( ConfigArgs *c )
 			}
 			break;
 
+		case MDB_GCOMMIT:
+			if ( mdb->mi_gc_maxops ) {
+				char buf[64];
+				struct berval bv;
+				bv.bv_len = snprintf( buf, sizeof(buf), "%u %u",
+					mdb->mi_gc_maxops, mdb->mi_gc_msec );
+				bv.bv_val = buf;
+				value_add_one( &c->rvalue_vals, &bv );
+			} else {
+				rc = 1;
+			}
+			break;
+
 		case MDB_DIRECTORY:
 			if ( mdb->mi_dbenv_home ) {
 				c->value_string = ch_strdup( mdb->mi_dbenv_home );
@@ -406,6 +657,14 @@ mdb_cf_gen( ConfigArgs *c )
 			c->value_ulong = mdb->mi_mapsize;
 			break;
 
+		case MDB_ECACHE:
+			c->value_uint = mdb->mi_ecache_size;
+			break;
+
+		case MDB_DICTSIZE:
+			c->value_uint = mdb->mi_dict_size;
+			break;
+
 		case MDB_MULTIVAL:
 			mdb_attr_multi_unparse( mdb, &c->rvalue_vals );
 			if ( !c->rvalue_vals ) rc = 1;
@@ -441,6 +700,13 @@ mdb_cf_gen( ConfigArgs *c )
 			}
 			mdb->mi_txn_cp = 0;
 			break;
+		case MDB_GCOMMIT:
+			mdb->mi_gc_maxops = 0;
+			mdb->mi_gc_msec = 0;
+			break;
+		case MDB_DICTSIZE:
+			mdb->mi_dict_size = 0;
+			break;
 		case MDB_DIRECTORY:
 			mdb->mi_flags |= MDB_RE_OPEN;
 			ch_free( mdb->mi_dbenv_home );
@@ -453,6 +719,14 @@ mdb_cf_gen( ConfigArgs *c )
 			mdb->mi_dbenv_flags &= ~MDB_NOSYNC;
 			break;
 
+		case MDB_ECACHE:
+			mdb->mi_ecache_size = 0;
+			if ( mdb->mi_flags & MDB_IS_OPEN ) {
+				mdb->mi_flags |= MDB_RESIZE_ECACHE;
+				config_push_cleanup( c, mdb_cf_cleanup );
+			}
+			break;
+
 		case MDB_ENVFLAGS:
 			if ( c->valx == -1 ) {
 				int i;
@@ -683,6 +957,30 @@ mdb_cf_gen( ConfigArgs *c )
 		}
 		} break;
 
+	case MDB_GCOMMIT: {
+		unsigned maxops, msec;
+		if ( lutil_atoux( &maxops, c->argv[1], 0 ) != 0 ) {
+			snprintf( c->cr_msg, sizeof( c->cr_msg ),
+				"%s: invalid ops \"%s\" in \"groupcommit\"",
+				c->log, c->argv[1] );
+			Debug( LDAP_DEBUG_ANY, "%s\n", c->cr_msg );
+			return 1;
+		}
+		if ( lutil_atoux( &msec, c->argv[2], 0 ) != 0 ) {
+			snprintf( c->cr_msg, sizeof( c->cr_msg ),
+				"%s: invalid msec \"%s\" in \"groupcommit\"",
+				c->log, c->argv[2] );
+			Debug( LDAP_DEBUG_ANY, "%s\n", c->cr_msg );
+			return 1;
+		}
+		if ( maxops && ( mdb->mi_dbenv_flags & MDB_WRITEMAP )) {
+			Debug( LDAP_DEBUG_ANY, "%s: \"groupcommit\" "
+				"is ignored with \"envflags writemap\".\n", c->log );
+		}
+		mdb->mi_gc_maxops = maxops;
+		mdb->mi_gc_msec = msec;
+		} break;
+
 	case MDB_DIRECTORY: {
 		FILE *f;
 		char *ptr, *testpath;
@@ -758,24 +1056,19 @@ mdb_cf_gen( ConfigArgs *c )
 
 		if( rc != LDAP_SUCCESS ) return 1;
 		if ( mdb->mi_flags & MDB_IS_OPEN ) {
+			if ( c->be->be_suffix == NULL || BER_BVISNULL( &c->be->be_suffix[0] ) ) {
+				fprintf( stderr, "%s: "
+					"\"index\" must occur after \"suffix\".\n",
+					c->log );
+				return 1;
+			}
 			mdb->mi_flags |= MDB_OPEN_INDEX;
 			config_push_cleanup( c, mdb_cf_cleanup );
-			if ( !mdb->mi_index_task ) {
-				/* Start the task as soon as we finish here. Set a long
-				 * interval (10 hours) so that it only gets scheduled once.
-				 */
-				if ( c->be->be_suffix == NULL || BER_BVISNULL( &c->be->be_suffix[0] ) ) {
-					fprintf( stderr, "%s: "
-						"\"index\" must occur after \"suffix\".\n",
-						c->log );
-					return 1;
-				}
-				ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
-				mdb->mi_index_task = ldap_pvt_runqueue_insert( &slapd_rq, 36000,
-					mdb_online_index, c->be,
-					LDAP_XSTRING(mdb_online_index), c->be->be_suffix[0].bv_val );
-				ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
-			}
+			/* The entries already reindexed lack the new keys:
+			 * the indexer starts over. It is paused meanwhile.
+			 */
+			mdb->mi_index_next = 1;
+			mdb_online_index_start( c->be );
 		}
 		break;
 
@@ -811,6 +1104,26 @@ mdb_cf_gen( ConfigArgs *c )
 
 		if( rc != LDAP_SUCCESS ) return 1;
 		break;
+
+	case MDB_ECACHE:
+		mdb->mi_ecache_size = c->value_uint;
+		if ( mdb->mi_flags & MDB_IS_OPEN ) {
+			mdb->mi_flags |= MDB_RESIZE_ECACHE;
+			config_push_cleanup( c, mdb_cf_cleanup );
+		}
+		break;
+
+	case MDB_DICTSIZE:
+		/* matches reach back at most 64k */
+		if ( c->value_uint > 65536 ) {
+			snprintf( c->cr_msg, sizeof( c->cr_msg ),
+				"%s: \"compressdict\" must be at most 65536",
+				c->log );
+			Debug( LDAP_DEBUG_ANY, "%s\n", c->cr_msg );
+			return 1;
+		}
+		mdb->mi_dict_size = c->value_uint;
+		break;
 	}
 	return 0;
 }
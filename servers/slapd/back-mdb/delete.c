@@ -52,6 +52,7 @@ mdb_delete( Operation *op, SlapReply *rs )
 	ctrls[num_ctrls] = 0;
 
 	/* begin transaction */
+	opinfo.moi_flag = MOI_GROUP;
 	rs->sr_err = mdb_opinfo_get( op, mdb, 0, &moi );
 	rs->sr_text = NULL;
 	if( rs->sr_err != 0 ) {
@@ -366,12 +367,12 @@ mdb_delete( Operation *op, SlapReply *rs )
 		LDAP_SLIST_REMOVE( &op->o_extra, &opinfo.moi_oe, OpExtra, oe_next );
 		opinfo.moi_oe.oe_key = NULL;
 		if( op->o_noop ) {
-			mdb_txn_abort( txn );
+			mdb_opinfo_abort( mdb, &opinfo );
 			rs->sr_err = LDAP_X_NO_OPERATION;
 			txn = NULL;
 			goto return_results;
 		} else {
-			rs->sr_err = mdb_txn_commit( txn );
+			rs->sr_err = mdb_opinfo_commit( mdb, &opinfo );
 		}
 		txn = NULL;
 	}
@@ -411,7 +412,7 @@ return_results:
 
 	if( moi == &opinfo ) {
 		if( txn != NULL ) {
-			mdb_txn_abort( txn );
+			mdb_opinfo_abort( mdb, &opinfo );
 		}
 		if ( opinfo.moi_oe.oe_key ) {
 			LDAP_SLIST_REMOVE( &op->o_extra, &opinfo.moi_oe, OpExtra, oe_next );
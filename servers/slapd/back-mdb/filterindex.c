@@ -558,6 +558,95 @@ base:
 	return 0;
 }
 
+/* Estimate how many candidates a filter component yields, from the
+ * size of its index slots. Returns NOID if there is no cheap estimate.
+ */
+static ID
+filter_estimate(
+	Operation *op,
+	MDB_txn *rtxn,
+	Filter *f )
+{
+	AttributeDescription *desc;
+	MatchingRule *mr;
+	MDB_dbi dbi;
+	slap_mask_t mask;
+	struct berval prefix = {0, NULL};
+	struct berval *keys = NULL;
+	ID est = NOID, n;
+	int i, rc;
+
+	switch ( f->f_choice ) {
+	case SLAPD_FILTER_COMPUTED:
+		if ( f->f_result == LDAP_COMPARE_FALSE ||
+			f->f_result == SLAPD_COMPARE_UNDEFINED )
+			est = 0;
+		return est;
+
+	case LDAP_FILTER_PRESENT:
+		desc = f->f_desc;
+		if ( desc == slap_schema.si_ad_objectClass )
+			return est;
+		rc = mdb_index_param( op->o_bd, desc, LDAP_FILTER_PRESENT,
+			&dbi, &mask, &prefix );
+		if ( rc || prefix.bv_val == NULL )
+			return est;
+		rc = mdb_key_count( op->o_bd, rtxn, dbi, &prefix, &est );
+		if ( rc == MDB_NOTFOUND )
+			est = 0;
+		else if ( rc )
+			est = NOID;
+		return est;
+
+	case LDAP_FILTER_EQUALITY:
+		desc = f->f_av_desc;
+		break;
+
+	default:
+		return est;
+	}
+
+	if ( desc == slap_schema.si_ad_entryDN )
+		return 1;
+#ifdef LDAP_COMP_MATCH
+	if ( is_aliased_attribute && is_aliased_attribute( desc ))
+		return est;
+#endif
+
+	rc = mdb_index_param( op->o_bd, desc, LDAP_FILTER_EQUALITY,
+		&dbi, &mask, &prefix );
+	if ( rc )
+		return est;
+	mr = desc->ad_type->sat_equality;
+	if ( !mr || !mr->smr_filter )
+		return est;
+	rc = (mr->smr_filter)( LDAP_FILTER_EQUALITY, mask,
+		desc->ad_type->sat_syntax, mr, &prefix, &f->f_av_value,
+		&keys, op->o_tmpmemctx );
+	if ( rc || keys == NULL )
+		return est;
+
+	/* the candidates are the intersection of all keys */
+	for ( i = 0; keys[i].bv_val != NULL; i++ ) {
+		rc = mdb_key_count( op->o_bd, rtxn, dbi, &keys[i], &n );
+		if ( rc == MDB_NOTFOUND ) {
+			est = 0;
+			break;
+		} else if ( rc ) {
+			break;
+		}
+		if ( n < est )
+			est = n;
+	}
+	ber_bvarray_free_x( keys, op->o_tmpmemctx );
+	return est;
+}
+
+typedef struct filter_plan {
+	Filter *fp_f;
+	ID fp_est;
+} filter_plan;
+
 static int
 list_candidates(
 	Operation *op,
@@ -568,11 +657,38 @@ list_candidates(
 	ID *tmp,
 	ID *save )
 {
-	int rc = 0;
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	int rc = 0, first = 1, reordered = 0;
+	int i, j, nplan = 0, iplan = 0;
+	filter_plan *plan = NULL, fp;
 	Filter	*f;
 
 	Debug( LDAP_DEBUG_FILTER, "=> mdb_list_candidates 0x%x\n", ftype );
-	for ( f = flist; f != NULL; f = f->f_next ) {
+
+	/* Order the terms of an AND cheapest first, so the candidate set
+	 * shrinks as fast as possible and large index slots may not
+	 * have to be read at all.
+	 */
+	if ( ftype == LDAP_FILTER_AND ) {
+		for ( f = flist; f != NULL; f = f->f_next )
+			nplan++;
+		if ( nplan > 1 ) {
+			plan = op->o_tmpalloc( nplan * sizeof(filter_plan), op->o_tmpmemctx );
+			for ( i = 0, f = flist; f != NULL; f = f->f_next, i++ ) {
+				fp.fp_f = f;
+				fp.fp_est = filter_estimate( op, rtxn, f );
+				/* stable insertion sort on the estimate */
+				for ( j = i; j > 0 && plan[j-1].fp_est > fp.fp_est; j-- )
+					plan[j] = plan[j-1];
+				plan[j] = fp;
+				if ( j < i )
+					reordered = 1;
+			}
+		}
+	}
+
+	for ( f = plan ? plan[0].fp_f : flist; f != NULL;
+		f = plan ? ( ++iplan < nplan ? plan[iplan].fp_f : NULL ) : f->f_next ) {
 		/* ignore precomputed scopes */
 		if ( f->f_choice == SLAPD_FILTER_COMPUTED &&
 		     f->f_result == LDAP_SUCCESS ) {
@@ -592,20 +708,42 @@ list_candidates(
 
 		
 		if ( ftype == LDAP_FILTER_AND ) {
-			if ( f == flist ) {
+			if ( first ) {
 				MDB_IDL_CPY( ids, save );
 			} else {
 				mdb_idl_intersection( ids, save );
 			}
-			if( MDB_IDL_IS_ZERO( ids ) )
+			if( MDB_IDL_IS_ZERO( ids ) ) {
+				iplan++;
 				break;
+			}
+			/* Few enough candidates left that testing the entries
+			 * is cheaper than reading more index slots.
+			 */
+			if ( plan && !MDB_IDL_IS_RANGE( ids ) &&
+				MDB_IDL_N( ids ) < mdb->mi_plan_threshold ) {
+				iplan++;
+				break;
+			}
 		} else {
-			if ( f == flist ) {
+			if ( first ) {
 				MDB_IDL_CPY( ids, save );
 			} else {
 				mdb_idl_union( ids, save );
 			}
 		}
+		first = 0;
+	}
+
+	if ( plan ) {
+		/* the statistics of every search, keep them off a lock */
+		__atomic_fetch_add( &mdb->mi_plan_ands, 1, __ATOMIC_RELAXED );
+		if ( reordered )
+			__atomic_fetch_add( &mdb->mi_plan_reorders, 1, __ATOMIC_RELAXED );
+		if ( iplan < nplan )
+			__atomic_fetch_add( &mdb->mi_plan_skipped, nplan - iplan,
+				__ATOMIC_RELAXED );
+		op->o_tmpfree( plan, op->o_tmpmemctx );
 	}
 
 	if( rc == LDAP_SUCCESS ) {
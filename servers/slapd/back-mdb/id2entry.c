@@ -35,7 +35,8 @@ static int mdb_entry_partsize(struct mdb_info *mdb, MDB_txn *txn, Entry *e,
 	Ecount *eh);
 static int mdb_entry_encode(Operation *op, Entry *e, MDB_val *data,
 	Ecount *ec);
-static Entry *mdb_entry_alloc( Operation *op, int nattrs, int nvals );
+static Entry *mdb_entry_alloc( Operation *op, int nattrs, int nvals,
+	size_t extra );
 
 #define ID2VKSZ	(sizeof(ID)+2)
 
@@ -271,7 +272,8 @@ static int mdb_id2entry_put(
 {
 	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
 	Ecount ec;
-	MDB_val key, data;
+	MDB_val key, data, raw, packed;
+	char *buf = NULL;
 	int rc, adding = flag, prev_ads = mdb->mi_numads;
 
 	/* We only store rdns, and they go in the dn2id database. */
@@ -285,26 +287,49 @@ static int mdb_id2entry_put(
 		goto fail;
 	}
 
-	flag |= MDB_RESERVE;
-
 	if (e->e_id < mdb->mi_nextid)
 		flag &= ~MDB_APPEND;
 
+	mdb_ecache_invalidate( mdb, txn, e->e_id );
+
 	if (mdb->mi_maxentrysize && ec.len > mdb->mi_maxentrysize) {
 		rc = LDAP_ADMINLIMIT_EXCEEDED;
 		goto fail;
 	}
 
+	if (mdb->mi_compress) {
+		/* encode it aside, and store it compressed if that helps */
+		buf = op->o_tmpalloc( ec.dlen + mdb_entry_packsize( ec.dlen ),
+			op->o_tmpmemctx );
+		raw.mv_size = ec.dlen;
+		raw.mv_data = buf;
+		rc = mdb_entry_encode( op, e, &raw, &ec );
+		if( rc != LDAP_SUCCESS )
+			goto fail;
+		packed.mv_data = buf + ec.dlen;
+		if ( mdb_entry_pack( mdb, &raw, &packed ))
+			packed = raw;
+	} else {
+		flag |= MDB_RESERVE;
+	}
+
 again:
-	data.mv_size = ec.dlen;
+	if ( buf )
+		data = packed;
+	else
+		data.mv_size = ec.dlen;
 	if ( mc )
 		rc = mdb_cursor_put( mc, &key, &data, flag );
 	else
 		rc = mdb_put( txn, mdb->mi_id2entry, &key, &data, flag );
 	if (rc == MDB_SUCCESS) {
-		rc = mdb_entry_encode( op, e, &data, &ec );
-		if( rc != LDAP_SUCCESS )
-			goto fail;
+		if ( !buf ) {
+			rc = mdb_entry_encode( op, e, &data, &ec );
+			if( rc != LDAP_SUCCESS )
+				goto fail;
+		} else if ( mdb->mi_dict_train && adding ) {
+			mdb_dict_sample( mdb, e->e_id, &raw );
+		}
 		/* Handle adds of large multi-valued attrs here.
 		 * Modifies handle them directly.
 		 */
@@ -349,6 +374,8 @@ fail:
 	if (rc) {
 		mdb_ad_unwind( mdb, prev_ads );
 	}
+	if ( buf )
+		op->o_tmpfree( buf, op->o_tmpmemctx );
 	return rc;
 }
 
@@ -393,6 +420,27 @@ int mdb_id2edata(
 	return rc;
 }
 
+/* Can entries read in txn come from the entry cache? Only if txn
+ * is a reader, since writers modify the entries they fetch.
+ */
+static int
+mdb_ecache_reader( Operation *op, MDB_txn *txn )
+{
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	OpExtra *oex;
+
+	if ( !mdb->mi_ecache_nslots )
+		return 0;
+
+	LDAP_SLIST_FOREACH( oex, &op->o_extra, oe_next ) {
+		if ( oex->oe_key == mdb ) {
+			mdb_op_info *moi = (mdb_op_info *)oex;
+			return moi->moi_txn == txn && ( moi->moi_flag & MOI_READER );
+		}
+	}
+	return 0;
+}
+
 int mdb_id2entry(
 	Operation *op,
 	MDB_cursor *mc,
@@ -400,10 +448,18 @@ int mdb_id2entry(
 	Entry **e )
 {
 	MDB_val key, data;
-	int rc = 0;
+	int rc = 0, cached;
 
 	*e = NULL;
 
+	cached = mdb_ecache_reader( op, mdb_cursor_txn( mc ));
+	if ( cached && mdb_ecache_get( op, mdb_cursor_txn( mc ), id, e ) == 0 ) {
+		(*e)->e_id = id;
+		(*e)->e_name.bv_val = NULL;
+		(*e)->e_nname.bv_val = NULL;
+		return 0;
+	}
+
 	key.mv_data = &id;
 	key.mv_size = sizeof(ID);
 
@@ -413,7 +469,7 @@ int mdb_id2entry(
 		/* Looking for root entry on an empty-dn suffix? */
 		if ( !id && BER_BVISEMPTY( &op->o_bd->be_nsuffix[0] )) {
 			struct berval gluebv = BER_BVC("glue");
-			Entry *r = mdb_entry_alloc(op, 2, 4);
+			Entry *r = mdb_entry_alloc(op, 2, 4, 0);
 			Attribute *a = r->e_attrs;
 			struct berval *bptr;
 
@@ -453,6 +509,9 @@ int mdb_id2entry(
 	(*e)->e_name.bv_val = NULL;
 	(*e)->e_nname.bv_val = NULL;
 
+	if ( cached )
+		mdb_ecache_put( op, mdb_cursor_txn( mc ), *e );
+
 	return rc;
 }
 
@@ -470,6 +529,8 @@ int mdb_id2entry_delete(
 	key.mv_data = &e->e_id;
 	key.mv_size = sizeof(ID);
 
+	mdb_ecache_invalidate( mdb, tid, e->e_id );
+
 	/* delete from database */
 	rc = mdb_del( tid, dbi, &key, NULL );
 	if (rc)
@@ -498,14 +559,16 @@ int mdb_id2entry_delete(
 	return rc;
 }
 
+/* The extra bytes follow the value array, for a decompressed record */
 static Entry * mdb_entry_alloc(
 	Operation *op,
 	int nattrs,
-	int nvals )
+	int nvals,
+	size_t extra )
 {
 	Entry *e = op->o_tmpalloc( sizeof(Entry) +
 		nattrs * sizeof(Attribute) +
-		nvals * sizeof(struct berval), op->o_tmpmemctx );
+		nvals * sizeof(struct berval) + extra, op->o_tmpmemctx );
 	BER_BVZERO(&e->e_bv);
 	e->e_private = e;
 	if (nattrs) {
@@ -526,6 +589,9 @@ int mdb_entry_return(
 	if ( !e )
 		return 0;
 	if ( e->e_private ) {
+		/* a shell from the entry cache */
+		if ( e->e_private != e )
+			mdb_ecache_release( e->e_private );
 		if ( op->o_hdr && op->o_tmpmfuncs ) {
 			op->o_tmpfree( e->e_nname.bv_val, op->o_tmpmemctx );
 			op->o_tmpfree( e->e_name.bv_val, op->o_tmpmemctx );
@@ -684,6 +750,8 @@ mdb_reader_flush( MDB_env *env )
 
 extern MDB_txn *mdb_tool_txn;
 
+static int mdb_gc_join( struct mdb_info *mdb, mdb_op_info *moi );
+
 int
 mdb_opinfo_get( Operation *op, struct mdb_info *mdb, int rdonly, mdb_op_info **moip )
 {
@@ -734,6 +802,22 @@ mdb_opinfo_get( Operation *op, struct mdb_info *mdb, int rdonly, mdb_op_info **m
 		if ( moi->moi_flag & MOI_READER ) {
 			moi = *moip;
 			LDAP_SLIST_INSERT_HEAD( &op->o_extra, &moi->moi_oe, oe_next );
+		} else if (( moi->moi_flag & MOI_BULK ) && *moip && *moip != moi ) {
+		/* An update in a bulk load gets a child txn of the load's,
+		 * so that it can fail without undoing the others */
+			MDB_txn *parent = moi->moi_txn;
+			moi = *moip;
+			LDAP_SLIST_INSERT_HEAD( &op->o_extra, &moi->moi_oe, oe_next );
+			moi->moi_oe.oe_key = mdb;
+			moi->moi_ref = 1;
+			moi->moi_flag &= ~MOI_GROUP;
+			moi->moi_flag |= MOI_DEFER;
+			rc = mdb_txn_begin( mdb->mi_dbenv, parent, 0, &moi->moi_txn );
+			if (rc) {
+				Debug( LDAP_DEBUG_ANY, "mdb_opinfo_get: err %s(%d)\n",
+					mdb_strerror(rc), rc );
+			}
+			return rc;
 		} else {
 		/* This op is continuing an existing write txn */
 			*moip = moi;
@@ -748,6 +832,12 @@ mdb_opinfo_get( Operation *op, struct mdb_info *mdb, int rdonly, mdb_op_info **m
 				if ( get_lazyCommit( op ))
 					flag |= MDB_NOMETASYNC;
 #endif
+				/* LMDB has no child txns in a writable map */
+				if (( moi->moi_flag & MOI_GROUP ) && !flag &&
+					mdb->mi_gc_maxops && ( slapMode & SLAP_SERVER_MODE ) &&
+					!( mdb->mi_dbenv_flags & MDB_WRITEMAP ))
+					return mdb_gc_join( mdb, moi );
+				moi->moi_flag &= ~MOI_GROUP;
 				rc = mdb_txn_begin( mdb->mi_dbenv, NULL, flag, &moi->moi_txn );
 				if (rc) {
 					Debug( LDAP_DEBUG_ANY, "mdb_opinfo_get: err %s(%d)\n",
@@ -811,6 +901,198 @@ ok:
 	return 0;
 }
 
+/* Group commit: a writer that finds no group open becomes the leader
+ * of a new one and begins the txn it shares. Every member, the leader
+ * included, runs its update in a child txn of it, one member at a time.
+ * When its own update is done, the leader waits for up to mi_gc_maxops
+ * updates or mi_gc_msec milliseconds, then commits the shared txn; the
+ * other members wait for that commit before their results are sent.
+ * Only the leader may end the shared txn: LMDB's writer lock belongs
+ * to the thread that began it.
+ *
+ * The members begin and end their child txns on their own threads.
+ * LMDB only ties a write txn to a thread through the writer lock,
+ * which a child txn neither takes nor releases; all else a txn keeps
+ * is plain memory. mi_gc_busy, set and cleared under mi_gc_mutex, lets
+ * one member at a time use the shared txn, so that each sees all the
+ * changes of the one before, and the leader waits for the last one to
+ * finish before it commits.
+ */
+#define MDB_GC_IDLE	0
+#define MDB_GC_STARTING	1	/* the leader is beginning the shared txn */
+#define MDB_GC_OPEN	2
+#define MDB_GC_CLOSING	3	/* the leader is committing it */
+
+/* Called by the leader with mi_gc_mutex locked */
+static int
+mdb_gc_lead( struct mdb_info *mdb )
+{
+	struct timeval now;
+	unsigned nops;
+	long msec;
+	int idle, rc;
+
+	for (;;) {
+		if ( mdb->mi_gc_nops >= mdb->mi_gc_maxops )
+			break;
+		gettimeofday( &now, NULL );
+		msec = mdb->mi_gc_msec -
+			( now.tv_sec - mdb->mi_gc_start.tv_sec ) * 1000 -
+			( now.tv_usec - mdb->mi_gc_start.tv_usec ) / 1000;
+		if ( msec <= 0 )
+			break;
+		/* Don't wait when no other writer is about, nor when
+		 * nobody came along for a millisecond */
+		idle = !mdb->mi_gc_busy && !mdb->mi_gc_waiting;
+		if ( idle && msec > 1 )
+			msec = 1;
+		nops = mdb->mi_gc_nops;
+		rc = ldap_pvt_thread_cond_timedwait( &mdb->mi_gc_cond,
+			&mdb->mi_gc_mutex, msec );
+		if ( idle && rc && !mdb->mi_gc_busy && !mdb->mi_gc_waiting &&
+			mdb->mi_gc_nops == nops )
+			break;
+	}
+
+	mdb->mi_gc_state = MDB_GC_CLOSING;
+	while ( mdb->mi_gc_busy )
+		ldap_pvt_thread_cond_wait( &mdb->mi_gc_cond, &mdb->mi_gc_mutex );
+	ldap_pvt_thread_mutex_unlock( &mdb->mi_gc_mutex );
+
+	rc = mdb_txn_commit( mdb->mi_gc_txn );
+	if ( rc ) {
+		Debug( LDAP_DEBUG_ANY, "mdb_gc_lead: "
+			"commit of %u updates failed: %s (%d)\n",
+			mdb->mi_gc_nops, mdb_strerror(rc), rc );
+	}
+
+	ldap_pvt_thread_mutex_lock( &mdb->mi_gc_mutex );
+	if ( rc )
+		mdb->mi_numads = mdb->mi_gc_numads;
+	mdb->mi_gc_txn = NULL;
+	mdb->mi_gc_rc = rc;
+	mdb->mi_gc_done = mdb->mi_gc_gen;
+	ldap_pvt_thread_cond_broadcast( &mdb->mi_gc_cond );
+	/* The members must get this group's result, not the next one's */
+	while ( mdb->mi_gc_pending )
+		ldap_pvt_thread_cond_wait( &mdb->mi_gc_cond, &mdb->mi_gc_mutex );
+	mdb->mi_gc_state = MDB_GC_IDLE;
+	ldap_pvt_thread_cond_broadcast( &mdb->mi_gc_cond );
+	return rc;
+}
+
+static int
+mdb_gc_join( struct mdb_info *mdb, mdb_op_info *moi )
+{
+	MDB_txn *txn;
+	int rc;
+
+	ldap_pvt_thread_mutex_lock( &mdb->mi_gc_mutex );
+	mdb->mi_gc_waiting++;
+	while ( mdb->mi_gc_state == MDB_GC_STARTING ||
+		mdb->mi_gc_state == MDB_GC_CLOSING || mdb->mi_gc_busy ||
+		( mdb->mi_gc_state == MDB_GC_OPEN &&
+			mdb->mi_gc_nops >= mdb->mi_gc_maxops ))
+		ldap_pvt_thread_cond_wait( &mdb->mi_gc_cond, &mdb->mi_gc_mutex );
+	mdb->mi_gc_waiting--;
+
+	if ( mdb->mi_gc_state == MDB_GC_IDLE ) {
+		mdb->mi_gc_state = MDB_GC_STARTING;
+		ldap_pvt_thread_mutex_unlock( &mdb->mi_gc_mutex );
+		rc = mdb_txn_begin( mdb->mi_dbenv, NULL, 0, &txn );
+		ldap_pvt_thread_mutex_lock( &mdb->mi_gc_mutex );
+		if ( rc ) {
+			mdb->mi_gc_state = MDB_GC_IDLE;
+			ldap_pvt_thread_cond_broadcast( &mdb->mi_gc_cond );
+			ldap_pvt_thread_mutex_unlock( &mdb->mi_gc_mutex );
+			Debug( LDAP_DEBUG_ANY, "mdb_gc_join: err %s(%d)\n",
+				mdb_strerror(rc), rc );
+			moi->moi_flag &= ~MOI_GROUP;
+			return rc;
+		}
+		mdb->mi_gc_txn = txn;
+		mdb->mi_gc_state = MDB_GC_OPEN;
+		mdb->mi_gc_nops = 0;
+		mdb->mi_gc_gen++;
+		mdb->mi_gc_numads = mdb->mi_numads;
+		gettimeofday( &mdb->mi_gc_start, NULL );
+		moi->moi_flag |= MOI_LEADER;
+	}
+
+	rc = mdb_txn_begin( mdb->mi_dbenv, mdb->mi_gc_txn, 0, &moi->moi_txn );
+	if ( rc ) {
+		Debug( LDAP_DEBUG_ANY, "mdb_gc_join: err %s(%d)\n",
+			mdb_strerror(rc), rc );
+		moi->moi_txn = NULL;
+		if ( moi->moi_flag & MOI_LEADER )
+			mdb_gc_lead( mdb );
+		moi->moi_flag &= ~(MOI_GROUP|MOI_LEADER);
+	} else {
+		mdb->mi_gc_busy = 1;
+		mdb->mi_gc_cnumads = mdb->mi_numads;
+		moi->moi_gen = mdb->mi_gc_gen;
+	}
+	ldap_pvt_thread_mutex_unlock( &mdb->mi_gc_mutex );
+	return rc;
+}
+
+static int
+mdb_gc_end( struct mdb_info *mdb, mdb_op_info *moi, int commit )
+{
+	int rc = 0, rc2;
+
+	if ( commit )
+		rc = mdb_txn_commit( moi->moi_txn );
+	else
+		mdb_txn_abort( moi->moi_txn );
+	moi->moi_txn = NULL;
+
+	ldap_pvt_thread_mutex_lock( &mdb->mi_gc_mutex );
+	mdb->mi_gc_busy = 0;
+	if ( commit && !rc ) {
+		mdb->mi_gc_nops++;
+	} else {
+		mdb->mi_numads = mdb->mi_gc_cnumads;
+	}
+	ldap_pvt_thread_cond_broadcast( &mdb->mi_gc_cond );
+
+	if ( moi->moi_flag & MOI_LEADER ) {
+		rc2 = mdb_gc_lead( mdb );
+		if ( commit && !rc )
+			rc = rc2;
+	} else if ( commit && !rc ) {
+		mdb->mi_gc_pending++;
+		while ( mdb->mi_gc_done < moi->moi_gen )
+			ldap_pvt_thread_cond_wait( &mdb->mi_gc_cond, &mdb->mi_gc_mutex );
+		rc = mdb->mi_gc_rc;
+		if ( --mdb->mi_gc_pending == 0 )
+			ldap_pvt_thread_cond_broadcast( &mdb->mi_gc_cond );
+	}
+	ldap_pvt_thread_mutex_unlock( &mdb->mi_gc_mutex );
+	moi->moi_flag &= ~MOI_LEADER;
+	return rc;
+}
+
+/* Commit the write txn of an update; if it joined a group,
+ * return once the group is committed.
+ */
+int
+mdb_opinfo_commit( struct mdb_info *mdb, mdb_op_info *moi )
+{
+	if ( moi->moi_flag & MOI_GROUP )
+		return mdb_gc_end( mdb, moi, 1 );
+	return mdb_txn_commit( moi->moi_txn );
+}
+
+void
+mdb_opinfo_abort( struct mdb_info *mdb, mdb_op_info *moi )
+{
+	if ( moi->moi_flag & MOI_GROUP )
+		mdb_gc_end( mdb, moi, 0 );
+	else
+		mdb_txn_abort( moi->moi_txn );
+}
+
 int mdb_txn( Operation *op, int txnop, OpExtra **ptr )
 {
 	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
@@ -825,8 +1107,35 @@ int mdb_txn( Operation *op, int txnop, OpExtra **ptr )
 			moi->moi_flag |= MOI_KEEPER;
 		}
 		return rc;
+	case SLAP_TXN_BULK:
+		/* LMDB has no child txns in a writable map */
+		if ( mdb->mi_dbenv_flags & MDB_WRITEMAP )
+			return LDAP_UNWILLING_TO_PERFORM;
+		rc = mdb_opinfo_get( op, mdb, 0, moip );
+		if ( rc )
+			return rc;
+		moi = *moip;
+		moi->moi_flag |= MOI_KEEPER|MOI_BULK;
+		rc = mdb_online_index_defer( op, moi->moi_txn );
+		if ( rc ) {
+			mdb->mi_numads = 0;
+			mdb_txn_abort( moi->moi_txn );
+			LDAP_SLIST_REMOVE( &op->o_extra, &moi->moi_oe, OpExtra, oe_next );
+			op->o_tmpfree( moi, op->o_tmpmemctx );
+			*moip = NULL;
+		}
+		return rc;
 	case SLAP_TXN_COMMIT:
+		/* the entries added are to be indexed even after a restart */
+		if ( moi->moi_flag & MOI_BULK ) {
+			rc = mdb_ixstate_put( mdb, moi->moi_txn );
+			if ( rc ) {
+				mdb_txn_abort( moi->moi_txn );
+				goto fail;
+			}
+		}
 		rc = mdb_txn_commit( moi->moi_txn );
+fail:
 		if ( rc )
 			mdb->mi_numads = 0;
 		op->o_tmpfree( moi, op->o_tmpmemctx );
@@ -836,6 +1145,9 @@ int mdb_txn( Operation *op, int txnop, OpExtra **ptr )
 		mdb_txn_abort( moi->moi_txn );
 		op->o_tmpfree( moi, op->o_tmpmemctx );
 		return 0;
+	case SLAP_TXN_BULK_END:
+		mdb_online_index_resume( op->o_bd );
+		return 0;
 	}
 	return LDAP_OTHER;
 }
@@ -1025,9 +1337,26 @@ int mdb_entry_decode(Operation *op, MDB_txn *txn, MDB_val *data, ID id, Entry **
 	Debug( LDAP_DEBUG_TRACE,
 		"=> mdb_entry_decode:\n" );
 
-	nattrs = *lp++;
-	nvals = *lp++;
-	x = mdb_entry_alloc(op, nattrs, nvals);
+	if (*lp & MDB_ENC_PACKED) {
+		/* nattrs, nvals and the length of the record follow */
+		unsigned int *hp = lp;
+		x = mdb_entry_alloc(op, hp[1], hp[2], hp[3]);
+		lp = (unsigned int *)((char *)(x+1) + hp[1] * sizeof(Attribute) +
+			hp[2] * sizeof(struct berval));
+		if (mdb_entry_unpack(mdb, txn, data, lp, hp[3])) {
+			Debug( LDAP_DEBUG_ANY,
+				"mdb_entry_decode: entry %lu: invalid compressed data\n",
+				(unsigned long) id );
+			op->o_tmpfree( x, op->o_tmpmemctx );
+			return LDAP_OTHER;
+		}
+		nattrs = *lp++;
+		nvals = *lp++;
+	} else {
+		nattrs = *lp++;
+		nvals = *lp++;
+		x = mdb_entry_alloc(op, nattrs, nvals, 0);
+	}
 	x->e_ocflags = *lp++;
 	if (!nvals) {
 		goto done;
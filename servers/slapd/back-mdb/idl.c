@@ -84,6 +84,133 @@ void mdb_idl_reset()
 	MDB_idl_um_max = MDB_idl_um_size - 1;
 }
 
+/* Bit twiddling on the bitmap half of a bitmap IDL word */
+#if defined(__GNUC__) && SIZEOF_LONG == 8
+#define IDL_POPCOUNT(w)	__builtin_popcountl( (w) & MDB_IDL_WMASK )
+#define IDL_LOWBIT(w)	__builtin_ctzl( (w) & MDB_IDL_WMASK )
+#define IDL_HIGHBIT(w)	( sizeof(ID) * CHAR_BIT - 1 - __builtin_clzl( (w) & MDB_IDL_WMASK ))
+#else
+static unsigned
+idl_popcount( ID w )
+{
+	unsigned n = 0;
+
+	for ( w &= MDB_IDL_WMASK; w; w &= w - 1 )
+		n++;
+	return n;
+}
+
+static unsigned
+idl_lowbit( ID w )
+{
+	unsigned n = 0;
+
+	for ( w &= MDB_IDL_WMASK; !( w & 1 ); w >>= 1 )
+		n++;
+	return n;
+}
+
+static unsigned
+idl_highbit( ID w )
+{
+	unsigned n = 0;
+
+	for ( w &= MDB_IDL_WMASK; w >>= 1; )
+		n++;
+	return n;
+}
+#define IDL_POPCOUNT(w)	idl_popcount(w)
+#define IDL_LOWBIT(w)	idl_lowbit(w)
+#define IDL_HIGHBIT(w)	idl_highbit(w)
+#endif
+
+ID mdb_idl_bits_first( ID *ids )
+{
+	return MDB_IDL_WBASE( ids[1] ) + IDL_LOWBIT( ids[1] );
+}
+
+ID mdb_idl_bits_last( ID *ids )
+{
+	ID w = ids[MDB_IDL_LEN( ids )];
+	return MDB_IDL_WBASE( w ) + IDL_HIGHBIT( w );
+}
+
+ID mdb_idl_bits_count( ID *ids )
+{
+	ID i, n = 0;
+
+	for ( i = 1; i <= MDB_IDL_LEN( ids ); i++ )
+		n += IDL_POPCOUNT( ids[i] );
+	return n;
+}
+
+/* binary search for the first word whose chunk is >= chunk */
+static unsigned
+mdb_idl_bits_search( ID *ids, ID chunk )
+{
+	unsigned base = 0;
+	unsigned n = MDB_IDL_LEN( ids );
+
+	while ( 0 < n ) {
+		unsigned pivot = n >> 1;
+		if ( MDB_IDL_WCHUNK( ids[base + pivot + 1] ) < chunk ) {
+			base += pivot + 1;
+			n -= pivot + 1;
+		} else {
+			n = pivot;
+		}
+	}
+	return base + 1;
+}
+
+/* return the smallest ID in the bitmap that is >= id */
+static ID
+mdb_idl_bits_seek( ID *ids, ID id )
+{
+	unsigned x, n = MDB_IDL_LEN( ids );
+	ID w;
+
+	if ( id > MDB_IDL_BITS_MAXID )
+		return NOID;
+
+	x = mdb_idl_bits_search( ids, id >> MDB_IDL_WSHIFT );
+	if ( x > n )
+		return NOID;
+
+	w = ids[x];
+	if ( MDB_IDL_WCHUNK( w ) == id >> MDB_IDL_WSHIFT ) {
+		/* drop the bits below id */
+		w &= ~((((ID)1) << ( id & ( MDB_IDL_WBITS-1 ))) - 1 );
+		if ( !( w & MDB_IDL_WMASK )) {
+			if ( ++x > n )
+				return NOID;
+			w = ids[x];
+		}
+	}
+	return MDB_IDL_WBASE( w ) + IDL_LOWBIT( w );
+}
+
+int mdb_idl_tobits( ID *ids )
+{
+	ID i, j, w;
+
+	if ( MDB_IDL_IS_ZERO( ids ) || MDB_IDL_IS_BITS( ids ))
+		return 0;
+	if ( MDB_IDL_IS_RANGE( ids ) || ids[ids[0]] > MDB_IDL_BITS_MAXID )
+		return -1;
+
+	/* words never outnumber IDs, so this can be done in place */
+	for ( i = 1, j = 0; i <= ids[0]; i++ ) {
+		w = MDB_IDL_WORD( ids[i] );
+		if ( j && MDB_IDL_WCHUNK( ids[j] ) == MDB_IDL_WCHUNK( w ))
+			ids[j] |= w;
+		else
+			ids[++j] = w;
+	}
+	ids[0] = MDB_IDL_BITS | j;
+	return 0;
+}
+
 unsigned mdb_idl_search( ID *ids, ID id )
 {
 #define IDL_BINARY_SEARCH 1
@@ -349,25 +476,67 @@ mdb_idl_fetch_key(
 		rc = MDB_NOTFOUND;
 	}
 	if (rc == 0) {
-		i = ids+1;
-		rc = mdb_cursor_get( cursor, key, &data, MDB_GET_MULTIPLE );
-		while (rc == 0) {
-			memcpy( i, data.mv_data, data.mv_size );
-			i += data.mv_size / sizeof(ID);
-			rc = mdb_cursor_get( cursor, key, &data, MDB_NEXT_MULTIPLE );
+		ID lo, hi;
+		int big = 0;
+
+		/* A 0 marker introduces a range or a bitmap. A bitmap is
+		 * only bounded by the number of its words, and may not fit.
+		 */
+		memcpy( &lo, data.mv_data, sizeof(ID) );
+		if ( lo == 0 ) {
+			size_t count;
+			rc = mdb_cursor_count( cursor, &count );
+			if ( rc == 0 )
+				rc = mdb_cursor_get( cursor, key, &data, MDB_LAST_DUP );
+			if ( rc == 0 ) {
+				memcpy( &hi, data.mv_data, sizeof(ID) );
+				big = ( hi == NOID && count > MDB_idl_um_max );
+			}
+			if ( rc == 0 && big ) {
+				/* Too many words, settle for the bitmap's range */
+				ID w;
+				mdb_cursor_get( cursor, key, &data, MDB_PREV_DUP );
+				memcpy( &w, data.mv_data, sizeof(ID) );
+				hi = MDB_IDL_WBASE( w ) + IDL_HIGHBIT( w );
+				mdb_cursor_get( cursor, key, &data, MDB_FIRST_DUP );
+				mdb_cursor_get( cursor, key, &data, MDB_NEXT_DUP );
+				memcpy( &w, data.mv_data, sizeof(ID) );
+				lo = MDB_IDL_WBASE( w ) + IDL_LOWBIT( w );
+				MDB_IDL_RANGE( ids, lo, hi );
+				/* leave the cursor on the last dup for MDB_NEXT */
+				rc = mdb_cursor_get( cursor, key, &data, MDB_LAST_DUP );
+			} else if ( rc == 0 ) {
+				rc = mdb_cursor_get( cursor, key, &data, MDB_FIRST_DUP );
+			}
 		}
-		if ( rc == MDB_NOTFOUND ) rc = 0;
-		ids[0] = i - &ids[1];
-		/* On disk, a range is denoted by 0 in the first element */
-		if (ids[1] == 0) {
-			if (ids[0] != MDB_IDL_RANGE_SIZE) {
-				Debug( LDAP_DEBUG_ANY, "=> mdb_idl_fetch_key: "
-					"range size mismatch: expected %d, got %ld\n",
-					MDB_IDL_RANGE_SIZE, ids[0] );
-				mdb_cursor_close( cursor );
-				return -1;
+		if ( rc == 0 && !big ) {
+			i = ids+1;
+			rc = mdb_cursor_get( cursor, key, &data, MDB_GET_MULTIPLE );
+			while (rc == 0) {
+				memcpy( i, data.mv_data, data.mv_size );
+				i += data.mv_size / sizeof(ID);
+				rc = mdb_cursor_get( cursor, key, &data, MDB_NEXT_MULTIPLE );
+			}
+			if ( rc == MDB_NOTFOUND ) rc = 0;
+			ids[0] = i - &ids[1];
+			/* On disk, a range is denoted by 0 in the first element,
+			 * a bitmap by 0 in the first and NOID in the last element.
+			 */
+			if ( ids[1] == 0 && ids[ids[0]] == NOID ) {
+				ids[0] -= 2;
+				AC_MEMCPY( &ids[1], &ids[2], ids[0] * sizeof(ID) );
+				if ( ids[0] )
+					ids[0] |= MDB_IDL_BITS;
+			} else if ( ids[1] == 0 ) {
+				if (ids[0] != MDB_IDL_RANGE_SIZE) {
+					Debug( LDAP_DEBUG_ANY, "=> mdb_idl_fetch_key: "
+						"range size mismatch: expected %d, got %ld\n",
+						MDB_IDL_RANGE_SIZE, ids[0] );
+					mdb_cursor_close( cursor );
+					return -1;
+				}
+				MDB_IDL_RANGE( ids, ids[2], ids[3] );
 			}
-			MDB_IDL_RANGE( ids, ids[2], ids[3] );
 		}
 		data.mv_size = MDB_IDL_SIZEOF(ids);
 	}
@@ -406,6 +575,232 @@ mdb_idl_fetch_key(
 	return rc;
 }
 
+/* Estimate the number of IDs stored under a key without reading
+ * them. Lists are counted exactly, ranges and bitmaps by their bounds.
+ */
+int
+mdb_idl_count_key(
+	MDB_txn		*txn,
+	MDB_dbi		dbi,
+	MDB_val		*key,
+	ID			*count )
+{
+	MDB_cursor *cursor;
+	MDB_val data;
+	ID lo, hi;
+	size_t n;
+	int rc;
+
+	rc = mdb_cursor_open( txn, dbi, &cursor );
+	if ( rc )
+		return rc;
+	rc = mdb_cursor_get( cursor, key, &data, MDB_SET );
+	if ( rc == 0 ) {
+		memcpy( &lo, data.mv_data, sizeof(ID) );
+		rc = mdb_cursor_count( cursor, &n );
+	}
+	if ( rc == 0 ) {
+		*count = n;
+		if ( lo == 0 ) {
+			rc = mdb_cursor_get( cursor, key, &data, MDB_LAST_DUP );
+			if ( rc == 0 ) {
+				memcpy( &hi, data.mv_data, sizeof(ID) );
+				if ( hi == NOID ) {
+					/* bitmap, every bit of every word could be set */
+					*count = ( n - 2 ) * MDB_IDL_WBITS;
+				} else {
+					rc = mdb_cursor_get( cursor, key, &data, MDB_PREV_DUP );
+					if ( rc == 0 ) {
+						memcpy( &lo, data.mv_data, sizeof(ID) );
+						*count = hi - lo + 1;
+					}
+				}
+			}
+		}
+	}
+	mdb_cursor_close( cursor );
+	return rc;
+}
+
+/* Store a range for the key, which must not exist */
+static int
+mdb_idl_range_put(
+	MDB_cursor	*cursor,
+	MDB_val		*key,
+	ID			lo,
+	ID			hi )
+{
+	MDB_val data;
+	ID id = 0;
+	int rc;
+
+	data.mv_size = sizeof(ID);
+	data.mv_data = &id;
+	rc = mdb_cursor_put( cursor, key, &data, 0 );
+	if ( rc == 0 ) {
+		id = lo;
+		rc = mdb_cursor_put( cursor, key, &data, 0 );
+	}
+	if ( rc == 0 ) {
+		id = hi;
+		rc = mdb_cursor_put( cursor, key, &data, 0 );
+	}
+	return rc;
+}
+
+/* Convert the full list the cursor is positioned on into a bitmap,
+ * adding id to it. Returns -1 without touching the DB if some ID is
+ * too large to be kept in a bitmap.
+ */
+static int
+mdb_idl_bits_convert(
+	MDB_cursor	*cursor,
+	MDB_val		*key,
+	size_t		count,
+	ID			id )
+{
+	MDB_val data, k2;
+	ID *ids, *i, w, x, n;
+	int rc;
+
+	ids = ch_malloc(( count + 3 ) * sizeof(ID));
+	i = ids+1;
+	rc = mdb_cursor_get( cursor, &k2, &data, MDB_GET_MULTIPLE );
+	while ( rc == 0 ) {
+		memcpy( i, data.mv_data, data.mv_size );
+		i += data.mv_size / sizeof(ID);
+		rc = mdb_cursor_get( cursor, &k2, &data, MDB_NEXT_MULTIPLE );
+	}
+	if ( rc != MDB_NOTFOUND )
+		goto leave;
+	ids[0] = i - &ids[1];
+	if ( id > MDB_IDL_BITS_MAXID || mdb_idl_tobits( ids )) {
+		rc = -1;
+		goto leave;
+	}
+
+	/* merge in the new ID */
+	w = MDB_IDL_WORD( id );
+	n = MDB_IDL_LEN( ids );
+	x = mdb_idl_bits_search( ids, MDB_IDL_WCHUNK( w ));
+	if ( x <= n && MDB_IDL_WCHUNK( ids[x] ) == MDB_IDL_WCHUNK( w )) {
+		ids[x] |= w;
+	} else {
+		AC_MEMCPY( &ids[x+1], &ids[x], ( n-x+1 ) * sizeof(ID) );
+		ids[x] = w;
+		n++;
+	}
+
+	/* replace the list with the bitmap */
+	rc = mdb_cursor_get( cursor, &k2, &data, MDB_FIRST_DUP );
+	if ( rc == 0 )
+		rc = mdb_cursor_del( cursor, MDB_NODUPDATA );
+	if ( rc )
+		goto leave;
+	ids[0] = 0;
+	ids[n+1] = NOID;
+	data.mv_size = sizeof(ID);
+	for ( x = 0; x <= n+1; x++ ) {
+		data.mv_data = &ids[x];
+		rc = mdb_cursor_put( cursor, key, &data, x ? MDB_APPENDDUP : 0 );
+		if ( rc )
+			break;
+	}
+leave:
+	ch_free( ids );
+	return rc;
+}
+
+/* Add an ID to the bitmap the cursor is positioned on */
+static int
+mdb_idl_bits_add(
+	MDB_cursor	*cursor,
+	MDB_val		*key,
+	ID			id )
+{
+	MDB_val data, k2;
+	ID w, nw;
+	int rc;
+
+	if ( id > MDB_IDL_BITS_MAXID ) {
+		/* Can't be kept in a bitmap, fall back to a range */
+		rc = mdb_cursor_get( cursor, &k2, &data, MDB_FIRST_DUP );
+		if ( rc == 0 )
+			rc = mdb_cursor_get( cursor, &k2, &data, MDB_NEXT_DUP );
+		if ( rc )
+			return rc;
+		memcpy( &w, data.mv_data, sizeof(ID) );
+		rc = mdb_cursor_del( cursor, MDB_NODUPDATA );
+		if ( rc )
+			return rc;
+		return mdb_idl_range_put( cursor, key,
+			MDB_IDL_WBASE( w ) + IDL_LOWBIT( w ), id );
+	}
+
+	/* find the word for this ID's chunk. Words are never 0, so
+	 * this skips the 0 marker, and the NOID marker sorts after
+	 * every word, so this always lands on something.
+	 */
+	nw = MDB_IDL_WORD( id );
+	w = ( nw & ~MDB_IDL_WMASK ) | 1;
+	data.mv_size = sizeof(ID);
+	data.mv_data = &w;
+	rc = mdb_cursor_get( cursor, key, &data, MDB_GET_BOTH_RANGE );
+	if ( rc )
+		return rc;
+	memcpy( &w, data.mv_data, sizeof(ID) );
+	data.mv_data = &nw;
+	if ( MDB_IDL_WCHUNK( w ) == MDB_IDL_WCHUNK( nw )) {
+		if ( w & nw & MDB_IDL_WMASK )
+			return 0;
+		nw |= w;
+		return mdb_cursor_put( cursor, key, &data, MDB_CURRENT );
+	}
+	return mdb_cursor_put( cursor, key, &data, 0 );
+}
+
+/* Remove an ID from the bitmap the cursor is positioned on */
+static int
+mdb_idl_bits_del(
+	MDB_cursor	*cursor,
+	MDB_val		*key,
+	ID			id )
+{
+	MDB_val data;
+	ID w, nw;
+	size_t count;
+	int rc;
+
+	if ( id > MDB_IDL_BITS_MAXID )
+		return 0;
+
+	nw = MDB_IDL_WORD( id );
+	w = ( nw & ~MDB_IDL_WMASK ) | 1;
+	data.mv_size = sizeof(ID);
+	data.mv_data = &w;
+	rc = mdb_cursor_get( cursor, key, &data, MDB_GET_BOTH_RANGE );
+	if ( rc )
+		return rc;
+	memcpy( &w, data.mv_data, sizeof(ID) );
+	if ( MDB_IDL_WCHUNK( w ) != MDB_IDL_WCHUNK( nw ) ||
+		!( w & nw & MDB_IDL_WMASK ))
+		return 0;
+
+	w &= ~( nw & MDB_IDL_WMASK );
+	if ( w & MDB_IDL_WMASK ) {
+		data.mv_data = &w;
+		return mdb_cursor_put( cursor, key, &data, MDB_CURRENT );
+	}
+
+	/* the word is empty now. If it was the only one, drop
+	 * the markers along with it.
+	 */
+	rc = mdb_cursor_count( cursor, &count );
+	if ( rc == 0 )
+		rc = mdb_cursor_del( cursor, count > 3 ? 0 : MDB_NODUPDATA );
+	return rc;
+}
+
 int
 mdb_idl_insert_keys(
 	BackendDB	*be,
@@ -441,7 +836,8 @@ mdb_idl_insert_keys(
 	 * exists and if it's a range.
 	 */
 #ifndef MISALIGNED_OK
-	if (keys[k].bv_len & ALIGNER) {
+	/* kbuf only has room for short keys */
+	if ((keys[k].bv_len & ALIGNER) && keys[k].bv_len < sizeof(kbuf)) {
 		key.mv_size = sizeof(kbuf);
 		key.mv_data = kbuf;
 		memcpy(key.mv_data, keys[k].bv_val, keys[k].bv_len);
@@ -465,7 +861,22 @@ mdb_idl_insert_keys(
 				goto fail;
 			}
 			if ( count >= MDB_idl_db_max ) {
-			/* No room, convert to a range */
+			/* No room, convert to a bitmap or a range */
+				if ( mdb->mi_idl_bitmap ) {
+					rc = mdb_idl_bits_convert( cursor, &key, count, id );
+					if ( rc == 0 )
+						continue;
+					if ( rc != -1 ) {
+						err = "bits convert";
+						goto fail;
+					}
+					rc = mdb_cursor_get( cursor, &key, &data, MDB_FIRST_DUP );
+					if ( rc != 0 ) {
+						err = "c_get first_dup";
+						goto fail;
+					}
+					i = data.mv_data;
+				}
 				lo = *i;
 				rc = mdb_cursor_get( cursor, &key, &data, MDB_LAST_DUP );
 				if ( rc != 0 && rc != MDB_NOTFOUND ) {
@@ -514,6 +925,27 @@ mdb_idl_insert_keys(
 				goto put1;
 			}
 		} else {
+			/* It's a range or a bitmap */
+			rc = mdb_cursor_get( cursor, &key, &data, MDB_LAST_DUP );
+			if ( rc != 0 ) {
+				err = "c_get last_dup";
+				goto fail;
+			}
+			memcpy( &hi, data.mv_data, sizeof(ID) );
+			if ( hi == NOID ) {
+				rc = mdb_idl_bits_add( cursor, &key, id );
+				if ( rc != 0 ) {
+					err = "bits add";
+					goto fail;
+				}
+				continue;
+			}
+			rc = mdb_cursor_get( cursor, &key, &data, MDB_FIRST_DUP );
+			if ( rc != 0 ) {
+				err = "c_get first_dup";
+				goto fail;
+			}
+			i = data.mv_data;
 			/* It's a range, see if we need to rewrite
 			 * the boundaries
 			 */
@@ -599,7 +1031,8 @@ mdb_idl_delete_keys(
 	 * exists and if it's a range.
 	 */
 #ifndef MISALIGNED_OK
-	if (keys[k].bv_len & ALIGNER) {
+	/* kbuf only has room for short keys */
+	if ((keys[k].bv_len & ALIGNER) && keys[k].bv_len < sizeof(kbuf)) {
 		key.mv_size = sizeof(kbuf);
 		key.mv_data = kbuf;
 		memcpy(key.mv_data, keys[k].bv_val, keys[k].bv_len);
@@ -628,6 +1061,27 @@ mdb_idl_delete_keys(
 				goto fail;
 			}
 		} else {
+			/* It's a range or a bitmap */
+			rc = mdb_cursor_get( cursor, &key, &data, MDB_LAST_DUP );
+			if ( rc != 0 ) {
+				err = "c_get last_dup";
+				goto fail;
+			}
+			memcpy( &tmp, data.mv_data, sizeof(ID) );
+			if ( tmp == NOID ) {
+				rc = mdb_idl_bits_del( cursor, &key, id );
+				if ( rc != 0 ) {
+					err = "bits del";
+					goto fail;
+				}
+				continue;
+			}
+			rc = mdb_cursor_get( cursor, &key, &data, MDB_FIRST_DUP );
+			if ( rc != 0 ) {
+				err = "c_get first_dup";
+				goto fail;
+			}
+			i = data.mv_data;
 			/* It's a range, see if we need to rewrite
 			 * the boundaries
 			 */
@@ -704,6 +1158,150 @@ fail:
 }
 
 
+/* Lists whose sizes differ by more than this factor are intersected
+ * by galloping through the longer one instead of merging.
+ */
+#define IDL_GALLOP_RATIO	16
+
+/* return the position of the first element >= id in ids[pos..n],
+ * or n+1. Probes at exponentially growing distances from pos, then
+ * binary searches the last interval.
+ */
+static ID
+mdb_idl_gallop( ID *ids, ID pos, ID n, ID id )
+{
+	ID hi = pos, step = 1, mid;
+
+	while ( hi <= n && ids[hi] < id ) {
+		pos = hi + 1;
+		hi += step;
+		step <<= 1;
+	}
+	if ( hi > n )
+		hi = n + 1;
+
+	while ( pos < hi ) {
+		mid = pos + (( hi - pos ) >> 1 );
+		if ( ids[mid] < id )
+			pos = mid + 1;
+		else
+			hi = mid;
+	}
+	return pos;
+}
+
+/* a = a intersection b, for lists a and b */
+static void
+mdb_idl_list_and( ID *a, ID *b )
+{
+	ID i, j, k = 0, x, y;
+	ID na = a[0], nb = b[0];
+
+	if ( na * IDL_GALLOP_RATIO < nb ) {
+		for ( i = 1, j = 1; i <= na; i++ ) {
+			j = mdb_idl_gallop( b, j, nb, a[i] );
+			if ( j > nb )
+				break;
+			if ( b[j] == a[i] )
+				a[++k] = a[i];
+		}
+	} else if ( nb * IDL_GALLOP_RATIO < na ) {
+		for ( i = 1, j = 1; j <= nb; j++ ) {
+			i = mdb_idl_gallop( a, i, na, b[j] );
+			if ( i > na )
+				break;
+			if ( a[i] == b[j] )
+				a[++k] = b[j];
+		}
+	} else {
+		/* Branch-free merge. The output never overtakes i,
+		 * so the store is harmless when there's no match.
+		 */
+		for ( i = 1, j = 1; i <= na && j <= nb; ) {
+			x = a[i];
+			y = b[j];
+			a[k+1] = x;
+			k += ( x == y );
+			i += ( x <= y );
+			j += ( y <= x );
+		}
+	}
+	a[0] = k;
+}
+
+/* a = a intersection [idmin, idmax], for list a */
+static void
+mdb_idl_list_clip( ID *a, ID idmin, ID idmax )
+{
+	ID lo, hi;
+
+	lo = mdb_idl_search( a, idmin );
+	hi = mdb_idl_search( a, idmax );
+	if ( hi <= a[0] && a[hi] == idmax )
+		hi++;
+	if ( lo > 1 )
+		AC_MEMCPY( &a[1], &a[lo], ( hi - lo ) * sizeof(ID) );
+	a[0] = hi - lo;
+}
+
+/* a = a intersection b, for bitmaps a and b */
+static void
+mdb_idl_bits_and( ID *a, ID *b )
+{
+	ID ia = 1, ib = 1, j = 0, w;
+	ID na = MDB_IDL_LEN( a ), nb = MDB_IDL_LEN( b );
+
+	while ( ia <= na && ib <= nb ) {
+		if ( MDB_IDL_WCHUNK( a[ia] ) < MDB_IDL_WCHUNK( b[ib] )) {
+			ia++;
+		} else if ( MDB_IDL_WCHUNK( a[ia] ) > MDB_IDL_WCHUNK( b[ib] )) {
+			ib++;
+		} else {
+			w = a[ia++] & b[ib++];
+			if ( w & MDB_IDL_WMASK )
+				a[++j] = w;
+		}
+	}
+	a[0] = j ? MDB_IDL_BITS | j : 0;
+}
+
+/* a = a intersection b, for list a and bitmap b */
+static void
+mdb_idl_bits_filter( ID *a, ID *b )
+{
+	ID i, ib = 1, j = 0, nb = MDB_IDL_LEN( b ), w;
+
+	for ( i = 1; i <= a[0] && ib <= nb; i++ ) {
+		w = MDB_IDL_WORD( a[i] );
+		while ( ib <= nb && MDB_IDL_WCHUNK( b[ib] ) < MDB_IDL_WCHUNK( w ))
+			ib++;
+		if ( ib <= nb && MDB_IDL_WCHUNK( b[ib] ) == MDB_IDL_WCHUNK( w ) &&
+			( b[ib] & w ) == w )
+			a[++j] = a[i];
+	}
+	a[0] = j;
+}
+
+/* a = range a intersection bitmap b, given the bounds of the result */
+static void
+mdb_idl_bits_clip( ID *a, ID *b, ID idmin, ID idmax )
+{
+	ID i, j = 0, nb = MDB_IDL_LEN( b ), w;
+
+	for ( i = mdb_idl_bits_search( b, idmin >> MDB_IDL_WSHIFT );
+		i <= nb && MDB_IDL_WBASE( b[i] ) <= idmax; i++ ) {
+		w = b[i];
+		if ( MDB_IDL_WBASE( w ) < idmin )
+			w &= ~((((ID)1) << ( idmin - MDB_IDL_WBASE( w ))) - 1 );
+		if ( idmax - MDB_IDL_WBASE( w ) < MDB_IDL_WBITS - 1 )
+			w &= ~MDB_IDL_WMASK |
+				((((ID)1) << ( idmax - MDB_IDL_WBASE( w ) + 1 )) - 1 );
+		if ( w & MDB_IDL_WMASK )
+			a[++j] = w;
+	}
+	a[0] = j ? MDB_IDL_BITS | j : 0;
+}
+
 /*
  * idl_intersection - return a = a intersection b
  */
@@ -712,9 +1310,7 @@ mdb_idl_intersection(
 	ID *a,
 	ID *b )
 {
-	ID ida, idb;
 	ID idmax, idmin;
-	ID cursora = 0, cursorb = 0, cursorc;
 	int swap = 0;
 
 	if ( MDB_IDL_IS_ZERO( a ) || MDB_IDL_IS_ZERO( b ) ) {
@@ -733,6 +1329,23 @@ mdb_idl_intersection(
 		return 0;
 	}
 
+	if ( MDB_IDL_IS_BITS( a ) || MDB_IDL_IS_BITS( b )) {
+		/* Keep the result in a, with b a bitmap */
+		if ( !MDB_IDL_IS_BITS( b )) {
+			ID *tmp = a;
+			a = b;
+			b = tmp;
+			swap = 1;
+		}
+		if ( MDB_IDL_IS_BITS( a ))
+			mdb_idl_bits_and( a, b );
+		else if ( MDB_IDL_IS_RANGE( a ))
+			mdb_idl_bits_clip( a, b, idmin, idmax );
+		else
+			mdb_idl_bits_filter( a, b );
+		goto done;
+	}
+
 	if ( MDB_IDL_IS_RANGE( a ) ) {
 		if ( MDB_IDL_IS_RANGE(b) ) {
 		/* If both are ranges, just shrink the boundaries */
@@ -757,26 +1370,10 @@ mdb_idl_intersection(
 		goto done;
 	}
 
-	/* Fine, do the intersection one element at a time.
-	 * First advance to idmin in both IDLs.
-	 */
-	cursora = cursorb = idmin;
-	ida = mdb_idl_first( a, &cursora );
-	idb = mdb_idl_first( b, &cursorb );
-	cursorc = 0;
-
-	while( ida <= idmax || idb <= idmax ) {
-		if( ida == idb ) {
-			a[++cursorc] = ida;
-			ida = mdb_idl_next( a, &cursora );
-			idb = mdb_idl_next( b, &cursorb );
-		} else if ( ida < idb ) {
-			ida = mdb_idl_next( a, &cursora );
-		} else {
-			idb = mdb_idl_next( b, &cursorb );
-		}
-	}
-	a[0] = cursorc;
+	if ( MDB_IDL_IS_RANGE( b ))
+		mdb_idl_list_clip( a, idmin, idmax );
+	else
+		mdb_idl_list_and( a, b );
 done:
 	if (swap)
 		MDB_IDL_CPY( b, a );
@@ -785,6 +1382,40 @@ done:
 }
 
 
+/* a = a union b, for bitmaps a and b. Returns -1 with a
+ * untouched if the result doesn't fit.
+ */
+static int
+mdb_idl_bits_or( ID *a, ID *b )
+{
+	ID ia = 1, ib = 1, ca, i, j, k;
+	ID na = MDB_IDL_LEN( a ), nb = MDB_IDL_LEN( b ), nc = nb;
+
+	/* Words of a are merged into b, or cat'd to it */
+	while ( ia <= na ) {
+		ca = MDB_IDL_WCHUNK( a[ia] );
+		if ( ib <= nb && MDB_IDL_WCHUNK( b[ib] ) < ca ) {
+			ib++;
+		} else if ( ib <= nb && MDB_IDL_WCHUNK( b[ib] ) == ca ) {
+			b[ib++] |= a[ia++];
+		} else {
+			if ( ++nc > MDB_idl_um_max )
+				return -1;
+			b[nc] = a[ia++];
+		}
+	}
+
+	/* b is copied back to a in sorted order */
+	for ( i = 1, j = nb+1, k = 1; i <= nb || j <= nc; k++ ) {
+		if ( j > nc || ( i <= nb && b[i] < b[j] ))
+			a[k] = b[i++];
+		else
+			a[k] = b[j++];
+	}
+	a[0] = MDB_IDL_BITS | nc;
+	return 0;
+}
+
 /*
  * idl_union - return a = a union b
  */
@@ -794,7 +1425,8 @@ mdb_idl_union(
 	ID	*b )
 {
 	ID ida, idb;
-	ID cursora = 0, cursorb = 0, cursorc;
+	ID cursora, cursorb, cursorc;
+	int skew;
 
 	if ( MDB_IDL_IS_ZERO( b ) ) {
 		return 0;
@@ -814,25 +1446,36 @@ over:		ida = IDL_MIN( MDB_IDL_FIRST(a), MDB_IDL_FIRST(b) );
 		return 0;
 	}
 
-	ida = mdb_idl_first( a, &cursora );
-	idb = mdb_idl_first( b, &cursorb );
+	if ( MDB_IDL_IS_BITS( a ) || MDB_IDL_IS_BITS( b )) {
+bits:	if ( mdb_idl_tobits( a ) || mdb_idl_tobits( b ) ||
+			mdb_idl_bits_or( a, b ))
+			goto over;
+		return 0;
+	}
 
+	cursora = 1;
+	cursorb = 1;
 	cursorc = b[0];
+	skew = a[0] * IDL_GALLOP_RATIO < b[0];
 
 	/* The distinct elements of a are cat'd to b */
-	while( ida != NOID || idb != NOID ) {
-		if ( ida < idb ) {
-			if( ++cursorc > MDB_idl_um_max ) {
-				goto over;
-			}
-			b[cursorc] = ida;
-			ida = mdb_idl_next( a, &cursora );
-
-		} else {
-			if ( ida == idb )
-				ida = mdb_idl_next( a, &cursora );
-			idb = mdb_idl_next( b, &cursorb );
+	while( cursora <= a[0] ) {
+		ida = a[cursora];
+		if ( skew )
+			cursorb = mdb_idl_gallop( b, cursorb, b[0], ida );
+		else
+			while ( cursorb <= b[0] && b[cursorb] < ida )
+				cursorb++;
+		if ( cursorb <= b[0] && b[cursorb] == ida ) {
+			cursora++;
+			cursorb++;
+			continue;
+		}
+		if( ++cursorc > MDB_idl_um_max ) {
+			goto bits;
 		}
+		b[cursorc] = ida;
+		cursora++;
 	}
 
 	/* b is copied back to a in sorted order */
@@ -927,6 +1570,14 @@ ID mdb_idl_first( ID *ids, ID *cursor )
 		return *cursor;
 	}
 
+	/* For bitmaps the cursor is the current ID */
+	if ( MDB_IDL_IS_BITS( ids ) ) {
+		pos = mdb_idl_bits_seek( ids, *cursor );
+		if ( pos != NOID )
+			*cursor = pos;
+		return pos;
+	}
+
 	if ( *cursor == 0 )
 		pos = 1;
 	else
@@ -949,6 +1600,17 @@ ID mdb_idl_next( ID *ids, ID *cursor )
 		return *cursor;
 	}
 
+	if ( MDB_IDL_IS_BITS( ids ) ) {
+		ID pos;
+
+		if ( *cursor >= MDB_IDL_BITS_MAXID )
+			return NOID;
+		pos = mdb_idl_bits_seek( ids, *cursor + 1 );
+		if ( pos != NOID )
+			*cursor = pos;
+		return pos;
+	}
+
 	if ( ++(*cursor) <= ids[0] ) {
 		return ids[*cursor];
 	}
@@ -1062,7 +1724,7 @@ mdb_idl_sort( ID *ids, ID *tmp )
 	int i,j,k,l,ir,jstack;
 	ID a, itmp;
 
-	if ( MDB_IDL_IS_RANGE( ids ))
+	if ( MDB_IDL_IS_RANGE( ids ) || MDB_IDL_IS_BITS( ids ))
 		return;
 
 	ir = ids[0];
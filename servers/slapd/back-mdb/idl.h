@@ -31,7 +31,31 @@ extern unsigned int MDB_idl_um_max;
 #define MDB_IDL_RANGE_SIZE		(3)
 #define MDB_IDL_RANGE_SIZEOF	(MDB_IDL_RANGE_SIZE * sizeof(ID))
 #define MDB_IDL_SIZEOF(ids)		((MDB_IDL_IS_RANGE(ids) \
-	? MDB_IDL_RANGE_SIZE : ((ids)[0]+1)) * sizeof(ID))
+	? MDB_IDL_RANGE_SIZE : (MDB_IDL_LEN(ids)+1)) * sizeof(ID))
+
+/* Bitmap IDLs
+ *
+ * A bitmap IDL keeps exact membership for sets too large for a
+ * plain list. Each element is a word holding a chunk number in its
+ * upper half and a bitmap of the IDs in that chunk in its lower half,
+ * so words sort in ID order. In memory, the count in ids[0] has the
+ * MDB_IDL_BITS flag set. On disk, the words are stored as dups of the
+ * key, preceded by a 0 marker and followed by a NOID marker; a range
+ * only has the 0 marker and always has exactly two more dups.
+ */
+#define MDB_IDL_BITS		((ID)1 << (sizeof(ID) * CHAR_BIT - 1))
+#define MDB_IDL_IS_BITS(ids)	(((ids)[0] & MDB_IDL_BITS) && !MDB_IDL_IS_RANGE(ids))
+#define MDB_IDL_LEN(ids)		((ids)[0] & ~MDB_IDL_BITS)
+
+#define MDB_IDL_WBITS		(sizeof(ID) * CHAR_BIT / 2)
+#define MDB_IDL_WSHIFT		(sizeof(ID) == 8 ? 5 : 4)
+#define MDB_IDL_WMASK		(((ID)1 << MDB_IDL_WBITS) - 1)
+#define MDB_IDL_WCHUNK(w)	((w) >> MDB_IDL_WBITS)
+#define MDB_IDL_WORD(id)	((((id) >> MDB_IDL_WSHIFT) << MDB_IDL_WBITS) | \
+	((ID)1 << ((id) & (MDB_IDL_WBITS-1))))
+#define MDB_IDL_WBASE(w)	(MDB_IDL_WCHUNK(w) << MDB_IDL_WSHIFT)
+/* the word of the last chunk would collide with the NOID marker */
+#define MDB_IDL_BITS_MAXID	((MDB_IDL_WMASK << MDB_IDL_WSHIFT) - 1)
 
 #define MDB_IDL_RANGE_FIRST(ids)	((ids)[1])
 #define MDB_IDL_RANGE_LAST(ids)		((ids)[2])
@@ -59,13 +83,16 @@ extern unsigned int MDB_idl_um_max;
 #define MDB_IDL_ID( mdb, ids, id ) MDB_IDL_RANGE( ids, id, NOID )
 #define MDB_IDL_ALL( ids ) MDB_IDL_RANGE( ids, 1, NOID )
 
-#define MDB_IDL_FIRST( ids )	( (ids)[1] )
+#define MDB_IDL_FIRST( ids )	( MDB_IDL_IS_BITS(ids) \
+	? mdb_idl_bits_first(ids) : (ids)[1] )
 #define MDB_IDL_LLAST( ids )	( (ids)[(ids)[0]] )
 #define MDB_IDL_LAST( ids )		( MDB_IDL_IS_RANGE(ids) \
-	? (ids)[2] : (ids)[(ids)[0]] )
+	? (ids)[2] : MDB_IDL_IS_BITS(ids) \
+	? mdb_idl_bits_last(ids) : (ids)[(ids)[0]] )
 
 #define MDB_IDL_N( ids )		( MDB_IDL_IS_RANGE(ids) \
-	? ((ids)[2]-(ids)[1])+1 : (ids)[0] )
+	? ((ids)[2]-(ids)[1])+1 : MDB_IDL_IS_BITS(ids) \
+	? mdb_idl_bits_count(ids) : (ids)[0] )
 
 	/** An ID2 is an ID/value pair.
 	 */
@@ -99,6 +126,7 @@ LDAP_BEGIN_DECL
 void mdb_idl_reset();
 
 
+
 	/** Search for an ID in an ID2L.
 	 * @param[in] ids	The ID2L to search.
 	 * @param[in] id	The ID to search for.
@@ -0,0 +1,233 @@
+/* idlbench.c - micro-benchmark for the IDL set operations */
+/* $OpenLDAP$ */
+/* This work is part of OpenLDAP Software <http://www.openldap.org/>.
+ *
+ * Copyright 2000-2020 The OpenLDAP Foundation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+/* Times mdb_idl_intersection and mdb_idl_union against the plain
+ * element-at-a-time merges they replaced, on IDL shapes seen in
+ * filter evaluation, and checks that both produce the same result.
+ * Built on demand with "make idlbench"; not installed.
+ */
+
+#define CH_FREE 1
+
+#include "portable.h"
+
+#include <stdio.h>
+#include <ac/stdlib.h>
+#include <ac/string.h>
+#include <ac/time.h>
+
+#include "back-mdb.h"
+#include "idl.h"
+
+#define IDL_MAX(x,y)	( (x) > (y) ? (x) : (y) )
+#define IDL_MIN(x,y)	( (x) < (y) ? (x) : (y) )
+
+/* slapd globals referenced by idl.c */
+int slap_debug;
+int ldap_syslog;
+int ldap_syslog_level;
+
+void *
+ch_malloc( ber_len_t size )
+{
+	void *p = malloc( size );
+	if ( p == NULL ) {
+		perror( "malloc" );
+		exit( EXIT_FAILURE );
+	}
+	return p;
+}
+
+void
+ch_free( void *p )
+{
+	free( p );
+}
+
+/* The original intersection of two lists, or a list and a range */
+static void
+ref_intersection( ID *a, ID *b )
+{
+	ID ida, idb, idmin, idmax, cursora, cursorb, cursorc = 0;
+
+	idmin = IDL_MAX( MDB_IDL_FIRST(a), MDB_IDL_FIRST(b) );
+	idmax = IDL_MIN( MDB_IDL_LAST(a), MDB_IDL_LAST(b) );
+	if ( idmin > idmax ) {
+		a[0] = 0;
+		return;
+	}
+	cursora = cursorb = idmin;
+	ida = mdb_idl_first( a, &cursora );
+	idb = mdb_idl_first( b, &cursorb );
+	while( ida <= idmax || idb <= idmax ) {
+		if( ida == idb ) {
+			a[++cursorc] = ida;
+			ida = mdb_idl_next( a, &cursora );
+			idb = mdb_idl_next( b, &cursorb );
+		} else if ( ida < idb ) {
+			ida = mdb_idl_next( a, &cursora );
+		} else {
+			idb = mdb_idl_next( b, &cursorb );
+		}
+	}
+	a[0] = cursorc;
+}
+
+/* The original union of two lists, without the range fallback */
+static void
+ref_union( ID *a, ID *b )
+{
+	ID ida, idb, cursora = 0, cursorb = 0, cursorc = b[0];
+
+	ida = mdb_idl_first( a, &cursora );
+	idb = mdb_idl_first( b, &cursorb );
+	while( ida != NOID || idb != NOID ) {
+		if ( ida < idb ) {
+			b[++cursorc] = ida;
+			ida = mdb_idl_next( a, &cursora );
+		} else {
+			if ( ida == idb )
+				ida = mdb_idl_next( a, &cursora );
+			idb = mdb_idl_next( b, &cursorb );
+		}
+	}
+	a[0] = cursorc;
+	cursora = 1;
+	cursorb = 1;
+	cursorc = b[0]+1;
+	while (cursorb <= b[0] || cursorc <= a[0]) {
+		if (cursorc > a[0])
+			idb = NOID;
+		else
+			idb = b[cursorc];
+		if (cursorb <= b[0] && b[cursorb] < idb)
+			a[cursora++] = b[cursorb++];
+		else {
+			a[cursora++] = idb;
+			cursorc++;
+		}
+	}
+}
+
+/* Fill ids with n sorted IDs drawn from [1, span] */
+static void
+mklist( ID *ids, ID n, ID span )
+{
+	ID i, id = 0, step = span / n;
+
+	for ( i = 1; i <= n; i++ ) {
+		id += 1 + ( step > 1 ? (ID)rand() % ( 2 * step - 1 ) : 0 );
+		ids[i] = id;
+	}
+	ids[0] = n;
+}
+
+typedef struct shape {
+	const char *name;
+	ID na, spana;
+	ID nb, spanb;	/* nb == 0: b is the range [1, spanb] */
+	int op;			/* 0 intersection, 1 union */
+} shape;
+
+static shape shapes[] = {
+	{ "and: equal dense lists", 30000, 60000, 30000, 60000, 0 },
+	{ "and: equal sparse lists", 20000, 2000000, 20000, 2000000, 0 },
+	{ "and: short vs long list", 200, 2000000, 60000, 2000000, 0 },
+	{ "and: long vs short list", 60000, 2000000, 200, 2000000, 0 },
+	{ "and: list vs range", 60000, 2000000, 0, 1000000, 0 },
+	{ "or: equal lists", 30000, 2000000, 30000, 2000000, 1 },
+	{ "or: long vs short list", 60000, 2000000, 200, 2000000, 1 },
+	{ NULL }
+};
+
+static double
+elapsed( struct timeval *start )
+{
+	struct timeval now;
+
+	gettimeofday( &now, NULL );
+	return ( now.tv_sec - start->tv_sec ) +
+		( now.tv_usec - start->tv_usec ) / 1e6;
+}
+
+int
+main( int argc, char **argv )
+{
+	ID *a, *b, *wa, *wb, *ra, *rb;
+	int n, loops = argc > 1 ? atoi( argv[1] ) : 200;
+	struct timeval tv;
+	double tref, tnew;
+	shape *s;
+	int rc = EXIT_SUCCESS;
+
+	mdb_idl_reset();
+	a = ch_malloc( MDB_idl_um_size * sizeof(ID) );
+	b = ch_malloc( MDB_idl_um_size * sizeof(ID) );
+	wa = ch_malloc( MDB_idl_um_size * sizeof(ID) );
+	wb = ch_malloc( MDB_idl_um_size * sizeof(ID) );
+	ra = ch_malloc( MDB_idl_um_size * sizeof(ID) );
+	rb = ch_malloc( MDB_idl_um_size * sizeof(ID) );
+
+	printf( "%-26s %12s %12s %8s\n", "shape", "old (us)", "new (us)", "speedup" );
+	for ( s = shapes; s->name; s++ ) {
+		srand( 1 );
+		mklist( a, s->na, s->spana );
+		if ( s->nb )
+			mklist( b, s->nb, s->spanb );
+		else
+			MDB_IDL_RANGE( b, 1, s->spanb );
+
+		gettimeofday( &tv, NULL );
+		for ( n = 0; n < loops; n++ ) {
+			MDB_IDL_CPY( ra, a );
+			MDB_IDL_CPY( rb, b );
+			if ( s->op )
+				ref_union( ra, rb );
+			else
+				ref_intersection( ra, rb );
+		}
+		tref = elapsed( &tv );
+
+		gettimeofday( &tv, NULL );
+		for ( n = 0; n < loops; n++ ) {
+			MDB_IDL_CPY( wa, a );
+			MDB_IDL_CPY( wb, b );
+			if ( s->op )
+				mdb_idl_union( wa, wb );
+			else
+				mdb_idl_intersection( wa, wb );
+		}
+		tnew = elapsed( &tv );
+
+		if ( wa[0] != ra[0] ||
+			memcmp( wa+1, ra+1, ra[0] * sizeof(ID) )) {
+			printf( "%-26s MISMATCH: %lu vs %lu IDs\n", s->name,
+				(unsigned long) wa[0], (unsigned long) ra[0] );
+			rc = EXIT_FAILURE;
+			continue;
+		}
+		printf( "%-26s %12.1f %12.1f %7.2fx\n", s->name,
+			tref * 1e6 / loops, tnew * 1e6 / loops, tref / tnew );
+	}
+
+	ch_free( a );
+	ch_free( b );
+	ch_free( wa );
+	ch_free( wb );
+	ch_free( ra );
+	ch_free( rb );
+	return rc;
+}
@@ -161,6 +161,71 @@ done:
 	return LDAP_SUCCESS;
 }
 
+/* The keys of a sort index are the normalized values themselves,
+ * truncated to the maximum key size, so they sort like the values
+ * do under octetStringOrderingMatch. The prefix keeps empty values
+ * from making empty keys.
+ */
+static int sort_indexer(
+	Operation *op,
+	MDB_txn *txn,
+	AttrInfo *ai,
+	BerVarray vals,
+	ID id,
+	int opid )
+{
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	MDB_cursor *mc = ai->ai_cursor;
+	mdb_idl_keyfunc *keyfunc;
+	struct berval *keys;
+	ber_len_t maxlen;
+	int i, n, rc;
+
+	if ( !mc ) {
+		rc = mdb_cursor_open( txn, ai->ai_dbi, &mc );
+		if ( rc ) return rc;
+		if ( slapMode & SLAP_TOOL_QUICK )
+			ai->ai_cursor = mc;
+	}
+
+	if ( opid == SLAP_INDEX_ADD_OP ) {
+#ifdef MDB_TOOL_IDL_CACHING
+		if (( slapMode & SLAP_TOOL_QUICK ) && slap_tool_thread_max > 2 ) {
+			AttrIxInfo *ax = (AttrIxInfo *)LDAP_SLIST_FIRST(&op->o_extra);
+			ax->ai_ai = ai;
+			keyfunc = mdb_tool_idl_add;
+			mc = (MDB_cursor *)ax;
+		} else
+#endif
+		if ( mdb_tool_runs )
+			keyfunc = mdb_tool_run_add;
+		else
+			keyfunc = mdb_idl_insert_keys;
+	} else
+		keyfunc = mdb_idl_delete_keys;
+
+	maxlen = mdb_env_get_maxkeysize( mdb->mi_dbenv );
+	for ( n = 0; !BER_BVISNULL( &vals[n] ); n++ ) ;
+	keys = op->o_tmpalloc( ( n + 1 ) * sizeof(struct berval), op->o_tmpmemctx );
+	for ( i = 0; i < n; i++ ) {
+		keys[i].bv_len = vals[i].bv_len + 1;
+		if ( keys[i].bv_len > maxlen )
+			keys[i].bv_len = maxlen;
+		keys[i].bv_val = op->o_tmpalloc( keys[i].bv_len + 1, op->o_tmpmemctx );
+		keys[i].bv_val[0] = SLAP_INDEX_SORT_PREFIX;
+		AC_MEMCPY( keys[i].bv_val + 1, vals[i].bv_val, keys[i].bv_len - 1 );
+		keys[i].bv_val[keys[i].bv_len] = '\0';
+	}
+	BER_BVZERO( &keys[n] );
+
+	rc = keyfunc( op->o_bd, mc, keys, id );
+	ber_bvarray_free_x( keys, op->o_tmpmemctx );
+
+	if ( !(slapMode & SLAP_TOOL_QUICK))
+		mdb_cursor_close( mc );
+	return rc;
+}
+
 static int indexer(
 	Operation *op,
 	MDB_txn *txn,
@@ -197,6 +262,9 @@ static int indexer(
 			mc = (MDB_cursor *)ax;
 		} else
 #endif
+		if ( mdb_tool_runs )
+			keyfunc = mdb_tool_run_add;
+		else
 			keyfunc = mdb_idl_insert_keys;
 	} else
 		keyfunc = mdb_idl_delete_keys;
@@ -268,6 +336,14 @@ static int indexer(
 		rc = LDAP_SUCCESS;
 	}
 
+	if( IS_SLAP_INDEX( mask, SLAP_INDEX_SORT ) && ai->ai_sort ) {
+		rc = sort_indexer( op, txn, ai->ai_sort, vals, id, opid );
+		if( rc ) {
+			err = "sort";
+			goto done;
+		}
+	}
+
 done:
 	if ( !(slapMode & SLAP_TOOL_QUICK))
 		mdb_cursor_close( mc );
@@ -296,8 +372,11 @@ static int index_at_values(
 	slap_mask_t mask = 0;
 	int ixop = opid;
 	AttrInfo *ai = NULL;
+	/* ad is only set for the values' own type; sort indexes
+	 * take no values of subtypes */
+	AttributeDescription *vad = ad;
 
-	if ( opid == MDB_INDEX_UPDATE_OP )
+	if ( opid == MDB_INDEX_UPDATE_OP || opid == MDB_INDEX_DEFER_OP )
 		ixop = SLAP_INDEX_ADD_OP;
 
 	if( type->sat_sup ) {
@@ -330,11 +409,18 @@ static int index_at_values(
 			 */
 			if ( opid == MDB_INDEX_UPDATE_OP )
 				mask = ai->ai_newmask & ~ai->ai_indexmask;
+			else if ( opid == MDB_INDEX_DEFER_OP )
+			/* Adds in a bulk load leave the indices being built to
+			 * the online indexer.
+			 */
+				mask = ai->ai_indexmask;
 			else
 			/* For regular updates, if there is a newmask use it. Otherwise
 			 * just use the old mask.
 			 */
 				mask = ai->ai_newmask ? ai->ai_newmask : ai->ai_indexmask;
+			if ( vad != ad )
+				mask &= ~SLAP_INDEX_SORT;
 			if( mask ) {
 				rc = indexer( op, txn, ai, ad, &type->sat_cname,
 					vals, id, ixop, mask );
@@ -354,8 +440,12 @@ static int index_at_values(
 			if( ai && ( ai->ai_indexmask || ai->ai_newmask )) {
 				if ( opid == MDB_INDEX_UPDATE_OP )
 					mask = ai->ai_newmask & ~ai->ai_indexmask;
+				else if ( opid == MDB_INDEX_DEFER_OP )
+					mask = ai->ai_indexmask;
 				else
 					mask = ai->ai_newmask ? ai->ai_newmask : ai->ai_indexmask;
+				if ( !vad )
+					mask &= ~SLAP_INDEX_SORT;
 				if ( mask ) {
 					rc = indexer( op, txn, ai, desc, &desc->ad_cname,
 						vals, id, ixop, mask );
@@ -459,11 +549,14 @@ int mdb_index_recrun(
 		ir = ir0 + i;
 		if ( !ir->ir_ai ) continue;
 		while (( al = ir->ir_attrs )) {
+			slap_mask_t mask = ir->ir_ai->ai_indexmask;
 			ir->ir_attrs = al->next;
-			rc = indexer( op, txn, ir->ir_ai, ir->ir_ai->ai_desc,
+			if ( al->attr->a_desc != ir->ir_ai->ai_desc )
+				mask &= ~SLAP_INDEX_SORT;
+			rc = mask ? indexer( op, txn, ir->ir_ai, ir->ir_ai->ai_desc,
 				&ir->ir_ai->ai_desc->ad_type->sat_cname,
 				al->attr->a_nvals, id, SLAP_INDEX_ADD_OP,
-				ir->ir_ai->ai_indexmask );
+				mask ) : 0;
 			free( al );
 			if ( rc ) break;
 		}
@@ -65,6 +65,12 @@ mdb_db_init( BackendDB *be, ConfigReply *cr )
 	mdb->mi_rtxn_size = DEFAULT_RTXN_SIZE;
 	mdb->mi_multi_hi = UINT_MAX;
 	mdb->mi_multi_lo = UINT_MAX;
+	mdb->mi_plan_threshold = DEFAULT_PLAN_THRESHOLD;
+	mdb->mi_index_chunk = DEFAULT_INDEX_CHUNK;
+	ldap_pvt_thread_mutex_init( &mdb->mi_gc_mutex );
+	ldap_pvt_thread_cond_init( &mdb->mi_gc_cond );
+	ldap_pvt_thread_mutex_init( &mdb->mi_dict_mutex );
+	mdb_ecache_init( mdb );
 
 	be->be_private = mdb;
 	be->be_cf_ocs = be->bd_info->bi_cf_ocs+1;
@@ -84,7 +90,7 @@ mdb_db_close( BackendDB *be, ConfigReply *cr );
 static int
 mdb_db_open( BackendDB *be, ConfigReply *cr )
 {
-	int rc, i;
+	int rc, i, building = 0;
 	struct mdb_info *mdb = (struct mdb_info *) be->be_private;
 	struct stat stat1;
 	unsigned flags;
@@ -272,6 +278,12 @@ mdb_db_open( BackendDB *be, ConfigReply *cr )
 		goto fail;
 	}
 
+	rc = mdb_dict_read( mdb, txn );
+	if ( rc ) {
+		mdb_txn_abort( txn );
+		goto fail;
+	}
+
 	/* slapcat doesn't need indexes. avoid a failure if
 	 * a configured index wasn't created yet.
 	 */
@@ -283,6 +295,10 @@ mdb_db_open( BackendDB *be, ConfigReply *cr )
 		}
 	}
 
+	/* resume building the indices that were not finished */
+	if ( slapMode & SLAP_SERVER_MODE )
+		building = mdb_ixstate_get( mdb, txn );
+
 	rc = mdb_txn_commit(txn);
 	if ( rc != 0 ) {
 		Debug( LDAP_DEBUG_ANY,
@@ -298,8 +314,14 @@ mdb_db_open( BackendDB *be, ConfigReply *cr )
 		goto fail;
 	}
 
+	if ( slapMode & SLAP_SERVER_MODE )
+		mdb_ecache_resize( mdb, mdb->mi_ecache_size );
+
 	mdb->mi_flags |= MDB_IS_OPEN;
 
+	if ( building )
+		mdb_online_index_start( be );
+
 	return 0;
 
 fail:
@@ -318,6 +340,9 @@ mdb_db_close( BackendDB *be, ConfigReply *cr )
 
 	mdb->mi_flags &= ~MDB_IS_OPEN;
 
+	mdb_ecache_resize( mdb, 0 );
+	mdb_dict_free( mdb );
+
 	if( mdb->mi_dbenv ) {
 		mdb_reader_flush( mdb->mi_dbenv );
 	}
@@ -373,6 +398,10 @@ mdb_db_destroy( BackendDB *be, ConfigReply *cr )
 	if( mdb->mi_dbenv_home ) ch_free( mdb->mi_dbenv_home );
 
 	mdb_attr_index_destroy( mdb );
+	ldap_pvt_thread_cond_destroy( &mdb->mi_gc_cond );
+	ldap_pvt_thread_mutex_destroy( &mdb->mi_gc_mutex );
+	ldap_pvt_thread_mutex_destroy( &mdb->mi_dict_mutex );
+	mdb_ecache_destroy( mdb );
 
 	ch_free( mdb );
 	be->be_private = NULL;
@@ -56,7 +56,8 @@ mdb_modify_idxflags(
 			 *
 			 * In 2.5 use refcounts and avoid all of this mess.
 			 */
-			if (!slap_hash64(-1) || (ai->ai_indexmask & SLAP_INDEX_SUBSTR)) {
+			if (!slap_hash64(-1) ||
+				(( ai->ai_indexmask | ai->ai_newmask ) & SLAP_INDEX_SUBSTR)) {
 				/* Find all other attrs that index to same slot */
 				for ( ap = newattrs; ap; ap = ap->a_next ) {
 					ai = mdb_index_mask( op->o_bd, ap->a_desc, &ix2 );
@@ -595,6 +596,7 @@ mdb_modify( Operation *op, SlapReply *rs )
 	ctrls[num_ctrls] = NULL;
 
 	/* begin transaction */
+	opinfo.moi_flag = MOI_GROUP;
 	rs->sr_err = mdb_opinfo_get( op, mdb, 0, &moi );
 	rs->sr_text = NULL;
 	if( rs->sr_err != 0 ) {
@@ -760,13 +762,14 @@ mdb_modify( Operation *op, SlapReply *rs )
 		opinfo.moi_oe.oe_key = NULL;
 		if( op->o_noop ) {
 			mdb->mi_numads = numads;
-			mdb_txn_abort( txn );
+			mdb_opinfo_abort( mdb, &opinfo );
 			rs->sr_err = LDAP_X_NO_OPERATION;
 			txn = NULL;
 			goto return_results;
 		} else {
-			rs->sr_err = mdb_txn_commit( txn );
-			if ( rs->sr_err )
+			rs->sr_err = mdb_opinfo_commit( mdb, &opinfo );
+			/* a failed group has reset it already */
+			if ( rs->sr_err && !( opinfo.moi_flag & MOI_GROUP ))
 				mdb->mi_numads = numads;
 			txn = NULL;
 		}
@@ -811,7 +814,7 @@ done:
 	if( moi == &opinfo ) {
 		if( txn != NULL ) {
 			mdb->mi_numads = numads;
-			mdb_txn_abort( txn );
+			mdb_opinfo_abort( mdb, &opinfo );
 		}
 		if ( opinfo.moi_oe.oe_key ) {
 			LDAP_SLIST_REMOVE( &op->o_extra, &opinfo.moi_oe, OpExtra, oe_next );
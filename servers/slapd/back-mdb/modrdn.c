@@ -65,6 +65,7 @@ mdb_modrdn( Operation	*op, SlapReply *rs )
 	ctrls[num_ctrls] = NULL;
 
 	/* begin transaction */
+	opinfo.moi_flag = MOI_GROUP;
 	rs->sr_err = mdb_opinfo_get( op, mdb, 0, &moi );
 	rs->sr_text = NULL;
 	if( rs->sr_err != 0 ) {
@@ -533,13 +534,13 @@ mdb_modrdn( Operation	*op, SlapReply *rs )
 		LDAP_SLIST_REMOVE( &op->o_extra, &opinfo.moi_oe, OpExtra, oe_next );
 		opinfo.moi_oe.oe_key = NULL;
 		if( op->o_noop ) {
-			mdb_txn_abort( txn );
+			mdb_opinfo_abort( mdb, &opinfo );
 			rs->sr_err = LDAP_X_NO_OPERATION;
 			txn = NULL;
 			goto return_results;
 
 		} else {
-			if(( rs->sr_err=mdb_txn_commit( txn )) != 0 ) {
+			if(( rs->sr_err=mdb_opinfo_commit( mdb, &opinfo )) != 0 ) {
 				rs->sr_text = "txn_commit failed";
 			} else {
 				rs->sr_err = LDAP_SUCCESS;
@@ -606,7 +607,7 @@ done:
 
 	if( moi == &opinfo ) {
 		if( txn != NULL ) {
-			mdb_txn_abort( txn );
+			mdb_opinfo_abort( mdb, &opinfo );
 		}
 		if ( opinfo.moi_oe.oe_key ) {
 			LDAP_SLIST_REMOVE( &op->o_extra, &opinfo.moi_oe, OpExtra, oe_next );
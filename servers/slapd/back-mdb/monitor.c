@@ -50,6 +50,12 @@ static AttributeDescription *ad_olmMDBReadersMax,
 
 static AttributeDescription *ad_olmMDBEntries;
 
+static AttributeDescription *ad_olmMDBPlannerFilters,
+	*ad_olmMDBPlannerReorders, *ad_olmMDBPlannerSkipped;
+
+static AttributeDescription *ad_olmMDBEntryCacheHits,
+	*ad_olmMDBEntryCacheMisses;
+
 /*
  * NOTE: there's some confusion in monitor OID arc;
  * by now, let's consider:
@@ -143,6 +149,46 @@ static struct {
 		"NO-USER-MODIFICATION "
 		"USAGE dSAOperation )",
 		&ad_olmMDBEntries },
+
+	{ "( olmMDBAttributes:7 "
+		"NAME ( 'olmMDBPlannerFilters' ) "
+		"DESC 'Number of AND filters planned by cost' "
+		"SUP monitorCounter "
+		"NO-USER-MODIFICATION "
+		"USAGE dSAOperation )",
+		&ad_olmMDBPlannerFilters },
+
+	{ "( olmMDBAttributes:8 "
+		"NAME ( 'olmMDBPlannerReorders' ) "
+		"DESC 'Number of AND filters evaluated out of order' "
+		"SUP monitorCounter "
+		"NO-USER-MODIFICATION "
+		"USAGE dSAOperation )",
+		&ad_olmMDBPlannerReorders },
+
+	{ "( olmMDBAttributes:9 "
+		"NAME ( 'olmMDBPlannerSkipped' ) "
+		"DESC 'Number of AND terms whose index was not read' "
+		"SUP monitorCounter "
+		"NO-USER-MODIFICATION "
+		"USAGE dSAOperation )",
+		&ad_olmMDBPlannerSkipped },
+
+	{ "( olmMDBAttributes:10 "
+		"NAME ( 'olmMDBEntryCacheHits' ) "
+		"DESC 'Number of entries found in the entry cache' "
+		"SUP monitorCounter "
+		"NO-USER-MODIFICATION "
+		"USAGE dSAOperation )",
+		&ad_olmMDBEntryCacheHits },
+
+	{ "( olmMDBAttributes:11 "
+		"NAME ( 'olmMDBEntryCacheMisses' ) "
+		"DESC 'Number of entries not found in the entry cache' "
+		"SUP monitorCounter "
+		"NO-USER-MODIFICATION "
+		"USAGE dSAOperation )",
+		&ad_olmMDBEntryCacheMisses },
 	{ NULL }
 };
 
@@ -162,6 +208,9 @@ static struct {
 #endif /* MDB_MONITOR_IDX */
 			"$ olmMDBPagesMax $ olmMDBPagesUsed $ olmMDBPagesFree "
 			"$ olmMDBReadersMax $ olmMDBReadersUsed $ olmMDBEntries "
+			"$ olmMDBPlannerFilters $ olmMDBPlannerReorders "
+			"$ olmMDBPlannerSkipped "
+			"$ olmMDBEntryCacheHits $ olmMDBEntryCacheMisses "
 			") )",
 		&oc_olmMDBDatabase },
 
@@ -216,6 +265,50 @@ mdb_monitor_update(
 	bv.bv_len = snprintf( buf, sizeof( buf ), "%u", mei.me_numreaders );
 	ber_bvreplace( &a->a_vals[ 0 ], &bv );
 
+	{
+		unsigned long ands, reorders, skipped;
+
+		ands = __atomic_load_n( &mdb->mi_plan_ands, __ATOMIC_RELAXED );
+		reorders = __atomic_load_n( &mdb->mi_plan_reorders, __ATOMIC_RELAXED );
+		skipped = __atomic_load_n( &mdb->mi_plan_skipped, __ATOMIC_RELAXED );
+
+		a = attr_find( e->e_attrs, ad_olmMDBPlannerFilters );
+		assert( a != NULL );
+		bv.bv_val = buf;
+		bv.bv_len = snprintf( buf, sizeof( buf ), "%lu", ands );
+		ber_bvreplace( &a->a_vals[ 0 ], &bv );
+
+		a = attr_find( e->e_attrs, ad_olmMDBPlannerReorders );
+		assert( a != NULL );
+		bv.bv_val = buf;
+		bv.bv_len = snprintf( buf, sizeof( buf ), "%lu", reorders );
+		ber_bvreplace( &a->a_vals[ 0 ], &bv );
+
+		a = attr_find( e->e_attrs, ad_olmMDBPlannerSkipped );
+		assert( a != NULL );
+		bv.bv_val = buf;
+		bv.bv_len = snprintf( buf, sizeof( buf ), "%lu", skipped );
+		ber_bvreplace( &a->a_vals[ 0 ], &bv );
+	}
+
+	{
+		unsigned long hits, misses;
+
+		mdb_ecache_stats( mdb, &hits, &misses );
+
+		a = attr_find( e->e_attrs, ad_olmMDBEntryCacheHits );
+		assert( a != NULL );
+		bv.bv_val = buf;
+		bv.bv_len = snprintf( buf, sizeof( buf ), "%lu", hits );
+		ber_bvreplace( &a->a_vals[ 0 ], &bv );
+
+		a = attr_find( e->e_attrs, ad_olmMDBEntryCacheMisses );
+		assert( a != NULL );
+		bv.bv_val = buf;
+		bv.bv_len = snprintf( buf, sizeof( buf ), "%lu", misses );
+		ber_bvreplace( &a->a_vals[ 0 ], &bv );
+	}
+
 	rc = mdb_txn_begin( mdb->mi_dbenv, NULL, MDB_RDONLY, &txn );
 	if ( !rc ) {
 		MDB_cursor *cursor;
@@ -436,7 +529,7 @@ mdb_monitor_db_open( BackendDB *be )
 	}
 
 	/* alloc as many as required (plus 1 for objectClass) */
-	a = attrs_alloc( 1 + 7 );
+	a = attrs_alloc( 1 + 12 );
 	if ( a == NULL ) {
 		rc = 1;
 		goto cleanup;
@@ -472,6 +565,26 @@ mdb_monitor_db_open( BackendDB *be )
 		next->a_desc = ad_olmMDBEntries;
 		attr_valadd( next, &bv, NULL, 1 );
 		next = next->a_next;
+
+		next->a_desc = ad_olmMDBPlannerFilters;
+		attr_valadd( next, &bv, NULL, 1 );
+		next = next->a_next;
+
+		next->a_desc = ad_olmMDBPlannerReorders;
+		attr_valadd( next, &bv, NULL, 1 );
+		next = next->a_next;
+
+		next->a_desc = ad_olmMDBPlannerSkipped;
+		attr_valadd( next, &bv, NULL, 1 );
+		next = next->a_next;
+
+		next->a_desc = ad_olmMDBEntryCacheHits;
+		attr_valadd( next, &bv, NULL, 1 );
+		next = next->a_next;
+
+		next->a_desc = ad_olmMDBEntryCacheMisses;
+		attr_valadd( next, &bv, NULL, 1 );
+		next = next->a_next;
 	}
 
 	{
@@ -59,11 +59,47 @@ int mdb_ad_read( struct mdb_info *mdb, MDB_txn *txn );
 int mdb_ad_get( struct mdb_info *mdb, MDB_txn *txn, AttributeDescription *ad );
 void mdb_ad_unwind( struct mdb_info *mdb, int prev_ads );
 
+int mdb_ixstate_get( struct mdb_info *mdb, MDB_txn *txn );
+int mdb_ixstate_put( struct mdb_info *mdb, MDB_txn *txn );
+
+/*
+ * cache.c
+ */
+
+void mdb_ecache_init( struct mdb_info *mdb );
+void mdb_ecache_destroy( struct mdb_info *mdb );
+void mdb_ecache_resize( struct mdb_info *mdb, unsigned nslots );
+int mdb_ecache_get( Operation *op, MDB_txn *txn, ID id, Entry **e );
+void mdb_ecache_put( Operation *op, MDB_txn *txn, Entry *e );
+void mdb_ecache_invalidate( struct mdb_info *mdb, MDB_txn *txn, ID id );
+void mdb_ecache_release( mdb_ecache_ent *ce );
+void mdb_ecache_stats( struct mdb_info *mdb, unsigned long *hits,
+	unsigned long *misses );
+
+/*
+ * compress.c
+ */
+
+int mdb_dict_read( struct mdb_info *mdb, MDB_txn *txn );
+void mdb_dict_unwind( struct mdb_info *mdb, int prev );
+void mdb_dict_free( struct mdb_info *mdb );
+size_t mdb_entry_packsize( size_t len );
+int mdb_entry_pack( struct mdb_info *mdb, MDB_val *raw, MDB_val *packed );
+int mdb_entry_unpack( struct mdb_info *mdb, MDB_txn *txn, MDB_val *data,
+	void *dst, unsigned len );
+void mdb_dict_sample_begin( struct mdb_info *mdb );
+void mdb_dict_sample( struct mdb_info *mdb, ID id, MDB_val *raw );
+int mdb_dict_sample_full( struct mdb_info *mdb );
+int mdb_dict_train( struct mdb_info *mdb, MDB_txn *txn );
+
 /*
  * config.c
  */
 
 int mdb_back_init_cf( BackendInfo *bi );
+void mdb_online_index_start( BackendDB *be );
+int mdb_online_index_defer( Operation *op, MDB_txn *txn );
+void mdb_online_index_resume( BackendDB *be );
 
 /*
  * dn2entry.c
@@ -219,6 +255,8 @@ int mdb_entry_decode( Operation *op, MDB_txn *txn, MDB_val *data, ID id, Entry *
 
 void mdb_reader_flush( MDB_env *env );
 int mdb_opinfo_get( Operation *op, struct mdb_info *mdb, int rdonly, mdb_op_info **moi );
+int mdb_opinfo_commit( struct mdb_info *mdb, mdb_op_info *moi );
+void mdb_opinfo_abort( struct mdb_info *mdb, mdb_op_info *moi );
 
 int mdb_mval_put(Operation *op, MDB_cursor *mc, ID id, Attribute *a);
 int mdb_mval_del(Operation *op, MDB_cursor *mc, ID id, Attribute *a);
@@ -238,6 +276,12 @@ int mdb_idl_fetch_key(
 	MDB_cursor	**saved_cursor,
 	int                     get_flag );
 
+int mdb_idl_count_key(
+	MDB_txn		*txn,
+	MDB_dbi		dbi,
+	MDB_val		*key,
+	ID			*count );
+
 int mdb_idl_insert( ID *ids, ID id );
 
 typedef int (mdb_idl_keyfunc)(
@@ -266,6 +310,11 @@ void mdb_idl_sort( ID *ids, ID *tmp );
 int mdb_idl_append( ID *a, ID *b );
 int mdb_idl_append_one( ID *ids, ID id );
 
+ID mdb_idl_bits_first( ID *ids );
+ID mdb_idl_bits_last( ID *ids );
+ID mdb_idl_bits_count( ID *ids );
+int mdb_idl_tobits( ID *ids );
+
 
 /*
  * index.c
@@ -333,6 +382,14 @@ mdb_key_read(
     MDB_cursor **saved_cursor,
         int get_flags );
 
+extern int
+mdb_key_count(
+    Backend	*be,
+	MDB_txn *txn,
+	MDB_dbi dbi,
+    struct berval *k,
+	ID *count );
+
 /*
  * nextid.c
  */
@@ -405,6 +462,8 @@ extern BI_tool_entry_modify		mdb_tool_entry_modify;
 extern BI_tool_entry_delete		mdb_tool_entry_delete;
 
 extern mdb_idl_keyfunc mdb_tool_idl_add;
+extern mdb_idl_keyfunc mdb_tool_run_add;
+extern int mdb_tool_runs;
 
 LDAP_END_DECL
 
@@ -416,6 +416,710 @@ mdb_waitfixup( Operation *op, ww_ctx *ww, MDB_cursor *mci, MDB_cursor *mcd, IdSc
 	return rc;
 }
 
+/* Parallel candidate evaluation. The ID range of a large candidate
+ * list is cut into chunks of MDB_PS_SPAN IDs. Pool threads claim the
+ * chunks in order and test their candidates against the filter in
+ * their own read txn, leaving a bit set for each ID worth a second
+ * look. The search thread still walks the candidates in ID order,
+ * skipping the IDs a worker cleared, and fetches, checks and sends
+ * the rest itself as usual. A chunk nobody has claimed by the time the search thread
+ * gets there is handled inline, so a busy pool only costs parallelism.
+ * The workers must see the snapshot of the search thread, and LMDB
+ * can only give them the latest one. A worker that comes too late
+ * tells the search thread, which then moves to a newer snapshot soon,
+ * if rtxnsize allows it to, and shares the chunks still ahead anew.
+ */
+#define MDB_PS_SPAN	1024
+#define MDB_PS_MIN	(4*MDB_PS_SPAN)	/* fewer candidates aren't split */
+#define MDB_PS_SLOTS	4	/* chunks in flight per worker */
+
+typedef struct mdb_pschunk {
+	ID pc_num;
+	int pc_state;
+#define PC_BUSY	1	/* a worker is testing it */
+#define PC_DONE	2	/* pc_bits are valid */
+#define PC_MAIN	3	/* the search thread does it all */
+	unsigned char pc_bits[MDB_PS_SPAN/8];
+} mdb_pschunk;
+
+struct mdb_psearch;
+
+typedef struct mdb_psworker {
+	struct mdb_psearch *pw_ps;
+	void *pw_cookie;
+	int pw_state;
+#define PW_QUEUED	1
+#define PW_RUNNING	2
+} mdb_psworker;
+
+typedef struct mdb_psearch {
+	ldap_pvt_thread_mutex_t ps_mutex;
+	ldap_pvt_thread_cond_t ps_cond;
+	Operation *ps_op;
+	BackendDB ps_db;	/* o_bd as it was when we started */
+	ID *ps_cands;
+	ID ps_first;	/* first ID of chunk 0 */
+	ID ps_nchunks;
+	ID ps_next;		/* next chunk to hand out */
+	ID ps_base;		/* chunk the search thread is in */
+	size_t ps_txnid;
+	int ps_settled;	/* ps_base is PC_DONE or PC_MAIN */
+	int ps_stale;	/* a worker found a newer snapshot */
+	int ps_stop;
+	int ps_nslots;
+	int ps_nworkers;
+	int ps_pending;	/* submitted workers that haven't exited */
+	mdb_psworker *ps_workers;
+	mdb_pschunk *ps_chunks;
+} mdb_psearch;
+
+/* Test the candidates of one chunk */
+static void
+mdb_psearch_chunk(
+	Operation *op,
+	mdb_psearch *ps,
+	MDB_txn *txn,
+	MDB_cursor *mci,
+	MDB_cursor **mcd,
+	mdb_pschunk *pc )
+{
+	ID lo = ps->ps_first + pc->pc_num * MDB_PS_SPAN;
+	ID id, cursor = lo;
+	MDB_val edata;
+	Entry *e;
+	int keep, manageDSAit = get_manageDSAit( op );
+
+	memset( pc->pc_bits, 0, sizeof( pc->pc_bits ));
+	for ( id = mdb_idl_first( ps->ps_cands, &cursor );
+		id != NOID && id - lo < MDB_PS_SPAN;
+		id = mdb_idl_next( ps->ps_cands, &cursor ))
+	{
+		if ( ps->ps_stop )
+			break;
+		if ( mdb_id2edata( op, mci, id, &edata ) == MDB_NOTFOUND )
+			continue;
+		/* anything we can't decide is left to the search thread */
+		keep = 1;
+		if ( !mdb_entry_decode( op, txn, &edata, id, &e )) {
+			e->e_id = id;
+			BER_BVZERO( &e->e_name );
+			BER_BVZERO( &e->e_nname );
+			/* ACLs and DN-valued filters need the entry's name */
+			if ( !mdb_id2name( op, txn, mcd, id, &e->e_name, &e->e_nname ) &&
+				( manageDSAit || !is_entry_referral( e )) &&
+				test_filter( op, e, op->ors_filter ) != LDAP_COMPARE_TRUE )
+				keep = 0;
+			mdb_entry_return( op, e );
+		}
+		if ( keep )
+			pc->pc_bits[(id - lo) >> 3] |= 1 << ((id - lo) & 7);
+	}
+}
+
+static void *
+mdb_psearch_task( void *ctx, void *arg )
+{
+	mdb_psworker *pw = arg;
+	mdb_psearch *ps = pw->pw_ps;
+	struct mdb_info *mdb = (struct mdb_info *) ps->ps_db.be_private;
+	Operation op2 = *ps->ps_op;
+	Opheader ohdr = *ps->ps_op->o_hdr;
+	BackendDB db = ps->ps_db;
+	mdb_op_info *moi = NULL;
+	MDB_cursor *mci = NULL, *mcd = NULL;
+	mdb_pschunk *pc;
+	int rc;
+
+	ldap_pvt_thread_mutex_lock( &ps->ps_mutex );
+	pw->pw_state = PW_RUNNING;
+	if ( ps->ps_stop )
+		goto leave;
+	ldap_pvt_thread_mutex_unlock( &ps->ps_mutex );
+
+	/* overlays point o_bd at copies of their own while the search
+	 * thread runs, and write to them */
+	op2.o_bd = &db;
+	op2.o_hdr = &ohdr;
+	op2.o_threadctx = ctx;
+	op2.o_tmpmemctx = slap_sl_mem_create( SLAP_SLAB_SIZE, SLAP_SLAB_STACK,
+		ctx, 1 );
+	LDAP_SLIST_INIT( &op2.o_extra );
+
+	rc = mdb_opinfo_get( &op2, mdb, 1, &moi );
+	if ( !rc )
+		rc = mdb_cursor_open( moi->moi_txn, mdb->mi_id2entry, &mci );
+	if ( !rc && mdb_txn_id( moi->moi_txn ) != ps->ps_txnid ) {
+		__atomic_store_n( &ps->ps_stale, 1, __ATOMIC_RELAXED );
+		rc = MDB_BAD_TXN;
+	}
+
+	ldap_pvt_thread_mutex_lock( &ps->ps_mutex );
+	while ( !rc && !ps->ps_stop && ps->ps_next < ps->ps_nchunks ) {
+		pc = &ps->ps_chunks[ps->ps_next % ps->ps_nslots];
+		/* the search thread may have skipped ahead of a chunk
+		 * that is still being tested in this slot */
+		if ( ps->ps_next >= ps->ps_base + ps->ps_nslots ||
+			pc->pc_state == PC_BUSY )
+		{
+			ldap_pvt_thread_cond_wait( &ps->ps_cond, &ps->ps_mutex );
+			continue;
+		}
+		pc->pc_num = ps->ps_next++;
+		pc->pc_state = PC_BUSY;
+		ldap_pvt_thread_mutex_unlock( &ps->ps_mutex );
+
+		mdb_psearch_chunk( &op2, ps, moi->moi_txn, mci, &mcd, pc );
+
+		ldap_pvt_thread_mutex_lock( &ps->ps_mutex );
+		pc->pc_state = PC_DONE;
+		ldap_pvt_thread_cond_broadcast( &ps->ps_cond );
+	}
+	ldap_pvt_thread_mutex_unlock( &ps->ps_mutex );
+
+	if ( mcd )
+		mdb_cursor_close( mcd );
+	if ( mci )
+		mdb_cursor_close( mci );
+	if ( moi ) {
+		if ( moi->moi_txn )
+			mdb_txn_reset( moi->moi_txn );
+		LDAP_SLIST_REMOVE( &op2.o_extra, &moi->moi_oe, OpExtra, oe_next );
+		op2.o_tmpfree( moi, op2.o_tmpmemctx );
+	}
+
+	ldap_pvt_thread_mutex_lock( &ps->ps_mutex );
+leave:
+	ps->ps_pending--;
+	ldap_pvt_thread_cond_broadcast( &ps->ps_cond );
+	ldap_pvt_thread_mutex_unlock( &ps->ps_mutex );
+	return NULL;
+}
+
+static mdb_psearch *
+mdb_psearch_start( Operation *op, ID *ids, ID first, MDB_txn *txn )
+{
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	mdb_psearch *ps;
+	int i, nworkers = mdb->mi_search_threads - 1;
+	int nslots = nworkers * MDB_PS_SLOTS;
+
+	ps = ch_calloc( 1, sizeof( mdb_psearch ) +
+		nworkers * sizeof( mdb_psworker ) + nslots * sizeof( mdb_pschunk ));
+	ps->ps_workers = (mdb_psworker *)(ps+1);
+	ps->ps_chunks = (mdb_pschunk *)(ps->ps_workers + nworkers);
+	ps->ps_op = op;
+	ps->ps_db = *op->o_bd;
+	ps->ps_cands = ids;
+	ps->ps_first = first;
+	ps->ps_nchunks = ( MDB_IDL_LAST( ids ) - first ) / MDB_PS_SPAN + 1;
+	ps->ps_txnid = mdb_txn_id( txn );
+	ps->ps_nslots = nslots;
+	ps->ps_nworkers = nworkers;
+	ldap_pvt_thread_mutex_init( &ps->ps_mutex );
+	ldap_pvt_thread_cond_init( &ps->ps_cond );
+
+	ldap_pvt_thread_mutex_lock( &ps->ps_mutex );
+	for ( i = 0; i < nworkers; i++ ) {
+		mdb_psworker *pw = &ps->ps_workers[i];
+		pw->pw_ps = ps;
+		if ( ldap_pvt_thread_pool_submit2( &connection_pool,
+			mdb_psearch_task, pw, &pw->pw_cookie ))
+			break;
+		pw->pw_state = PW_QUEUED;
+		ps->ps_pending++;
+	}
+	ldap_pvt_thread_mutex_unlock( &ps->ps_mutex );
+
+	Debug( LDAP_DEBUG_TRACE, LDAP_XSTRING(mdb_search)
+		": %lu chunks shared with %d workers\n",
+		(unsigned long) ps->ps_nchunks, i );
+	return ps;
+}
+
+/* Is this candidate worth fetching? */
+static int
+mdb_psearch_check( mdb_psearch *ps, ID id )
+{
+	ID num = ( id - ps->ps_first ) / MDB_PS_SPAN;
+	mdb_pschunk *pc = &ps->ps_chunks[num % ps->ps_nslots];
+
+	if ( num != ps->ps_base || !ps->ps_settled ) {
+		ldap_pvt_thread_mutex_lock( &ps->ps_mutex );
+		if ( num != ps->ps_base ) {
+			/* frees the slots of the chunks we're done with */
+			ps->ps_base = num;
+			ldap_pvt_thread_cond_broadcast( &ps->ps_cond );
+		}
+		for (;;) {
+			if ( pc->pc_state != PC_BUSY ) {
+				if ( num >= ps->ps_next ) {
+					/* nobody got to it yet, do it ourselves */
+					ps->ps_next = num + 1;
+					pc->pc_num = num;
+					pc->pc_state = PC_MAIN;
+					break;
+				}
+				if ( pc->pc_num == num )
+					break;
+			}
+			/* a worker is on this chunk, or on a chunk we skipped
+			 * that used the same slot */
+			ldap_pvt_thread_cond_wait( &ps->ps_cond, &ps->ps_mutex );
+		}
+		ps->ps_settled = 1;
+		ldap_pvt_thread_mutex_unlock( &ps->ps_mutex );
+	}
+	if ( pc->pc_state == PC_MAIN )
+		return 1;
+	id -= ps->ps_first + num * MDB_PS_SPAN;
+	return pc->pc_bits[id >> 3] & ( 1 << ( id & 7 ));
+}
+
+static void
+mdb_psearch_end( mdb_psearch *ps )
+{
+	int i;
+
+	ldap_pvt_thread_mutex_lock( &ps->ps_mutex );
+	ps->ps_stop = 1;
+	ldap_pvt_thread_cond_broadcast( &ps->ps_cond );
+	/* Workers that haven't started won't touch ps once retracted.
+	 * One that was dequeued but hasn't marked itself running is
+	 * blocked on ps_mutex and will exit as soon as we wait.
+	 */
+	for ( i = 0; i < ps->ps_nworkers; i++ ) {
+		mdb_psworker *pw = &ps->ps_workers[i];
+		if ( pw->pw_state == PW_QUEUED &&
+			ldap_pvt_thread_pool_retract( pw->pw_cookie ) > 0 )
+			ps->ps_pending--;
+	}
+	while ( ps->ps_pending > 0 )
+		ldap_pvt_thread_cond_wait( &ps->ps_cond, &ps->ps_mutex );
+	ldap_pvt_thread_mutex_unlock( &ps->ps_mutex );
+
+	ldap_pvt_thread_cond_destroy( &ps->ps_cond );
+	ldap_pvt_thread_mutex_destroy( &ps->ps_mutex );
+	ch_free( ps );
+}
+
+/* Server side sorting from a sort index. The sssvlv overlay asks
+ * for it with a SortedSearch in o_extra. The keys of the index are
+ * walked in order, keeping the candidates found there in the order
+ * of their least value, followed by the candidates without a value.
+ * Candidates with equal values stay in ID order, either way round.
+ * Every key is visited, so unless a VLV search can stop at its window
+ * the walk is only worth it when the candidates make up a good part
+ * of the index. Otherwise sssvlv sorts them quicker by itself.
+ */
+#define MDB_SORT_FRACTION	4	/* of the IDs in the index, at least */
+
+static SortedSearch *
+mdb_sorted_search( Operation *op, MDB_txn *txn, ID ncand )
+{
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	SortedSearch *ss = NULL;
+	MatchingRule *mr;
+	OpExtra *oex;
+	AttrInfo *ai;
+
+	LDAP_SLIST_FOREACH( oex, &op->o_extra, oe_next ) {
+		if ( oex->oe_key == (void *)slap_sorted_window ) {
+			ss = (SortedSearch *)oex;
+			break;
+		}
+	}
+	/* searches run on behalf of this one get no help */
+	if ( !ss || ss->ss_sorted )
+		return NULL;
+	if ( get_pagedresults( op ) > SLAP_CONTROL_IGNORED ||
+		SLAP_GLUE_INSTANCE( op->o_bd ) || SLAP_GLUE_SUBORDINATE( op->o_bd ))
+		return NULL;
+	if ( ss->ss_ordering->smr_match != octetStringOrderingMatch )
+		return NULL;
+	/* the index holds the values as the equality rule normalizes
+	 * them, they must be what the ordering rule compares */
+	mr = ss->ss_ad->ad_type->sat_equality;
+	if ( !mr || mr->smr_normalize != ss->ss_ordering->smr_normalize )
+		return NULL;
+	ai = mdb_attr_mask( mdb, ss->ss_ad );
+	if ( !ai || !ai->ai_sort || ai->ai_desc != ss->ss_ad ||
+		( ai->ai_indexmask & MDB_INDEX_DELETING ) ||
+		!IS_SLAP_INDEX( ai->ai_indexmask, SLAP_INDEX_SORT ))
+		return NULL;
+	if ( !ss->ss_vlv ) {
+		MDB_stat st;
+
+		/* counts the IDs under all keys */
+		if ( mdb_stat( txn, ai->ai_sort->ai_dbi, &st ) ||
+			ncand < st.ms_entries / MDB_SORT_FRACTION )
+			return NULL;
+	}
+	return ss;
+}
+
+static int
+sort_cand( ID *ids, ID id )
+{
+	if ( MDB_IDL_IS_RANGE( ids )) {
+		return id >= MDB_IDL_RANGE_FIRST( ids ) &&
+			id <= MDB_IDL_RANGE_LAST( ids );
+	} else if ( MDB_IDL_IS_BITS( ids )) {
+		ID c = id;
+		return mdb_idl_first( ids, &c ) == id;
+	} else {
+		unsigned i = mdb_idl_search( ids, id );
+		return i <= ids[0] && ids[i] == id;
+	}
+}
+
+/* Walks the candidates in the order of a sort index, one at a time,
+ * so nothing is collected up front and a VLV search can stop once it
+ * has its window. The IDs under each key come in ID order, whether or
+ * not the key is their entry's least value; mdb_sortwalk_check() skips
+ * the others once the entry is at hand. A key whose IDs were folded
+ * into a range or a bitmap yields the candidates within its bounds.
+ * The candidates without a value sort after all others, in ID order
+ * either way round, as they do in sssvlv's own tree. Keys are cut
+ * short at the largest key size, values that only differ after that
+ * stay in ID order as well.
+ */
+typedef struct mdb_sortwalk {
+	SortedSearch *sw_ss;
+	MDB_cursor *sw_mc;
+	ID *sw_ids;		/* the candidates */
+	ID sw_maxid;
+	ID sw_id;		/* the last ID returned, 0 before the first */
+	ID sw_cursor;		/* in sw_ids, for spans and the tail */
+	ID sw_hi;		/* end of the current span */
+	int sw_state;
+	int sw_lost;		/* the txn was renewed, seek sw_key again */
+	int sw_rc;
+	unsigned char *sw_seen;	/* IDs found under some key, unless VLV */
+	size_t sw_maxkey;
+	MDB_val sw_key;		/* the current key, our own copy */
+	/* a VLV search keeps its last sw_size matches */
+	ID *sw_win;
+	ID sw_size;
+	ID sw_nmatch;
+	ID sw_target;		/* position of the target, once known */
+	ID sw_first;		/* the window, once known */
+	ID sw_last;		/* stop after this many matches, if set */
+	int sw_done;
+	int sw_again;		/* looking for the window a second time */
+} mdb_sortwalk;
+
+#define SW_START	0
+#define SW_KEY	1	/* IDs under sw_key */
+#define SW_SPAN	2	/* candidates up to sw_hi */
+#define SW_TAIL	3	/* candidates without a value */
+#define SW_END	4
+
+/* Start at the beginning, with the tail if in reverse */
+static void
+mdb_sortwalk_reset( mdb_sortwalk *sw )
+{
+	sw->sw_state = sw->sw_ss->ss_reverse ? SW_TAIL : SW_START;
+	sw->sw_lost = 0;
+	sw->sw_id = 0;
+	sw->sw_cursor = 0;
+	sw->sw_nmatch = 0;
+	sw->sw_done = 0;
+}
+
+static mdb_sortwalk *
+mdb_sortwalk_open(
+	Operation *op,
+	MDB_txn *txn,
+	MDB_cursor *mci,
+	SortedSearch *ss,
+	ID *ids,
+	ID ncand )
+{
+	struct mdb_info *mdb = (struct mdb_info *) op->o_bd->be_private;
+	AttrInfo *ai = mdb_attr_mask( mdb, ss->ss_ad )->ai_sort;
+	mdb_sortwalk *sw;
+	MDB_cursor *mc;
+	MDB_val key, data;
+	ID maxid;
+
+	if ( mdb_cursor_get( mci, &key, &data, MDB_LAST ))
+		return NULL;
+	memcpy( &maxid, key.mv_data, sizeof(ID) );
+	if ( mdb_cursor_open( txn, ai->ai_dbi, &mc ))
+		return NULL;
+
+	sw = ch_calloc( 1, sizeof( mdb_sortwalk ));
+	sw->sw_ss = ss;
+	sw->sw_mc = mc;
+	sw->sw_ids = ids;
+	sw->sw_maxid = maxid;
+	sw->sw_maxkey = mdb_env_get_maxkeysize( mdb->mi_dbenv );
+	sw->sw_key.mv_data = ch_malloc( sw->sw_maxkey );
+	if ( ss->ss_vlv ) {
+		/* room for the window, unless there can't be that many */
+		sw->sw_size = (ID)ss->ss_before + ss->ss_after + 1;
+		if ( sw->sw_size > ncand )
+			sw->sw_size = ncand ? ncand : 1;
+		sw->sw_win = ch_malloc( sw->sw_size * sizeof(ID) );
+	} else if ( !ss->ss_reverse ) {
+		/* spares looking at them again in the tail */
+		sw->sw_seen = ch_calloc( 1, maxid / 8 + 1 );
+	}
+	mdb_sortwalk_reset( sw );
+	return sw;
+}
+
+static void
+mdb_sortwalk_close( mdb_sortwalk *sw )
+{
+	mdb_cursor_close( sw->sw_mc );
+	ch_free( sw->sw_key.mv_data );
+	ch_free( sw->sw_win );
+	ch_free( sw->sw_seen );
+	ch_free( sw );
+}
+
+/* The read txn was renewed under the walk */
+static void
+mdb_sortwalk_renew( mdb_sortwalk *sw, MDB_txn *txn )
+{
+	mdb_cursor_renew( txn, sw->sw_mc );
+	sw->sw_lost = 1;
+}
+
+/* Move on to the next key, or the first one */
+static int
+mdb_sortwalk_key( mdb_sortwalk *sw )
+{
+	MDB_cursor *mc = sw->sw_mc;
+	MDB_val key, data;
+	ID lo, hi;
+	int rev = sw->sw_ss->ss_reverse, last = 0, rc;
+
+	if ( sw->sw_state == SW_START ) {
+		rc = mdb_cursor_get( mc, &key, &data, rev ? MDB_LAST : MDB_FIRST );
+		last = rev;
+	} else if ( !sw->sw_lost ) {
+		rc = mdb_cursor_get( mc, &key, &data,
+			rev ? MDB_PREV_NODUP : MDB_NEXT_NODUP );
+	} else {
+		/* our key may be gone, find the one after it */
+		key = sw->sw_key;
+		rc = mdb_cursor_get( mc, &key, &data, MDB_SET_RANGE );
+		if ( rev ) {
+			if ( rc == 0 )
+				rc = mdb_cursor_get( mc, &key, &data, MDB_PREV_NODUP );
+			else if ( rc == MDB_NOTFOUND ) {
+				rc = mdb_cursor_get( mc, &key, &data, MDB_LAST );
+				last = 1;
+			}
+		} else if ( rc == 0 && key.mv_size == sw->sw_key.mv_size &&
+			!memcmp( key.mv_data, sw->sw_key.mv_data, key.mv_size )) {
+			rc = mdb_cursor_get( mc, &key, &data, MDB_NEXT_NODUP );
+		}
+	}
+	/* MDB_LAST leaves the cursor at EOF, where MDB_NEXT_DUP
+	 * finds nothing */
+	if ( rc == 0 && last )
+		rc = mdb_cursor_get( mc, &key, &data, MDB_SET );
+	/* the last dup if we came backwards */
+	if ( rc == 0 )
+		rc = mdb_cursor_get( mc, &key, &data, MDB_FIRST_DUP );
+	if ( rc )
+		return rc;
+	sw->sw_lost = 0;
+	sw->sw_key.mv_size = key.mv_size;
+	memcpy( sw->sw_key.mv_data, key.mv_data, key.mv_size );
+
+	memcpy( &lo, data.mv_data, sizeof(ID) );
+	if ( lo ) {
+		sw->sw_state = SW_KEY;
+		sw->sw_id = lo;
+		return 0;
+	}
+
+	/* A range or a bitmap, only their bounds are known */
+	rc = mdb_cursor_get( mc, &key, &data, MDB_NEXT_DUP );
+	if ( rc == 0 ) {
+		memcpy( &lo, data.mv_data, sizeof(ID) );
+		rc = mdb_cursor_get( mc, &key, &data, MDB_LAST_DUP );
+	}
+	if ( rc == 0 ) {
+		memcpy( &hi, data.mv_data, sizeof(ID) );
+		if ( hi == NOID ) {
+			rc = mdb_cursor_get( mc, &key, &data, MDB_PREV_DUP );
+			memcpy( &hi, data.mv_data, sizeof(ID) );
+			hi = MDB_IDL_WBASE( hi ) + ((ID)1 << MDB_IDL_WSHIFT) - 1;
+			lo = MDB_IDL_WBASE( lo );
+		}
+	}
+	if ( rc )
+		return rc;
+	sw->sw_state = SW_SPAN;
+	sw->sw_cursor = lo;
+	sw->sw_hi = hi;
+	sw->sw_id = 0;
+	return 0;
+}
+
+/* The next candidate in sort order, or NOID */
+static ID
+mdb_sortwalk_next( mdb_sortwalk *sw )
+{
+	MDB_val key, data;
+	ID id;
+	int rc;
+
+	if ( sw->sw_done || sw->sw_state == SW_END )
+		return NOID;
+
+	for (;;) {
+		id = NOID;
+		if ( sw->sw_state == SW_KEY ) {
+			if ( sw->sw_lost ) {
+				id = sw->sw_id + 1;
+				key = sw->sw_key;
+				data.mv_size = sizeof(ID);
+				data.mv_data = &id;
+				rc = mdb_cursor_get( sw->sw_mc, &key, &data,
+					MDB_GET_BOTH_RANGE );
+				if ( rc == 0 )
+					sw->sw_lost = 0;
+			} else {
+				rc = mdb_cursor_get( sw->sw_mc, &key, &data, MDB_NEXT_DUP );
+			}
+			if ( rc == 0 )
+				memcpy( &id, data.mv_data, sizeof(ID) );
+			else if ( rc == MDB_NOTFOUND )
+				id = NOID;
+			else
+				break;
+
+		} else if ( sw->sw_state == SW_SPAN || sw->sw_state == SW_TAIL ) {
+			if ( sw->sw_id )
+				id = mdb_idl_next( sw->sw_ids, &sw->sw_cursor );
+			else
+				id = mdb_idl_first( sw->sw_ids, &sw->sw_cursor );
+			if ( id != NOID && !sort_cand( sw->sw_ids, id ))
+				id = NOID;
+			if ( sw->sw_state == SW_TAIL ) {
+				if ( id > sw->sw_maxid ) {
+					if ( sw->sw_ss->ss_reverse ) {
+						sw->sw_state = SW_START;
+						continue;
+					}
+					sw->sw_state = SW_END;
+					return NOID;
+				}
+				sw->sw_id = id;
+				if ( sw->sw_seen && ( sw->sw_seen[id >> 3] & ( 1 << ( id & 7 ))))
+					continue;
+				return id;
+			}
+			if ( id > sw->sw_hi )
+				id = NOID;
+			else
+				sw->sw_id = id;
+		}
+
+		if ( id == NOID ) {
+			rc = mdb_sortwalk_key( sw );
+			if ( rc == MDB_NOTFOUND ) {
+				if ( sw->sw_ss->ss_reverse ) {
+					sw->sw_state = SW_END;
+					return NOID;
+				}
+				sw->sw_state = SW_TAIL;
+				sw->sw_cursor = 0;
+				sw->sw_id = 0;
+				continue;
+			} else if ( rc ) {
+				break;
+			}
+			if ( sw->sw_state == SW_SPAN )
+				continue;
+			id = sw->sw_id;
+		}
+
+		if ( sw->sw_state == SW_KEY ) {
+			sw->sw_id = id;
+			if ( id > sw->sw_maxid )
+				continue;
+			if ( sw->sw_seen )
+				sw->sw_seen[id >> 3] |= 1 << ( id & 7 );
+		}
+		if ( sort_cand( sw->sw_ids, id ))
+			return id;
+	}
+	sw->sw_rc = rc;
+	return NOID;
+}
+
+/* Compare a normalized value with the current key */
+static int
+mdb_sortwalk_cmp( mdb_sortwalk *sw, struct berval *bv )
+{
+	ber_len_t klen = sw->sw_key.mv_size - 1, len = bv->bv_len;
+	int cmp;
+
+	/* keys are cut short */
+	if ( len > sw->sw_maxkey - 1 )
+		len = sw->sw_maxkey - 1;
+	cmp = memcmp( (char *)sw->sw_key.mv_data + 1, bv->bv_val,
+		klen < len ? klen : len );
+	if ( !cmp )
+		cmp = klen < len ? -1 : klen > len;
+	return cmp;
+}
+
+/* Tell whether e belongs where the walk is: under the key of its
+ * least value, or in the tail if it has none.
+ */
+static int
+mdb_sortwalk_check( mdb_sortwalk *sw, Entry *e )
+{
+	Attribute *a = attr_find( e->e_attrs, sw->sw_ss->ss_ad );
+	struct berval *least;
+	unsigned i;
+
+	if ( sw->sw_state == SW_TAIL )
+		return a == NULL;
+	if ( a == NULL )
+		return 0;
+
+	least = a->a_nvals;
+	for ( i = 1; i < a->a_numvals; i++ ) {
+		struct berval *bv = &a->a_nvals[i];
+		int cmp = memcmp( bv->bv_val, least->bv_val,
+			bv->bv_len < least->bv_len ? bv->bv_len : least->bv_len );
+		if ( cmp < 0 || ( !cmp && bv->bv_len < least->bv_len ))
+			least = bv;
+	}
+	return !mdb_sortwalk_cmp( sw, least );
+}
+
+/* Keep a matching entry of a VLV search. Once the match that sorts
+ * first at or after ss_value is seen, it is the target.
+ */
+static void
+mdb_sortwalk_match( mdb_sortwalk *sw, ID id )
+{
+	SortedSearch *ss = sw->sw_ss;
+
+	sw->sw_win[ sw->sw_nmatch++ % sw->sw_size ] = id;
+	if ( !sw->sw_target && !BER_BVISNULL( &ss->ss_value )) {
+		/* those without a value sort after all others */
+		int cmp = sw->sw_state == SW_TAIL ? 1 :
+			mdb_sortwalk_cmp( sw, &ss->ss_value );
+		if ( ss->ss_reverse ? cmp <= 0 : cmp >= 0 ) {
+			sw->sw_target = sw->sw_nmatch;
+			sw->sw_last = sw->sw_target + ss->ss_after;
+		}
+	}
+	if ( sw->sw_last && sw->sw_nmatch >= sw->sw_last )
+		sw->sw_done = 1;
+}
+
 int
 mdb_search( Operation *op, SlapReply *rs )
 {
@@ -436,6 +1140,9 @@ mdb_search( Operation *op, SlapReply *rs )
 	MDB_cursor	*mci, *mcd;
 	ww_ctx wwctx;
 	slap_callback cb = { 0 };
+	mdb_psearch	*ps = NULL;
+	SortedSearch	*ss = NULL;
+	mdb_sortwalk	*sw = NULL;
 
 	mdb_op_info	opinfo = {{{0}}}, *moi = &opinfo;
 	MDB_txn			*ltid = NULL;
@@ -765,6 +1472,43 @@ adminlimit:
 		nsubs = ncand;	/* always bypass scope'd search */
 		goto loop_begin;
 	}
+	/* Return the candidates in the order of a sort index */
+	ss = mdb_sorted_search( op, ltid, ncand );
+	if ( ss )
+		sw = mdb_sortwalk_open( op, ltid, mci, ss, candidates, ncand );
+	if ( sw ) {
+		nsubs = ncand;
+		ss->ss_sorted = 1;
+		if ( ss->ss_vlv && BER_BVISNULL( &ss->ss_value )) {
+			int first, last;
+
+			/* The count of candidates stands in for the count of
+			 * entries, as the VLV draft allows, so the walk can
+			 * stop at the end of the window.
+			 */
+			if ( slap_sorted_window( ss, ncand, 0, &first, &last )) {
+				rs->sr_err = LDAP_VLV_ERROR;
+				send_ldap_result( op, rs );
+				rs->sr_err = LDAP_SUCCESS;
+				goto done;
+			}
+			sw->sw_target = ss->ss_target;
+			sw->sw_first = first;
+			sw->sw_last = last;
+			if ( last < first )
+				sw->sw_done = 1;
+		}
+	}
+	/* Share the filter tests of a large search with other threads.
+	 * That needs the candidates in ID order, so give up the scope
+	 * walk as long as most candidates are in scope anyway.
+	 */
+	if ( !sw && mdb->mi_search_threads > 1 && ncand >= MDB_PS_MIN &&
+		nsubs >= ncand / 2 && !( slapMode & SLAP_TOOL_MODE ))
+	{
+		nsubs = ncand;
+		ps = mdb_psearch_start( op, candidates, MDB_IDL_FIRST( candidates ), ltid );
+	}
 	if ( nsubs < ncand ) {
 		int rc;
 		/* Do scope-based search */
@@ -792,6 +1536,8 @@ adminlimit:
 		else
 			id = isc.id;
 		cscope = 0;
+	} else if ( sw ) {
+		id = mdb_sortwalk_next( sw );
 	} else {
 		id = mdb_idl_first( candidates, &cursor );
 	}
@@ -830,6 +1576,8 @@ loop_begin:
 			goto done;
 		}
 
+		/* don't let batched entries wait on a sparse search */
+		slap_batch_flush( op );
 
 		if ( nsubs < ncand ) {
 			unsigned i;
@@ -839,6 +1587,10 @@ loop_begin:
 				if ( id >= MDB_IDL_RANGE_FIRST( candidates ) &&
 					id <= MDB_IDL_RANGE_LAST( candidates ))
 					scopeok = 1;
+			} else if (MDB_IDL_IS_BITS( candidates )) {
+				ID c = id;
+				if ( mdb_idl_first( candidates, &c ) == id )
+					scopeok = 1;
 			} else {
 				i = mdb_idl_search( candidates, id );
 				if (i <= candidates[0] && candidates[i] == id )
@@ -849,6 +1601,15 @@ loop_begin:
 			goto loop_continue;
 		}
 
+		/* Already tested and dropped by a worker? */
+		if ( ps && ps->ps_txnid != mdb_txn_id( ltid )) {
+			/* our read txn was renewed, the tests so far are stale */
+			mdb_psearch_end( ps );
+			ps = mdb_psearch_start( op, candidates, id, ltid );
+		}
+		if ( ps && !mdb_psearch_check( ps, id ))
+			goto loop_continue;
+
 		/* Does this candidate actually satisfy the search scope?
 		 */
 		scopeok = 0;
@@ -904,7 +1665,7 @@ scopeok:
 			rs->sr_err = mdb_id2edata( op, mci, id, &edata );
 			if ( rs->sr_err == MDB_NOTFOUND ) {
 notfound:
-				if( nsubs < ncand )
+				if( nsubs < ncand || sw )
 					goto loop_continue;
 
 				if( !MDB_IDL_IS_RANGE(candidates) ) {
@@ -948,6 +1709,10 @@ notfound:
 			e->e_nname.bv_val = NULL;
 		}
 
+		/* in sort order, only under the key of its least value */
+		if ( sw && !mdb_sortwalk_check( sw, e ))
+			goto loop_continue;
+
 		if ( is_entry_subentry( e ) ) {
 			if( op->oq_search.rs_scope != LDAP_SCOPE_BASE ) {
 				if(!get_subentries_visibility( op )) {
@@ -1050,7 +1815,13 @@ notfound:
 		if ( !manageDSAit && op->oq_search.rs_scope != LDAP_SCOPE_BASE
 			&& is_entry_referral( e ) )
 		{
-			BerVarray erefs = get_entry_referrals( op, e );
+			BerVarray erefs;
+
+			/* already sent the first time round */
+			if ( sw && sw->sw_again )
+				goto loop_continue;
+
+			erefs = get_entry_referrals( op, e );
 			rs->sr_ref = referral_rewrite( erefs, &e->e_name, NULL,
 				op->oq_search.rs_scope == LDAP_SCOPE_ONELEVEL
 					? LDAP_SCOPE_BASE : LDAP_SCOPE_SUBTREE );
@@ -1088,6 +1859,12 @@ notfound:
 				lastid = id;
 			}
 
+			/* only the VLV window is sent, once all are known */
+			if ( sw && ss->ss_vlv ) {
+				mdb_sortwalk_match( sw, id );
+				goto loop_continue;
+			}
+
 			if (e) {
 				/* safe default */
 				rs->sr_attrs = op->oq_search.rs_attrs;
@@ -1136,7 +1913,10 @@ notfound:
 loop_continue:
 		if ( moi == &opinfo && !wwctx.flag && mdb->mi_rtxn_size ) {
 			wwctx.nentries++;
-			if ( wwctx.nentries >= mdb->mi_rtxn_size ) {
+			/* the workers can't help until we catch up with them */
+			if ( wwctx.nentries >= mdb->mi_rtxn_size || ( ps &&
+				wwctx.nentries >= MDB_PS_SPAN &&
+				__atomic_load_n( &ps->ps_stale, __ATOMIC_RELAXED ))) {
 				MDB_envinfo ei;
 				wwctx.nentries = 0;
 				mdb_env_info(mdb->mi_dbenv, &ei);
@@ -1146,6 +1926,8 @@ loop_continue:
 		}
 		if ( wwctx.flag ) {
 			rs->sr_err = mdb_waitfixup( op, &wwctx, mci, mcd, &isc );
+			if ( sw )
+				mdb_sortwalk_renew( sw, ltid );
 			if ( rs->sr_err ) {
 				send_ldap_result( op, rs );
 				goto done;
@@ -1187,11 +1969,105 @@ loop_continue:
 				}
 			} else
 				id = isc.id;
+		} else if ( sw ) {
+			id = mdb_sortwalk_next( sw );
 		} else {
 			id = mdb_idl_next( candidates, &cursor );
 		}
 	}
 
+	if ( sw && sw->sw_rc ) {
+		rs->sr_err = LDAP_OTHER;
+		rs->sr_text = "internal error in sort index";
+		send_ldap_result( op, rs );
+		goto done;
+	}
+
+	if ( sw && ss->ss_vlv ) {
+		int first, last;
+
+		if ( !sw->sw_done ) {
+			/* All entries were seen, the count is exact */
+			ID n = sw->sw_nmatch;
+			if ( slap_sorted_window( ss, n,
+				sw->sw_target ? sw->sw_target - 1 : n, &first, &last ))
+			{
+				rs->sr_err = LDAP_VLV_ERROR;
+				send_ldap_result( op, rs );
+				rs->sr_err = LDAP_SUCCESS;
+				goto done;
+			}
+			if ( first + sw->sw_size <= n && sw->sw_again ) {
+				/* things changed meanwhile, send what we have */
+				first = n - sw->sw_size + 1;
+			} else if ( first + sw->sw_size <= n ) {
+				/* The guessed target was too far out and the
+				 * window went by, look for it again.
+				 */
+				mdb_sortwalk_reset( sw );
+				sw->sw_target = ss->ss_target;
+				sw->sw_last = last;
+				sw->sw_again = 1;
+				id = mdb_sortwalk_next( sw );
+				if ( id != NOID )
+					goto loop_begin;
+			}
+			sw->sw_first = first;
+			sw->sw_last = last;
+		} else if ( !BER_BVISNULL( &ss->ss_value )) {
+			/* Stopped after the window, guess the count */
+			slap_sorted_window( ss,
+				ncand > sw->sw_last ? ncand : sw->sw_last,
+				sw->sw_target - 1, &first, &last );
+			sw->sw_first = first;
+			sw->sw_last = last;
+		}
+		for ( ; sw->sw_first <= sw->sw_last; sw->sw_first++ ) {
+			id = sw->sw_win[ ( sw->sw_first - 1 ) % sw->sw_size ];
+			if ( id == base->e_id ) {
+				e = base;
+			} else {
+				if ( mdb_id2entry( op, mci, id, &e ))
+					continue;
+				mdb_id2name( op, ltid, &isc.mc, id, &e->e_name, &e->e_nname );
+			}
+			rs->sr_attrs = op->oq_search.rs_attrs;
+			rs->sr_operational_attrs = NULL;
+			rs->sr_ctrls = NULL;
+			rs->sr_entry = e;
+			rs->sr_flags = 0;
+			rs->sr_err = send_search_entry( op, rs );
+			rs->sr_attrs = NULL;
+			rs->sr_entry = NULL;
+			if ( e != base )
+				mdb_entry_return( op, e );
+			e = NULL;
+
+			switch ( rs->sr_err ) {
+			case LDAP_BUSY:
+				send_ldap_result( op, rs );
+				goto done;
+			case LDAP_UNAVAILABLE:
+			case LDAP_SIZELIMIT_EXCEEDED:
+				if ( rs->sr_err == LDAP_SIZELIMIT_EXCEEDED ) {
+					rs->sr_ref = rs->sr_v2ref;
+					send_ldap_result( op, rs );
+					rs->sr_err = LDAP_SUCCESS;
+				} else {
+					rs->sr_err = LDAP_OTHER;
+				}
+				goto done;
+			}
+			if ( wwctx.flag ) {
+				rs->sr_err = mdb_waitfixup( op, &wwctx, mci, mcd, &isc );
+				if ( rs->sr_err ) {
+					send_ldap_result( op, rs );
+					goto done;
+				}
+			}
+		}
+	}
+
 nochange:
 	rs->sr_ctrls = NULL;
 	rs->sr_ref = rs->sr_v2ref;
@@ -1206,6 +2082,10 @@ nochange:
 	rs->sr_err = LDAP_SUCCESS;
 
 done:
+	if ( ps )
+		mdb_psearch_end( ps );
+	if ( sw )
+		mdb_sortwalk_close( sw );
 	if ( cb.sc_private ) {
 		/* remove our writewait callback */
 		slap_callback **scp = &op->o_callback;
@@ -86,6 +86,7 @@ static ldap_pvt_thread_cond_t mdb_tool_index_cond_work;
 static void * mdb_tool_index_task( void *ctx, void *ptr );
 
 static int	mdb_writes, mdb_writes_per_commit;
+static int	mdb_tool_ixstate_done;
 
 /* Number of ops per commit in Quick mode.
  * Batching speeds writes overall, but too large a
@@ -98,6 +99,641 @@ static int	mdb_writes, mdb_writes_per_commit;
 static int
 mdb_tool_entry_get_int( BackendDB *be, ID id, Entry **ep );
 
+/* In Quick mode, slapadd and slapindex defer the keys of the indices
+ * that are empty when they start: the (key, ID) pairs are collected in
+ * a buffer, which is sorted and written out to a temporary file as a
+ * run once it holds MDB_TOOL_RUN_SIZE bytes. When all entries have been
+ * processed, the runs are merged and each index is loaded in key order
+ * with appending cursor puts, instead of taking its keys in random
+ * order one entry at a time.
+ */
+#ifndef MDB_TOOL_RUN_SIZE
+#define MDB_TOOL_RUN_SIZE	(256*1024*1024)
+#endif
+
+/* Number of IDs per commit while loading the runs */
+#ifndef MDB_TOOL_RUN_COMMIT
+#define MDB_TOOL_RUN_COMMIT	(256*1024)
+#endif
+
+/* Seconds between progress reports */
+#ifndef MDB_TOOL_PROGRESS_INTERVAL
+#define MDB_TOOL_PROGRESS_INTERVAL	5
+#endif
+
+typedef struct mdb_tool_rec {
+	MDB_dbi tr_dbi;
+	ID tr_id;
+	unsigned short tr_klen;
+	char tr_key[1];
+} mdb_tool_rec;
+
+#define TR_HDRLEN	offsetof(mdb_tool_rec, tr_key)
+#define TR_SIZE(klen)	((TR_HDRLEN + (klen) + sizeof(ID) - 1) & ~(sizeof(ID) - 1))
+#define TR_REC(off)	((mdb_tool_rec *)(mdb_tool_rbuf + (off)))
+
+/* what to do with the keys of a DBI */
+#define RUN_UNKNOWN	0
+#define RUN_DEFER	1	/* was empty, collect its keys */
+#define RUN_DIRECT	2	/* had keys, update it in place */
+
+typedef struct mdb_tool_rdbi {
+	int rd_state;
+	unsigned long rd_pairs;		/* keys collected */
+} mdb_tool_rdbi;
+
+int mdb_tool_runs;
+static mdb_tool_rdbi *mdb_tool_rdbis;
+static unsigned mdb_tool_nrdbi;
+static unsigned long mdb_tool_nscanned;	/* entries processed */
+static struct timeval mdb_tool_scan_start;
+static char *mdb_tool_rbuf;
+static size_t mdb_tool_rsize, mdb_tool_rlen;
+static size_t *mdb_tool_roff, mdb_tool_nrec, mdb_tool_maxrec;
+/* the records before these were committed */
+static size_t mdb_tool_rmark, mdb_tool_nmark;
+static FILE **mdb_tool_rfiles;
+static int mdb_tool_nruns;
+
+typedef struct mdb_tool_src {
+	FILE *ts_fp;		/* NULL for the records still in memory */
+	size_t ts_next;
+	mdb_tool_rec *ts_rec;
+} mdb_tool_src;
+
+typedef struct mdb_tool_load {
+	BackendDB *tl_be;
+	MDB_txn *tl_txn;
+	MDB_cursor *tl_mc;
+	MDB_dbi tl_dbi;
+	MDB_val tl_key;
+	ID *tl_ids;
+	size_t tl_n;
+	ID tl_last;
+	size_t tl_puts;
+	/* progress of the index being loaded */
+	MDB_dbi tl_rdbi;
+	unsigned long tl_nkeys, tl_nids, tl_npairs;
+	struct timeval tl_start, tl_shown;
+} mdb_tool_load;
+
+static int
+mdb_tool_rec_cmp( const mdb_tool_rec *a, const mdb_tool_rec *b )
+{
+	int rc;
+
+	if ( a->tr_dbi != b->tr_dbi )
+		return a->tr_dbi < b->tr_dbi ? -1 : 1;
+	/* the default LMDB key order */
+	rc = memcmp( a->tr_key, b->tr_key,
+		a->tr_klen < b->tr_klen ? a->tr_klen : b->tr_klen );
+	if ( !rc )
+		rc = (int)a->tr_klen - (int)b->tr_klen;
+	if ( !rc && a->tr_id != b->tr_id )
+		rc = a->tr_id < b->tr_id ? -1 : 1;
+	return rc;
+}
+
+static int
+mdb_tool_roff_cmp( const void *a, const void *b )
+{
+	return mdb_tool_rec_cmp( TR_REC( *(const size_t *)a ),
+		TR_REC( *(const size_t *)b ));
+}
+
+static void
+mdb_tool_run_commit( void )
+{
+	mdb_tool_rmark = mdb_tool_rlen;
+	mdb_tool_nmark = mdb_tool_nrec;
+}
+
+static void
+mdb_tool_run_abort( void )
+{
+	mdb_tool_rlen = mdb_tool_rmark;
+	mdb_tool_nrec = mdb_tool_nmark;
+}
+
+/* Sort the committed records and write them out as a new run.
+ * The records of the current txn stay in the buffer.
+ */
+static int
+mdb_tool_run_spill( void )
+{
+	FILE *fp;
+	size_t i;
+
+	if ( !mdb_tool_nmark )
+		return 0;
+
+	qsort( mdb_tool_roff, mdb_tool_nmark, sizeof(size_t), mdb_tool_roff_cmp );
+	fp = tmpfile();
+	if ( !fp ) {
+		Debug( LDAP_DEBUG_ANY, LDAP_XSTRING(mdb_tool_run_spill)
+			": tmpfile failed: %s\n", mdb_strerror(errno) );
+		return -1;
+	}
+	for ( i = 0; i < mdb_tool_nmark; i++ ) {
+		mdb_tool_rec *tr = TR_REC( mdb_tool_roff[i] );
+		if ( fwrite( tr, TR_SIZE( tr->tr_klen ), 1, fp ) != 1 )
+			break;
+	}
+	if ( i < mdb_tool_nmark || fflush( fp )) {
+		Debug( LDAP_DEBUG_ANY, LDAP_XSTRING(mdb_tool_run_spill)
+			": write failed: %s\n", mdb_strerror(errno) );
+		fclose( fp );
+		return -1;
+	}
+	mdb_tool_rfiles = ch_realloc( mdb_tool_rfiles,
+		( mdb_tool_nruns + 1 ) * sizeof(FILE *));
+	mdb_tool_rfiles[mdb_tool_nruns++] = fp;
+
+	memmove( mdb_tool_rbuf, mdb_tool_rbuf + mdb_tool_rmark,
+		mdb_tool_rlen - mdb_tool_rmark );
+	for ( i = mdb_tool_nmark; i < mdb_tool_nrec; i++ )
+		mdb_tool_roff[i - mdb_tool_nmark] = mdb_tool_roff[i] - mdb_tool_rmark;
+	mdb_tool_rlen -= mdb_tool_rmark;
+	mdb_tool_nrec -= mdb_tool_nmark;
+	mdb_tool_rmark = 0;
+	mdb_tool_nmark = 0;
+	return 0;
+}
+
+int
+mdb_tool_run_add(
+	BackendDB *be,
+	MDB_cursor *mc,
+	struct berval *keys,
+	ID id )
+{
+	MDB_dbi dbi = mdb_cursor_dbi( mc );
+	mdb_tool_rec *tr;
+	size_t size;
+	unsigned klen;
+	int k, rc;
+
+	if ( dbi >= mdb_tool_nrdbi ) {
+		unsigned n = dbi + 16;
+		mdb_tool_rdbis = ch_realloc( mdb_tool_rdbis, n * sizeof(mdb_tool_rdbi));
+		memset( mdb_tool_rdbis + mdb_tool_nrdbi, 0,
+			( n - mdb_tool_nrdbi ) * sizeof(mdb_tool_rdbi));
+		mdb_tool_nrdbi = n;
+	}
+	if ( mdb_tool_rdbis[dbi].rd_state == RUN_UNKNOWN ) {
+		MDB_stat ms;
+		rc = mdb_stat( mdb_cursor_txn( mc ), dbi, &ms );
+		if ( rc )
+			return rc;
+		mdb_tool_rdbis[dbi].rd_state = ms.ms_entries ? RUN_DIRECT : RUN_DEFER;
+	}
+	if ( mdb_tool_rdbis[dbi].rd_state == RUN_DIRECT )
+		return mdb_idl_insert_keys( be, mc, keys, id );
+
+	if ( !mdb_tool_rbuf ) {
+		mdb_tool_rsize = MDB_TOOL_RUN_SIZE;
+		mdb_tool_rbuf = ch_malloc( mdb_tool_rsize );
+	}
+	for ( k = 0; keys[k].bv_val; k++ ) {
+		klen = keys[k].bv_len;
+#ifndef MISALIGNED_OK
+		/* padded like mdb_idl_insert_keys does */
+		if (( klen & ALIGNER ) && klen < 2 * sizeof(int))
+			klen = 2 * sizeof(int);
+#endif
+		size = TR_SIZE( klen );
+		if ( mdb_tool_rlen + size > mdb_tool_rsize ) {
+			rc = mdb_tool_run_spill();
+			if ( rc )
+				return rc;
+			/* the current txn alone filled it */
+			if ( mdb_tool_rlen + size > mdb_tool_rsize ) {
+				mdb_tool_rsize *= 2;
+				mdb_tool_rbuf = ch_realloc( mdb_tool_rbuf, mdb_tool_rsize );
+			}
+		}
+		if ( mdb_tool_nrec == mdb_tool_maxrec ) {
+			mdb_tool_maxrec = mdb_tool_maxrec ? mdb_tool_maxrec * 2 : 4096;
+			mdb_tool_roff = ch_realloc( mdb_tool_roff,
+				mdb_tool_maxrec * sizeof(size_t));
+		}
+		tr = TR_REC( mdb_tool_rlen );
+		tr->tr_dbi = dbi;
+		tr->tr_id = id;
+		tr->tr_klen = klen;
+		memcpy( tr->tr_key, keys[k].bv_val, keys[k].bv_len );
+		if ( klen > keys[k].bv_len )
+			memset( tr->tr_key + keys[k].bv_len, 0, klen - keys[k].bv_len );
+		mdb_tool_roff[mdb_tool_nrec++] = mdb_tool_rlen;
+		mdb_tool_rlen += size;
+		mdb_tool_rdbis[dbi].rd_pairs++;
+	}
+	return 0;
+}
+
+/* returns 1 if there's a record, 0 at the end, -1 on error */
+static int
+mdb_tool_src_next( mdb_tool_src *ts )
+{
+	size_t len;
+
+	if ( !ts->ts_fp ) {
+		if ( ts->ts_next == mdb_tool_nrec )
+			return 0;
+		ts->ts_rec = TR_REC( mdb_tool_roff[ts->ts_next++] );
+		return 1;
+	}
+	if ( fread( ts->ts_rec, TR_HDRLEN, 1, ts->ts_fp ) != 1 )
+		return ferror( ts->ts_fp ) ? -1 : 0;
+	len = TR_SIZE( ts->ts_rec->tr_klen ) - TR_HDRLEN;
+	if ( fread( (char *)ts->ts_rec + TR_HDRLEN, len, 1, ts->ts_fp ) != 1 )
+		return -1;
+	return 1;
+}
+
+static void
+mdb_tool_heap_down( mdb_tool_src **heap, int n, int i )
+{
+	mdb_tool_src *ts = heap[i];
+	int j;
+
+	while (( j = 2 * i + 1 ) < n ) {
+		if ( j + 1 < n &&
+			mdb_tool_rec_cmp( heap[j+1]->ts_rec, heap[j]->ts_rec ) < 0 )
+			j++;
+		if ( mdb_tool_rec_cmp( ts->ts_rec, heap[j]->ts_rec ) <= 0 )
+			break;
+		heap[i] = heap[j];
+		i = j;
+	}
+	heap[i] = ts;
+}
+
+static int
+mdb_tool_load_put( mdb_tool_load *tl, ID *ids, size_t n )
+{
+	MDB_val data[2];
+	int rc;
+
+	data[0].mv_size = sizeof(ID);
+	data[0].mv_data = ids;
+	rc = mdb_cursor_put( tl->tl_mc, &tl->tl_key, data, MDB_APPEND );
+	if ( rc == 0 && n > 1 ) {
+		data[0].mv_data = ids + 1;
+		data[1].mv_size = n - 1;
+		rc = mdb_cursor_put( tl->tl_mc, &tl->tl_key, data,
+			MDB_APPENDDUP|MDB_MULTIPLE );
+	}
+	tl->tl_puts += n;
+	return rc;
+}
+
+/* Write the IDs of the current key, if they were not already */
+static int
+mdb_tool_load_end( mdb_tool_load *tl )
+{
+	struct mdb_info *mdb = tl->tl_be->be_private;
+	int rc = 0;
+
+	if ( !tl->tl_n )
+		return 0;
+	if ( tl->tl_n <= MDB_idl_db_max ) {
+		rc = mdb_tool_load_put( tl, tl->tl_ids, tl->tl_n );
+	} else if ( !mdb->mi_idl_bitmap ) {
+		/* store the range, like mdb_idl_insert_keys would */
+		ID range[3];
+		range[0] = 0;
+		range[1] = tl->tl_ids[0];
+		range[2] = tl->tl_last;
+		rc = mdb_tool_load_put( tl, range, 3 );
+	}
+	tl->tl_n = 0;
+	if ( rc == 0 && tl->tl_puts >= MDB_TOOL_RUN_COMMIT ) {
+		rc = mdb_txn_commit( tl->tl_txn );
+		tl->tl_txn = NULL;
+		tl->tl_mc = NULL;
+		tl->tl_puts = 0;
+	}
+	return rc;
+}
+
+static int
+mdb_tool_load_id( mdb_tool_load *tl, ID id )
+{
+	struct mdb_info *mdb = tl->tl_be->be_private;
+	struct berval keys[2];
+	int rc;
+
+	/* a key may come twice from the values of one entry */
+	if ( tl->tl_n && tl->tl_last == id )
+		return 0;
+	if ( tl->tl_n < MDB_idl_db_max ) {
+		tl->tl_ids[tl->tl_n] = id;
+	} else if ( mdb->mi_idl_bitmap ) {
+		/* the slot overflows: write out what fits, and let
+		 * mdb_idl_insert_keys turn it into a bitmap
+		 */
+		if ( tl->tl_n == MDB_idl_db_max ) {
+			rc = mdb_tool_load_put( tl, tl->tl_ids, tl->tl_n );
+			if ( rc )
+				return rc;
+		}
+		keys[0].bv_val = tl->tl_key.mv_data;
+		keys[0].bv_len = tl->tl_key.mv_size;
+		BER_BVZERO( &keys[1] );
+		rc = mdb_idl_insert_keys( tl->tl_be, tl->tl_mc, keys, id );
+		if ( rc )
+			return rc;
+		tl->tl_puts++;
+	}
+	tl->tl_n++;
+	tl->tl_last = id;
+	return 0;
+}
+
+static double
+mdb_tool_elapsed( struct timeval *start, struct timeval *now )
+{
+	double secs = ( now->tv_sec - start->tv_sec ) +
+		( now->tv_usec - start->tv_usec ) / 1000000.0;
+	return secs > 0 ? secs : 0;
+}
+
+static void
+mdb_tool_dbi_name( BackendDB *be, MDB_dbi dbi, char *buf, size_t len )
+{
+	struct mdb_info *mdb = be->be_private;
+	int i;
+
+	for ( i = 0; i < mdb->mi_nattrs; i++ ) {
+		AttrInfo *ai = mdb->mi_attrs[i];
+		if ( ai->ai_dbi == dbi ) {
+			snprintf( buf, len, "%s", ai->ai_desc->ad_cname.bv_val );
+			return;
+		}
+		if ( ai->ai_sort && ai->ai_sort->ai_dbi == dbi ) {
+			snprintf( buf, len, "%s (sort)", ai->ai_desc->ad_cname.bv_val );
+			return;
+		}
+	}
+	snprintf( buf, len, "dbi %u", dbi );
+}
+
+/* Report the progress of the index being loaded, or its totals once
+ * it is done.
+ */
+static void
+mdb_tool_load_report( mdb_tool_load *tl, int done )
+{
+	struct timeval now;
+	double secs;
+	char name[64];
+
+	if ( !( slapMode & SLAP_TOOL_PROGRESS ))
+		return;
+	gettimeofday( &now, NULL );
+	if ( !done &&
+		mdb_tool_elapsed( &tl->tl_shown, &now ) < MDB_TOOL_PROGRESS_INTERVAL )
+		return;
+	tl->tl_shown = now;
+	mdb_tool_dbi_name( tl->tl_be, tl->tl_rdbi, name, sizeof(name) );
+	secs = mdb_tool_elapsed( &tl->tl_start, &now );
+	if ( done ) {
+		fprintf( stderr, "%s: %lu keys, %lu IDs loaded in %.1fs",
+			name, tl->tl_nkeys, tl->tl_nids, secs );
+		if ( secs > 0 )
+			fprintf( stderr, " (%.0f IDs/s)", tl->tl_nids / secs );
+		fputc( '\n', stderr );
+	} else if ( tl->tl_npairs >= tl->tl_nids ) {
+		fprintf( stderr, "%s: %lu of %lu IDs (%lu%%), %lu keys\n",
+			name, tl->tl_nids, tl->tl_npairs,
+			tl->tl_nids * 100 / tl->tl_npairs, tl->tl_nkeys );
+	}
+}
+
+/* Start the progress of the index dbi */
+static void
+mdb_tool_load_start( mdb_tool_load *tl, MDB_dbi dbi )
+{
+	if ( tl->tl_start.tv_sec )
+		mdb_tool_load_report( tl, 1 );
+	tl->tl_rdbi = dbi;
+	tl->tl_nkeys = tl->tl_nids = 0;
+	tl->tl_npairs = dbi < mdb_tool_nrdbi ? mdb_tool_rdbis[dbi].rd_pairs : 0;
+	gettimeofday( &tl->tl_start, NULL );
+	tl->tl_shown = tl->tl_start;
+}
+
+/* Merge the runs and the records still in memory into the indices */
+static int
+mdb_tool_run_flush( BackendDB *be )
+{
+	struct mdb_info *mdb = be->be_private;
+	mdb_tool_src *srcs = NULL, **heap = NULL;
+	mdb_tool_load tl = {0};
+	mdb_tool_rec *tr;
+	size_t maxsize;
+	int i, n = 0, nsrc, rc = 0;
+	char *err = "read";
+
+	if ( !mdb_tool_nrec && !mdb_tool_nruns )
+		goto done;
+
+	if ( slapMode & SLAP_TOOL_PROGRESS ) {
+		struct timeval now;
+		unsigned long npairs = 0;
+		double secs;
+		unsigned j;
+
+		for ( j = 0; j < mdb_tool_nrdbi; j++ )
+			npairs += mdb_tool_rdbis[j].rd_pairs;
+		gettimeofday( &now, NULL );
+		secs = mdb_tool_elapsed( &mdb_tool_scan_start, &now );
+		fprintf( stderr, "%lu entries scanned in %.1fs",
+			mdb_tool_nscanned, secs );
+		if ( secs > 0 )
+			fprintf( stderr, " (%.0f entries/s)", mdb_tool_nscanned / secs );
+		fprintf( stderr, ", %lu index keys in %d runs\n",
+			npairs, mdb_tool_nruns + ( mdb_tool_nrec != 0 ));
+	}
+
+	qsort( mdb_tool_roff, mdb_tool_nrec, sizeof(size_t), mdb_tool_roff_cmp );
+
+	maxsize = TR_SIZE( mdb_env_get_maxkeysize( mdb->mi_dbenv ) + 2 * sizeof(int) );
+	nsrc = mdb_tool_nruns + 1;
+	srcs = ch_calloc( nsrc, sizeof(mdb_tool_src) + sizeof(mdb_tool_src *) );
+	heap = (mdb_tool_src **)( srcs + nsrc );
+	for ( i = 0; i < nsrc; i++ ) {
+		if ( i < mdb_tool_nruns ) {
+			srcs[i].ts_fp = mdb_tool_rfiles[i];
+			srcs[i].ts_rec = ch_malloc( maxsize );
+			rewind( srcs[i].ts_fp );
+		}
+		rc = mdb_tool_src_next( &srcs[i] );
+		if ( rc < 0 )
+			goto fail;
+		if ( rc )
+			heap[n++] = &srcs[i];
+	}
+	for ( i = n / 2 - 1; i >= 0; i-- )
+		mdb_tool_heap_down( heap, n, i );
+
+	tl.tl_be = be;
+	tl.tl_ids = ch_malloc( MDB_idl_db_max * sizeof(ID) );
+	tl.tl_key.mv_data = ch_malloc( maxsize );
+	rc = 0;
+	while ( n ) {
+		tr = heap[0]->ts_rec;
+		if ( !tl.tl_n || tr->tr_dbi != tl.tl_dbi ||
+			tr->tr_klen != tl.tl_key.mv_size ||
+			memcmp( tr->tr_key, tl.tl_key.mv_data, tr->tr_klen )) {
+			err = "put";
+			rc = mdb_tool_load_end( &tl );
+			if ( rc )
+				goto fail;
+			if ( !tl.tl_txn ) {
+				err = "txn_begin";
+				rc = mdb_txn_begin( mdb->mi_dbenv, NULL, 0, &tl.tl_txn );
+				if ( rc )
+					goto fail;
+			}
+			if ( !tl.tl_mc || tr->tr_dbi != tl.tl_dbi ) {
+				if ( tl.tl_mc )
+					mdb_cursor_close( tl.tl_mc );
+				err = "cursor_open";
+				rc = mdb_cursor_open( tl.tl_txn, tr->tr_dbi, &tl.tl_mc );
+				if ( rc )
+					goto fail;
+				tl.tl_dbi = tr->tr_dbi;
+			}
+			if ( tr->tr_dbi != tl.tl_rdbi || !tl.tl_start.tv_sec )
+				mdb_tool_load_start( &tl, tr->tr_dbi );
+			tl.tl_key.mv_size = tr->tr_klen;
+			memcpy( tl.tl_key.mv_data, tr->tr_key, tr->tr_klen );
+			tl.tl_nkeys++;
+		}
+		err = "put";
+		rc = mdb_tool_load_id( &tl, tr->tr_id );
+		if ( rc )
+			goto fail;
+		if ( !( ++tl.tl_nids & 0xffff ))
+			mdb_tool_load_report( &tl, 0 );
+
+		err = "read";
+		rc = mdb_tool_src_next( heap[0] );
+		if ( rc < 0 )
+			goto fail;
+		if ( !rc )
+			heap[0] = heap[--n];
+		mdb_tool_heap_down( heap, n, 0 );
+	}
+	err = "put";
+	rc = mdb_tool_load_end( &tl );
+	if ( rc == 0 && tl.tl_txn ) {
+		err = "txn_commit";
+		rc = mdb_txn_commit( tl.tl_txn );
+		tl.tl_txn = NULL;
+	}
+	if ( rc == 0 )
+		mdb_tool_load_report( &tl, 1 );
+
+fail:
+	if ( rc ) {
+		Debug( LDAP_DEBUG_ANY, LDAP_XSTRING(mdb_tool_run_flush)
+			": database %s: %s failed: %s (%d)\n",
+			be->be_suffix[0].bv_val, err,
+			rc < 0 ? mdb_strerror(errno) : mdb_strerror(rc), rc );
+		if ( tl.tl_txn )
+			mdb_txn_abort( tl.tl_txn );
+	}
+	for ( i = 0; i < mdb_tool_nruns; i++ ) {
+		fclose( mdb_tool_rfiles[i] );
+		ch_free( srcs[i].ts_rec );
+	}
+	ch_free( srcs );
+	ch_free( tl.tl_ids );
+	ch_free( tl.tl_key.mv_data );
+
+done:
+	ch_free( mdb_tool_rfiles );
+	mdb_tool_rfiles = NULL;
+	mdb_tool_nruns = 0;
+	ch_free( mdb_tool_rbuf );
+	mdb_tool_rbuf = NULL;
+	mdb_tool_rsize = mdb_tool_rlen = mdb_tool_rmark = 0;
+	mdb_tool_nrec = mdb_tool_nmark = 0;
+	/* the loaded indices are not empty anymore */
+	if ( mdb_tool_rdbis )
+		memset( mdb_tool_rdbis, 0, mdb_tool_nrdbi * sizeof(mdb_tool_rdbi));
+	return rc;
+}
+
+/* Commit the pending entries and load the deferred keys, so the
+ * indices are complete before anything reads or updates them.
+ */
+static int
+mdb_tool_run_sync( BackendDB *be )
+{
+	struct mdb_info *mdb = be->be_private;
+	int i, rc;
+
+	if ( !mdb_tool_nrec && !mdb_tool_nruns )
+		return 0;
+
+	if ( mdb_tool_txn ) {
+		if ( cursor ) {
+			mdb_cursor_close( cursor );
+			cursor = NULL;
+		}
+		rc = mdb_txn_commit( mdb_tool_txn );
+		mdb_tool_txn = NULL;
+		idcursor = NULL;
+		for ( i=0; i<mdb->mi_nattrs; i++ ) {
+			mdb->mi_attrs[i]->ai_cursor = NULL;
+			if ( mdb->mi_attrs[i]->ai_sort )
+				mdb->mi_attrs[i]->ai_sort->ai_cursor = NULL;
+		}
+		mdb_writes = 0;
+		if ( rc ) {
+			mdb->mi_numads = 0;
+			mdb_tool_run_abort();
+			Debug( LDAP_DEBUG_ANY, LDAP_XSTRING(mdb_tool_run_sync)
+				": database %s: txn_commit failed: %s (%d)\n",
+				be->be_suffix[0].bv_val, mdb_strerror(rc), rc );
+			return rc;
+		}
+		mdb_tool_run_commit();
+	}
+	return mdb_tool_run_flush( be );
+}
+
+/* Train a compression dictionary from the entries sampled so far.
+ * It gets a txn of its own, so that the entries it compresses again
+ * were all committed, and no later abort can lose it.
+ */
+static void
+mdb_tool_dict_train( BackendDB *be )
+{
+	struct mdb_info *mdb = (struct mdb_info *) be->be_private;
+	MDB_txn *txn;
+	int rc, prev = mdb->mi_ndicts;
+
+	rc = mdb_txn_begin( mdb->mi_dbenv, NULL, 0, &txn );
+	if ( rc == 0 ) {
+		rc = mdb_dict_train( mdb, txn );
+		if ( rc == 0 )
+			rc = mdb_txn_commit( txn );
+		else
+			mdb_txn_abort( txn );
+	}
+	if ( rc ) {
+		mdb_dict_unwind( mdb, prev );
+		Debug( LDAP_DEBUG_ANY, LDAP_XSTRING(mdb_tool_dict_train)
+			": database %s: no dictionary: %s (%d)\n",
+			be->be_suffix[0].bv_val, mdb_strerror(rc), rc );
+	}
+}
+
 int mdb_tool_entry_open(
 	BackendDB *be, int mode )
 {
@@ -108,6 +744,22 @@ int mdb_tool_entry_open(
 	else
 		mdb_writes_per_commit = 1;
 
+	mdb_tool_ixstate_done = 0;
+
+	if ( mode && !( slapMode & SLAP_TOOL_READONLY )) {
+		struct mdb_info *mdb = (struct mdb_info *) be->be_private;
+		if ( mdb->mi_compress && mdb->mi_dict_size && !mdb->mi_ndicts )
+			mdb_dict_sample_begin( mdb );
+	}
+
+	/* Defer the keys of empty indices while adding or reindexing
+	 * in Quick mode */
+	if (( slapMode & (SLAP_TOOL_QUICK|SLAP_TOOL_READONLY)) == SLAP_TOOL_QUICK ) {
+		mdb_tool_runs = 1;
+		mdb_tool_nscanned = 0;
+		gettimeofday( &mdb_tool_scan_start, NULL );
+	}
+
 #ifdef MDB_TOOL_IDL_CACHING			/* threaded indexing has no performance advantage */
 	/* Set up for threaded slapindex */
 	if (( slapMode & (SLAP_TOOL_QUICK|SLAP_TOOL_READONLY)) == SLAP_TOOL_QUICK ) {
@@ -202,8 +854,11 @@ int mdb_tool_entry_close(
 		struct mdb_info *mdb = be->be_private;
 		if ( mdb ) {
 			int i;
-			for (i=0; i<mdb->mi_nattrs; i++)
+			for (i=0; i<mdb->mi_nattrs; i++) {
 				mdb->mi_attrs[i]->ai_cursor = NULL;
+				if ( mdb->mi_attrs[i]->ai_sort )
+					mdb->mi_attrs[i]->ai_sort->ai_cursor = NULL;
+			}
 		}
 	}
 	if( mdb_tool_txn ) {
@@ -228,6 +883,17 @@ int mdb_tool_entry_close(
 		}
 		txi = NULL;
 	}
+	{
+		struct mdb_info *mdb = be->be_private;
+		if ( mdb && mdb->mi_dict_train )
+			mdb_tool_dict_train( be );
+	}
+	if( mdb_tool_runs ) {
+		mdb_tool_run_commit();
+		mdb_tool_runs = 0;
+		if ( mdb_tool_run_flush( be ))
+			return -1;
+	}
 
 	if( nholes ) {
 		unsigned i;
@@ -598,6 +1264,12 @@ mdb_tool_index_add(
 				 &ir[i].ir_ai->ai_cursor );
 			if ( rc )
 				return rc;
+			if ( ir[i].ir_ai->ai_sort ) {
+				rc = mdb_cursor_open( txn, ir[i].ir_ai->ai_sort->ai_dbi,
+					 &ir[i].ir_ai->ai_sort->ai_cursor );
+				if ( rc )
+					return rc;
+			}
 		}
 		mdb_tool_ix_id = e->e_id;
 		mdb_tool_ix_txn = txn;
@@ -752,18 +1424,23 @@ ID mdb_tool_entry_put(
 
 done:
 	if( rc == 0 ) {
+		mdb_tool_nscanned++;
 		mdb_writes++;
 		if ( mdb_writes >= mdb_writes_per_commit ) {
 			unsigned i;
 			MDB_TOOL_IDL_FLUSH( be, mdb_tool_txn );
 			rc = mdb_txn_commit( mdb_tool_txn );
-			for ( i=0; i<mdb->mi_nattrs; i++ )
+			for ( i=0; i<mdb->mi_nattrs; i++ ) {
 				mdb->mi_attrs[i]->ai_cursor = NULL;
+				if ( mdb->mi_attrs[i]->ai_sort )
+					mdb->mi_attrs[i]->ai_sort->ai_cursor = NULL;
+			}
 			mdb_writes = 0;
 			mdb_tool_txn = NULL;
 			idcursor = NULL;
 			if( rc != 0 ) {
 				mdb->mi_numads = 0;
+				mdb_tool_run_abort();
 				snprintf( text->bv_val, text->bv_len,
 						"txn_commit failed: %s (%d)",
 						mdb_strerror(rc), rc );
@@ -771,16 +1448,24 @@ done:
 					"=> " LDAP_XSTRING(mdb_tool_entry_put) ": %s\n",
 					text->bv_val );
 				e->e_id = NOID;
+			} else {
+				mdb_tool_run_commit();
+				if ( mdb->mi_dict_train && mdb_dict_sample_full( mdb ))
+					mdb_tool_dict_train( be );
 			}
 		}
 
 	} else {
 		unsigned i;
 		mdb_txn_abort( mdb_tool_txn );
+		mdb_tool_run_abort();
 		mdb_tool_txn = NULL;
 		idcursor = NULL;
-		for ( i=0; i<mdb->mi_nattrs; i++ )
+		for ( i=0; i<mdb->mi_nattrs; i++ ) {
 			mdb->mi_attrs[i]->ai_cursor = NULL;
+			if ( mdb->mi_attrs[i]->ai_sort )
+				mdb->mi_attrs[i]->ai_sort->ai_cursor = NULL;
+		}
 		mdb_writes = 0;
 		snprintf( text->bv_val, text->bv_len,
 			"txn_aborted! %s (%d)",
@@ -894,6 +1579,8 @@ int mdb_tool_entry_reindex(
 		int i;
 		for ( i=0; i < mi->mi_nattrs; i++ ) {
 			rc = mdb_drop( txi, mi->mi_attrs[i]->ai_dbi, 0 );
+			if ( rc == 0 && mi->mi_attrs[i]->ai_sort )
+				rc = mdb_drop( txi, mi->mi_attrs[i]->ai_sort->ai_dbi, 0 );
 			if ( rc ) {
 				Debug( LDAP_DEBUG_ANY,
 					LDAP_XSTRING(mdb_tool_entry_reindex)
@@ -906,6 +1593,15 @@ int mdb_tool_entry_reindex(
 		slapMode ^= SLAP_TRUNCATE_MODE;
 	}
 
+	/* Reindexing every index completes those the server
+	 * was building online */
+	if ( !adv && !mdb_tool_ixstate_done ) {
+		rc = mdb_ixstate_put( mi, txi );
+		if ( rc )
+			goto done;
+		mdb_tool_ixstate_done = 1;
+	}
+
 	/*
 	 * just (re)add them for now
 	 * Use truncate mode to empty/reset index databases
@@ -924,6 +1620,7 @@ int mdb_tool_entry_reindex(
 
 done:
 	if( rc == 0 ) {
+		mdb_tool_nscanned++;
 		mdb_writes++;
 		if ( mdb_writes >= mdb_writes_per_commit ) {
 			MDB_val key;
@@ -931,14 +1628,20 @@ done:
 			MDB_TOOL_IDL_FLUSH( be, txi );
 			rc = mdb_txn_commit( txi );
 			mdb_writes = 0;
-			for ( i=0; i<mi->mi_nattrs; i++ )
+			for ( i=0; i<mi->mi_nattrs; i++ ) {
 				mi->mi_attrs[i]->ai_cursor = NULL;
+				if ( mi->mi_attrs[i]->ai_sort )
+					mi->mi_attrs[i]->ai_sort->ai_cursor = NULL;
+			}
 			if( rc != 0 ) {
 				Debug( LDAP_DEBUG_ANY,
 					"=> " LDAP_XSTRING(mdb_tool_entry_reindex)
 					": txn_commit failed: %s (%d)\n",
 					mdb_strerror(rc), rc );
 				e->e_id = NOID;
+				mdb_tool_run_abort();
+			} else {
+				mdb_tool_run_commit();
 			}
 			mdb_cursor_close( cursor );
 			txi = NULL;
@@ -958,8 +1661,12 @@ done:
 		mdb_cursor_close( cursor );
 		cursor = NULL;
 		mdb_txn_abort( txi );
-		for ( i=0; i<mi->mi_nattrs; i++ )
+		mdb_tool_run_abort();
+		for ( i=0; i<mi->mi_nattrs; i++ ) {
 			mi->mi_attrs[i]->ai_cursor = NULL;
+			if ( mi->mi_attrs[i]->ai_sort )
+				mi->mi_attrs[i]->ai_sort->ai_cursor = NULL;
+		}
 		Debug( LDAP_DEBUG_ANY,
 			"=> " LDAP_XSTRING(mdb_tool_entry_reindex)
 			": txn_aborted! err=%d\n",
@@ -1035,6 +1742,7 @@ done:
 		rc = mdb_txn_commit( mdb_tool_txn );
 		if( rc != 0 ) {
 			mdb->mi_numads = 0;
+			mdb_tool_run_abort();
 			snprintf( text->bv_val, text->bv_len,
 					"txn_commit failed: %s (%d)",
 					mdb_strerror(rc), rc );
@@ -1042,10 +1750,13 @@ done:
 				"=> " LDAP_XSTRING(mdb_tool_entry_modify) ": "
 				"%s\n", text->bv_val );
 			e->e_id = NOID;
+		} else {
+			mdb_tool_run_commit();
 		}
 
 	} else {
 		mdb_txn_abort( mdb_tool_txn );
+		mdb_tool_run_abort();
 		snprintf( text->bv_val, text->bv_len,
 			"txn_aborted! %s (%d)",
 			mdb_strerror(rc), rc );
@@ -1086,6 +1797,13 @@ int mdb_tool_entry_delete(
 
 	mdb = (struct mdb_info *) be->be_private;
 
+	rc = mdb_tool_run_sync( be );
+	if( rc != 0 ) {
+		snprintf( text->bv_val, text->bv_len,
+			"index load failed: err=%d", rc );
+		return LDAP_OTHER;
+	}
+
 	assert( cursor == NULL );
 	if( cursor ) {
 		mdb_cursor_close( cursor );
@@ -1389,10 +2107,18 @@ mdb_tool_idl_flush( BackendDB *be, MDB_txn *txn )
 	unsigned int i, dbi;
 
 	for ( i=0; i < mdb->mi_nattrs; i++ ) {
-		if ( !mdb->mi_attrs[i]->ai_root ) continue;
-		rc = mdb_tool_idl_flush_db( txn, mdb->mi_attrs[i], mdb_tool_axinfo[i % mdb_tool_threads] );
-		tavl_free(mdb->mi_attrs[i]->ai_root, NULL);
-		mdb->mi_attrs[i]->ai_root = NULL;
+		AttrInfo *ai = mdb->mi_attrs[i];
+		if ( ai->ai_sort && ai->ai_sort->ai_root ) {
+			rc = mdb_tool_idl_flush_db( txn, ai->ai_sort, mdb_tool_axinfo[i % mdb_tool_threads] );
+			tavl_free(ai->ai_sort->ai_root, NULL);
+			ai->ai_sort->ai_root = NULL;
+			if ( rc )
+				break;
+		}
+		if ( !ai->ai_root ) continue;
+		rc = mdb_tool_idl_flush_db( txn, ai, mdb_tool_axinfo[i % mdb_tool_threads] );
+		tavl_free(ai->ai_root, NULL);
+		ai->ai_root = NULL;
 		if ( rc )
 			break;
 	}
@@ -33,6 +33,7 @@ typedef enum {
 	MT_UNKNOWN,
 	MT_RUNQUEUE,
 	MT_TASKLIST,
+	MT_QUEUES,
 
 	MT_LAST
 } monitor_thread_t;
@@ -86,6 +87,9 @@ static struct {
 	{ BER_BVC( "cn=Tasklist" ),
 		BER_BVC("List of running plus standby threads - besides those handling operations"),
 		BER_BVNULL,	LDAP_PVT_THREAD_POOL_PARAM_UNKNOWN,	MT_TASKLIST },
+	{ BER_BVC( "cn=Queues" ),
+		BER_BVC("Occupancy and wait times of the thread pool work queues"),
+		BER_BVNULL,	LDAP_PVT_THREAD_POOL_PARAM_UNKNOWN,	MT_QUEUES },
 
 	{ BER_BVNULL }
 };
@@ -225,6 +229,7 @@ monitor_subsys_thread_update(
 	struct re_s		*re;
 	int			count = -1;
 	char			*state = NULL;
+	ldap_pvt_thread_pool_qstat_t	qs;
 
 	assert( mi != NULL );
 
@@ -312,6 +317,41 @@ monitor_subsys_thread_update(
 			}
 			break;
 
+		case MT_QUEUES:
+			if ( a != NULL ) {
+				if ( a->a_nvals != a->a_vals ) {
+					ber_bvarray_free( a->a_nvals );
+				}
+				ber_bvarray_free( a->a_vals );
+				a->a_vals = NULL;
+				a->a_nvals = NULL;
+				a->a_numvals = 0;
+			}
+
+			bv.bv_val = buf;
+			for ( i = 0; ldap_pvt_thread_pool_queue_stats( &connection_pool,
+				i, &qs ) == 0; i++ )
+			{
+				bv.bv_len = snprintf( buf, sizeof( buf ),
+					"{%d}open=%d active=%d pending=%d tasks=%lu stolen=%lu "
+					"waitavg=%luus waitmax=%luus",
+					i, qs.qs_open, qs.qs_active, qs.qs_pending,
+					qs.qs_tasks, qs.qs_stolen,
+					qs.qs_wait_avg, qs.qs_wait_max );
+				if ( bv.bv_len < sizeof( buf ) ) {
+					value_add_one( &vals, &bv );
+				}
+			}
+
+			if ( vals ) {
+				attr_merge_normalize( e, mi->mi_ad_monitoredInfo, vals, NULL );
+				ber_bvarray_free( vals );
+
+			} else {
+				attr_delete( &e->e_attrs, mi->mi_ad_monitoredInfo );
+			}
+			break;
+
 		default:
 			assert( 0 );
 		}
@@ -52,6 +52,9 @@ slap_bi_head backendInfo = LDAP_STAILQ_HEAD_INITIALIZER(backendInfo);
 int			nBackendDB = 0; 
 slap_be_head backendDB = LDAP_STAILQ_HEAD_INITIALIZER(backendDB);
 
+static void backend_group_cache_init( void );
+static void backend_group_cache_destroy( void );
+
 static int
 backend_init_controls( BackendInfo *bi )
 {
@@ -92,6 +95,8 @@ int backend_init(void)
 		return -1;
 	}
 
+	backend_group_cache_init();
+
 	for( bi=slap_binfo; bi->bi_type != NULL; bi++,nBackendInfo++ ) {
 		assert( bi->bi_init != 0 );
 
@@ -211,6 +216,8 @@ int backend_startup_one(Backend *be, ConfigReply *cr)
 	/* set database controls */
 	(void)backend_set_controls( be );
 
+	acl_compile( be->be_acl );
+
 #if 0
 	if ( !BER_BVISEMPTY( &be->be_rootndn )
 		&& select_backend( &be->be_rootndn, 0 ) == be
@@ -282,6 +289,8 @@ int backend_startup(Backend *be)
 		return backend_startup_one( be, &cr );
 	}
 
+	acl_compile( frontendDB->be_acl );
+
 	/* open frontend, if required */
 	if ( frontendDB->bd_info->bi_db_open ) {
 		rc = frontendDB->bd_info->bi_db_open( frontendDB, &cr );
@@ -509,6 +518,8 @@ int backend_destroy(void)
 	nBackendInfo = 0;
 	LDAP_STAILQ_INIT(&backendInfo);
 
+	backend_group_cache_destroy();
+
 	/* destroy frontend database */
 	bd = frontendDB;
 	if ( bd ) {
@@ -1440,6 +1451,278 @@ be_entry_get_rw(
 	return LDAP_UNWILLING_TO_PERFORM;
 }
 
+/*
+ * Server-wide cache of static group membership, behind op->o_groups.
+ * It is direct mapped on (database, objectClass, attribute, group ndn,
+ * member ndn); the slot, its lock and the group's invalidation stamp
+ * are all picked by the hash of the group ndn, so everything about one
+ * group is serialized by a single lock.
+ *
+ * Entries are stamped with the start time of the operation that
+ * computed them. Writes record their own time in the stamp of the
+ * entry they touched when they send their result, after they have
+ * committed. An entry is only returned, or stored, if it is newer than
+ * the stamp of its group: an operation that started before the write
+ * may have read the old group entry. A modrdn may move any number of
+ * groups, so it invalidates every group.
+ *
+ * Dynamic groups depend on the member's entry as well, and are not
+ * cached here.
+ */
+#define GCACHE_LOCKS	16
+#define GCACHE_STAMPS	1024	/* a multiple of GCACHE_LOCKS */
+
+typedef struct gcache_stamp {
+	time_t gs_time;
+	int gs_tincr;
+} gcache_stamp;
+
+#define GCACHE_AFTER(t, i, s)	((t) > (s)->gs_time || \
+	((t) == (s)->gs_time && (i) > (s)->gs_tincr))
+
+typedef struct gcache_ent {
+	Backend *ge_be;
+	ObjectClass *ge_oc;
+	AttributeDescription *ge_at;
+	time_t ge_time;
+	int ge_tincr;
+	int ge_res;
+	ber_len_t ge_grlen;
+	ber_len_t ge_oplen;
+	char ge_ndn[1];		/* group ndn, NUL, member ndn, NUL */
+} gcache_ent;
+
+typedef struct gcache_lock {
+	ldap_pvt_thread_mutex_t gl_mutex;
+	unsigned long gl_hits;
+	unsigned long gl_misses;
+} gcache_lock;
+
+unsigned int slap_group_cache_size;
+
+static gcache_lock gcache_locks[GCACHE_LOCKS];
+static gcache_stamp gcache_stamps[GCACHE_STAMPS];
+static gcache_ent **gcache_slots;
+static unsigned int gcache_nslots;
+
+static unsigned int
+gcache_hash( unsigned int h, struct berval *bv )
+{
+	ber_len_t i;
+
+	for ( i = 0; i < bv->bv_len; i++ ) {
+		h ^= (unsigned char)bv->bv_val[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+static void
+backend_group_cache_init( void )
+{
+	int i;
+
+	for ( i = 0; i < GCACHE_LOCKS; i++ )
+		ldap_pvt_thread_mutex_init( &gcache_locks[i].gl_mutex );
+}
+
+static void
+backend_group_cache_destroy( void )
+{
+	int i;
+
+	backend_group_cache_resize( 0 );
+	for ( i = 0; i < GCACHE_LOCKS; i++ )
+		ldap_pvt_thread_mutex_destroy( &gcache_locks[i].gl_mutex );
+}
+
+/* Empty the cache and give it room for nslots results */
+void
+backend_group_cache_resize( unsigned int nslots )
+{
+	gcache_ent **slots = NULL;
+	unsigned int i;
+
+	if ( nslots ) {
+		nslots = ( nslots + GCACHE_LOCKS - 1 ) & ~( GCACHE_LOCKS - 1 );
+		slots = ch_calloc( nslots, sizeof(gcache_ent *) );
+	}
+
+	for ( i = 0; i < GCACHE_LOCKS; i++ )
+		ldap_pvt_thread_mutex_lock( &gcache_locks[i].gl_mutex );
+
+	for ( i = 0; i < gcache_nslots; i++ ) {
+		if ( gcache_slots[i] )
+			ch_free( gcache_slots[i] );
+	}
+	ch_free( gcache_slots );
+	gcache_slots = slots;
+	gcache_nslots = nslots;
+
+	for ( i = 0; i < GCACHE_LOCKS; i++ )
+		ldap_pvt_thread_mutex_unlock( &gcache_locks[i].gl_mutex );
+}
+
+/* The slot of a result; the caller holds the lock of gh */
+static gcache_ent **
+gcache_slot( unsigned int gh, unsigned int mh )
+{
+	unsigned int n = gcache_nslots / GCACHE_LOCKS;
+
+	return &gcache_slots[ ( mh % n ) * GCACHE_LOCKS + gh % GCACHE_LOCKS ];
+}
+
+static int
+gcache_get(
+	Operation *op,
+	struct berval *gr_ndn,
+	struct berval *op_ndn,
+	ObjectClass *group_oc,
+	AttributeDescription *group_at,
+	unsigned int *ghp,
+	unsigned int *mhp,
+	int *res )
+{
+	unsigned int gh, mh;
+	gcache_lock *gl;
+	gcache_ent *ge;
+	int rc = -1;
+
+	gh = gcache_hash( 2166136261U, gr_ndn );
+	mh = gcache_hash( gh, op_ndn );
+	mh = gcache_hash( mh ^ (unsigned int)(ber_len_t)group_at, &group_oc->soc_cname );
+	*ghp = gh;
+	*mhp = mh;
+
+	gl = &gcache_locks[ gh % GCACHE_LOCKS ];
+	ldap_pvt_thread_mutex_lock( &gl->gl_mutex );
+	if ( gcache_nslots ) {
+		ge = *gcache_slot( gh, mh );
+		if ( ge && ge->ge_be == op->o_bd && ge->ge_oc == group_oc &&
+			ge->ge_at == group_at &&
+			ge->ge_grlen == gr_ndn->bv_len &&
+			ge->ge_oplen == op_ndn->bv_len &&
+			!memcmp( ge->ge_ndn, gr_ndn->bv_val, gr_ndn->bv_len ) &&
+			!memcmp( ge->ge_ndn + gr_ndn->bv_len + 1, op_ndn->bv_val,
+				op_ndn->bv_len ) &&
+			GCACHE_AFTER( ge->ge_time, ge->ge_tincr,
+				&gcache_stamps[ gh % GCACHE_STAMPS ] ) )
+		{
+			*res = ge->ge_res;
+			rc = 0;
+			gl->gl_hits++;
+		} else {
+			gl->gl_misses++;
+		}
+	}
+	ldap_pvt_thread_mutex_unlock( &gl->gl_mutex );
+
+	return rc;
+}
+
+static void
+gcache_put(
+	Operation *op,
+	struct berval *gr_ndn,
+	struct berval *op_ndn,
+	ObjectClass *group_oc,
+	AttributeDescription *group_at,
+	unsigned int gh,
+	unsigned int mh,
+	int res )
+{
+	gcache_lock *gl = &gcache_locks[ gh % GCACHE_LOCKS ];
+	gcache_ent *ge, **slot;
+
+	ge = ch_malloc( sizeof(gcache_ent) + gr_ndn->bv_len + op_ndn->bv_len + 1 );
+	ge->ge_be = op->o_bd;
+	ge->ge_oc = group_oc;
+	ge->ge_at = group_at;
+	ge->ge_time = op->o_time;
+	ge->ge_tincr = op->o_tincr;
+	ge->ge_res = res;
+	ge->ge_grlen = gr_ndn->bv_len;
+	ge->ge_oplen = op_ndn->bv_len;
+	memcpy( ge->ge_ndn, gr_ndn->bv_val, gr_ndn->bv_len + 1 );
+	memcpy( ge->ge_ndn + gr_ndn->bv_len + 1, op_ndn->bv_val,
+		op_ndn->bv_len + 1 );
+
+	ldap_pvt_thread_mutex_lock( &gl->gl_mutex );
+	if ( gcache_nslots && GCACHE_AFTER( op->o_time, op->o_tincr,
+		&gcache_stamps[ gh % GCACHE_STAMPS ] ) )
+	{
+		slot = gcache_slot( gh, mh );
+		if ( *slot )
+			ch_free( *slot );
+		*slot = ge;
+		ge = NULL;
+	}
+	ldap_pvt_thread_mutex_unlock( &gl->gl_mutex );
+
+	if ( ge )
+		ch_free( ge );
+}
+
+/* op is sending its result: forget what it may have changed */
+void
+backend_group_cache_write( Operation *op )
+{
+	gcache_stamp now;
+	unsigned int gh;
+
+	if ( !gcache_nslots )
+		return;
+
+	switch ( op->o_tag ) {
+	case LDAP_REQ_ADD:
+	case LDAP_REQ_DELETE:
+	case LDAP_REQ_MODIFY:
+		slap_op_time( &now.gs_time, &now.gs_tincr );
+		gh = gcache_hash( 2166136261U, &op->o_req_ndn );
+		ldap_pvt_thread_mutex_lock( &gcache_locks[ gh % GCACHE_LOCKS ].gl_mutex );
+		gcache_stamps[ gh % GCACHE_STAMPS ] = now;
+		ldap_pvt_thread_mutex_unlock( &gcache_locks[ gh % GCACHE_LOCKS ].gl_mutex );
+		break;
+
+	case LDAP_REQ_MODRDN:
+		backend_group_cache_flush();
+		break;
+	}
+}
+
+/* forget everything cached so far */
+void
+backend_group_cache_flush( void )
+{
+	gcache_stamp now;
+	int i;
+
+	if ( !gcache_nslots )
+		return;
+
+	slap_op_time( &now.gs_time, &now.gs_tincr );
+	for ( i = 0; i < GCACHE_LOCKS; i++ )
+		ldap_pvt_thread_mutex_lock( &gcache_locks[i].gl_mutex );
+	for ( i = 0; i < GCACHE_STAMPS; i++ )
+		gcache_stamps[i] = now;
+	for ( i = 0; i < GCACHE_LOCKS; i++ )
+		ldap_pvt_thread_mutex_unlock( &gcache_locks[i].gl_mutex );
+}
+
+void
+backend_group_cache_stats( unsigned long *hits, unsigned long *misses )
+{
+	int i;
+
+	*hits = *misses = 0;
+	for ( i = 0; i < GCACHE_LOCKS; i++ ) {
+		ldap_pvt_thread_mutex_lock( &gcache_locks[i].gl_mutex );
+		*hits += gcache_locks[i].gl_hits;
+		*misses += gcache_locks[i].gl_misses;
+		ldap_pvt_thread_mutex_unlock( &gcache_locks[i].gl_mutex );
+	}
+}
+
 int 
 fe_acl_group(
 	Operation *op,
@@ -1456,6 +1739,8 @@ fe_acl_group(
 	GroupAssertion *g;
 	Backend *be = op->o_bd;
 	OpExtra		*oex;
+	unsigned int gh = 0, mh = 0;
+	int gcache = 0;
 
 	LDAP_SLIST_FOREACH(oex, &op->o_extra, oe_next) {
 		if ( oex->oe_key == (void *)backend_group )
@@ -1489,10 +1774,22 @@ fe_acl_group(
 		rc = 0;
 
 	} else {
+		/* target may be a version of the group that is not committed */
+		if ( gcache_nslots && !op->o_do_not_cache ) {
+			if ( gcache_get( op, gr_ndn, op_ndn, group_oc, group_at,
+				&gh, &mh, &rc ) == 0 )
+				goto cache;
+			gcache = 1;
+		}
+
 		op->o_private = NULL;
 		rc = be_entry_get_rw( op, gr_ndn, group_oc, group_at, 0, &e );
 		e_priv = op->o_private;
 		op->o_private = o_priv;
+
+		if ( rc != LDAP_SUCCESS && rc != LDAP_NO_SUCH_OBJECT &&
+			rc != LDAP_NO_SUCH_ATTRIBUTE )
+			gcache = 0;
 	}
 
 	if ( e ) {
@@ -1512,6 +1809,7 @@ fe_acl_group(
 				void *user_priv = NULL;
 				Backend *b2 = op->o_bd;
 
+				gcache = 0;
 				if ( target && dn_match( &target->e_nname, op_ndn ) ) {
 					user = target;
 				}
@@ -1644,6 +1942,11 @@ loopit:
 		rc = LDAP_NO_SUCH_OBJECT;
 	}
 
+	if ( gcache ) {
+		gcache_put( op, gr_ndn, op_ndn, group_oc, group_at, gh, mh, rc );
+	}
+
+cache:
 	if ( op->o_tag != LDAP_REQ_BIND && !op->o_do_not_cache ) {
 		g = op->o_tmpalloc( sizeof( GroupAssertion ) + gr_ndn->bv_len,
 			op->o_tmpmemctx );
@@ -201,6 +201,7 @@ enum {
 	CFG_TLS_CACERT,
 	CFG_TLS_CERT,
 	CFG_TLS_KEY,
+	CFG_GROUPCACHE,
 
 	CFG_LAST
 };
@@ -397,6 +398,10 @@ static ConfigTable config_back_cf_table[] = {
 		"( OLcfgGlAt:17 NAME 'olcGentleHUP' "
 			"EQUALITY booleanMatch "
 			"SYNTAX OMsBoolean SINGLE-VALUE )", NULL, NULL },
+	{ "group-cache", "entries", 2, 2, 0, ARG_UINT|ARG_MAGIC|CFG_GROUPCACHE,
+		&config_generic, "( OLcfgGlAt:103 NAME 'olcGroupCache' "
+			"EQUALITY integerMatch "
+			"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "hidden", "on|off", 2, 2, 0, ARG_DB|ARG_ON_OFF|ARG_MAGIC|CFG_HIDDEN,
 		&config_generic, "( OLcfgDbAt:0.17 NAME 'olcHidden' "
 			"EQUALITY booleanMatch "
@@ -576,6 +581,14 @@ static ConfigTable config_back_cf_table[] = {
 		&config_restrict, "( OLcfgGlAt:48 NAME 'olcRestrict' "
 			"EQUALITY caseIgnoreMatch "
 			"SYNTAX OMsDirectoryString )", NULL, NULL },
+	{ "result-batch-delay", "msec", 2, 2, 0, ARG_UINT,
+		&slap_batch_delay, "( OLcfgGlAt:102 NAME 'olcResultBatchDelay' "
+			"EQUALITY integerMatch "
+			"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
+	{ "result-batch-size", "bytes", 2, 2, 0, ARG_UINT,
+		&slap_batch_size, "( OLcfgGlAt:101 NAME 'olcResultBatchSize' "
+			"EQUALITY integerMatch "
+			"SYNTAX OMsInteger SINGLE-VALUE )", NULL, NULL },
 	{ "reverse-lookup", "on|off", 2, 2, 0,
 #ifdef SLAPD_RLOOKUPS
 		ARG_ON_OFF, &use_reverse_lookup,
@@ -938,14 +951,15 @@ static ConfigOCs cf_ocs[] = {
 		 "olcAttributeOptions $ olcAuthIDRewrite $ "
 		 "olcAuthzPolicy $ olcAuthzRegexp $ olcConcurrency $ "
 		 "olcConnMaxPending $ olcConnMaxPendingAuth $ "
-		 "olcDisallows $ olcGentleHUP $ olcIdleTimeout $ "
+		 "olcDisallows $ olcGentleHUP $ olcGroupCache $ olcIdleTimeout $ "
 		 "olcIndexSubstrIfMaxLen $ olcIndexSubstrIfMinLen $ "
 		 "olcIndexSubstrAnyLen $ olcIndexSubstrAnyStep $ olcIndexHash64 $ "
 		 "olcIndexIntLen $ "
 		 "olcListenerThreads $ olcLocalSSF $ olcLogFile $ olcLogLevel $ "
 		 "olcPasswordCryptSaltFormat $ olcPasswordHash $ olcPidFile $ "
 		 "olcPluginLogFile $ olcReadOnly $ olcReferral $ "
-		 "olcReplogFile $ olcRequires $ olcRestrict $ olcReverseLookup $ "
+		 "olcReplogFile $ olcRequires $ olcRestrict $ "
+		 "olcResultBatchDelay $ olcResultBatchSize $ olcReverseLookup $ "
 		 "olcRootDSE $ "
 		 "olcSaslAuxprops $ olcSaslAuxpropsDontUseCopy $ olcSaslAuxpropsDontUseCopyIgnore $ "
 		 "olcSaslCBinding $ olcSaslHost $ olcSaslRealm $ olcSaslSecProps $ "
@@ -1073,6 +1087,9 @@ config_generic(ConfigArgs *c) {
 		case CFG_LTHREADS:
 			c->value_uint = slapd_daemon_threads;
 			break;
+		case CFG_GROUPCACHE:
+			c->value_uint = slap_group_cache_size;
+			break;
 		case CFG_SALT:
 			if ( passwd_salt )
 				c->value_string = ch_strdup( passwd_salt );
@@ -1429,6 +1446,11 @@ config_generic(ConfigArgs *c) {
 		case CFG_SYNC_SUBENTRY:
 			break;
 
+		case CFG_GROUPCACHE:
+			backend_group_cache_resize( 0 );
+			slap_group_cache_size = 0;
+			break;
+
 #ifdef LDAP_SLAPI
 		case CFG_PLUGIN:
 			slapi_int_unregister_plugins(c->be, c->valx);
@@ -1831,6 +1853,12 @@ config_generic(ConfigArgs *c) {
 			slap_tool_thread_max = c->value_int;	/* save for reference */
 			break;
 
+		case CFG_GROUPCACHE:
+			if ( slapMode & SLAP_SERVER_MODE )
+				backend_group_cache_resize( c->value_uint );
+			slap_group_cache_size = c->value_uint;
+			break;
+
 		case CFG_LTHREADS:
 			if ( c->value_uint < 1 ) {
 				snprintf( c->cr_msg, sizeof( c->cr_msg ),
@@ -1848,6 +1876,15 @@ config_generic(ConfigArgs *c) {
 				mask |= 1;
 			}
 			new_daemon_threads = mask+1;
+			if ( slapd_listener_shards &&
+				new_daemon_threads != slapd_daemon_threads ) {
+				snprintf( c->cr_msg, sizeof( c->cr_msg ),
+					"listenerthreads is fixed at %d by the listener-shards option",
+					slapd_daemon_threads );
+				Debug(LDAP_DEBUG_ANY, "%s: %s.\n",
+					c->log, c->cr_msg );
+				return 1;
+			}
 			config_push_cleanup( c, config_resize_lthreads );
 			}
 			break;
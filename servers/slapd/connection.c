@@ -56,6 +56,14 @@ static unsigned long conn_nextid = SLAPD_SYNC_SYNCCONN_OFFSET;
 
 static const char conn_lost_str[] = "connection lost";
 
+/* TCP readahead comes with the experimental io_uring event backend,
+ * other builds keep their sockbuf stack as it was. Defining
+ * SLAP_TCP_READAHEAD to a size enables it on its own.
+ */
+#if defined(SLAP_X_IOURING) && !defined(SLAP_TCP_READAHEAD)
+#define SLAP_TCP_READAHEAD	4096
+#endif
+
 const char *
 connection_state2str( int state )
 {
@@ -156,6 +164,8 @@ int connections_destroy(void)
 	for ( i = 0; i < dtblsize; i++ ) {
 		if( connections[i].c_struct_state != SLAP_C_UNINITIALIZED ) {
 			ber_sockbuf_free( connections[i].c_sb );
+			if ( connections[i].c_rbatch.bv_val )
+				ch_free( connections[i].c_rbatch.bv_val );
 			ldap_pvt_thread_mutex_destroy( &connections[i].c_mutex );
 			ldap_pvt_thread_mutex_destroy( &connections[i].c_write1_mutex );
 			ldap_pvt_thread_cond_destroy( &connections[i].c_write1_cv );
@@ -331,6 +341,9 @@ Connection * connection_init(
 	Connection *c;
 	int doinit = 0;
 	ber_socket_t sfd = SLAP_FD2SOCK(s);
+#ifdef SLAP_TCP_READAHEAD
+	int rdahead = SLAP_TCP_READAHEAD;
+#endif
 
 	assert( connections != NULL );
 
@@ -495,6 +508,15 @@ Connection * connection_init(
 #endif
 		ber_sockbuf_add_io( c->c_sb, &ber_sockbuf_io_tcp,
 			LBER_SBIOD_LEVEL_PROVIDER, (void *)&sfd );
+#ifdef SLAP_TCP_READAHEAD
+		/* Fetch the length and the body of a small PDU with a
+		 * single read. connection_read() keeps reading until the
+		 * socket would block, so nothing is left in the buffer
+		 * unnoticed.
+		 */
+		ber_sockbuf_add_io( c->c_sb, &ber_sockbuf_io_readahead,
+			LBER_SBIOD_LEVEL_PROVIDER, (void *)&rdahead );
+#endif
 	}
 
 #ifdef LDAP_DEBUG
@@ -659,6 +681,8 @@ connection_destroy( Connection *c )
 		c->c_currentber = NULL;
 	}
 
+	slap_batch_reset( c );
+
 
 #ifdef LDAP_SLAPI
 	/* call destructors, then constructors; avoids unnecessary allocation */
@@ -1328,7 +1352,7 @@ int connection_read_activate( ber_socket_t s )
 	 * thread reads data on it. Otherwise the listener thread will repeatedly
 	 * submit the same event on it to the pool.
 	 */
-	rc = slapd_clr_read( s, 0 );
+	rc = slapd_hold_read( s );
 	if ( rc )
 		return rc;
 
@@ -1442,6 +1466,9 @@ connection_read( ber_socket_t s, conn_readinfo *cri )
 		/* if success and data is ready, fall thru to data input loop */
 		if( !ber_sockbuf_ctrl( c->c_sb, LBER_SB_OPT_DATA_READY, NULL ) )
 		{
+			/* input may be left on the socket; rearm edge-triggered
+			 * sessions so that it is reported again */
+			slapd_clr_read( s, 0 );
 			slapd_set_read( s, 1 );
 			connection_return( c );
 			return 0;
@@ -1453,6 +1480,7 @@ connection_read( ber_socket_t s, conn_readinfo *cri )
 	if ( c->c_sasl_layers ) {
 		/* If previous layer is not removed yet, give up for now */
 		if ( !c->c_sasl_sockctx ) {
+			slapd_clr_read( s, 0 );
 			slapd_set_read( s, 1 );
 			connection_return( c );
 			return 0;
@@ -49,6 +49,11 @@
 # include <sys/types.h>
 # include <sys/event.h>
 # include <sys/time.h>
+#elif defined(SLAP_X_IOURING) && defined(__linux__)
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <linux/io_uring.h>
+# define SLAP_IOURING	1
 #elif defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL)
 # include <sys/epoll.h>
 #elif defined(SLAP_X_DEVPOLL) && defined(HAVE_SYS_DEVPOLL_H) && defined(HAVE_DEVPOLL)
@@ -96,7 +101,35 @@ static volatile sig_atomic_t listening = 1; /* 0 when slap_listeners closed */
 #define SLAPD_LISTEN_BACKLOG 2048
 #endif /* ! SLAPD_LISTEN_BACKLOG */
 
+#if !defined(HAVE_KQUEUE) && !defined(SLAP_IOURING) && \
+	defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL) && defined(SO_REUSEPORT)
+#define SLAP_LISTENER_SHARDS	1
+#endif
+
+#ifdef SLAP_LISTENER_SHARDS
+/* With sharded listeners every listener thread accepts on its own
+ * SO_REUSEPORT socket and keeps the sessions it accepted, so the
+ * owning thread of a descriptor is recorded here instead of being
+ * derived from the descriptor number.
+ */
+static unsigned char *sd_owner;	/* indexed by fd */
+#define SD_EDGE		0x80	/* edge-triggered descriptor */
+#define SD_TIDMASK	0x7f
+#define SLAPD_MAX_SHARDS	64
+
+#define	DAEMON_ID(fd)	(sd_owner ? (sd_owner[fd] & SD_TIDMASK) : \
+	(fd & slapd_daemon_mask))
+#ifdef LDAP_CONNECTIONLESS
+#define SLAP_LISTENER_EDGE(sl)	(sd_owner != NULL && !(sl)->sl_is_udp)
+#else
+#define SLAP_LISTENER_EDGE(sl)	(sd_owner != NULL)
+#endif
+#else
 #define	DAEMON_ID(fd)	(fd & slapd_daemon_mask)
+#define SLAP_LISTENER_EDGE(sl)	0
+#endif /* SLAP_LISTENER_SHARDS */
+
+int slapd_listener_shards;
 
 typedef ber_socket_t sdpair[2];
 
@@ -149,6 +182,37 @@ typedef struct slap_daemon_st {
 	}               sd_kqc[2];
 	int             sd_changeidx; /* index to current change buffer */
 	int             sd_kq;
+#elif defined(SLAP_IOURING)
+	/* eXperimental */
+	struct slap_ring_fd {
+		Listener	*rf_l;
+		unsigned	rf_gen;		/* tags the outstanding poll */
+		unsigned short	rf_armed;	/* poll mask submitted */
+		unsigned char	rf_modes;
+	}			*sd_rfds;	/* indexed by fd */
+	struct slap_ring_ev {
+		ber_socket_t	re_fd;
+		int		re_events;
+	}			*sd_revents;
+	ber_socket_t		*sd_fired;	/* polls completed by the last wait */
+	int			sd_nfired;
+	int			sd_ring;
+	unsigned		sd_sq_entries;
+	unsigned		sd_sq_mask;
+	unsigned		*sd_sq_head;
+	unsigned		*sd_sq_tail;
+	unsigned		*sd_sq_array;
+	struct io_uring_sqe	*sd_sqes;
+	unsigned		sd_cq_entries;
+	unsigned		sd_cq_mask;
+	unsigned		*sd_cq_head;
+	unsigned		*sd_cq_tail;
+	struct io_uring_cqe	*sd_cqes;
+	void			*sd_sq_map;
+	size_t			sd_sq_mapsz;
+	void			*sd_cq_map;
+	size_t			sd_cq_mapsz;
+	size_t			sd_sqes_mapsz;
 #elif defined(HAVE_EPOLL)
 
 	struct epoll_event	*sd_epolls;
@@ -181,7 +245,7 @@ static slap_daemon_st *slap_daemon;
  *   with file descriptors and events respectively
  *
  * - SLAP_<type>_* for private interface; type by now is one of
- *   EPOLL, DEVPOLL, SELECT, KQUEUE
+ *   EPOLL, DEVPOLL, SELECT, KQUEUE, IOURING
  *
  * private interface should not be used in the code.
  */
@@ -403,6 +467,399 @@ static slap_daemon_st *slap_daemon;
 
 /*-------------------------------------------------------------------------------*/
 
+#elif defined(SLAP_IOURING)
+/*************************************************************
+ * Use io_uring(7) - eXperimental
+ *
+ * Readiness is still what the event loop consumes, but it is
+ * obtained with one-shot poll requests on a submission ring.
+ * Interest changes are only queued by SLAP_SOCK_SET_*; they are
+ * handed to the kernel together with the wait in a single
+ * io_uring_enter(2), so a busy listener thread makes one system
+ * call per loop instead of one epoll_ctl(2) per change.
+ *
+ * Only the readiness polling uses the ring. Requests and results
+ * are still read and written through the sockbuf layers with
+ * recv(2) and send(2), one connection at a time; neither batched
+ * recv/send completions across connections nor registered buffers
+ * are implemented.
+ *************************************************************/
+# define SLAP_EVENT_FNAME		"io_uring"
+# define SLAP_EVENTS_ARE_INDEXED	0
+
+# define SLAP_IOURING_ENTRIES		1024
+
+# define SLAP_IOURING_SOCK_ACTIVE	0x01
+# define SLAP_IOURING_SOCK_READ		0x02
+# define SLAP_IOURING_SOCK_WRITE	0x04
+
+/* user_data of requests whose completion is of no interest */
+# define SLAP_IOURING_NOKEY		(~(__u64)0)
+# define SLAP_IOURING_KEY(s,gen)	(((__u64)(gen) << 32) | (__u32)(s))
+
+# define SLAP_IOURING_FD(t,s)		(slap_daemon[t].sd_rfds[(s)])
+
+static struct io_uring_sqe *
+slap_iouring_sqe( int t )
+{
+	slap_daemon_st *sd = &slap_daemon[t];
+	unsigned head, tail = *sd->sd_sq_tail;
+
+	head = __atomic_load_n( sd->sd_sq_head, __ATOMIC_ACQUIRE );
+	if ( tail - head >= sd->sd_sq_entries ) {
+		/* Ring is full, hand what we have to the kernel now */
+		syscall( __NR_io_uring_enter, sd->sd_ring, tail - head, 0, 0, NULL, 0 );
+		head = __atomic_load_n( sd->sd_sq_head, __ATOMIC_ACQUIRE );
+		if ( tail - head >= sd->sd_sq_entries ) {
+			Debug( LDAP_DEBUG_ANY,
+				"daemon: io_uring submission ring full, shutting down\n" );
+			slapd_shutdown = 2;
+			return NULL;
+		}
+	}
+	sd->sd_sq_array[tail & sd->sd_sq_mask] = tail & sd->sd_sq_mask;
+	return memset( &sd->sd_sqes[tail & sd->sd_sq_mask], 0,
+		sizeof(struct io_uring_sqe) );
+}
+
+static void
+slap_iouring_queue( int t, int op, ber_socket_t s, unsigned events, __u64 addr,
+	__u64 key )
+{
+	slap_daemon_st *sd = &slap_daemon[t];
+	struct io_uring_sqe *sqe = slap_iouring_sqe( t );
+
+	if ( sqe == NULL ) return;
+	sqe->opcode = op;
+	sqe->fd = s;
+	sqe->addr = addr;
+#if __BYTE_ORDER == __BIG_ENDIAN
+	events = ( events << 16 ) | ( events >> 16 );
+#endif
+	sqe->poll32_events = events;
+	sqe->user_data = key;
+	__atomic_store_n( sd->sd_sq_tail, *sd->sd_sq_tail + 1, __ATOMIC_RELEASE );
+}
+
+/* Make sure a poll covering every wanted event is outstanding.
+ * Clearing interest is lazy: a poll that is no longer wanted is
+ * left alone and its completion is filtered when it arrives.
+ */
+static void
+slap_iouring_arm( int t, ber_socket_t s )
+{
+	struct slap_ring_fd *rf = &SLAP_IOURING_FD(t,s);
+	unsigned want = 0;
+
+	if ( rf->rf_modes & SLAP_IOURING_SOCK_READ ) want |= POLLIN;
+	if ( rf->rf_modes & SLAP_IOURING_SOCK_WRITE ) want |= POLLOUT;
+	if ( !( want & ~rf->rf_armed )) return;
+
+	if ( rf->rf_armed ) {
+		slap_iouring_queue( t, IORING_OP_POLL_REMOVE, -1, 0,
+			SLAP_IOURING_KEY( s, rf->rf_gen ), SLAP_IOURING_NOKEY );
+		rf->rf_gen++;
+	}
+	slap_iouring_queue( t, IORING_OP_POLL_ADD, s, want, 0,
+		SLAP_IOURING_KEY( s, rf->rf_gen ));
+	rf->rf_armed = want;
+}
+
+static void
+slap_iouring_del( int t, ber_socket_t s )
+{
+	struct slap_ring_fd *rf = &SLAP_IOURING_FD(t,s);
+
+	if ( rf->rf_armed ) {
+		/* The poll holds a reference on the file, submit the removal
+		 * right away so the descriptor is really released on close.
+		 */
+		slap_iouring_queue( t, IORING_OP_POLL_REMOVE, -1, 0,
+			SLAP_IOURING_KEY( s, rf->rf_gen ), SLAP_IOURING_NOKEY );
+		syscall( __NR_io_uring_enter, slap_daemon[t].sd_ring,
+			slap_daemon[t].sd_sq_entries, 0, 0, NULL, 0 );
+	}
+	rf->rf_gen++;
+	rf->rf_armed = 0;
+	rf->rf_modes = 0;
+	rf->rf_l = NULL;
+}
+
+static int
+slap_iouring_setup( int t )
+{
+	slap_daemon_st *sd = &slap_daemon[t];
+	struct io_uring_params p;
+	char *sq, *cq;
+
+	memset( &p, 0, sizeof(p) );
+	sd->sd_ring = syscall( __NR_io_uring_setup, SLAP_IOURING_ENTRIES, &p );
+	if ( sd->sd_ring < 0 ) {
+		Debug( LDAP_DEBUG_ANY,
+			"daemon: io_uring_setup() failed, errno=%d\n", errno );
+		return -1;
+	}
+	/* The wait timeout is passed with the enter call */
+	if ( !( p.features & IORING_FEAT_EXT_ARG )) {
+		Debug( LDAP_DEBUG_ANY,
+			"daemon: io_uring lacks IORING_FEAT_EXT_ARG\n" );
+		close( sd->sd_ring );
+		sd->sd_ring = -1;
+		return -1;
+	}
+
+	sd->sd_sq_mapsz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	sd->sd_cq_mapsz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	sd->sd_sqes_mapsz = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	sd->sd_sq_map = mmap( NULL, sd->sd_sq_mapsz, PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_POPULATE, sd->sd_ring, IORING_OFF_SQ_RING );
+	sd->sd_cq_map = mmap( NULL, sd->sd_cq_mapsz, PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_POPULATE, sd->sd_ring, IORING_OFF_CQ_RING );
+	sd->sd_sqes = mmap( NULL, sd->sd_sqes_mapsz, PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_POPULATE, sd->sd_ring, IORING_OFF_SQES );
+	if ( sd->sd_sq_map == MAP_FAILED || sd->sd_cq_map == MAP_FAILED ||
+		sd->sd_sqes == MAP_FAILED )
+	{
+		Debug( LDAP_DEBUG_ANY,
+			"daemon: io_uring mmap() failed, errno=%d\n", errno );
+		return -1;
+	}
+
+	sq = sd->sd_sq_map;
+	sd->sd_sq_entries = p.sq_entries;
+	sd->sd_sq_mask = *(unsigned *)(sq + p.sq_off.ring_mask);
+	sd->sd_sq_head = (unsigned *)(sq + p.sq_off.head);
+	sd->sd_sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	sd->sd_sq_array = (unsigned *)(sq + p.sq_off.array);
+
+	cq = sd->sd_cq_map;
+	sd->sd_cq_entries = p.cq_entries;
+	sd->sd_cq_mask = *(unsigned *)(cq + p.cq_off.ring_mask);
+	sd->sd_cq_head = (unsigned *)(cq + p.cq_off.head);
+	sd->sd_cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	sd->sd_cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	return 0;
+}
+
+static void
+slap_iouring_close( int t )
+{
+	slap_daemon_st *sd = &slap_daemon[t];
+
+	if ( sd->sd_sqes && sd->sd_sqes != MAP_FAILED )
+		munmap( sd->sd_sqes, sd->sd_sqes_mapsz );
+	if ( sd->sd_cq_map && sd->sd_cq_map != MAP_FAILED )
+		munmap( sd->sd_cq_map, sd->sd_cq_mapsz );
+	if ( sd->sd_sq_map && sd->sd_sq_map != MAP_FAILED )
+		munmap( sd->sd_sq_map, sd->sd_sq_mapsz );
+	sd->sd_sqes = NULL;
+	sd->sd_cq_map = NULL;
+	sd->sd_sq_map = NULL;
+	if ( sd->sd_ring >= 0 ) {
+		close( sd->sd_ring );
+		sd->sd_ring = -1;
+	}
+}
+
+static void
+slap_iouring_init( int t )
+{
+	slap_daemon_st *sd = &slap_daemon[t];
+
+	sd->sd_nfds = 0;
+	sd->sd_nfired = 0;
+	sd->sd_rfds = ch_calloc( dtblsize, sizeof(struct slap_ring_fd) );
+	if ( slap_iouring_setup( t ) < 0 ) {
+		slap_iouring_close( t );
+		slapd_shutdown = 2;
+		return;
+	}
+	sd->sd_revents = ch_malloc( sd->sd_cq_entries * sizeof(struct slap_ring_ev) );
+	sd->sd_fired = ch_malloc( sd->sd_cq_entries * sizeof(ber_socket_t) );
+}
+
+/* A ring set up before a fork can't be used in the child process.
+ * Set up a new one and submit again the polls of the descriptors
+ * that were already added.
+ */
+static void
+slap_iouring_init2( void )
+{
+	ber_socket_t s;
+
+	slap_iouring_close( 0 );
+	if ( slap_iouring_setup( 0 ) < 0 ) {
+		slap_iouring_close( 0 );
+		slapd_shutdown = 2;
+		return;
+	}
+	for ( s = 0; s < dtblsize; s++ ) {
+		struct slap_ring_fd *rf = &SLAP_IOURING_FD(0,s);
+		if ( !rf->rf_modes ) continue;
+		rf->rf_gen++;
+		rf->rf_armed = 0;
+		slap_iouring_arm( 0, s );
+	}
+}
+
+static void
+slap_iouring_destroy( int t )
+{
+	slap_daemon_st *sd = &slap_daemon[t];
+
+	slap_iouring_close( t );
+	if ( sd->sd_rfds ) {
+		ch_free( sd->sd_rfds );
+		sd->sd_rfds = NULL;
+	}
+	if ( sd->sd_revents ) {
+		ch_free( sd->sd_revents );
+		sd->sd_revents = NULL;
+	}
+	if ( sd->sd_fired ) {
+		ch_free( sd->sd_fired );
+		sd->sd_fired = NULL;
+	}
+	sd->sd_nfds = 0;
+}
+
+static int
+slap_iouring_wait( int t, struct timeval *tvp )
+{
+	slap_daemon_st *sd = &slap_daemon[t];
+	struct io_uring_getevents_arg arg;
+	struct __kernel_timespec ts;
+	unsigned head, tail;
+	int i, rc, err = 0, n = 0;
+
+	ldap_pvt_thread_mutex_lock( &sd->sd_mutex );
+	/* Polls are one-shot: rearm what completed last time and is
+	 * still wanted, which gives the same level-triggered behaviour
+	 * as the other mechanisms.
+	 */
+	for ( i = 0; i < sd->sd_nfired; i++ ) {
+		if ( SLAP_IOURING_FD(t, sd->sd_fired[i]).rf_modes )
+			slap_iouring_arm( t, sd->sd_fired[i] );
+	}
+	sd->sd_nfired = 0;
+	ldap_pvt_thread_mutex_unlock( &sd->sd_mutex );
+
+	memset( &arg, 0, sizeof(arg) );
+	if ( tvp ) {
+		ts.tv_sec = tvp->tv_sec;
+		ts.tv_nsec = tvp->tv_usec * 1000;
+		arg.ts = (__u64)(uintptr_t)&ts;
+	}
+	rc = syscall( __NR_io_uring_enter, sd->sd_ring, sd->sd_sq_entries, 1,
+		IORING_ENTER_GETEVENTS|IORING_ENTER_EXT_ARG, &arg, sizeof(arg) );
+	if ( rc < 0 && errno != ETIME )
+		err = errno;
+
+	ldap_pvt_thread_mutex_lock( &sd->sd_mutex );
+	head = *sd->sd_cq_head;
+	tail = __atomic_load_n( sd->sd_cq_tail, __ATOMIC_ACQUIRE );
+	for ( ; head != tail; head++ ) {
+		struct io_uring_cqe *cqe = &sd->sd_cqes[head & sd->sd_cq_mask];
+		struct slap_ring_fd *rf;
+		ber_socket_t s;
+		int ev;
+
+		if ( cqe->user_data == SLAP_IOURING_NOKEY ) continue;
+		s = (ber_socket_t)(__u32)cqe->user_data;
+		rf = &SLAP_IOURING_FD(t,s);
+		/* removed, or superseded by a poll with another mask */
+		if ( rf->rf_gen != (unsigned)( cqe->user_data >> 32 )) continue;
+
+		rf->rf_armed = 0;
+		sd->sd_fired[sd->sd_nfired++] = s;
+
+		ev = cqe->res < 0 ? POLLERR : cqe->res;
+		/* Let the reader find out about errors and hangups */
+		if ( ev & ( POLLERR|POLLHUP )) ev |= POLLIN;
+		if ( !( rf->rf_modes & SLAP_IOURING_SOCK_READ )) ev &= ~POLLIN;
+		if ( !( rf->rf_modes & SLAP_IOURING_SOCK_WRITE )) ev &= ~POLLOUT;
+		ev &= POLLIN|POLLOUT;
+		if ( ev ) {
+			sd->sd_revents[n].re_fd = s;
+			sd->sd_revents[n].re_events = ev;
+			n++;
+		}
+	}
+	__atomic_store_n( sd->sd_cq_head, head, __ATOMIC_RELEASE );
+	ldap_pvt_thread_mutex_unlock( &sd->sd_mutex );
+
+	if ( !n && err ) {
+		errno = err;
+		return -1;
+	}
+	return n;
+}
+
+# define SLAP_SOCK_IS_ACTIVE(t,s)	(SLAP_IOURING_FD(t,s).rf_modes != 0)
+# define SLAP_SOCK_NOT_ACTIVE(t,s)	(SLAP_IOURING_FD(t,s).rf_modes == 0)
+# define SLAP_SOCK_IS_READ(t,s) \
+	(SLAP_IOURING_FD(t,s).rf_modes & SLAP_IOURING_SOCK_READ)
+# define SLAP_SOCK_IS_WRITE(t,s) \
+	(SLAP_IOURING_FD(t,s).rf_modes & SLAP_IOURING_SOCK_WRITE)
+
+# define SLAP_IOURING_SOCK_SET(t,s,mode)	do { \
+	SLAP_IOURING_FD(t,s).rf_modes |= (mode); \
+	slap_iouring_arm( t, (s) ); \
+} while (0)
+
+# define SLAP_IOURING_SOCK_CLR(t,s,mode)	do { \
+	SLAP_IOURING_FD(t,s).rf_modes &= ~(mode); \
+} while (0)
+
+# define SLAP_SOCK_SET_READ(t,s)	SLAP_IOURING_SOCK_SET(t,(s), SLAP_IOURING_SOCK_READ)
+# define SLAP_SOCK_SET_WRITE(t,s)	SLAP_IOURING_SOCK_SET(t,(s), SLAP_IOURING_SOCK_WRITE)
+# define SLAP_SOCK_CLR_READ(t,s)	SLAP_IOURING_SOCK_CLR(t,(s), SLAP_IOURING_SOCK_READ)
+# define SLAP_SOCK_CLR_WRITE(t,s)	SLAP_IOURING_SOCK_CLR(t,(s), SLAP_IOURING_SOCK_WRITE)
+
+# define SLAP_SOCK_ADD(t, s, l)		do { \
+	assert( (s) < dtblsize ); \
+	SLAP_IOURING_FD(t,s).rf_l = (l); \
+	SLAP_IOURING_FD(t,s).rf_armed = 0; \
+	SLAP_IOURING_FD(t,s).rf_modes = \
+		SLAP_IOURING_SOCK_ACTIVE | SLAP_IOURING_SOCK_READ; \
+	slap_iouring_arm( t, (s) ); \
+	slap_daemon[t].sd_nfds++; \
+} while (0)
+
+# define SLAP_SOCK_DEL(t, s)		do { \
+	slap_iouring_del( t, (s) ); \
+	slap_daemon[t].sd_nfds--; \
+} while (0)
+
+# define SLAP_EVENT_MAX(t)		slap_daemon[t].sd_nfds
+
+# define SLAP_IOURING_EVENT_CLR(i, mode)	(revents[(i)].re_events &= ~(mode))
+# define SLAP_IOURING_EVENT_CHK(i, mode)	(revents[(i)].re_events & (mode))
+
+# define SLAP_EVENT_CLR_READ(i)		SLAP_IOURING_EVENT_CLR((i), POLLIN)
+# define SLAP_EVENT_CLR_WRITE(i)	SLAP_IOURING_EVENT_CLR((i), POLLOUT)
+# define SLAP_EVENT_IS_READ(i)		SLAP_IOURING_EVENT_CHK((i), POLLIN)
+# define SLAP_EVENT_IS_WRITE(i)		SLAP_IOURING_EVENT_CHK((i), POLLOUT)
+
+# define SLAP_EVENT_FD(t,i)		(revents[(i)].re_fd)
+# define SLAP_EVENT_LISTENER(t,i)	(SLAP_IOURING_FD(t, SLAP_EVENT_FD(t,i)).rf_l)
+# define SLAP_EVENT_IS_LISTENER(t,i)	(SLAP_EVENT_LISTENER(t,i) != NULL)
+
+# define SLAP_SOCK_INIT(t)		slap_iouring_init(t)
+# define SLAP_SOCK_INIT2()		slap_iouring_init2()
+# define SLAP_SOCK_DESTROY(t)		slap_iouring_destroy(t)
+
+# define SLAP_EVENT_DECL		struct slap_ring_ev *revents
+
+# define SLAP_EVENT_INIT(t)		do { \
+	revents = slap_daemon[t].sd_revents; \
+} while (0)
+
+# define SLAP_EVENT_WAIT(t, tvp, nsp)	do { \
+	*(nsp) = slap_iouring_wait( t, (tvp) ); \
+} while (0)
+
 #elif defined(HAVE_EPOLL)
 /***************************************
  * Use epoll infrastructure - epoll(4) *
@@ -457,11 +914,14 @@ static slap_daemon_st *slap_daemon;
  * index array. If we can't do this add, the system is out of
  * resources and we need to shutdown.
  */
-# define SLAP_SOCK_ADD(t, s, l)		do { \
+# define SLAP_SOCK_ADD(t, s, l)		SLAP_EPOLL_SOCK_ADD(t, s, l, EPOLLIN)
+# define SLAP_SOCK_ADD_EDGE(t, s, l)	SLAP_EPOLL_SOCK_ADD(t, s, l, EPOLLIN|EPOLLET)
+
+# define SLAP_EPOLL_SOCK_ADD(t, s, l, ev)	do { \
 	int rc; \
 	SLAP_EPOLL_SOCK_IX(t,(s)) = slap_daemon[t].sd_nfds; \
 	SLAP_EPOLL_SOCK_EP(t,(s)).data.ptr = (l) ? (l) : (void *)(&SLAP_EPOLL_SOCK_IX(t,s)); \
-	SLAP_EPOLL_SOCK_EV(t,(s)) = EPOLLIN; \
+	SLAP_EPOLL_SOCK_EV(t,(s)) = (ev); \
 	rc = epoll_ctl(slap_daemon[t].sd_epfd, EPOLL_CTL_ADD, \
 		(s), &SLAP_EPOLL_SOCK_EP(t,(s))); \
 	if ( rc == 0 ) { \
@@ -1145,6 +1605,11 @@ slapd_add( ber_socket_t s, int isactive, Listener *sl, int id )
 
 	if ( isactive ) slap_daemon[id].sd_nactives++;
 
+#ifdef SLAP_LISTENER_SHARDS
+	if ( sd_owner && ( sd_owner[s] & SD_EDGE ))
+		SLAP_SOCK_ADD_EDGE(id, s, sl);
+	else
+#endif
 	SLAP_SOCK_ADD(id, s, sl);
 
 	Debug( LDAP_DEBUG_CONNS, "daemon: added %ldr%s listener=%p\n",
@@ -1208,6 +1673,17 @@ slapd_remove(
 			if ( lr->sl_mute ) {
 				lr->sl_mute = 0;
 				emfile--;
+#ifdef SLAP_LISTENER_SHARDS
+				/* An edge-triggered listener was disarmed when it
+				 * was muted; rearming it reports the backlog again.
+				 */
+				if ( SLAP_LISTENER_EDGE( lr )) {
+					if ( lr->sl_tid == id )
+						SLAP_SOCK_SET_READ( id, lr->sl_sd );
+					else
+						WAKE_LISTENER(lr->sl_tid, 1);
+				} else
+#endif
 				if ( DAEMON_ID(lr->sl_sd) != id )
 					WAKE_LISTENER(DAEMON_ID(lr->sl_sd), wake);
 				break;
@@ -1274,6 +1750,30 @@ slapd_clr_read( ber_socket_t s, int wake )
 	return rc;
 }
 
+/*
+ * Called before a thread is sent to read from a session. Reading is
+ * normally suspended until slapd_set_read(), so the same input is not
+ * reported again meanwhile. Sessions on sharded listeners are
+ * edge-triggered and stay armed: an edge only comes with new input,
+ * and connection_read() drains the socket.
+ */
+int
+slapd_hold_read( ber_socket_t s )
+{
+#ifdef SLAP_LISTENER_SHARDS
+	if ( sd_owner && ( sd_owner[s] & SD_EDGE )) {
+		int rc = 1;
+		int id = DAEMON_ID(s);
+		ldap_pvt_thread_mutex_lock( &slap_daemon[id].sd_mutex );
+		if ( SLAP_SOCK_IS_ACTIVE( id, s ))
+			rc = 0;
+		ldap_pvt_thread_mutex_unlock( &slap_daemon[id].sd_mutex );
+		return rc;
+	}
+#endif
+	return slapd_clr_read( s, 0 );
+}
+
 void
 slapd_set_read( ber_socket_t s, int wake )
 {
@@ -1549,6 +2049,81 @@ errexit:
 	return -1;
 }
 
+#ifdef SLAP_LISTENER_SHARDS
+/* Give every other listener thread its own accept socket on the
+ * address of li, so the kernel spreads incoming connections over
+ * the threads. If a socket can't be set up, the address is left
+ * to the threads that already have one.
+ */
+static void
+slap_open_shards(
+	Listener *li,
+	struct sockaddr *sa,
+	int addrlen,
+	int *listeners,
+	int *cur )
+{
+	Listener *ls;
+	ber_socket_t s;
+	int t, tmp, rc;
+	char ebuf[128];
+
+	for ( t = 1; t < slapd_daemon_threads; t++ ) {
+		s = socket( sa->sa_family, SOCK_STREAM, 0 );
+		if ( s == AC_SOCKET_INVALID ) {
+			int err = sock_errno();
+			Debug( LDAP_DEBUG_ANY,
+				"daemon: shard socket() failed errno=%d (%s)\n",
+				err, sock_errstr(err, ebuf, sizeof(ebuf)) );
+			return;
+		}
+		if ( SLAP_SOCKNEW( s ) >= dtblsize ) {
+			Debug( LDAP_DEBUG_ANY,
+				"daemon: listener descriptor %ld is too great %ld\n",
+				(long) SLAP_SOCKNEW( s ), (long) dtblsize );
+			tcp_close( s );
+			return;
+		}
+
+		tmp = 1;
+		(void) setsockopt( s, SOL_SOCKET, SO_REUSEADDR,
+			(char *) &tmp, sizeof(tmp) );
+#if defined(LDAP_PF_INET6) && defined(IPV6_V6ONLY)
+		if ( sa->sa_family == AF_INET6 ) {
+			(void) setsockopt( s, IPPROTO_IPV6, IPV6_V6ONLY,
+				(char *) &tmp, sizeof(tmp) );
+		}
+#endif /* LDAP_PF_INET6 && IPV6_V6ONLY */
+		rc = setsockopt( s, SOL_SOCKET, SO_REUSEPORT,
+			(char *) &tmp, sizeof(tmp) );
+		if ( rc == 0 )
+			rc = bind( s, sa, addrlen );
+		if ( rc ) {
+			int err = sock_errno();
+			Debug( LDAP_DEBUG_ANY,
+				"daemon: shard %d of %s failed errno=%d (%s)\n",
+				t, li->sl_url.bv_val, err,
+				sock_errstr(err, ebuf, sizeof(ebuf)) );
+			tcp_close( s );
+			return;
+		}
+
+		ls = ch_malloc( sizeof( Listener ));
+		*ls = *li;
+		ls->sl_sd = SLAP_SOCKNEW( s );
+		ls->sl_tid = t;
+		ber_dupbv( &ls->sl_url, &li->sl_url );
+		ber_dupbv( &ls->sl_name, &li->sl_name );
+		sd_owner[ls->sl_sd] = t | SD_EDGE;
+
+		(*listeners)++;
+		slap_listeners = ch_realloc( slap_listeners,
+			(*listeners + 1) * sizeof(Listener *) );
+		slap_listeners[(*cur)++] = ls;
+	}
+}
+#endif /* SLAP_LISTENER_SHARDS */
+
 static int
 slap_open_listener(
 	const char* url,
@@ -1585,6 +2160,7 @@ slap_open_listener(
 	l.sl_url.bv_val = NULL;
 	l.sl_mute = 0;
 	l.sl_busy = 0;
+	l.sl_tid = 0;
 
 #ifndef HAVE_TLS
 	if( ldap_pvt_url_scheme2tls( lud->lud_scheme ) ) {
@@ -1728,6 +2304,19 @@ slap_open_listener(
 					(long) l.sl_sd, err, sock_errstr(err, ebuf, sizeof(ebuf)) );
 			}
 #endif /* SO_REUSEADDR */
+#ifdef SLAP_LISTENER_SHARDS
+			if ( sd_owner && socktype == SOCK_STREAM ) {
+				tmp = 1;
+				rc = setsockopt( s, SOL_SOCKET, SO_REUSEPORT,
+					(char *) &tmp, sizeof(tmp) );
+				if ( rc == AC_SOCKET_ERROR ) {
+					int err = sock_errno();
+					Debug( LDAP_DEBUG_ANY, "slapd(%ld): "
+						"setsockopt(SO_REUSEPORT) failed errno=%d (%s)\n",
+						(long) l.sl_sd, err, sock_errstr(err, ebuf, sizeof(ebuf)) );
+				}
+			}
+#endif /* SLAP_LISTENER_SHARDS */
 		}
 
 		switch( (*sal)->sa_family ) {
@@ -1855,6 +2444,15 @@ slap_open_listener(
 		*li = l;
 		slap_listeners[*cur] = li;
 		(*cur)++;
+#ifdef SLAP_LISTENER_SHARDS
+		if ( sd_owner && socktype == SOCK_STREAM ) {
+			sd_owner[li->sl_sd] = SD_EDGE;
+#ifdef LDAP_PF_LOCAL
+			if ( (*sal)->sa_family != AF_LOCAL )
+#endif /* LDAP_PF_LOCAL */
+				slap_open_shards( li, *sal, addrlen, listeners, cur );
+		}
+#endif /* SLAP_LISTENER_SHARDS */
 		sal++;
 	}
 
@@ -1912,6 +2510,11 @@ slapd_daemon_init( const char *urls )
 
 	SETUP_CLOSE();
 
+#ifdef SLAP_LISTENER_SHARDS
+	if ( slapd_listener_shards )
+		sd_owner = ch_calloc( dtblsize, sizeof( *sd_owner ));
+#endif /* SLAP_LISTENER_SHARDS */
+
 	/* open a pipe (or something equivalent connected to itself).
 	 * we write a byte on this fd whenever we catch a signal. The main
 	 * loop will be select'ing on this socket, and will wake up when
@@ -2055,6 +2658,12 @@ slapd_daemon_destroy( void )
 			SLAP_SOCK_DESTROY(i);
 		}
 		daemon_inited = 0;
+#ifdef SLAP_LISTENER_SHARDS
+		if ( sd_owner ) {
+			ch_free( sd_owner );
+			sd_owner = NULL;
+		}
+#endif /* SLAP_LISTENER_SHARDS */
 		ldap_pvt_thread_mutex_destroy( &emfile_mutex );
 #ifdef HAVE_TCPD
 		ldap_pvt_thread_mutex_destroy( &sd_tcpd_mutex );
@@ -2250,14 +2859,24 @@ slap_listener(
 		"daemon: accept() = %d\n", s );
 
 	/* Resume the listener FD to allow concurrent-processing of
-	 * additional incoming connections.
+	 * additional incoming connections. Edge-triggered listeners
+	 * are never suspended, slap_listener_thread() drains them.
 	 */
-	sl->sl_busy = 0;
-	WAKE_LISTENER(DAEMON_ID(sl->sl_sd),1);
+	if ( !SLAP_LISTENER_EDGE( sl )) {
+		sl->sl_busy = 0;
+		WAKE_LISTENER(DAEMON_ID(sl->sl_sd),1);
+	}
 
 	if ( s == AC_SOCKET_INVALID ) {
 		int err = sock_errno();
 
+#ifdef SLAP_LISTENER_SHARDS
+		/* the backlog is empty */
+		if ( SLAP_LISTENER_EDGE( sl ) &&
+			( err == EWOULDBLOCK || err == EAGAIN ))
+			return -1;
+#endif /* SLAP_LISTENER_SHARDS */
+
 		if(
 #ifdef EMFILE
 		    err == EMFILE ||
@@ -2267,17 +2886,39 @@ slap_listener(
 #endif /* ENFILE */
 		    0 )
 		{
+#ifdef SLAP_LISTENER_SHARDS
+			if ( SLAP_LISTENER_EDGE( sl ))
+				ldap_pvt_thread_mutex_lock( &slap_daemon[sl->sl_tid].sd_mutex );
+#endif /* SLAP_LISTENER_SHARDS */
 			ldap_pvt_thread_mutex_lock( &emfile_mutex );
 			emfile++;
 			/* Stop listening until an existing session closes */
 			sl->sl_mute = 1;
+#ifdef SLAP_LISTENER_SHARDS
+			/* Disarm it here, so that unmuting always rearms it */
+			if ( SLAP_LISTENER_EDGE( sl )) {
+				if ( sl->sl_sd != AC_SOCKET_INVALID &&
+					SLAP_SOCK_IS_ACTIVE( sl->sl_tid, sl->sl_sd ))
+					SLAP_SOCK_CLR_READ( sl->sl_tid, sl->sl_sd );
+			}
+#endif /* SLAP_LISTENER_SHARDS */
 			ldap_pvt_thread_mutex_unlock( &emfile_mutex );
+#ifdef SLAP_LISTENER_SHARDS
+			if ( SLAP_LISTENER_EDGE( sl ))
+				ldap_pvt_thread_mutex_unlock( &slap_daemon[sl->sl_tid].sd_mutex );
+#endif /* SLAP_LISTENER_SHARDS */
 		}
 
 		Debug( LDAP_DEBUG_ANY,
 			"daemon: accept(%ld) failed errno=%d (%s)\n",
 			(long) sl->sl_sd, err, sock_errstr(err, ebuf, sizeof(ebuf)) );
 		ldap_pvt_thread_yield();
+#ifdef SLAP_LISTENER_SHARDS
+		/* keep draining only past errors of a single connection */
+		if ( SLAP_LISTENER_EDGE( sl ) &&
+			err != ECONNABORTED && err != EINTR )
+			return -1;
+#endif /* SLAP_LISTENER_SHARDS */
 		return 0;
 	}
 	sfd = SLAP_SOCKNEW( s );
@@ -2292,6 +2933,11 @@ slap_listener(
 		ldap_pvt_thread_yield();
 		return 0;
 	}
+#ifdef SLAP_LISTENER_SHARDS
+	/* the session stays with the thread that accepted it */
+	if ( SLAP_LISTENER_EDGE( sl ))
+		sd_owner[sfd] = sl->sl_tid | SD_EDGE;
+#endif /* SLAP_LISTENER_SHARDS */
 	tid = DAEMON_ID(sfd);
 
 #ifdef LDAP_DEBUG
@@ -2467,6 +3113,25 @@ slap_listener_thread(
 	int		rc;
 	Listener	*sl = (Listener *)ptr;
 
+#ifdef SLAP_LISTENER_SHARDS
+	if ( SLAP_LISTENER_EDGE( sl )) {
+		/* No further edge comes for connections already queued,
+		 * so accept until the backlog is empty. Go around again
+		 * if the daemon saw another edge meanwhile.
+		 */
+		do {
+			while ( listening && !slapd_shutdown && !sl->sl_mute &&
+				sl->sl_sd != AC_SOCKET_INVALID &&
+				slap_listener( sl ) == 0 )
+				/* empty */;
+			ldap_pvt_thread_mutex_lock( &slap_daemon[sl->sl_tid].sd_mutex );
+			rc = --sl->sl_busy;
+			ldap_pvt_thread_mutex_unlock( &slap_daemon[sl->sl_tid].sd_mutex );
+		} while ( rc );
+		return (void*)NULL;
+	}
+#endif /* SLAP_LISTENER_SHARDS */
+
 	rc = slap_listener( sl );
 
 	if( rc != LDAP_SUCCESS ) {
@@ -2487,6 +3152,19 @@ slap_listener_activate(
 	Debug( LDAP_DEBUG_TRACE, "slap_listener_activate(%d): %s\n",
 		sl->sl_sd, sl->sl_busy ? "busy" : "" );
 
+#ifdef SLAP_LISTENER_SHARDS
+	/* An edge-triggered listener stays armed while its accept task
+	 * runs; an edge seen meanwhile just sends the task around again.
+	 */
+	if ( SLAP_LISTENER_EDGE( sl )) {
+		ldap_pvt_thread_mutex_lock( &slap_daemon[sl->sl_tid].sd_mutex );
+		rc = sl->sl_busy;
+		sl->sl_busy = rc ? 2 : 1;
+		ldap_pvt_thread_mutex_unlock( &slap_daemon[sl->sl_tid].sd_mutex );
+		if ( rc )
+			return 0;
+	} else
+#endif /* SLAP_LISTENER_SHARDS */
 	sl->sl_busy = 1;
 
 	rc = ldap_pvt_thread_pool_submit( &connection_pool,
@@ -2813,7 +3491,7 @@ loop:
 			if ( DAEMON_ID( lr->sl_sd ) != tid ) continue;
 			if ( !SLAP_SOCK_IS_ACTIVE( tid, lr->sl_sd )) continue;
 
-			if ( lr->sl_mute || lr->sl_busy )
+			if ( lr->sl_mute || ( lr->sl_busy && !SLAP_LISTENER_EDGE( lr )))
 			{
 				SLAP_SOCK_CLR_READ( tid, lr->sl_sd );
 			} else {
@@ -2874,6 +3552,17 @@ loop:
 					tvp = &tv;
 				}
 			}
+
+			/* result batches waiting too long */
+			{
+				int msec = slap_batch_tick();
+				if ( msec >= 0 && ( tvp == NULL ||
+					tv.tv_sec * 1000 + tv.tv_usec / 1000 > msec )) {
+					tv.tv_sec = msec / 1000;
+					tv.tv_usec = ( msec % 1000 ) * 1000;
+					tvp = &tv;
+				}
+			}
 		}
 
 		for ( l = 0; slap_listeners[l] != NULL; l++ ) {
@@ -3179,7 +3868,7 @@ loop:
 					SLAP_EVENT_CLR_READ( i );
 					connection_read_activate( fd );
 				} else if ( !w ) {
-#ifdef HAVE_EPOLL
+#if defined(HAVE_EPOLL) && !defined(SLAP_IOURING)
 					/* Don't keep reporting the hangup
 					 */
 					if ( SLAP_SOCK_IS_ACTIVE( tid, fd )) {
@@ -3265,6 +3954,34 @@ slapd_daemon_tid_cleanup(
 	return NULL;
 }
 
+/*
+ * Spread the listeners over n listener threads, each with its own
+ * accept sockets and edge-triggered event set. This must be set up
+ * before slapd_daemon_init(), since the sockets are opened there.
+ */
+int
+slapd_daemon_shards( int n )
+{
+#ifdef SLAP_LISTENER_SHARDS
+	int mask = 0;
+
+	if ( n > SLAPD_MAX_SHARDS )
+		n = SLAPD_MAX_SHARDS;
+	/* use a power of two, as for listener-threads */
+	while ( n > 1 ) {
+		n >>= 1;
+		mask <<= 1;
+		mask |= 1;
+	}
+	slapd_daemon_threads = mask + 1;
+	slapd_daemon_mask = mask;
+	slapd_listener_shards = 1;
+	return 0;
+#else
+	return -1;
+#endif /* SLAP_LISTENER_SHARDS */
+}
+
 int
 slapd_daemon_resize( int newnum )
 {
@@ -3401,6 +4118,10 @@ slapd_daemon( void )
 			return rc;
 		}
 		ber_pvt_socket_set_nonblock( wake_sds[i][1], 1 );
+#ifdef SLAP_LISTENER_SHARDS
+		if ( sd_owner )
+			sd_owner[wake_sds[i][0]] = i;
+#endif /* SLAP_LISTENER_SHARDS */
 
 		SLAP_SOCK_INIT(i);
 	}
@@ -3582,6 +4303,11 @@ slapd_add_internal( ber_socket_t s, int isactive )
 {
 	if (!isactive) {
 		SET_CLOSE(s);
+#ifdef SLAP_LISTENER_SHARDS
+		/* outbound sessions are not sharded */
+		if ( sd_owner )
+			sd_owner[s] = s & slapd_daemon_mask;
+#endif /* SLAP_LISTENER_SHARDS */
 	}
 	slapd_add( s, isactive, NULL, -1 );
 }
@@ -30,6 +30,7 @@ static slap_verbmasks idxstr[] = {
 	{ BER_BVC("subany"), SLAP_INDEX_SUBSTR_ANY },
 	{ BER_BVC("subfinal"), SLAP_INDEX_SUBSTR_FINAL },
 	{ BER_BVC("sub"), SLAP_INDEX_SUBSTR_DEFAULT },
+	{ BER_BVC("sort"), SLAP_INDEX_SORT },
 	{ BER_BVC("substr"), 0 },
 	{ BER_BVC("notags"), SLAP_INDEX_NOTAGS },
 	{ BER_BVC("nolang"), 0 },	/* backwards compat */
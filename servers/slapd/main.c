@@ -139,6 +139,25 @@ slapd_opt_slp( const char *val, void *arg )
 #endif
 }
 
+static int
+slapd_opt_shards( const char *val, void *arg )
+{
+	int n;
+
+	if ( val == NULL || lutil_atoi( &n, val ) != 0 || n < 1 ) {
+		fprintf( stderr, "invalid value \"%s\" for listener-shards option\n",
+			val ? val : "" );
+		return -1;
+	}
+
+	if ( slapd_daemon_shards( n ) != 0 ) {
+		fputs( "slapd: sharded listeners are not available\n", stderr );
+		return -1;
+	}
+
+	return 0;
+}
+
 /*
  * Option helper structure:
  * 
@@ -159,6 +178,7 @@ struct option_helper {
 	const char	*oh_usage;
 } option_helpers[] = {
 	{ BER_BVC("slp"),	slapd_opt_slp,	NULL, "slp[={on|off|(attrs)}] enable/disable SLP using (attrs)" },
+	{ BER_BVC("listener-shards"),	slapd_opt_shards,	NULL, "listener-shards=<n> accept on <n> listener threads, each with its own sockets" },
 	{ BER_BVNULL, 0, NULL, NULL }
 };
 
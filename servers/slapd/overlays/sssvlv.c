@@ -117,6 +117,7 @@ typedef struct sort_op
 	int so_session;
 	unsigned long so_vcontext;
 	int so_running;
+	SortedSearch *so_ss;	/* if the backend may sort by itself */
 } sort_op;
 
 /* There is only one conn table for all overlay instances */
@@ -368,7 +369,8 @@ static int find_session_by_context(
 	int sess_id;
 	for(sess_id = 0; sess_id < svi_max_percon; sess_id++) {
 		if( sort_conns[conn_id] && sort_conns[conn_id][sess_id] &&
-		    ( sort_conns[conn_id][sess_id]->so_vcontext == vc_context || 
+		    ( ( sort_conns[conn_id][sess_id]->so_vcontext &&
+			sort_conns[conn_id][sess_id]->so_vcontext == vc_context ) ||
                       (PagedResultsCookie) sort_conns[conn_id][sess_id]->so_tree == ps_cookie ) )
 			return sess_id;
 	}
@@ -720,6 +722,12 @@ static int sssvlv_op_response(
 {
 	sort_ctrl *sc = op->o_controls[sss_cid];
 	sort_op *so = op->o_callback->sc_private;
+	SortedSearch *ss = so->so_ss;
+
+	if ( ss && ss->ss_sorted && rs->sr_type == REP_SEARCH ) {
+		/* already in order, and only the VLV window */
+		return SLAP_CB_CONTINUE;
+	}
 
 	if ( rs->sr_type == REP_SEARCH ) {
 		int i;
@@ -795,6 +803,29 @@ static int sssvlv_op_response(
 			op->o_callback = op->o_callback->sc_next;
 		}
 
+		if ( ss ) {
+			LDAP_SLIST_REMOVE( &op->o_extra, &ss->ss_oe, OpExtra, oe_next );
+			if ( ss->ss_sorted ) {
+				/* there is no tree to continue from */
+				so->so_nentries = ss->ss_nentries;
+				so->so_vlv_target = ss->ss_target;
+				so->so_vlv_rc = ss->ss_vlv_rc;
+				so->so_vcontext = 0;
+				if ( so->so_vlv_rc != LDAP_SUCCESS ) {
+					/* as send_list() does */
+					LDAPControl *ctrls[2];
+					pack_vlv_response_control( op, rs, so, ctrls );
+					ctrls[1] = NULL;
+					slap_add_ctrls( op, rs, ctrls );
+				}
+			}
+			if ( !BER_BVISNULL( &ss->ss_value ) &&
+				ss->ss_value.bv_val != ((vlv_ctrl *)op->o_controls[vlv_cid])->vc_value.bv_val )
+				op->o_tmpfree( ss->ss_value.bv_val, op->o_tmpmemctx );
+			op->o_tmpfree( ss, op->o_tmpmemctx );
+			so->so_ss = NULL;
+		}
+
 		send_entry( op, rs, so );
 		send_result( op, rs, so );
 	}
@@ -802,6 +833,42 @@ static int sssvlv_op_response(
 	return rs->sr_err;
 }
 
+static SortedSearch *sort_search(
+	Operation		*op,
+	sort_ctrl		*sc,
+	vlv_ctrl		*vc )
+{
+	SortedSearch *ss;
+	MatchingRule *mr = sc->sc_keys[0].sk_ordering;
+
+	ss = op->o_tmpcalloc( 1, sizeof(SortedSearch), op->o_tmpmemctx );
+	ss->ss_oe.oe_key = (void *)slap_sorted_window;
+	ss->ss_ad = sc->sc_keys[0].sk_ad;
+	ss->ss_ordering = mr;
+	ss->ss_reverse = sc->sc_keys[0].sk_direction < 0;
+	if ( vc ) {
+		ss->ss_vlv = 1;
+		ss->ss_before = vc->vc_before;
+		ss->ss_after = vc->vc_after;
+		ss->ss_offset = vc->vc_offset;
+		ss->ss_count = vc->vc_count;
+		if ( !BER_BVISNULL( &vc->vc_value )) {
+			if ( !mr->smr_normalize ) {
+				ss->ss_value = vc->vc_value;
+			} else if ( mr->smr_normalize( SLAP_MR_VALUE_OF_SYNTAX,
+				mr->smr_syntax, mr, &vc->vc_value, &ss->ss_value,
+				op->o_tmpmemctx ))
+			{
+				/* let send_list() report it */
+				op->o_tmpfree( ss, op->o_tmpmemctx );
+				return NULL;
+			}
+		}
+	}
+	LDAP_SLIST_INSERT_HEAD( &op->o_extra, &ss->ss_oe, oe_next );
+	return ss;
+}
+
 static int sssvlv_op_search(
 	Operation		*op,
 	SlapReply		*rs)
@@ -969,6 +1036,13 @@ static int sssvlv_op_search(
 			so->so_vcontext = (unsigned long)so;
 			so->so_nentries = 0;
 			so->so_running = 1;
+			so->so_ss = NULL;
+
+			/* A backend with a sort index for the only key can
+			 * return the entries in order by itself.
+			 */
+			if ( sc->sc_nkeys == 1 && !ps )
+				so->so_ss = sort_search( op, sc, vc );
 
 			op->o_callback		= cb;
 		}
@@ -53,6 +53,7 @@ LDAP_SLAPD_F (int) access_allowed_mask LDAP_P((
 	AccessControlState *state,
 	slap_mask_t *mask ));
 #define access_allowed(op,e,desc,val,access,state) access_allowed_mask(op,e,desc,val,access,state,NULL)
+LDAP_SLAPD_F (int) access_allowed_unrestricted LDAP_P(( Operation *op ));
 LDAP_SLAPD_F (int) slap_access_allowed LDAP_P((
 	Operation		*op,
 	Entry			*e,
@@ -80,6 +81,8 @@ LDAP_SLAPD_F (int) slap_dynacl_register LDAP_P(( slap_dynacl_t *da ));
 LDAP_SLAPD_F (slap_dynacl_t *) slap_dynacl_get LDAP_P(( const char *name ));
 #endif /* SLAP_DYNACL */
 LDAP_SLAPD_F (int) acl_init LDAP_P(( void ));
+LDAP_SLAPD_F (void) acl_compile LDAP_P(( AccessControl *a ));
+LDAP_SLAPD_F (void) acl_uncompile LDAP_P(( void ));
 
 LDAP_SLAPD_F (int) acl_get_part LDAP_P((
 	struct berval	*list,
@@ -416,6 +419,15 @@ LDAP_SLAPD_F (int) backend_group LDAP_P((
 	AttributeDescription *group_at
 ));
 
+LDAP_SLAPD_F (void) backend_group_cache_resize LDAP_P((
+	unsigned int nslots ));
+LDAP_SLAPD_F (void) backend_group_cache_write LDAP_P((
+	Operation *op ));
+LDAP_SLAPD_F (void) backend_group_cache_flush LDAP_P(( void ));
+LDAP_SLAPD_F (void) backend_group_cache_stats LDAP_P((
+	unsigned long *hits,
+	unsigned long *misses ));
+
 LDAP_SLAPD_F (int) backend_attribute LDAP_P((
 	Operation *op,
 	Entry *target,
@@ -879,6 +891,7 @@ LDAP_SLAPD_F (void) slap_queue_csn LDAP_P(( Operation *, struct berval * ));
 LDAP_SLAPD_F (void) slapd_add_internal(ber_socket_t s, int isactive);
 LDAP_SLAPD_F (int) slapd_daemon_init( const char *urls );
 LDAP_SLAPD_F (int) slapd_daemon_resize( int newnum );
+LDAP_SLAPD_F (int) slapd_daemon_shards( int n );
 LDAP_SLAPD_F (int) slapd_daemon_destroy(void);
 LDAP_SLAPD_F (int) slapd_daemon(void);
 LDAP_SLAPD_F (Listener **)	slapd_get_listeners LDAP_P((void));
@@ -900,6 +913,7 @@ LDAP_SLAPD_F (void) slapd_set_write LDAP_P((ber_socket_t s, int wake));
 LDAP_SLAPD_F (void) slapd_clr_write LDAP_P((ber_socket_t s, int wake));
 LDAP_SLAPD_F (void) slapd_set_read LDAP_P((ber_socket_t s, int wake));
 LDAP_SLAPD_F (int) slapd_clr_read LDAP_P((ber_socket_t s, int wake));
+LDAP_SLAPD_F (int) slapd_hold_read LDAP_P((ber_socket_t s));
 LDAP_SLAPD_F (int) slapd_wait_writer( ber_socket_t sd );
 LDAP_SLAPD_F (void) slapd_shutsock( ber_socket_t sd );
 
@@ -911,6 +925,7 @@ LDAP_SLAPD_V (slap_ssf_t) local_ssf;
 LDAP_SLAPD_V (struct runqueue_s) slapd_rq;
 LDAP_SLAPD_V (int) slapd_daemon_threads;
 LDAP_SLAPD_V (int) slapd_daemon_mask;
+LDAP_SLAPD_V (int) slapd_listener_shards;
 #ifdef LDAP_TCP_BUFFER
 LDAP_SLAPD_V (int) slapd_tcp_rmem;
 LDAP_SLAPD_V (int) slapd_tcp_wmem;
@@ -1628,6 +1643,11 @@ LDAP_SLAPD_F (void) slap_send_ldap_intermediate LDAP_P(( Operation *op, SlapRepl
 LDAP_SLAPD_F (void) slap_send_search_result LDAP_P(( Operation *op, SlapReply *rs ));
 LDAP_SLAPD_F (int) slap_send_search_reference LDAP_P(( Operation *op, SlapReply *rs ));
 LDAP_SLAPD_F (int) slap_send_search_entry LDAP_P(( Operation *op, SlapReply *rs ));
+LDAP_SLAPD_F (int) slap_batch_begin LDAP_P(( Operation *op ));
+LDAP_SLAPD_F (void) slap_batch_flush LDAP_P(( Operation *op ));
+LDAP_SLAPD_F (void) slap_batch_end LDAP_P(( Operation *op ));
+LDAP_SLAPD_F (void) slap_batch_reset LDAP_P(( Connection *conn ));
+LDAP_SLAPD_F (int) slap_batch_tick LDAP_P(( void ));
 LDAP_SLAPD_F (int) slap_null_cb LDAP_P(( Operation *op, SlapReply *rs ));
 LDAP_SLAPD_F (int) slap_freeself_cb LDAP_P(( Operation *op, SlapReply *rs ));
 
@@ -1849,6 +1869,12 @@ LDAP_SLAPD_F (int) dscompare LDAP_P(( const char *s1, const char *s2del,
 LDAP_SLAPD_F (int) parse_syn LDAP_P((
 	struct config_args_s *ca, Syntax **sat, Syntax *prev ));
 
+/*
+ * search.c
+ */
+LDAP_SLAPD_F (int) slap_sorted_window LDAP_P((
+	SortedSearch *ss, int nentries, int nbefore, int *first, int *last ));
+
 /*
  * sessionlog.c
  */
@@ -2071,6 +2097,9 @@ LDAP_SLAPD_V (const char) 	Versionstr[];
 LDAP_SLAPD_V (int)		global_gentlehup;
 LDAP_SLAPD_V (int)		global_idletimeout;
 LDAP_SLAPD_V (int)		global_writetimeout;
+LDAP_SLAPD_V (unsigned int)	slap_batch_size;
+LDAP_SLAPD_V (unsigned int)	slap_batch_delay;
+LDAP_SLAPD_V (unsigned int)	slap_group_cache_size;
 LDAP_SLAPD_V (char *)	global_host;
 LDAP_SLAPD_V (struct berval)	global_host_bv;
 LDAP_SLAPD_V (char *)	global_realm;
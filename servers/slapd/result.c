@@ -331,55 +331,25 @@ slap_writewait_play(
 	}
 }
 
-static long send_ldap_ber(
+/* Write one pdu with c_write1_mutex held and our turn to write taken.
+ * Returns 0 when written, 1 if the connection was closed under us,
+ * and -1 on error with *close_reason set.
+ */
+static int
+slap_write_ber(
 	Operation *op,
-	BerElement *ber )
+	BerElement *ber,
+	char **close_reason,
+	int *do_resume )
 {
 	Connection *conn = op->o_conn;
-	ber_len_t bytes;
-	long ret = 0;
-	char *close_reason;
-	int do_resume = 0;
-
-	ber_get_option( ber, LBER_OPT_BER_BYTES_TO_WRITE, &bytes );
-
-	/* write only one pdu at a time - wait til it's our turn */
-	ldap_pvt_thread_mutex_lock( &conn->c_write1_mutex );
-	if (( op->o_abandon && !op->o_cancel ) || !connection_valid( conn ) ||
-		conn->c_writers < 0 ) {
-		ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
-		return 0;
-	}
-
-	conn->c_writers++;
-
-	while ( conn->c_writers > 0 && conn->c_writing ) {
-		ldap_pvt_thread_pool_idle( &connection_pool );
-		ldap_pvt_thread_cond_wait( &conn->c_write1_cv, &conn->c_write1_mutex );
-		ldap_pvt_thread_pool_unidle( &connection_pool );
-	}
-
-	/* connection was closed under us */
-	if ( conn->c_writers < 0 ) {
-		/* we're the last waiter, let the closer continue */
-		if ( conn->c_writers == -1 )
-			ldap_pvt_thread_cond_signal( &conn->c_write1_cv );
-		conn->c_writers++;
-		ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
-		return 0;
-	}
 
-	/* Our turn */
-	conn->c_writing = 1;
-
-	/* write the pdu */
 	while( 1 ) {
 		int err;
 		char ebuf[128];
 
 		if ( ber_flush2( conn->c_sb, ber, LBER_FLUSH_FREE_NEVER ) == 0 ) {
-			ret = bytes;
-			break;
+			return 0;
 		}
 
 		err = sock_errno();
@@ -394,19 +364,12 @@ static long send_ldap_ber(
 		    err, sock_errstr(err, ebuf, sizeof(ebuf)) );
 
 		if ( err != EWOULDBLOCK && err != EAGAIN ) {
-			close_reason = "connection lost on write";
-fail:
-			conn->c_writers--;
-			conn->c_writing = 0;
-			ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
-			ldap_pvt_thread_mutex_lock( &conn->c_mutex );
-			connection_closing( conn, close_reason );
-			ldap_pvt_thread_mutex_unlock( &conn->c_mutex );
+			*close_reason = "connection lost on write";
 			return -1;
 		}
 
 		/* wait for socket to be write-ready */
-		do_resume = 1;
+		*do_resume = 1;
 		conn->c_writewaiter = 1;
 		ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
 		ldap_pvt_thread_pool_idle( &connection_pool );
@@ -420,18 +383,200 @@ fail:
 		 */
 		if ( err <= 0 ) {
 			if ( err == 0 )
-				close_reason = "writetimeout";
+				*close_reason = "writetimeout";
 			else
-				close_reason = "connection lost on writewait";
-			goto fail;
+				*close_reason = "connection lost on writewait";
+			return -1;
 		}
 
 		if ( conn->c_writers < 0 ) {
-			ret = 0;
-			break;
+			return 1;
+		}
+	}
+}
+
+/*
+ * Result batching: while a search owns its connection's batch (see
+ * slap_batch_begin()), its entries are copied into c_rbatch instead of
+ * being written one by one. The batch goes out in a single write when
+ * the next entry might not fit in slap_batch_size bytes, when its
+ * oldest entry has waited slap_batch_delay milliseconds, or together
+ * with the next pdu of any other kind written on the connection, such
+ * as the searchResultDone. A search that goes a while without finding
+ * an entry calls slap_batch_flush() so the delay holds meanwhile, and
+ * the entries of a search that gets abandoned are dropped. All of it is
+ * done with our turn to write taken, so c_rbatch needs no further
+ * locking.
+ *
+ * Searches of other databases may stall on their way to the next
+ * entry, so the listener also keeps a timer while any batch is
+ * pending and has a pool thread write out the ones that are overdue,
+ * see slap_batch_tick().
+ */
+static int slap_batch_pending;	/* connections with entries in c_rbatch */
+static int slap_batch_armed;	/* the listener is keeping the timer */
+static int slap_batch_running;	/* a flush task is queued or running */
+static struct timeval slap_batch_last;	/* when it was last queued */
+
+static void
+slap_batch_clear( Connection *conn )
+{
+	if ( conn->c_rbatch.bv_len ) {
+		conn->c_rbatch.bv_len = 0;
+		__atomic_fetch_sub( &slap_batch_pending, 1, __ATOMIC_RELAXED );
+	}
+}
+
+static int
+slap_batch_add( Connection *conn, BerElement *ber, ber_len_t bytes )
+{
+	struct berval bv;
+
+	if ( conn->c_rbatch_size < slap_batch_size ) {
+		conn->c_rbatch.bv_val = ch_realloc( conn->c_rbatch.bv_val,
+			slap_batch_size );
+		conn->c_rbatch_size = slap_batch_size;
+	}
+	if ( conn->c_rbatch.bv_len + bytes > conn->c_rbatch_size ) {
+		return -1;
+	}
+	if ( conn->c_rbatch.bv_len == 0 ) {
+		gettimeofday( &conn->c_rbatch_time, NULL );
+		if ( __atomic_fetch_add( &slap_batch_pending, 1, __ATOMIC_RELAXED ) == 0 &&
+			slap_batch_delay && !__atomic_load_n( &slap_batch_armed, __ATOMIC_RELAXED ))
+			slap_wake_listener();
+	}
+	ber_flatten2( ber, &bv, 0 );
+	AC_MEMCPY( conn->c_rbatch.bv_val + conn->c_rbatch.bv_len,
+		bv.bv_val, bytes );
+	conn->c_rbatch.bv_len += bytes;
+	return 0;
+}
+
+static int
+slap_batch_due( Connection *conn, ber_len_t bytes )
+{
+	if ( conn->c_rbatch.bv_len + bytes > slap_batch_size ) {
+		return 1;
+	}
+	if ( slap_batch_delay ) {
+		struct timeval now;
+		long msec;
+
+		gettimeofday( &now, NULL );
+		msec = ( now.tv_sec - conn->c_rbatch_time.tv_sec ) * 1000 +
+			( now.tv_usec - conn->c_rbatch_time.tv_usec ) / 1000;
+		if ( msec >= (long)slap_batch_delay ) {
+			return 1;
 		}
 	}
+	return 0;
+}
+
+/* Write a pdu. If batch is set, the pdu is a search entry that may
+ * wait in the batch. With ber NULL, write the pending batch and end
+ * op's batching, or with batch set, write the batch only if it is due.
+ */
+static long send_ldap_ber(
+	Operation *op,
+	BerElement *ber,
+	int batch )
+{
+	Connection *conn = op->o_conn;
+	ber_len_t bytes = 0;
+	long ret = 0;
+	char *close_reason;
+	int do_resume = 0;
+	int rc = 0;
+
+	if ( ber != NULL )
+		ber_get_option( ber, LBER_OPT_BER_BYTES_TO_WRITE, &bytes );
+
+	/* write only one pdu at a time - wait til it's our turn */
+	ldap_pvt_thread_mutex_lock( &conn->c_write1_mutex );
+	if (( op->o_abandon && !op->o_cancel && ber != NULL ) ||
+		!connection_valid( conn ) ||
+		conn->c_writers < 0 ) {
+		ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
+		return 0;
+	}
+
+	conn->c_writers++;
+
+	while ( conn->c_writers > 0 && conn->c_writing ) {
+		ldap_pvt_thread_pool_idle( &connection_pool );
+		ldap_pvt_thread_cond_wait( &conn->c_write1_cv, &conn->c_write1_mutex );
+		ldap_pvt_thread_pool_unidle( &connection_pool );
+	}
 
+	/* connection was closed under us */
+	if ( conn->c_writers < 0 ) {
+		/* we're the last waiter, let the closer continue */
+		if ( conn->c_writers == -1 )
+			ldap_pvt_thread_cond_signal( &conn->c_write1_cv );
+		conn->c_writers++;
+		ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
+		return 0;
+	}
+
+	/* Our turn */
+	conn->c_writing = 1;
+
+	/* don't send the entries of an abandoned search */
+	if ( conn->c_rbatch_op && conn->c_rbatch_op->o_abandon &&
+		!conn->c_rbatch_op->o_cancel )
+		slap_batch_clear( conn );
+
+	if ( ber == NULL ) {
+		if ( !batch ) {
+			if ( conn->c_rbatch_op == op )
+				conn->c_rbatch_op = NULL;
+		} else if ( !conn->c_rbatch.bv_len ||
+			!slap_batch_due( conn, 0 )) {
+			goto done;
+		}
+	}
+
+	batch = batch && conn->c_rbatch_op == op;
+	if ( ber != NULL && ( batch || conn->c_rbatch.bv_len ) &&
+		slap_batch_add( conn, ber, bytes ) == 0 )
+	{
+		ber = NULL;
+		ret = bytes;
+		if ( batch && !slap_batch_due( conn, bytes ) )
+			goto done;
+	}
+
+	/* write the batch, then the pdu if it didn't go into the batch */
+	if ( conn->c_rbatch.bv_len ) {
+		BerElementBuffer berbuf;
+		BerElement *bber = (BerElement *) &berbuf;
+
+		ber_init2( bber, &conn->c_rbatch, 0 );
+		ber_set_option( bber, LBER_OPT_BER_BYTES_TO_WRITE,
+			&conn->c_rbatch.bv_len );
+		rc = slap_write_ber( op, bber, &close_reason, &do_resume );
+		slap_batch_clear( conn );
+	}
+	if ( rc == 0 && ber != NULL ) {
+		rc = slap_write_ber( op, ber, &close_reason, &do_resume );
+		if ( rc == 0 )
+			ret = bytes;
+	}
+
+	if ( rc < 0 ) {
+		conn->c_writers--;
+		conn->c_writing = 0;
+		ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
+		ldap_pvt_thread_mutex_lock( &conn->c_mutex );
+		connection_closing( conn, close_reason );
+		ldap_pvt_thread_mutex_unlock( &conn->c_mutex );
+		return -1;
+	}
+	if ( rc > 0 )
+		ret = 0;
+
+done:
 	conn->c_writing = 0;
 	if ( conn->c_writers < 0 ) {
 		/* shutting down, don't resume any ops */
@@ -455,6 +600,150 @@ fail:
 	return ret;
 }
 
+/* Let op batch the entries it sends. Returns nonzero if it may. */
+int
+slap_batch_begin( Operation *op )
+{
+	Connection *conn = op->o_conn;
+	int rc = 0;
+
+	if ( !slap_batch_size || conn == NULL )
+		return 0;
+#ifdef LDAP_CONNECTIONLESS
+	if ( conn->c_is_udp )
+		return 0;
+#endif
+
+	ldap_pvt_thread_mutex_lock( &conn->c_write1_mutex );
+	if ( conn->c_rbatch_op == NULL ) {
+		conn->c_rbatch_op = op;
+		rc = 1;
+	}
+	ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
+	return rc;
+}
+
+/* Write op's batch if its oldest entry has waited long enough */
+void
+slap_batch_flush( Operation *op )
+{
+	Connection *conn = op->o_conn;
+
+	/* Only op adds entries while it owns the batch, so peeking
+	 * without the lock is fine; send_ldap_ber() checks again.
+	 */
+	if ( !slap_batch_delay || conn == NULL || conn->c_rbatch_op != op ||
+		!conn->c_rbatch.bv_len || !slap_batch_due( conn, 0 ))
+		return;
+
+	(void)send_ldap_ber( op, NULL, 1 );
+}
+
+/* Stop batching for op, write out what it left in the batch */
+void
+slap_batch_end( Operation *op )
+{
+	Connection *conn = op->o_conn;
+
+	ldap_pvt_thread_mutex_lock( &conn->c_write1_mutex );
+	if ( conn->c_rbatch_op != op ) {
+		ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
+		return;
+	}
+	ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
+
+	(void)send_ldap_ber( op, NULL, 0 );
+
+	/* in case send_ldap_ber() gave up before taking its turn */
+	ldap_pvt_thread_mutex_lock( &conn->c_write1_mutex );
+	if ( conn->c_rbatch_op == op )
+		conn->c_rbatch_op = NULL;
+	/* a flush task may still be using op */
+	while ( conn->c_rbatch_pins )
+		ldap_pvt_thread_cond_wait( &conn->c_write1_cv, &conn->c_write1_mutex );
+	ldap_pvt_thread_mutex_unlock( &conn->c_write1_mutex );
+}
+
+/* Drop what a closing connection left in its batch */
+void
+slap_batch_reset( Connection *conn )
+{
+	slap_batch_clear( conn );
+	conn->c_rbatch_op = NULL;
+}
+
+/* Write out the overdue batches of all connections */
+static void *
+slap_batch_flush_task( void *ctx, void *arg )
+{
+	Connection *c;
+	ber_socket_t i;
+
+	for ( c = connection_first( &i ); c; c = connection_next( c, &i )) {
+		Operation *op = NULL;
+
+		ldap_pvt_thread_mutex_lock( &c->c_write1_mutex );
+		if ( c->c_rbatch_op && c->c_rbatch.bv_len &&
+			slap_batch_due( c, 0 ))
+		{
+			/* slap_batch_end() waits until we're done with op */
+			op = c->c_rbatch_op;
+			c->c_rbatch_pins++;
+		}
+		ldap_pvt_thread_mutex_unlock( &c->c_write1_mutex );
+		if ( op == NULL )
+			continue;
+
+		/* send_ldap_ber() takes c_mutex when the write fails */
+		ldap_pvt_thread_mutex_unlock( &c->c_mutex );
+		(void)send_ldap_ber( op, NULL, 1 );
+		ldap_pvt_thread_mutex_lock( &c->c_write1_mutex );
+		c->c_rbatch_pins--;
+		ldap_pvt_thread_cond_broadcast( &c->c_write1_cv );
+		ldap_pvt_thread_mutex_unlock( &c->c_write1_mutex );
+		ldap_pvt_thread_mutex_lock( &c->c_mutex );
+	}
+	connection_done( c );
+
+	__atomic_store_n( &slap_batch_running, 0, __ATOMIC_RELEASE );
+	return NULL;
+}
+
+/* Called by the first listener thread on each turn of its loop. While
+ * batches are pending, queues a flush task every slap_batch_delay
+ * milliseconds and returns how long the listener may wait for the next
+ * one, otherwise returns -1.
+ */
+int
+slap_batch_tick( void )
+{
+	struct timeval now;
+	long msec;
+
+	if ( !slap_batch_delay ||
+		!__atomic_load_n( &slap_batch_pending, __ATOMIC_RELAXED ))
+	{
+		__atomic_store_n( &slap_batch_armed, 0, __ATOMIC_RELAXED );
+		return -1;
+	}
+	__atomic_store_n( &slap_batch_armed, 1, __ATOMIC_RELAXED );
+
+	gettimeofday( &now, NULL );
+	msec = ( now.tv_sec - slap_batch_last.tv_sec ) * 1000 +
+		( now.tv_usec - slap_batch_last.tv_usec ) / 1000;
+	if ( msec >= 0 && msec < (long)slap_batch_delay )
+		return slap_batch_delay - msec;
+
+	if ( !__atomic_load_n( &slap_batch_running, __ATOMIC_ACQUIRE )) {
+		slap_batch_running = 1;
+		if ( ldap_pvt_thread_pool_submit( &connection_pool,
+			slap_batch_flush_task, NULL ))
+			slap_batch_running = 0;
+	}
+	slap_batch_last = now;
+	return slap_batch_delay;
+}
+
 static int
 send_ldap_control( BerElement *ber, LDAPControl *c )
 {
@@ -760,7 +1049,7 @@ send_ldap_response(
 	}
 
 	/* send BER */
-	bytes = send_ldap_ber( op, ber );
+	bytes = send_ldap_ber( op, ber, 0 );
 #ifdef LDAP_CONNECTIONLESS
 	if (!op->o_conn || op->o_conn->c_is_udp == 0)
 #endif
@@ -868,6 +1157,8 @@ slap_send_ldap_result( Operation *op, SlapReply *rs )
 
 	rs->sr_type = REP_RESULT;
 
+	backend_group_cache_write( op );
+
 	/* Propagate Abandons so that cleanup callbacks can be processed */
 	if ( rs->sr_err == SLAPD_ABANDON || op->o_abandon )
 		goto abandon;
@@ -1009,6 +1300,24 @@ slap_send_ldap_intermediate( Operation *op, SlapReply *rs )
 #define set_ldap_error( rs, err, text ) do { \
 		(rs)->sr_err = err; (rs)->sr_text = text; } while(0)
 
+/* Start an attribute and put all of its values, as "{O[O...O" does */
+static int
+slap_put_attr_vals( BerElement *ber, Attribute *a )
+{
+	BerVarray bv;
+
+	if ( ber_start_seq( ber, LBER_SEQUENCE ) == -1 ||
+		ber_put_berval( ber, &a->a_desc->ad_cname, LBER_OCTETSTRING ) == -1 ||
+		ber_start_set( ber, LBER_SET ) == -1 )
+		return -1;
+
+	for ( bv = a->a_vals; bv->bv_val != NULL; bv++ ) {
+		if ( ber_put_berval( ber, bv, LBER_OCTETSTRING ) == -1 )
+			return -1;
+	}
+	return 0;
+}
+
 /*
  * returns:
  *
@@ -1029,6 +1338,7 @@ slap_send_search_entry( Operation *op, SlapReply *rs )
 	int		userattrs;
 	AccessControlState acl_state = ACL_STATE_INIT;
 	int			 attrsonly;
+	int			 allvals;
 	AttributeDescription *ad_entry = slap_schema.si_ad_entry;
 
 	/* a_flags: array of flags telling if the i-th element will be
@@ -1138,6 +1448,12 @@ slap_send_search_entry( Operation *op, SlapReply *rs )
 	/* check for special all user attributes ("*") type */
 	userattrs = SLAP_USERATTRS( rs->sr_attr_flags );
 
+	/* When neither ACLs nor a ValuesReturnFilter can withhold values,
+	 * each attribute's values are put without the per-value access
+	 * checks. They are still copied into the BER as usual. */
+	allvals = !attrsonly && op->o_vrFilter == NULL &&
+		access_allowed_unrestricted( op );
+
 	/* create an array of arrays of flags. Each flag corresponds
 	 * to particular value of attribute and equals 1 if value matches
 	 * to ValuesReturnFilter or 0 if not
@@ -1238,6 +1554,20 @@ slap_send_search_entry( Operation *op, SlapReply *rs )
 			}
 			finish = 1;
 
+		} else if ( allvals ) {
+			if ( slap_put_attr_vals( ber, a ) == -1 ) {
+				Debug( LDAP_DEBUG_ANY,
+					"send_search_entry: conn %lu  ber_printf failed\n",
+					op->o_connid );
+
+				if ( op->o_res_ber == NULL ) ber_free_buf( ber );
+				set_ldap_error( rs, LDAP_OTHER,
+					"encoding values error" );
+				rc = rs->sr_err;
+				goto error_return;
+			}
+			finish = 1;
+
 		} else {
 			int first = 1;
 			for ( i = 0; a->a_nvals[i].bv_val != NULL; i++ ) {
@@ -1487,7 +1817,7 @@ slap_send_search_entry( Operation *op, SlapReply *rs )
 	rs_flush_entry( op, rs, NULL );
 
 	if ( op->o_res_ber == NULL ) {
-		bytes = send_ldap_ber( op, ber );
+		bytes = send_ldap_ber( op, ber, 1 );
 		ber_free_buf( ber );
 
 		if ( bytes < 0 ) {
@@ -1653,7 +1983,7 @@ slap_send_search_reference( Operation *op, SlapReply *rs )
 #ifdef LDAP_CONNECTIONLESS
 	if (!op->o_conn || op->o_conn->c_is_udp == 0) {
 #endif
-	bytes = send_ldap_ber( op, ber );
+	bytes = send_ldap_ber( op, ber, 0 );
 	ber_free_buf( ber );
 
 	if ( bytes < 0 ) {
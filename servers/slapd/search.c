@@ -402,8 +402,12 @@ fail1:
 
 	} else if ( op->o_bd->be_search ) {
 		if ( limits_check( op, rs ) == 0 ) {
+			int batch = slap_batch_begin( op );
+
 			/* actually do the search and send the result(s) */
 			(op->o_bd->be_search)( op, rs );
+			if ( batch )
+				slap_batch_end( op );
 		}
 		/* else limits_check() sends error */
 
@@ -417,3 +421,56 @@ return_results:;
 	return rs->sr_err;
 }
 
+
+/* Find the VLV window of a search whose nentries matching entries
+ * were put in order by the backend; nbefore of them sort before
+ * ss_value, if one was given. The window is positions first through
+ * last, counting from 1, and is empty if first > last. The target
+ * is chosen the same way sssvlv does when it sorts by itself.
+ */
+int
+slap_sorted_window(
+	SortedSearch *ss,
+	int nentries,
+	int nbefore,
+	int *first,
+	int *last )
+{
+	int target, cur;
+
+	ss->ss_nentries = nentries;
+	ss->ss_target = 0;
+	ss->ss_vlv_rc = LDAP_SUCCESS;
+	*first = 1;
+	*last = ss->ss_vlv ? 0 : nentries;
+	if ( !ss->ss_vlv || !nentries )
+		return LDAP_SUCCESS;
+
+	if ( !BER_BVISNULL( &ss->ss_value )) {
+		/* past the end if no entry is >= the value */
+		target = nbefore + 1;
+	} else if ( ss->ss_offset == ss->ss_count ) {
+		target = nentries;
+	} else if ( ss->ss_offset == 1 ) {
+		target = 1;
+	} else if ( ss->ss_count && ss->ss_count != nentries ) {
+		if ( ss->ss_offset > ss->ss_count )
+			goto range_err;
+		target = nentries * ss->ss_offset / ss->ss_count;
+	} else {
+		if ( ss->ss_offset > nentries ) {
+range_err:
+			ss->ss_vlv_rc = LDAP_VLV_RANGE_ERROR;
+			return LDAP_VLV_ERROR;
+		}
+		target = ss->ss_offset;
+	}
+	ss->ss_target = target;
+
+	cur = target > 0 ? target : 1;
+	*first = cur > ss->ss_before ? cur - ss->ss_before : 1;
+	if ( *first > nentries )
+		*first = nentries;
+	*last = cur < nentries - ss->ss_after ? cur + ss->ss_after : nentries;
+	return LDAP_SUCCESS;
+}
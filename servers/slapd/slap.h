@@ -250,6 +250,7 @@ typedef struct slap_ssf_set {
 #define SLAP_INDEX_APPROX         0x0008UL
 #define SLAP_INDEX_SUBSTR         0x0010UL
 #define SLAP_INDEX_EXTENDED		  0x0020UL
+#define SLAP_INDEX_SORT           0x0040UL	/* values in order, for sorting */
 
 #define SLAP_INDEX_DEFAULT        SLAP_INDEX_EQUALITY
 
@@ -291,6 +292,7 @@ typedef struct slap_ssf_set {
 #define SLAP_INDEX_SUBSTR_INITIAL_PREFIX '^'
 #define SLAP_INDEX_SUBSTR_FINAL_PREFIX '$'
 #define SLAP_INDEX_CONT_PREFIX		'.'		/* prefix for continuation keys */
+#define SLAP_INDEX_SORT_PREFIX		'<'		/* prefix for sort keys */
 
 #define SLAP_SYNTAX_MATCHINGRULES_OID	 "1.3.6.1.4.1.1466.115.121.1.30"
 #define SLAP_SYNTAX_ATTRIBUTETYPES_OID	 "1.3.6.1.4.1.1466.115.121.1.3"
@@ -1557,8 +1559,22 @@ typedef struct AccessControl {
 	Access	*acl_access;
 
 	struct AccessControl	*acl_next;
+
+	/* the compiled list this acl belongs to, and its position there */
+	struct AclIndex	*acl_cidx;
+	int		acl_cpos;
 } AccessControl;
 
+/* Which acls of a compiled list apply to an entry, whatever the attribute */
+#define ACL_MEMO_MAX	512
+#define ACL_MEMO_BITS	(sizeof(unsigned long) * 8)
+#define ACL_MEMO_WORDS	(ACL_MEMO_MAX / ACL_MEMO_BITS)
+typedef struct AclMemo {
+	struct AclIndex	*am_idx;
+	unsigned long	am_dn[ACL_MEMO_WORDS];		/* the DN matches */
+	unsigned long	am_filter[ACL_MEMO_WORDS];	/* and so does the filter */
+} AclMemo;
+
 typedef struct AccessControlState {
 	/* Access state */
 
@@ -1579,6 +1595,13 @@ typedef struct AccessControlState {
 
 	/* True if started to process frontend ACLs */
 	int as_fe_done;
+
+	/* What is known about the entry itself; this part is kept
+	 * from one attribute to the next */
+	Entry *as_memo_e;
+	ber_len_t as_memo_dnlen;
+	unsigned int as_memo_dnhash;
+	AclMemo as_memo[2];
 } AccessControlState;
 #define ACL_STATE_INIT { NULL, ACL_NONE, NULL, 0, 0, ACL_PRIV_NONE, -1, 0 }
 
@@ -1615,6 +1638,7 @@ LDAP_SLAPD_V (int) slapMode;
 #define	SLAP_TOOL_QUICK		0x0800
 #define SLAP_TOOL_NO_SCHEMA_CHECK	0x1000
 #define SLAP_TOOL_VALUE_CHECK	0x2000
+#define SLAP_TOOL_PROGRESS	0x4000	/* report progress of long tasks */
 
 #define SLAP_SERVER_RUNNING	0x8000
 
@@ -2209,6 +2233,12 @@ typedef int (BI_op_txn) LDAP_P(( Operation *op, int txnop, struct OpExtra **ptr
 #define SLAP_TXN_BEGIN	1
 #define SLAP_TXN_COMMIT	2
 #define SLAP_TXN_ABORT	3
+/* A txn for loading many entries, committed and aborted like the others.
+ * Each update in it succeeds or fails on its own, and the backend may
+ * put off indexing added entries until the load ends with BULK_END.
+ */
+#define SLAP_TXN_BULK	4
+#define SLAP_TXN_BULK_END	5
 
 typedef int (BI_conn_func) LDAP_P(( BackendDB *bd, Connection *c ));
 typedef BI_conn_func BI_connection_init;
@@ -2608,6 +2638,34 @@ typedef struct OpExtraDB {
 	BackendDB *oe_db;
 } OpExtraDB;
 
+/* A search whose entries are wanted in the order of one attribute,
+ * as by the server side sorting control. sssvlv puts it in o_extra,
+ * keyed by slap_sorted_window. A backend able to return the entries
+ * in that order itself sets ss_sorted before it sends any, and then
+ * only sends those in the VLV window, if any.
+ */
+typedef struct SortedSearch {
+	OpExtra ss_oe;
+	AttributeDescription *ss_ad;
+	MatchingRule *ss_ordering;	/* compares normalized values */
+	int ss_reverse;
+	int ss_vlv;
+	int ss_before;
+	int ss_after;
+	int ss_offset;
+	int ss_count;
+	struct berval ss_value;	/* target value if not BER_BVISNULL */
+	/* set by the backend */
+	int ss_sorted;
+	int ss_nentries;	/* entries matched */
+	int ss_target;	/* position of the VLV target entry */
+	int ss_vlv_rc;	/* virtualListViewResult */
+} SortedSearch;
+
+#ifndef LDAP_VLV_RANGE_ERROR
+#define LDAP_VLV_RANGE_ERROR	0x4D
+#endif
+
 struct Operation {
 	Opheader *o_hdr;
 
@@ -2935,6 +2993,14 @@ struct Connection {
 	int			c_writers;		/* number of writers waiting */
 	char		c_writing;		/* someone is writing */
 
+	/* search entries waiting to be written together,
+	 * protected by c_write1_mutex */
+	struct berval	c_rbatch;
+	ber_len_t	c_rbatch_size;	/* allocated size of c_rbatch */
+	struct timeval	c_rbatch_time;	/* when the first entry was added */
+	Operation	*c_rbatch_op;	/* search allowed to add entries */
+	int		c_rbatch_pins;	/* flushers using c_rbatch_op */
+
 	char		c_sasl_bind_in_progress;	/* multi-op bind in progress */
 	char		c_writewaiter;	/* true if blocked on write */
 
@@ -3021,6 +3087,7 @@ struct Listener {
 #endif
 	int	sl_mute;	/* Listener is temporarily disabled due to emfile */
 	int	sl_busy;	/* Listener is busy (accept thread activated) */
+	int	sl_tid;		/* owning listener thread, if sharded */
 	ber_socket_t sl_sd;
 	Sockaddr sl_sa;
 #define sl_addr	sl_sa.sa_in_addr
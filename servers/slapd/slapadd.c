@@ -56,23 +56,43 @@
 
 extern int slap_DN_strict;	/* dn.c */
 
-static char csnbuf[ LDAP_PVT_CSNSTR_BUFSIZE ];
-
 typedef struct Erec {
 	Entry *e;
 	unsigned long lineno;
 	unsigned long nextline;
 } Erec;
 
+/* With more than one tool thread, records go through a ring of Trecs:
+ * a reader thread reads them from the LDIF file, parser tasks in the
+ * thread pool turn them into checked entries, and the main thread
+ * takes them back in the order they were read and adds them.
+ */
 typedef struct Trec {
 	Entry *e;
 	unsigned long lineno;
 	unsigned long nextline;
+	char *buf;
+	int lmax;
 	int rc;
-	int ready;
+	int state;
 } Trec;
 
-static Trec trec;
+#define TREC_FREE	0	/* owned by the reader */
+#define TREC_READ	1	/* waiting for a parser */
+#define TREC_BUSY	2	/* being parsed */
+#define TREC_DONE	3	/* waiting for the main thread */
+
+/* slots per tool thread */
+#ifndef SLAPADD_RING_PER_THREAD
+#define SLAPADD_RING_PER_THREAD	16
+#endif
+
+static Trec *trecs;
+static unsigned long ntrecs;
+static unsigned long trec_read, trec_parsed, trec_done;
+static int trec_eof;		/* the reader has stopped */
+static int trec_parsers;	/* parser tasks still running */
+
 static unsigned long sid = SLAP_SYNC_SID_MAX + 1;
 static int checkvals;
 static int enable_meter;
@@ -83,54 +103,66 @@ static char *buf;
 static int lmax;
 
 static ldap_pvt_thread_mutex_t add_mutex;
-static ldap_pvt_thread_cond_t add_cond;
+static ldap_pvt_thread_cond_t add_cond;	/* a slot is free */
+static ldap_pvt_thread_cond_t parse_cond;	/* a record was read */
+static ldap_pvt_thread_cond_t done_cond;	/* a record was parsed */
 static int add_stop;
 
+static ldap_pvt_thread_mutex_t uuid_mutex;
+static int ldif_threaded;
+
 /* returns:
  *	1: got a record
  *	0: EOF
  * -1: read failure
+ */
+static int
+getrec_read(Erec *erec, char **bufp, int *lmaxp)
+{
+	int ldifrc;
+
+	do {
+		erec->lineno = erec->nextline+1;
+		/* nextline is the line number of the end of the current entry */
+		ldifrc = ldif_read_record( ldiffp, &erec->nextline, bufp, lmaxp );
+		if (ldifrc < 1)
+			return ldifrc < 0 ? -1 : 0;
+	} while ( erec->lineno < jumpline );
+
+	if ( enable_meter )
+		lutil_meter_update( &meter,
+				 ftello( ldiffp->fp ),
+				 0);
+	return 1;
+}
+
+/* returns:
+ *	1: got an entry
  * -2: parse failure
  */
 static int
-getrec0(Erec *erec)
+getrec_parse(Erec *erec, char *ldif, Operation *op)
 {
 	const char *text;
-	int ldifrc;
 	char textbuf[SLAP_TEXT_BUFLEN] = { '\0' };
 	size_t textlen = sizeof textbuf;
+	char csnbuf[ LDAP_PVT_CSNSTR_BUFSIZE ];
 	struct berval csn;
-	Operation *op = &opbuf.ob_op;
-	op->o_hdr = &opbuf.ob_hdr;
-
-again:
-	erec->lineno = erec->nextline+1;
-	/* nextline is the line number of the end of the current entry */
-	ldifrc = ldif_read_record( ldiffp, &erec->nextline, &buf, &lmax );
-	if (ldifrc < 1)
-		return ldifrc < 0 ? -1 : 0;
 	{
 		BackendDB *bd;
 		Entry *e;
 		int prev_DN_strict;
 
-		if ( erec->lineno < jumpline )
-			goto again;
-
-		if ( !dbnum ) {
+		/* when threaded, slapadd() relaxes it for all parsers */
+		if ( !dbnum && !ldif_threaded ) {
 			prev_DN_strict = slap_DN_strict;
 			slap_DN_strict = 0;
 		}
-		e = str2entry2( buf, checkvals );
-		if ( !dbnum ) {
+		e = str2entry2( ldif, checkvals );
+		if ( !dbnum && !ldif_threaded ) {
 			slap_DN_strict = prev_DN_strict;
 		}
 
-		if ( enable_meter )
-			lutil_meter_update( &meter,
-					 ftello( ldiffp->fp ),
-					 0);
-
 		if( e == NULL ) {
 			fprintf( stderr, "%s: could not parse entry (line=%lu)\n",
 				progname, erec->lineno );
@@ -246,7 +278,12 @@ again:
 				== NULL )
 			{
 				got &= ~GOT_UUID;
+				/* its clock sequence is not thread safe */
+				if ( ldif_threaded )
+					ldap_pvt_thread_mutex_lock( &uuid_mutex );
 				vals[0].bv_len = lutil_uuidstr( uuidbuf, sizeof( uuidbuf ) );
+				if ( ldif_threaded )
+					ldap_pvt_thread_mutex_unlock( &uuid_mutex );
 				vals[0].bv_val = uuidbuf;
 				attr_merge_normalize_one( e, slap_schema.si_ad_entryUUID, vals, NULL );
 			}
@@ -298,50 +335,136 @@ again:
 				      (!(got & GOT_CSN) ? slap_schema.si_ad_entryCSN->ad_cname.bv_val : ""),
 				      e->e_name.bv_val );
 			}
-
-			sid = slap_tool_update_ctxcsn_check( progname, e );
 		}
 		erec->e = e;
 	}
 	return 1;
 }
 
+/* returns:
+ *	1: got a record
+ *	0: EOF
+ * -1: read failure
+ * -2: parse failure
+ */
+static int
+getrec0(Erec *erec)
+{
+	Operation *op = &opbuf.ob_op;
+	int rc;
+
+	op->o_hdr = &opbuf.ob_hdr;
+	rc = getrec_read( erec, &buf, &lmax );
+	if ( rc < 1 )
+		return rc;
+	return getrec_parse( erec, buf, op );
+}
+
 static void *
 getrec_thr(void *ctx)
 {
+	Erec erec;
+	Trec *t;
+	int rc;
+
+	erec.nextline = 0;
 	ldap_pvt_thread_mutex_lock( &add_mutex );
 	while (!add_stop) {
-		trec.rc = getrec0((Erec *)&trec);
-		trec.ready = 1;
-		while (trec.ready)
+		t = &trecs[trec_read % ntrecs];
+		if ( t->state != TREC_FREE ) {
 			ldap_pvt_thread_cond_wait( &add_cond, &add_mutex );
-		/* eof or read failure */
-		if ( trec.rc == 0 || trec.rc == -1 )
+			continue;
+		}
+		ldap_pvt_thread_mutex_unlock( &add_mutex );
+		rc = getrec_read( &erec, &t->buf, &t->lmax );
+		ldap_pvt_thread_mutex_lock( &add_mutex );
+		t->e = NULL;
+		t->lineno = erec.lineno;
+		t->nextline = erec.nextline;
+		t->rc = rc;
+		/* eof or read failure go straight to the main thread */
+		t->state = rc < 1 ? TREC_DONE : TREC_READ;
+		trec_read++;
+		if ( rc < 1 )
 			break;
+		ldap_pvt_thread_cond_signal( &parse_cond );
 	}
+	trec_eof = 1;
+	ldap_pvt_thread_cond_broadcast( &parse_cond );
+	ldap_pvt_thread_cond_signal( &done_cond );
 	ldap_pvt_thread_mutex_unlock( &add_mutex );
 	return NULL;
 }
 
-static int ldif_threaded;
+static void *
+getrec_parse_task(void *ctx, void *arg)
+{
+	OperationBuffer ob = {0};
+	Operation *op = &ob.ob_op;
+	Erec erec;
+	Trec *t;
+
+	op->o_hdr = &ob.ob_hdr;
+	ldap_pvt_thread_mutex_lock( &add_mutex );
+	while (!add_stop) {
+		if ( trec_parsed == trec_read ) {
+			if ( trec_eof )
+				break;
+			ldap_pvt_thread_cond_wait( &parse_cond, &add_mutex );
+			continue;
+		}
+		t = &trecs[trec_parsed % ntrecs];
+		trec_parsed++;
+		if ( t->state != TREC_READ )
+			continue;
+		t->state = TREC_BUSY;
+		ldap_pvt_thread_mutex_unlock( &add_mutex );
+
+		erec.lineno = t->lineno;
+		erec.nextline = t->nextline;
+		erec.e = NULL;
+		t->rc = getrec_parse( &erec, t->buf, op );
+		t->e = erec.e;
+
+		ldap_pvt_thread_mutex_lock( &add_mutex );
+		t->state = TREC_DONE;
+		if ( t == &trecs[trec_done % ntrecs] )
+			ldap_pvt_thread_cond_signal( &done_cond );
+	}
+	trec_parsers--;
+	ldap_pvt_thread_cond_signal( &done_cond );
+	ldap_pvt_thread_mutex_unlock( &add_mutex );
+	return NULL;
+}
 
 static int
 getrec(Erec *erec)
 {
+	Trec *t;
 	int rc;
-	if ( !ldif_threaded )
-		return getrec0(erec);
-
-	while (!trec.ready)
-		ldap_pvt_thread_yield();
-	erec->e = trec.e;
-	erec->lineno = trec.lineno;
-	erec->nextline = trec.nextline;
-	trec.ready = 0;
-	rc = trec.rc;
-	ldap_pvt_thread_mutex_lock( &add_mutex );
-	ldap_pvt_thread_mutex_unlock( &add_mutex );
-	ldap_pvt_thread_cond_signal( &add_cond );
+
+	if ( !ldif_threaded ) {
+		rc = getrec0(erec);
+	} else {
+		ldap_pvt_thread_mutex_lock( &add_mutex );
+		t = &trecs[trec_done % ntrecs];
+		while ( t->state != TREC_DONE )
+			ldap_pvt_thread_cond_wait( &done_cond, &add_mutex );
+		erec->lineno = t->lineno;
+		erec->nextline = t->nextline;
+		rc = t->rc;
+		if ( rc > 0 )
+			erec->e = t->e;
+		t->e = NULL;
+		t->state = TREC_FREE;
+		trec_done++;
+		ldap_pvt_thread_cond_signal( &add_cond );
+		ldap_pvt_thread_mutex_unlock( &add_mutex );
+	}
+
+	/* the contextCSN is tracked in LDIF order */
+	if ( rc > 0 && SLAP_LASTMOD(be) )
+		sid = slap_tool_update_ctxcsn_check( progname, erec->e );
 	return rc;
 }
 
@@ -355,6 +478,7 @@ slapadd( int argc, char **argv )
 	ldap_pvt_thread_t thr;
 	ID id;
 	Entry *prev = NULL;
+	int prev_DN_strict = 0;
 
 	int ldifrc;
 	int rc = EXIT_SUCCESS;
@@ -425,10 +549,39 @@ slapadd( int argc, char **argv )
 	}
 
 	if ( slap_tool_thread_max > 1 ) {
+		int i;
+
 		ldap_pvt_thread_mutex_init( &add_mutex );
 		ldap_pvt_thread_cond_init( &add_cond );
-		ldap_pvt_thread_create( &thr, 0, getrec_thr, NULL );
+		ldap_pvt_thread_cond_init( &parse_cond );
+		ldap_pvt_thread_cond_init( &done_cond );
+		ldap_pvt_thread_mutex_init( &uuid_mutex );
+		ntrecs = SLAPADD_RING_PER_THREAD * slap_tool_thread_max;
+		trecs = ch_calloc( ntrecs, sizeof( Trec ));
 		ldif_threaded = 1;
+		/* entries of the first database are parsed leniently */
+		if ( !dbnum ) {
+			prev_DN_strict = slap_DN_strict;
+			slap_DN_strict = 0;
+		}
+
+		/* the main thread is the writer, the others parse */
+		ldap_pvt_thread_mutex_lock( &add_mutex );
+		for ( i = 0; i < slap_tool_thread_max - 1; i++ ) {
+			if ( ldap_pvt_thread_pool_submit( &connection_pool,
+				getrec_parse_task, NULL ))
+				break;
+			trec_parsers++;
+		}
+		ldap_pvt_thread_mutex_unlock( &add_mutex );
+		if ( trec_parsers ) {
+			ldap_pvt_thread_create( &thr, 0, getrec_thr, NULL );
+		} else {
+			ch_free( trecs );
+			ldif_threaded = 0;
+			if ( !dbnum )
+				slap_DN_strict = prev_DN_strict;
+		}
 	}
 
 	erec.nextline = 0;
@@ -477,12 +630,23 @@ slapadd( int argc, char **argv )
 	}
 
 	if ( ldif_threaded ) {
+		unsigned long i;
+
 		ldap_pvt_thread_mutex_lock( &add_mutex );
 		add_stop = 1;
-		trec.ready = 0;
 		ldap_pvt_thread_cond_signal( &add_cond );
+		ldap_pvt_thread_cond_broadcast( &parse_cond );
+		while ( trec_parsers > 0 )
+			ldap_pvt_thread_cond_wait( &done_cond, &add_mutex );
 		ldap_pvt_thread_mutex_unlock( &add_mutex );
 		ldap_pvt_thread_join( thr, NULL );
+		for ( i = 0; i < ntrecs; i++ ) {
+			if ( trecs[i].e ) entry_free( trecs[i].e );
+			ch_free( trecs[i].buf );
+		}
+		ch_free( trecs );
+		if ( !dbnum )
+			slap_DN_strict = prev_DN_strict;
 	}
 	if ( erec.e ) entry_free( erec.e );
 
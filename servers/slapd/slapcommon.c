@@ -552,6 +552,7 @@ slap_tool_init(
 
 		case 'v':	/* turn on verbose */
 			verbose++;
+			mode |= SLAP_TOOL_PROGRESS;
 			break;
 
 		case 'w':	/* write context csn at the end */
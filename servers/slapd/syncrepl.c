@@ -58,6 +58,25 @@ static AttributeDescription *sy_ad_dseeLastChange;
 
 #define	UUIDLEN	16
 
+/* The UUIDs the provider reported present during a refresh. The first
+ * two bytes of a UUID pick its bucket; the bucket keeps the remaining
+ * bytes in one array, appended as they arrive and sorted on first lookup.
+ */
+#define	PL_BUCKETS	65536
+#define	PL_KEYLEN	(UUIDLEN-2)
+
+typedef struct presentlist_bucket {
+	unsigned char *pb_keys;
+	unsigned pb_num;	/* keys stored */
+	unsigned pb_max;	/* keys allocated */
+	unsigned pb_sorted;	/* leading keys in order, without duplicates */
+} presentlist_bucket;
+
+typedef struct presentlist {
+	unsigned long pl_found;	/* lookups that found their UUID */
+	presentlist_bucket pl_buckets[PL_BUCKETS];
+} presentlist;
+
 struct nonpresent_entry {
 	struct berval *npe_name;
 	struct berval *npe_nname;
@@ -99,6 +118,9 @@ typedef struct cookie_state {
 #define RETRYNUM_VALID(n)	((n) >= RETRYNUM_FOREVER)	/* valid retrynum */
 #define RETRYNUM_FINITE(n)	((n) > RETRYNUM_FOREVER)	/* not forever */
 
+typedef struct syncapply syncapply;
+typedef struct syncapply_task syncapply_task;
+
 typedef struct syncinfo_s {
 	struct syncinfo_s	*si_next;
 	BackendDB		*si_be;
@@ -146,8 +168,14 @@ typedef struct syncinfo_s {
 	int			si_strict_refresh;	/* stop listening during fallback refresh */
 	int			si_too_old;
 	int			si_is_configdb;
+	int			si_applythreads;
+	syncapply		*si_apply;	/* parallel apply, if applythreads > 1 */
+	int			si_refreshbatch;	/* refresh entries per txn, 0 = one each */
+	int			si_bulkload;	/* 1 = in a bulk load, -1 = unsupported */
+	int			si_bulkops;		/* entries applied in si_bulk */
+	OpExtra			*si_bulk;	/* the open txn of the bulk load */
 	ber_int_t	si_msgid;
-	Avlnode			*si_presentlist;
+	presentlist		*si_presentlist;
 	LDAP			*si_ld;
 	Connection		*si_conn;
 	LDAP_LIST_HEAD(np, nonpresent_entry)	si_nonpresentlist;
@@ -173,11 +201,9 @@ typedef struct syncinfo_s {
 	ldap_pvt_thread_mutex_t	si_mutex;
 } syncinfo_t;
 
-static int syncuuid_cmp( const void *, const void * );
-static int presentlist_insert( syncinfo_t* si, struct berval *syncUUID );
-static void presentlist_delete( Avlnode **av, struct berval *syncUUID );
-static char *presentlist_find( Avlnode *av, struct berval *syncUUID );
-static int presentlist_free( Avlnode *av );
+static void presentlist_insert( syncinfo_t* si, struct berval *syncUUID );
+static int presentlist_find( presentlist *pl, struct berval *syncUUID );
+static unsigned long presentlist_free( presentlist *pl );
 static void syncrepl_del_nonpresent( Operation *, syncinfo_t *, BerVarray, struct sync_cookie *, int );
 static int syncrepl_message_to_op(
 					syncinfo_t *, Operation *, LDAPMessage *, int );
@@ -187,7 +213,7 @@ static int syncrepl_message_to_entry(
 static int syncrepl_entry(
 					syncinfo_t *, Operation*, Entry*,
 					Modifications**,int, struct berval*,
-					struct berval *cookieCSN );
+					struct berval *cookieCSN, syncapply_task * );
 static int syncrepl_updateCookie(
 					syncinfo_t *, Operation *,
 					struct sync_cookie *, int save );
@@ -930,6 +956,7 @@ do_syncrep1(
 
 	si->si_lastconnect = slap_get_time();
 	si->si_refreshDone = 0;
+	si->si_bulkload = 0;
 	rc = slap_client_connect( &si->si_ld, &si->si_bindconf );
 	if ( rc != LDAP_SUCCESS ) {
 		goto done;
@@ -1210,6 +1237,616 @@ get_pmutex(
 	return 0;
 }
 
+/* Parallel apply of received entries.
+ *
+ * With applythreads=<n>, n > 1, a consumer using plain content sync
+ * queues the entries it receives on n lanes instead of applying them
+ * itself, and pool threads apply the lanes. Each lane is applied in
+ * order by one thread at a time. An entry is queued on the lane that
+ * has a change of the same entryUUID, of the same DN or of its nearest
+ * ancestor still queued, so the changes of one entry stay in order and
+ * parents are added before their children; other entries go to the
+ * shortest lane.
+ * An entry that turns out to be renamed waits until all the entries
+ * received before it are applied. Deletes and all other messages
+ * wait until the lanes are empty and are handled by the reader.
+ *
+ * The cookies received with the entries are merged in receive order
+ * once the entries are committed, so the contextCSN never covers an
+ * entry that is not committed. The reader takes cs_pmutex before it
+ * queues an entry and keeps it until the queue is drained, so other
+ * consumers of the same database wait for the queued entries as they
+ * wait for the one entry being applied in serial mode.
+ */
+#define SYNC_DEFERRED	-104	/* a renamed entry must wait for its turn */
+
+#define SYNCAPPLY_QUEUE	64	/* queued entries per lane; also the number
+				 * of cookies merged before they are stored */
+
+typedef struct syncapply_key {
+	struct berval sk_val;	/* a normalized DN or entryUUID */
+	int sk_lane;
+	int sk_refcnt;	/* queued entries with this key */
+} syncapply_key;
+
+struct syncapply_task {
+	syncapply_task *st_next;	/* next in its lane */
+	syncapply_task *st_onext;	/* next in receive order */
+	syncapply_key *st_dn;
+	syncapply_key *st_uuidkey;
+	Entry *st_entry;
+	Modifications *st_modlist;
+	struct sync_cookie *st_cookie;
+	struct berval st_uuid[2];
+	int st_state;
+	int st_lane;
+	int st_done;
+};
+
+typedef struct syncapply_lane {
+	syncapply_task *sl_head, *sl_tail;
+	int sl_count;
+	int sl_busy;		/* a thread is applying this lane */
+	int sl_blocked;		/* the head waits for its turn */
+} syncapply_lane;
+
+struct syncapply {
+	ldap_pvt_thread_mutex_t sa_mutex;
+	ldap_pvt_thread_cond_t sa_cond;
+	syncinfo_t *sa_si;
+	int sa_refcnt;		/* the syncinfo and each helper */
+	int sa_closed;
+	int sa_helpers;		/* helper tasks submitted or running */
+	int sa_err;		/* first failure */
+	int sa_discard;		/* drop entries not yet applied */
+	int sa_plocked;		/* the reader holds cs_pmutex until the drain */
+	int sa_ntasks;		/* entries not yet committed */
+	int sa_nmerged;		/* cookies merged into sa_cookie */
+	syncapply_task *sa_ohead, *sa_otail;	/* in receive order */
+	struct sync_cookie sa_cookie;	/* committed, not yet stored */
+	Avlnode *sa_dns;	/* DNs of queued entries */
+	Avlnode *sa_uuids;	/* entryUUIDs of queued entries */
+	int sa_nlanes;
+	syncapply_lane sa_lanes[1];
+};
+
+static int
+syncapply_key_cmp( const void *v1, const void *v2 )
+{
+	const syncapply_key *k1 = v1, *k2 = v2;
+	int rc = k1->sk_val.bv_len - k2->sk_val.bv_len;
+
+	if ( rc == 0 )
+		rc = memcmp( k1->sk_val.bv_val, k2->sk_val.bv_val, k1->sk_val.bv_len );
+	return rc;
+}
+
+/* Count a queued entry with key val on lane; called with sa_mutex held */
+static syncapply_key *
+syncapply_key_get( Avlnode **tree, syncapply_key *sk, struct berval *val, int lane )
+{
+	if ( sk == NULL ) {
+		sk = ch_malloc( sizeof( syncapply_key ) + val->bv_len + 1 );
+		sk->sk_val.bv_val = (char *)( sk + 1 );
+		sk->sk_val.bv_len = val->bv_len;
+		AC_MEMCPY( sk->sk_val.bv_val, val->bv_val, val->bv_len );
+		sk->sk_val.bv_val[val->bv_len] = '\0';
+		sk->sk_lane = lane;
+		sk->sk_refcnt = 0;
+		avl_insert( tree, sk, syncapply_key_cmp, avl_dup_error );
+	}
+	sk->sk_refcnt++;
+	return sk;
+}
+
+static void
+syncapply_key_put( Avlnode **tree, syncapply_key *sk )
+{
+	if ( --sk->sk_refcnt == 0 ) {
+		avl_delete( tree, sk, syncapply_key_cmp );
+		ch_free( sk );
+	}
+}
+
+static syncapply *
+syncapply_new( syncinfo_t *si )
+{
+	syncapply *sa;
+
+	sa = ch_calloc( 1, sizeof( syncapply ) +
+		( si->si_applythreads - 1 ) * sizeof( syncapply_lane ));
+	ldap_pvt_thread_mutex_init( &sa->sa_mutex );
+	ldap_pvt_thread_cond_init( &sa->sa_cond );
+	sa->sa_si = si;
+	sa->sa_refcnt = 1;
+	sa->sa_nlanes = si->si_applythreads;
+	return sa;
+}
+
+/* Drop a reference; called with sa_mutex held, returns without it */
+static void
+syncapply_unref( syncapply *sa )
+{
+	int refcnt = --sa->sa_refcnt;
+
+	ldap_pvt_thread_mutex_unlock( &sa->sa_mutex );
+	if ( refcnt == 0 ) {
+		ldap_pvt_thread_cond_destroy( &sa->sa_cond );
+		ldap_pvt_thread_mutex_destroy( &sa->sa_mutex );
+		ch_free( sa );
+	}
+}
+
+static void
+syncapply_task_free( syncapply_task *st )
+{
+	if ( st->st_entry )
+		entry_free( st->st_entry );
+	if ( st->st_modlist )
+		slap_mods_free( st->st_modlist, 1 );
+	slap_sync_cookie_free( st->st_cookie, 1 );
+	ch_free( st->st_uuid[0].bv_val );
+	ch_free( st->st_uuid[1].bv_val );
+	ch_free( st );
+}
+
+/* Keep the newest CSN of each SID of src in dst */
+static void
+syncapply_merge_cookie( struct sync_cookie *dst, struct sync_cookie *src )
+{
+	ber_len_t len;
+	int i, j;
+
+	for ( i = 0; i < src->numcsns; i++ ) {
+		for ( j = 0; j < dst->numcsns && dst->sids[j] < src->sids[i]; j++ )
+			;
+		if ( j < dst->numcsns && dst->sids[j] == src->sids[i] ) {
+			len = src->ctxcsn[i].bv_len;
+			if ( len > dst->ctxcsn[j].bv_len )
+				len = dst->ctxcsn[j].bv_len;
+			if ( memcmp( src->ctxcsn[i].bv_val, dst->ctxcsn[j].bv_val, len ) > 0 )
+				ber_bvreplace( &dst->ctxcsn[j], &src->ctxcsn[i] );
+		} else {
+			slap_insert_csn_sids( dst, j, src->sids[i], &src->ctxcsn[i] );
+		}
+	}
+}
+
+/* Is it st's turn, i.e. are all entries received before it committed? */
+static int
+syncapply_turn( syncapply *sa, syncapply_task *st )
+{
+	int rc;
+
+	ldap_pvt_thread_mutex_lock( &sa->sa_mutex );
+	rc = sa->sa_ohead == st;
+	ldap_pvt_thread_mutex_unlock( &sa->sa_mutex );
+	return rc;
+}
+
+static void *syncapply_worker( void *ctx, void *arg );
+
+/* Make sure the runnable lanes get a thread; called with sa_mutex held */
+static void
+syncapply_kick( syncapply *sa )
+{
+	if ( sa->sa_helpers < sa->sa_nlanes ) {
+		sa->sa_helpers++;
+		sa->sa_refcnt++;
+		if ( ldap_pvt_thread_pool_submit( &connection_pool,
+			syncapply_worker, sa )) {
+			/* the reader will apply it */
+			sa->sa_helpers--;
+			sa->sa_refcnt--;
+		}
+	}
+	ldap_pvt_thread_cond_broadcast( &sa->sa_cond );
+}
+
+/* Entry st was applied, or dropped; called with sa_mutex held */
+static void
+syncapply_done( syncapply *sa, syncapply_task *st, int rc )
+{
+	syncapply_lane *sl;
+
+	st->st_done = 1;
+	if ( rc != LDAP_SUCCESS && !sa->sa_err )
+		sa->sa_err = rc;
+	syncapply_key_put( &sa->sa_dns, st->st_dn );
+	syncapply_key_put( &sa->sa_uuids, st->st_uuidkey );
+
+	/* retire the committed head of the receive order */
+	while (( st = sa->sa_ohead ) && st->st_done ) {
+		sa->sa_ohead = st->st_onext;
+		sa->sa_ntasks--;
+		/* stop at the first entry that was not applied */
+		if ( st->st_cookie && !sa->sa_err && !sa->sa_discard ) {
+			syncapply_merge_cookie( &sa->sa_cookie, st->st_cookie );
+			sa->sa_nmerged++;
+		}
+		syncapply_task_free( st );
+	}
+	if ( st ) {
+		/* the oldest entry may be waiting for its turn */
+		sl = &sa->sa_lanes[st->st_lane];
+		if ( sl->sl_blocked && sl->sl_head == st ) {
+			sl->sl_blocked = 0;
+			if ( !sl->sl_busy )
+				syncapply_kick( sa );
+		}
+	} else {
+		sa->sa_otail = NULL;
+	}
+	ldap_pvt_thread_cond_broadcast( &sa->sa_cond );
+}
+
+/* Apply the entries of lane sl, which the caller claimed;
+ * called and returns with sa_mutex held */
+static void
+syncapply_run( syncapply *sa, Operation *op, syncapply_lane *sl )
+{
+	syncinfo_t *si = sa->sa_si;
+	syncapply_task *st;
+	struct berval syncUUID[2];
+	int rc;
+
+	while (( st = sl->sl_head ) && !sl->sl_blocked ) {
+		rc = LDAP_SUCCESS;
+		if ( !sa->sa_err && !sa->sa_discard ) {
+			ldap_pvt_thread_mutex_unlock( &sa->sa_mutex );
+
+			op->o_bd = si->si_be;
+			op->o_dn = op->o_bd->be_rootdn;
+			op->o_ndn = op->o_bd->be_rootndn;
+			syncUUID[0] = st->st_uuid[0];
+			ber_dupbv_x( &syncUUID[1], &st->st_uuid[1], op->o_tmpmemctx );
+			rc = syncrepl_entry( si, op, st->st_entry, &st->st_modlist,
+				st->st_state, syncUUID,
+				st->st_cookie ? st->st_cookie->ctxcsn : NULL, st );
+			if ( rc != SYNC_DEFERRED ) {
+				/* syncrepl_entry took the entry */
+				st->st_entry = NULL;
+				if ( st->st_modlist ) {
+					slap_mods_free( st->st_modlist, 1 );
+					st->st_modlist = NULL;
+				}
+			}
+
+			ldap_pvt_thread_mutex_lock( &sa->sa_mutex );
+			if ( rc == SYNC_DEFERRED ) {
+				if ( sa->sa_ohead != st )
+					sl->sl_blocked = 1;
+				continue;
+			}
+		}
+		sl->sl_head = st->st_next;
+		if ( sl->sl_head == NULL )
+			sl->sl_tail = NULL;
+		sl->sl_count--;
+		syncapply_done( sa, st, rc );
+	}
+	sl->sl_busy = 0;
+}
+
+/* Claim a lane that has entries to apply; called with sa_mutex held */
+static syncapply_lane *
+syncapply_claim( syncapply *sa )
+{
+	syncapply_lane *sl;
+	int i;
+
+	for ( i = 0; i < sa->sa_nlanes; i++ ) {
+		sl = &sa->sa_lanes[i];
+		if ( sl->sl_head && !sl->sl_busy && !sl->sl_blocked ) {
+			sl->sl_busy = 1;
+			return sl;
+		}
+	}
+	return NULL;
+}
+
+static void *
+syncapply_worker( void *ctx, void *arg )
+{
+	syncapply *sa = arg;
+	syncapply_lane *sl;
+	Connection conn = {0};
+	OperationBuffer opbuf;
+	Operation *op = NULL;
+
+	ldap_pvt_thread_mutex_lock( &sa->sa_mutex );
+	while ( !sa->sa_closed && ( sl = syncapply_claim( sa ))) {
+		if ( op == NULL ) {
+			connection_fake_init( &conn, &opbuf, ctx );
+			op = &opbuf.ob_op;
+			op->o_connid = SLAPD_SYNC_RID2SYNCCONN( sa->sa_si->si_rid );
+			op->o_managedsait = SLAP_CONTROL_NONCRITICAL;
+			if ( !sa->sa_si->si_schemachecking )
+				op->o_no_schema_check = 1;
+		}
+		syncapply_run( sa, op, sl );
+	}
+	sa->sa_helpers--;
+	syncapply_unref( sa );
+	return NULL;
+}
+
+/* The reader waits for the lanes: apply one itself, so that it never
+ * waits for helpers the pool cannot start; called with sa_mutex held */
+static void
+syncapply_wait( syncapply *sa, Operation *op )
+{
+	syncapply_lane *sl = syncapply_claim( sa );
+
+	if ( sl )
+		syncapply_run( sa, op, sl );
+	else
+		ldap_pvt_thread_cond_wait( &sa->sa_cond, &sa->sa_mutex );
+}
+
+/* Undo the pending CSNs of entries that were not committed;
+ * called with cs_pmutex held */
+static void
+syncapply_revert( syncinfo_t *si )
+{
+	cookie_state *cs = si->si_cookieState;
+	int i, j;
+
+	ldap_pvt_thread_mutex_lock( &cs->cs_mutex );
+	for ( j = 0; j < cs->cs_pnum; j++ ) {
+		for ( i = 0; i < cs->cs_num; i++ ) {
+			if ( cs->cs_sids[i] == cs->cs_psids[j] ) {
+				ber_bvreplace( &cs->cs_pvals[j], &cs->cs_vals[i] );
+				break;
+			}
+		}
+		if ( i == cs->cs_num )
+			cs->cs_pvals[j].bv_val[0] = '\0';
+	}
+	ldap_pvt_thread_mutex_unlock( &cs->cs_mutex );
+}
+
+/* Store the cookies of the committed entries; called with sa_mutex
+ * held, which is released while the contextCSN is written */
+static void
+syncapply_store( syncinfo_t *si, Operation *op )
+{
+	syncapply *sa = si->si_apply;
+	struct sync_cookie sc = sa->sa_cookie;
+
+	memset( &sa->sa_cookie, 0, sizeof( sa->sa_cookie ));
+	sa->sa_nmerged = 0;
+	ldap_pvt_thread_mutex_unlock( &sa->sa_mutex );
+	syncrepl_updateCookie( si, op, &sc, 0 );
+	slap_sync_cookie_free( &sc, 0 );
+	ldap_pvt_thread_mutex_lock( &sa->sa_mutex );
+}
+
+/* Queue a received entry; takes over entry, *modlist and a copy of
+ * syncCookie. Returns the first failure of a queued entry, if any.
+ */
+static int
+syncapply_queue(
+	syncinfo_t *si,
+	Operation *op,
+	Entry *entry,
+	Modifications **modlist,
+	int syncstate,
+	struct berval *syncUUID,
+	struct sync_cookie *syncCookie )
+{
+	syncapply *sa = si->si_apply;
+	syncapply_task *st;
+	syncapply_lane *sl;
+	syncapply_key *sk, *dn, *uuid, key;
+	int i, lane, rc;
+
+	st = ch_calloc( 1, sizeof( syncapply_task ));
+	st->st_entry = entry;
+	st->st_modlist = *modlist;
+	*modlist = NULL;
+	st->st_state = syncstate;
+	ber_dupbv( &st->st_uuid[0], &syncUUID[0] );
+	ber_dupbv( &st->st_uuid[1], &syncUUID[1] );
+	if ( syncCookie && syncCookie->ctxcsn )
+		st->st_cookie = slap_dup_sync_cookie( NULL, syncCookie );
+
+	ldap_pvt_thread_mutex_lock( &sa->sa_mutex );
+	while ( !sa->sa_err && sa->sa_ntasks >= sa->sa_nlanes * SYNCAPPLY_QUEUE )
+		syncapply_wait( sa, op );
+
+	/* Find the lane of the entry's queued changes, by entryUUID and DN,
+	 * or of its nearest queued ancestor. If they are on different
+	 * lanes, wait for them.
+	 */
+	for (;;) {
+		key.sk_val = syncUUID[0];
+		uuid = avl_find( sa->sa_uuids, &key, syncapply_key_cmp );
+		lane = uuid ? uuid->sk_lane : -1;
+		dn = NULL;
+		key.sk_val = entry->e_nname;
+		for (;;) {
+			sk = avl_find( sa->sa_dns, &key, syncapply_key_cmp );
+			if ( sk ) {
+				if ( lane < 0 ) {
+					lane = sk->sk_lane;
+				} else if ( sk->sk_lane != lane ) {
+					break;
+				}
+				if ( key.sk_val.bv_val == entry->e_nname.bv_val )
+					dn = sk;
+			}
+			if ( BER_BVISEMPTY( &key.sk_val ))
+				break;
+			dnParent( &key.sk_val, &key.sk_val );
+		}
+		if ( sa->sa_err || BER_BVISEMPTY( &key.sk_val ))
+			break;
+		syncapply_wait( sa, op );
+	}
+
+	rc = sa->sa_err;
+	if ( rc ) {
+		ldap_pvt_thread_mutex_unlock( &sa->sa_mutex );
+		syncapply_task_free( st );
+		return rc;
+	}
+
+	if ( lane < 0 ) {
+		for ( i = 1, lane = 0; i < sa->sa_nlanes; i++ ) {
+			if ( sa->sa_lanes[i].sl_count < sa->sa_lanes[lane].sl_count )
+				lane = i;
+		}
+	}
+	st->st_dn = syncapply_key_get( &sa->sa_dns, dn, &entry->e_nname, lane );
+	st->st_uuidkey = syncapply_key_get( &sa->sa_uuids, uuid, &syncUUID[0], lane );
+	st->st_lane = lane;
+
+	sl = &sa->sa_lanes[lane];
+	if ( sl->sl_tail )
+		sl->sl_tail->st_next = st;
+	else
+		sl->sl_head = st;
+	sl->sl_tail = st;
+	sl->sl_count++;
+	if ( sa->sa_otail )
+		sa->sa_otail->st_onext = st;
+	else
+		sa->sa_ohead = st;
+	sa->sa_otail = st;
+	sa->sa_ntasks++;
+	if ( !sl->sl_busy && !sl->sl_blocked )
+		syncapply_kick( sa );
+
+	if ( sa->sa_nmerged >= SYNCAPPLY_QUEUE )
+		syncapply_store( si, op );
+	rc = sa->sa_err;
+	ldap_pvt_thread_mutex_unlock( &sa->sa_mutex );
+	return rc;
+}
+
+/* Wait until all queued entries are committed and store their cookies.
+ * With discard set, entries not yet applied are dropped. Returns the
+ * first failure of a queued entry, if any.
+ */
+static int
+syncapply_drain( syncinfo_t *si, Operation *op, int discard )
+{
+	syncapply *sa = si->si_apply;
+	int rc;
+
+	ldap_pvt_thread_mutex_lock( &sa->sa_mutex );
+	if ( discard )
+		sa->sa_discard = 1;
+	while ( sa->sa_ohead )
+		syncapply_wait( sa, op );
+	rc = sa->sa_err;
+	if ( sa->sa_nmerged ) {
+		if ( rc ) {
+			slap_sync_cookie_free( &sa->sa_cookie, 0 );
+			sa->sa_nmerged = 0;
+		} else {
+			syncapply_store( si, op );
+		}
+	}
+	sa->sa_err = 0;
+	sa->sa_discard = 0;
+	ldap_pvt_thread_mutex_unlock( &sa->sa_mutex );
+
+	if ( sa->sa_plocked ) {
+		if ( rc || discard )
+			syncapply_revert( si );
+		ldap_pvt_thread_mutex_unlock( &si->si_cookieState->cs_pmutex );
+		sa->sa_plocked = 0;
+	}
+	return rc;
+}
+
+/* Refresh load.
+ *
+ * With refreshbatch=<n>, the entries of the refresh phase that carry no
+ * cookie are applied n at a time in a bulk txn of the backend instead
+ * of a txn apiece, and the backend may put off indexing the added ones
+ * until the refresh is over, as slapadd -q followed by slapindex would.
+ * A bulk txn only takes such entries: it is committed before anything
+ * else is applied or a cookie stored, and before do_syncrep2 returns,
+ * since the backend's writer lock may belong to the thread. It keeps
+ * cs_pmutex, which the backend's writers take before the writer lock.
+ */
+static int
+syncrepl_bulk_begin( syncinfo_t *si, Operation *op )
+{
+	BackendDB *be = op->o_bd;
+	int rc;
+
+	if ( si->si_bulk || si->si_bulkload < 0 )
+		return 0;
+	if ( !si->si_be->bd_info->bi_op_txn ) {
+		si->si_bulkload = -1;
+		return 0;
+	}
+	if (( rc = get_pmutex( si )))
+		return rc;
+	op->o_bd = si->si_be;
+	rc = op->o_bd->bd_info->bi_op_txn( op, SLAP_TXN_BULK, &si->si_bulk );
+	op->o_bd = be;
+	if ( rc ) {
+		ldap_pvt_thread_mutex_unlock( &si->si_cookieState->cs_pmutex );
+		Debug( LDAP_DEBUG_ANY, "syncrepl_bulk_begin: %s "
+			"refresh load not supported by the database (%d)\n",
+			si->si_ridtxt, rc );
+		si->si_bulk = NULL;
+		si->si_bulkload = -1;
+		return 0;
+	}
+	si->si_bulkload = 1;
+	si->si_bulkops = 0;
+	return 0;
+}
+
+static int
+syncrepl_bulk_commit( syncinfo_t *si, Operation *op )
+{
+	BackendDB *be = op->o_bd;
+	int rc;
+
+	if ( !si->si_bulk )
+		return 0;
+	LDAP_SLIST_REMOVE( &op->o_extra, si->si_bulk, OpExtra, oe_next );
+	op->o_bd = si->si_be;
+	rc = op->o_bd->bd_info->bi_op_txn( op, SLAP_TXN_COMMIT, &si->si_bulk );
+	op->o_bd = be;
+	ldap_pvt_thread_mutex_unlock( &si->si_cookieState->cs_pmutex );
+	si->si_bulk = NULL;
+	if ( rc ) {
+		Debug( LDAP_DEBUG_ANY, "syncrepl_bulk_commit: %s "
+			"commit of %d entries failed (%d)\n",
+			si->si_ridtxt, si->si_bulkops, rc );
+		rc = LDAP_OTHER;
+	}
+	/* their results were sent before the commit */
+	backend_group_cache_flush();
+	return rc;
+}
+
+/* The refresh is over: have the backend catch up with what it put off */
+static int
+syncrepl_bulk_end( syncinfo_t *si, Operation *op )
+{
+	BackendDB *be = op->o_bd;
+	OpExtra *oex = NULL;
+	int rc;
+
+	rc = syncrepl_bulk_commit( si, op );
+	if ( si->si_bulkload > 0 ) {
+		op->o_bd = si->si_be;
+		op->o_bd->bd_info->bi_op_txn( op, SLAP_TXN_BULK_END, &oex );
+		op->o_bd = be;
+		si->si_bulkload = 0;
+	}
+	return rc;
+}
+
 static int
 do_syncrep2(
 	Operation *op,
@@ -1234,6 +1871,7 @@ do_syncrep2(
 
 	int		refreshDeletes = 0;
 	char empty[6] = "empty";
+	syncapply	*sa = si->si_apply;
 
 	if ( slapd_shutdown ) {
 		rc = SYNC_SHUTDOWN;
@@ -1250,14 +1888,14 @@ do_syncrep2(
 	while ( ( rc = ldap_result( si->si_ld, si->si_msgid, LDAP_MSG_ONE,
 		&tout, &msg ) ) > 0 )
 	{
-		int				match, punlock, syncstate;
+		int				match, punlock = -1, syncstate, queued, bulk;
 		struct berval	*retdata, syncUUID[2], cookie = BER_BVNULL;
 		char			*retoid;
 		LDAPControl		**rctrls = NULL, *rctrlp = NULL;
 		BerVarray		syncUUIDs;
 		ber_len_t		len;
 		ber_tag_t		si_tag;
-		Entry			*entry;
+		Entry			*entry = NULL;
 		struct berval	bdn;
 
 		if ( slapd_shutdown ) {
@@ -1265,6 +1903,16 @@ do_syncrep2(
 			goto done;
 		}
 		si->si_lastcontact = slap_get_time();
+		/* a bulk txn only takes entries */
+		if ( si->si_bulk && ldap_msgtype( msg ) != LDAP_RES_SEARCH_ENTRY ) {
+			if (( rc = syncrepl_bulk_commit( si, op )))
+				goto done;
+		}
+		/* only entries may overtake the queued ones */
+		if ( sa && ldap_msgtype( msg ) != LDAP_RES_SEARCH_ENTRY ) {
+			if (( rc = syncapply_drain( si, op, 0 )))
+				goto done;
+		}
 		switch( ldap_msgtype( msg ) ) {
 		case LDAP_RES_SEARCH_ENTRY:
 #ifdef LDAP_CONTROL_X_DIRSYNC
@@ -1272,7 +1920,7 @@ do_syncrep2(
 				BER_BVZERO( &syncUUID[0] );
 				rc = syncrepl_dirsync_message( si, op, msg, &modlist, &entry, &syncstate, syncUUID );
 				if ( rc == 0 )
-					rc = syncrepl_entry( si, op, entry, &modlist, syncstate, syncUUID, NULL );
+					rc = syncrepl_entry( si, op, entry, &modlist, syncstate, syncUUID, NULL, NULL );
 				op->o_tmpfree( syncUUID[0].bv_val, op->o_tmpmemctx );
 				if ( modlist )
 					slap_mods_free( modlist, 1);
@@ -1309,7 +1957,7 @@ do_syncrep2(
 					rc = syncrepl_message_to_entry( si, op, msg,
 						&modlist, &entry, syncstate, syncUUID );
 					if ( rc == 0 )
-						rc = syncrepl_entry( si, op, entry, &modlist, syncstate, syncUUID, NULL );
+						rc = syncrepl_entry( si, op, entry, &modlist, syncstate, syncUUID, NULL, NULL );
 					op->o_tmpfree( syncUUID[0].bv_val, op->o_tmpmemctx );
 					if ( modlist )
 						slap_mods_free( modlist, 1);
@@ -1370,6 +2018,28 @@ do_syncrep2(
 				rc = -1;
 				goto done;
 			}
+			/* a refresh load takes the entries without a cookie */
+			bulk = si->si_refreshbatch && !si->si_refreshDone &&
+				si->si_bulkload >= 0 && !si->si_is_configdb &&
+				!( si->si_syncdata && si->si_logstate == SYNCLOG_LOGGING ) &&
+				ber_peek_tag( ber, &len ) != LDAP_TAG_SYNC_COOKIE;
+			if ( si->si_bulk && !bulk ) {
+				if (( rc = syncrepl_bulk_commit( si, op ))) {
+					ldap_controls_free( rctrls );
+					goto done;
+				}
+			}
+			/* adds and modifies are queued, anything else waits
+			 * for the queue and is applied here */
+			queued = sa && !bulk &&
+				( syncstate == LDAP_SYNC_ADD || syncstate == LDAP_SYNC_MODIFY );
+			if ( sa && !queued && (( bulk && !si->si_bulk ) ||
+				syncstate == LDAP_SYNC_DELETE || sa->sa_plocked )) {
+				if (( rc = syncapply_drain( si, op, 0 ))) {
+					ldap_controls_free( rctrls );
+					goto done;
+				}
+			}
 			punlock = -1;
 			if ( ber_peek_tag( ber, &len ) == LDAP_TAG_SYNC_COOKIE ) {
 				if ( ber_scanf( ber, /*"{"*/ "m}", &cookie ) != LBER_ERROR ) {
@@ -1404,7 +2074,7 @@ do_syncrep2(
 						si->si_too_old = 0;
 
 						/* check pending CSNs too */
-						if (( rc = get_pmutex( si )))
+						if ( !( sa && sa->sa_plocked ) && ( rc = get_pmutex( si )))
 							goto done;
 
 						i = check_csn_age( si, &bdn, syncCookie.ctxcsn, sid, (cookie_vals *)&si->si_cookieState->cs_pvals, &slot );
@@ -1412,7 +2082,8 @@ do_syncrep2(
 							ber_bvreplace( &si->si_cookieState->cs_pvals[slot],
 								syncCookie.ctxcsn );
 						} else if ( i == CV_CSN_OLD ) {
-							ldap_pvt_thread_mutex_unlock( &si->si_cookieState->cs_pmutex );
+							if ( !( sa && sa->sa_plocked ))
+								ldap_pvt_thread_mutex_unlock( &si->si_cookieState->cs_pmutex );
 							ldap_controls_free( rctrls );
 							rc = 0;
 							goto done;
@@ -1437,6 +2108,16 @@ do_syncrep2(
 				}
 			}
 			rc = 0;
+			if ( queued ) {
+				/* the queue keeps cs_pmutex until it is drained */
+				if ( punlock < 0 && !sa->sa_plocked &&
+					( rc = get_pmutex( si ))) {
+					ldap_controls_free( rctrls );
+					goto done;
+				}
+				sa->sa_plocked = 1;
+				punlock = -1;
+			}
 			if ( si->si_syncdata && si->si_logstate == SYNCLOG_LOGGING ) {
 				modlist = NULL;
 				if ( ( rc = syncrepl_message_to_op( si, op, msg, punlock < 0 ) ) == LDAP_SUCCESS &&
@@ -1468,18 +2149,31 @@ logerr:
 			} else if ( ( rc = syncrepl_message_to_entry( si, op, msg,
 				&modlist, &entry, syncstate, syncUUID ) ) == LDAP_SUCCESS )
 			{
-				if ( punlock < 0 ) {
-					if (( rc = get_pmutex( si )))
-						goto done;
-				}
-				if ( ( rc = syncrepl_entry( si, op, entry, &modlist,
-					syncstate, syncUUID, syncCookie.ctxcsn ) ) == LDAP_SUCCESS &&
-					syncCookie.ctxcsn )
-				{
-					rc = syncrepl_updateCookie( si, op, &syncCookie, 0 );
+				if ( queued ) {
+					rc = syncapply_queue( si, op, entry, &modlist,
+						syncstate, syncUUID, &syncCookie );
+				} else {
+					if ( bulk ) {
+						if (( rc = syncrepl_bulk_begin( si, op )))
+							goto done;
+					}
+					if ( punlock < 0 && !si->si_bulk ) {
+						if (( rc = get_pmutex( si )))
+							goto done;
+					}
+					if ( ( rc = syncrepl_entry( si, op, entry, &modlist,
+						syncstate, syncUUID, syncCookie.ctxcsn, NULL ) ) == LDAP_SUCCESS &&
+						syncCookie.ctxcsn )
+					{
+						rc = syncrepl_updateCookie( si, op, &syncCookie, 0 );
+					}
+					if ( si->si_bulk ) {
+						if ( rc == LDAP_SUCCESS &&
+							++si->si_bulkops >= si->si_refreshbatch )
+							rc = syncrepl_bulk_commit( si, op );
+					} else if ( punlock < 0 )
+						ldap_pvt_thread_mutex_unlock( &si->si_cookieState->cs_pmutex );
 				}
-				if ( punlock < 0 )
-					ldap_pvt_thread_mutex_unlock( &si->si_cookieState->cs_pmutex );
 			}
 			if ( punlock >= 0 ) {
 				/* on failure, revert pending CSN */
@@ -1796,7 +2490,7 @@ logerr:
 						} else {
 							int i;
 							for ( i = 0; !BER_BVISNULL( &syncUUIDs[i] ); i++ ) {
-								(void)presentlist_insert( si, &syncUUIDs[i] );
+								presentlist_insert( si, &syncUUIDs[i] );
 								slap_sl_free( syncUUIDs[i].bv_val, op->o_tmpmemctx );
 							}
 							slap_sl_free( syncUUIDs, op->o_tmpmemctx );
@@ -1874,7 +2568,15 @@ logerr:
 		}
 		ldap_msgfree( msg );
 		msg = NULL;
+		if ( si->si_bulkload > 0 && si->si_refreshDone ) {
+			if (( rc = syncrepl_bulk_end( si, op )))
+				goto done;
+		}
 		if ( ldap_pvt_thread_pool_pausing( &connection_pool )) {
+			if (( rc = syncrepl_bulk_commit( si, op )))
+				goto done;
+			if ( sa && ( rc = syncapply_drain( si, op, 0 )))
+				goto done;
 			slap_sync_cookie_free( &syncCookie, 0 );
 			slap_sync_cookie_free( &syncCookie_req, 0 );
 			return SYNC_PAUSED;
@@ -1888,6 +2590,20 @@ logerr:
 	}
 
 done:
+	if ( si->si_bulkload > 0 ) {
+		/* the load goes on when more entries come in */
+		int rc2 = rc == SYNC_TIMEOUT ?
+			syncrepl_bulk_commit( si, op ) : syncrepl_bulk_end( si, op );
+		if ( rc == SYNC_TIMEOUT )
+			rc = rc2;
+	}
+	if ( sa ) {
+		/* on failure, the entries not applied yet are refetched */
+		int rc2 = syncapply_drain( si, op, rc != SYNC_TIMEOUT );
+		if ( rc == SYNC_TIMEOUT )
+			rc = rc2;
+	}
+
 	if ( err != LDAP_SUCCESS ) {
 		Debug( LDAP_DEBUG_ANY,
 			"do_syncrep2: %s (%d) %s\n",
@@ -3781,6 +4497,8 @@ typedef struct dninfo {
 	struct berval nnewSup;
 	int syncstate;
 	int renamed;	/* Was an existing entry renamed? */
+	int deferred;	/* Must the rename wait for its turn? */
+	syncapply_task *task;	/* the queued entry, if applied in parallel */
 	int delOldRDN;	/* Was old RDN deleted? */
 	Modifications **modlist;	/* the modlist we received */
 	Modifications *mods;	/* the modlist we compared */
@@ -3789,104 +4507,104 @@ typedef struct dninfo {
 	AttributeDescription *newDesc;	/* for renames */
 } dninfo;
 
-#define HASHUUID	1
-
-/* return 1 if inserted, 0 otherwise */
-static int
+static void
 presentlist_insert(
 	syncinfo_t* si,
 	struct berval *syncUUID )
 {
-	char *val;
-
-#ifdef HASHUUID
-	Avlnode **av;
+	presentlist_bucket *pb;
 	unsigned short s;
 
 	if ( !si->si_presentlist )
-		si->si_presentlist = ch_calloc(65536, sizeof( Avlnode * ));
+		si->si_presentlist = ch_calloc( 1, sizeof( presentlist ));
 
-	av = (Avlnode **)si->si_presentlist;
-
-	val = ch_malloc(UUIDLEN-2);
-	memcpy(&s, syncUUID->bv_val, 2);
-	memcpy(val, syncUUID->bv_val+2, UUIDLEN-2);
-
-	if ( avl_insert( &av[s], val,
-		syncuuid_cmp, avl_dup_error ) )
-	{
-		ch_free( val );
-		return 0;
+	memcpy( &s, syncUUID->bv_val, 2 );
+	pb = &si->si_presentlist->pl_buckets[s];
+	if ( pb->pb_num == pb->pb_max ) {
+		pb->pb_max = pb->pb_max ? pb->pb_max * 2 : 4;
+		pb->pb_keys = ch_realloc( pb->pb_keys, pb->pb_max * PL_KEYLEN );
 	}
-#else
-	val = ch_malloc(UUIDLEN);
+	memcpy( pb->pb_keys + pb->pb_num * PL_KEYLEN, syncUUID->bv_val+2, PL_KEYLEN );
+	pb->pb_num++;
+}
 
-	AC_MEMCPY( val, syncUUID->bv_val, UUIDLEN );
+static int
+presentlist_key_cmp( const void *v_key1, const void *v_key2 )
+{
+	return memcmp( v_key1, v_key2, PL_KEYLEN );
+}
 
-	if ( avl_insert( &si->si_presentlist, val,
-		syncuuid_cmp, avl_dup_error ) )
-	{
-		ch_free( val );
-		return 0;
-	}
-#endif
+/* sort the keys of a bucket and drop the duplicates */
+static void
+presentlist_sort( presentlist_bucket *pb )
+{
+	unsigned i, n;
 
-	return 1;
+	qsort( pb->pb_keys, pb->pb_num, PL_KEYLEN, presentlist_key_cmp );
+	for ( i = 1, n = 1; i < pb->pb_num; i++ ) {
+		if ( memcmp( pb->pb_keys + i * PL_KEYLEN,
+			pb->pb_keys + ( n - 1 ) * PL_KEYLEN, PL_KEYLEN ) == 0 )
+			continue;
+		if ( i != n )
+			memcpy( pb->pb_keys + n * PL_KEYLEN,
+				pb->pb_keys + i * PL_KEYLEN, PL_KEYLEN );
+		n++;
+	}
+	pb->pb_num = pb->pb_sorted = n;
 }
 
-static char *
+/* return 1 if present, 0 otherwise */
+static int
 presentlist_find(
-	Avlnode *av,
+	presentlist *pl,
 	struct berval *val )
 {
-#ifdef HASHUUID
-	Avlnode **a2 = (Avlnode **)av;
+	presentlist_bucket *pb;
 	unsigned short s;
+	unsigned lo, hi, mid;
+	int c;
 
-	if (!av)
-		return NULL;
+	if ( !pl )
+		return 0;
 
-	memcpy(&s, val->bv_val, 2);
-	return avl_find( a2[s], val->bv_val+2, syncuuid_cmp );
-#else
-	return avl_find( av, val->bv_val, syncuuid_cmp );
-#endif
+	memcpy( &s, val->bv_val, 2 );
+	pb = &pl->pl_buckets[s];
+	if ( pb->pb_num > pb->pb_sorted )
+		presentlist_sort( pb );
+
+	lo = 0;
+	hi = pb->pb_num;
+	while ( lo < hi ) {
+		mid = ( lo + hi ) / 2;
+		c = memcmp( val->bv_val+2, pb->pb_keys + mid * PL_KEYLEN, PL_KEYLEN );
+		if ( c == 0 ) {
+			pl->pl_found++;
+			return 1;
+		}
+		if ( c < 0 )
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return 0;
 }
 
-static int
-presentlist_free( Avlnode *av )
+/* return the number of UUIDs no lookup found */
+static unsigned long
+presentlist_free( presentlist *pl )
 {
-#ifdef HASHUUID
-	Avlnode **a2 = (Avlnode **)av;
-	int i, count = 0;
+	unsigned long count = 0;
+	int i;
 
-	if ( av ) {
-		for (i=0; i<65536; i++) {
-			if (a2[i])
-				count += avl_free( a2[i], ch_free );
+	if ( pl ) {
+		for ( i = 0; i < PL_BUCKETS; i++ ) {
+			count += pl->pl_buckets[i].pb_num;
+			ch_free( pl->pl_buckets[i].pb_keys );
 		}
-		ch_free( av );
+		count = count > pl->pl_found ? count - pl->pl_found : 0;
+		ch_free( pl );
 	}
 	return count;
-#else
-	return avl_free( av, ch_free );
-#endif
-}
-
-static void
-presentlist_delete(
-	Avlnode **av,
-	struct berval *val )
-{
-#ifdef HASHUUID
-	Avlnode **a2 = *(Avlnode ***)av;
-	unsigned short s;
-
-	memcpy(&s, val->bv_val, 2);
-	avl_delete( &a2[s], val->bv_val+2, syncuuid_cmp );
-#else
-	avl_delete( av, val->bv_val, syncuuid_cmp );
-#endif
 }
 
 static int
@@ -3897,7 +4615,8 @@ syncrepl_entry(
 	Modifications** modlist,
 	int syncstate,
 	struct berval* syncUUID,
-	struct berval* syncCSN )
+	struct berval* syncCSN,
+	syncapply_task *task )
 {
 	Backend *be = op->o_bd;
 	slap_callback	cb = { NULL, NULL, NULL, NULL };
@@ -3919,7 +4638,12 @@ syncrepl_entry(
 
 	if (( syncstate == LDAP_SYNC_PRESENT || syncstate == LDAP_SYNC_ADD ) ) {
 		if ( !si->si_refreshPresent && !si->si_refreshDone ) {
-			syncuuid_inserted = presentlist_insert( si, syncUUID );
+			if ( si->si_apply )
+				ldap_pvt_thread_mutex_lock( &si->si_apply->sa_mutex );
+			presentlist_insert( si, syncUUID );
+			syncuuid_inserted = 1;
+			if ( si->si_apply )
+				ldap_pvt_thread_mutex_unlock( &si->si_apply->sa_mutex );
 		}
 	}
 
@@ -4000,6 +4724,7 @@ syncrepl_entry(
 	dni.new_entry = entry;
 	dni.modlist = modlist;
 	dni.syncstate = syncstate;
+	dni.task = task;
 
 	rc = be->be_search( op, &rs_search );
 	Debug( LDAP_DEBUG_SYNC,
@@ -4010,6 +4735,17 @@ syncrepl_entry(
 		slap_sl_free( op->ors_filterstr.bv_val, op->o_tmpmemctx );
 	}
 
+	if ( dni.deferred ) {
+		/* the caller keeps the entry and retries later */
+		Debug( LDAP_DEBUG_SYNC,
+				"syncrepl_entry: %s rename of %s deferred\n",
+				si->si_ridtxt, dni.dn.bv_val );
+		entry = NULL;
+		syncCSN = NULL;
+		rc = SYNC_DEFERRED;
+		goto done;
+	}
+
 	cb.sc_response = syncrepl_null_callback;
 	cb.sc_private = si;
 
@@ -4082,10 +4818,10 @@ retry_add:;
 				if ( abs(si->si_type) == LDAP_SYNC_REFRESH_AND_PERSIST &&
 					si->si_refreshDone ) {
 					/* Something's wrong, start over */
-					ber_bvarray_free( si->si_syncCookie.ctxcsn );
-					si->si_syncCookie.ctxcsn = NULL;
 					entry_free( entry );
 					ldap_pvt_thread_mutex_lock( &si->si_cookieState->cs_mutex );
+					ber_bvarray_free( si->si_syncCookie.ctxcsn );
+					si->si_syncCookie.ctxcsn = NULL;
 					ber_bvarray_free( si->si_cookieState->cs_vals );
 					ch_free( si->si_cookieState->cs_sids );
 					si->si_cookieState->cs_vals = NULL;
@@ -5480,6 +6216,14 @@ dn_callback(
 					int oldpos, newpos;
 					Attribute *a;
 
+					/* With parallel apply, changes received before
+					 * the rename may still refer to the old DN
+					 */
+					if ( dni->task && !syncapply_turn( dni->si->si_apply, dni->task )) {
+						dni->deferred = 1;
+						return LDAP_SUCCESS;
+					}
+
 					dni->renamed = 1;
 					if ( new_sup )
 						dni->nnewSup = new_p;
@@ -5562,8 +6306,8 @@ nonpresent_callback(
 {
 	syncinfo_t *si = op->o_callback->sc_private;
 	Attribute *a;
-	int count = 0;
-	char *present_uuid = NULL;
+	unsigned long count;
+	int present_uuid = 0;
 	struct nonpresent_entry *np_entry;
 	struct sync_cookie *syncCookie = op->o_controls[slap_cids.sc_LDAPsync];
 
@@ -5571,7 +6315,7 @@ nonpresent_callback(
 		count = presentlist_free( si->si_presentlist );
 		si->si_presentlist = NULL;
 		Debug( LDAP_DEBUG_SYNC, "nonpresent_callback: %s "
-			"had %d items left in the list\n", si->si_ridtxt, count );
+			"had %lu items left in the list\n", si->si_ridtxt, count );
 
 	} else if ( rs->sr_type == REP_SEARCH ) {
 		if ( !( si->si_refreshDelete & NP_DELETE_ONE ) ) {
@@ -5591,7 +6335,7 @@ nonpresent_callback(
 			if ( a == NULL ) return 0;
 		}
 
-		if ( present_uuid == NULL ) {
+		if ( !present_uuid ) {
 			int covered = 1; /* covered by our new contextCSN? */
 
 			if ( !syncCookie )
@@ -5623,10 +6367,6 @@ nonpresent_callback(
 					"adding entry %s to non-present list\n",
 					si->si_ridtxt, np_entry->npe_name->bv_val );
 			}
-
-		} else {
-			presentlist_delete( &si->si_presentlist, &a->a_nvals[0] );
-			ch_free( present_uuid );
 		}
 	}
 	return LDAP_SUCCESS;
@@ -5735,16 +6475,6 @@ done:;
 	return new;
 }
 
-static int
-syncuuid_cmp( const void* v_uuid1, const void* v_uuid2 )
-{
-#ifdef HASHUUID
-	return ( memcmp( v_uuid1, v_uuid2, UUIDLEN-2 ));
-#else
-	return ( memcmp( v_uuid1, v_uuid2, UUIDLEN ));
-#endif
-}
-
 void
 syncinfo_free( syncinfo_t *sie, int free_all )
 {
@@ -5779,6 +6509,22 @@ syncinfo_free( syncinfo_t *sie, int free_all )
 			ldap_pvt_thread_mutex_unlock( &slapd_rq.rq_mutex );
 		}
 
+		/* removed in the middle of a refresh load */
+		if ( sie->si_bulkload > 0 && !slapd_shutdown ) {
+			Operation op = {0};
+			OpExtra *oex = NULL;
+
+			op.o_bd = sie->si_be;
+			op.o_bd->bd_info->bi_op_txn( &op, SLAP_TXN_BULK_END, &oex );
+		}
+
+		if ( sie->si_apply ) {
+			/* helpers that did not start yet free it */
+			ldap_pvt_thread_mutex_lock( &sie->si_apply->sa_mutex );
+			sie->si_apply->sa_closed = 1;
+			syncapply_unref( sie->si_apply );
+		}
+
 		ldap_pvt_thread_mutex_destroy( &sie->si_mutex );
 		ldap_pvt_thread_mutex_destroy( &sie->si_monitor_mutex );
 
@@ -5952,6 +6698,8 @@ config_suffixm( ConfigArgs *c, syncinfo_t *si )
 #define SUFFIXMSTR		"suffixmassage"
 #define	STRICT_REFRESH	"strictrefresh"
 #define LAZY_COMMIT		"lazycommit"
+#define APPLYTHREADSSTR		"applythreads"
+#define REFRESHBATCHSTR		"refreshbatch"
 
 /* FIXME: undocumented */
 #define EXATTRSSTR		"exattrs"
@@ -6479,6 +7227,32 @@ parse_syncrepl_line(
 					STRLENOF( LAZY_COMMIT ) ) )
 		{
 			si->si_lazyCommit = 1;
+		} else if ( !strncasecmp( c->argv[ i ], APPLYTHREADSSTR "=",
+					STRLENOF( APPLYTHREADSSTR "=" ) ) )
+		{
+			val = c->argv[ i ] + STRLENOF( APPLYTHREADSSTR "=" );
+			if ( lutil_atoi( &si->si_applythreads, val ) != 0 ||
+				si->si_applythreads < 1 || si->si_applythreads > SLAP_MAX_WORKER_THREADS )
+			{
+				snprintf( c->cr_msg, sizeof( c->cr_msg ),
+					"invalid apply threads value \"%s\".\n",
+					val );
+				Debug( LDAP_DEBUG_ANY, "%s: %s.\n", c->log, c->cr_msg );
+				return 1;
+			}
+		} else if ( !strncasecmp( c->argv[ i ], REFRESHBATCHSTR "=",
+					STRLENOF( REFRESHBATCHSTR "=" ) ) )
+		{
+			val = c->argv[ i ] + STRLENOF( REFRESHBATCHSTR "=" );
+			if ( lutil_atoi( &si->si_refreshbatch, val ) != 0 ||
+				si->si_refreshbatch < 0 )
+			{
+				snprintf( c->cr_msg, sizeof( c->cr_msg ),
+					"invalid refresh batch value \"%s\".\n",
+					val );
+				Debug( LDAP_DEBUG_ANY, "%s: %s.\n", c->log, c->cr_msg );
+				return 1;
+			}
 		} else if ( !bindconf_parse( c->argv[i], &si->si_bindconf ) ) {
 			si->si_got |= GOT_BINDCONF;
 		} else {
@@ -6988,6 +7762,7 @@ add_syncrepl(
 	si->si_manageDSAit = 0;
 	si->si_tlimit = 0;
 	si->si_slimit = 0;
+	si->si_applythreads = 1;
 
 	si->si_presentlist = NULL;
 	LDAP_LIST_INIT( &si->si_nonpresentlist );
@@ -7051,6 +7826,10 @@ add_syncrepl(
 
 			if ( !isMe ) {
 				init_syncrepl( si );
+				/* not for cn=config, whose updates may pause the pool */
+				if ( si->si_applythreads > 1 &&
+					si->si_syncdata == SYNCDATA_DEFAULT && !si->si_is_configdb )
+					si->si_apply = syncapply_new( si );
 				ldap_pvt_thread_mutex_lock( &slapd_rq.rq_mutex );
 				si->si_re = ldap_pvt_runqueue_insert( &slapd_rq,
 					si->si_interval, do_syncrepl, si, "do_syncrepl",
@@ -7294,6 +8073,18 @@ syncrepl_unparse( syncinfo_t *si, struct berval *bv )
 		ptr = lutil_strcopy( ptr, " " LAZY_COMMIT );
 	}
 
+	if ( si->si_applythreads > 1 ) {
+		len = snprintf( ptr, WHATSLEFT, " " APPLYTHREADSSTR "=%d", si->si_applythreads );
+		if ( WHATSLEFT <= len ) return;
+		ptr += len;
+	}
+
+	if ( si->si_refreshbatch ) {
+		len = snprintf( ptr, WHATSLEFT, " " REFRESHBATCHSTR "=%d", si->si_refreshbatch );
+		if ( WHATSLEFT <= len ) return;
+		ptr += len;
+	}
+
 	bc.bv_len = ptr - buf;
 	bc.bv_val = buf;
 	ber_dupbv( bv, &bc );
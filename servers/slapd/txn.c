@@ -295,6 +295,11 @@ int txn_end_extop(
 		if ( rc ) {
 			rs->sr_text = "transaction commit failed";
 			rc = LDAP_OTHER;
+		} else {
+			/* their results were sent before the commit */
+			LDAP_STAILQ_FOREACH( o, &c->c_txn_ops, o_next ) {
+				backend_group_cache_write( o );
+			}
 		}
 	} else {
 		rs->sr_text = "transaction aborted";
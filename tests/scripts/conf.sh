@@ -48,6 +48,7 @@ sed -e "s/@BACKEND@/${BACKEND}/"			\
 	-e "s/^#${AC_syncprov}#//"			\
 	-e "s/^#${AC_translucent}#//"			\
 	-e "s/^#${AC_unique}#//"			\
+	-e "s/^#${AC_sssvlv}#//"			\
 	-e "s/^#${AC_valsort}#//"			\
 	-e "s/^#${INDEXDB}#//"				\
 	-e "s/^#${MAINDB}#//"				\
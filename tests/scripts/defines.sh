@@ -42,6 +42,7 @@ RWM=${AC_rwm-rwmno}
 SYNCPROV=${AC_syncprov-syncprovno}
 TRANSLUCENT=${AC_translucent-translucentno}
 UNIQUE=${AC_unique-uniqueno}
+SSSVLV=${AC_sssvlv-sssvlvno}
 VALSORT=${AC_valsort-valsortno}
 
 # misc
@@ -105,6 +106,8 @@ R2SRCONSUMERCONF=$DATADIR/slapd-syncrepl-consumer-refresh2.conf
 P1SRCONSUMERCONF=$DATADIR/slapd-syncrepl-consumer-persist1.conf
 P2SRCONSUMERCONF=$DATADIR/slapd-syncrepl-consumer-persist2.conf
 P3SRCONSUMERCONF=$DATADIR/slapd-syncrepl-consumer-persist3.conf
+RPSRCONSUMERCONF=$DATADIR/slapd-syncrepl-consumer-parallel-refresh.conf
+PPSRCONSUMERCONF=$DATADIR/slapd-syncrepl-consumer-parallel-persist.conf
 DIRSYNC1CONF=$DATADIR/slapd-dirsync1.conf
 DSEESYNC1CONF=$DATADIR/slapd-dsee-consumer1.conf
 DSEESYNC2CONF=$DATADIR/slapd-dsee-consumer2.conf
@@ -139,6 +142,7 @@ ASYNCMETACONF=$DATADIR/slapd-asyncmeta.conf
 GLUELDAPCONF=$DATADIR/slapd-glue-ldap.conf
 ACICONF=$DATADIR/slapd-aci.conf
 VALSORTCONF=$DATADIR/slapd-valsort.conf
+SSSVLVCONF=$DATADIR/slapd-sssvlv.conf
 DYNLISTCONF=$DATADIR/slapd-dynlist.conf
 RCONSUMERCONF=$DATADIR/slapd-repl-consumer-remote.conf
 PLSRCONSUMERCONF=$DATADIR/slapd-syncrepl-consumer-persist-ldap.conf